@@ -117,6 +117,7 @@ LIB_DIRECT_SOURCES = \
 	$(DFB_SOURCE)/lib/direct/debug.c				\
 	$(DFB_SOURCE)/lib/direct/direct.c				\
 	$(DFB_SOURCE)/lib/direct/direct_result.c			\
+	$(DFB_SOURCE)/lib/direct/executor.c			\
 	$(DFB_SOURCE)/lib/direct/fastlz.c				\
 	$(DFB_SOURCE)/lib/direct/fifo.c				\
 	$(DFB_SOURCE)/lib/direct/flz.c				\
@@ -170,7 +171,8 @@ LIB_FUSION_SOURCES = \
 	$(DFB_SOURCE)/lib/fusion/reactor.c				\
 	$(DFB_SOURCE)/lib/fusion/ref.c				\
 	$(DFB_SOURCE)/lib/fusion/shmalloc.c			\
-	$(DFB_SOURCE)/lib/fusion/vector.c
+	$(DFB_SOURCE)/lib/fusion/vector.c			\
+	$(DFB_SOURCE)/lib/fusion/wire.c
 
 LIB_FUSION_SOURCES_SINGLE = \
 	$(DFB_SOURCE)/lib/fusion/shm/fake.c
@@ -260,6 +262,7 @@ DIRECTFB_SOURCES = \
 	$(DFB_SOURCE)/src/media/idirectfbvideoprovider.c		\
 	$(DFB_SOURCE)/src/media/ImageProvider.cpp			\
 	$(DFB_SOURCE)/src/media/ImageProvider_real.cpp		\
+	$(DFB_SOURCE)/src/misc/capture.c				\
 	$(DFB_SOURCE)/src/misc/conf.c				\
 	$(DFB_SOURCE)/src/misc/gfx_util.c				\
 	$(DFB_SOURCE)/src/misc/util.c				\
@@ -5071,6 +5071,81 @@ D_DEFINE_INTERFACE(   IDirectFBSurface,
           IDirectFBSurface         *thiz,
           DFBSurfaceFlushFlags      flags
      );
+
+
+   /** Buffer age **/
+
+     /*
+      * Get the age of the back buffer's content.
+      *
+      * Returns the number of frames since the content of the
+      * buffer being drawn to has been shown, e.g. 1 if it still
+      * contains the previous frame, 2 for the frame before that.
+      *
+      * Zero means that the content is undefined and everything
+      * has to be redrawn, e.g. right after creation or resizing.
+      *
+      * Applications may redraw the damage of the last <b>age</b>
+      * frames only and pass their damage via Flip() using
+      * DSFLIP_SWAP to let the window manager or layer update only
+      * the region given.
+      */
+     DFBResult (*GetBufferAge) (
+          IDirectFBSurface         *thiz,
+          unsigned int             *ret_age
+     );
+
+
+   /** Duplication **/
+
+     /*
+      * Create a copy of the surface.
+      *
+      * The new surface has the same configuration and content,
+      * but the buffers are shared until either surface is written,
+      * which makes this a lot cheaper than a Blit() into a newly
+      * created surface, e.g. for snapshots of the content.
+      *
+      * Not supported by sub surfaces.
+      */
+     DFBResult (*Duplicate) (
+          IDirectFBSurface         *thiz,
+          IDirectFBSurface        **ret_interface
+     );
+
+
+   /** Asynchronous locking **/
+
+     /*
+      * Lock the surface for the access type specified without
+      * waiting for pending operations on the buffer.
+      *
+      * Returns a data pointer and the line pitch of it like Lock(),
+      * but the data must not be accessed before the returned fence
+      * file descriptor becomes readable, e.g. via poll().
+      * If the lock has been granted already, the fence is -1.
+      *
+      * The fence belongs to the surface and is closed by the unlock.
+      */
+     DFBResult (*LockFenced) (
+          IDirectFBSurface         *thiz,
+          DFBSurfaceLockFlags       flags,
+          void                    **ret_ptr,
+          int                      *ret_pitch,
+          int                      *ret_fence
+     );
+
+     /*
+      * Unlock the surface after direct access, keeping the buffer
+      * busy for other operations until the fence becomes readable.
+      *
+      * Ownership of the fence file descriptor is passed to the
+      * surface, -1 unlocks immediately like Unlock().
+      */
+     DFBResult (*UnlockFenced) (
+          IDirectFBSurface         *thiz,
+          int                       fence
+     );
 )
 
 /**************************
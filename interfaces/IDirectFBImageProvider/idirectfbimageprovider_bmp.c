@@ -27,6 +27,7 @@
 
 #include <display/idirectfbsurface.h>
 
+#include <media/idirectfbdatabuffer.h>
 #include <media/idirectfbimageprovider.h>
 
 #include <core/coredefs.h>
@@ -106,6 +107,35 @@ fetch_data( IDirectFBDataBuffer *buffer, void *ptr, int len )
      return DFB_OK;
 }
 
+/*
+ * Points 'ret_ptr' into the buffer if possible (memory buffer or mapped file),
+ * otherwise the data is fetched into 'buf'.
+ */
+static DFBResult
+borrow_data( IDirectFBDataBuffer *buffer, void *buf, int len, const u8 **ret_ptr )
+{
+     DFBResult     ret;
+     const void   *ptr;
+     unsigned int  size;
+
+     ret = IDirectFBDataBuffer_Borrow( buffer, len, &ptr, &size );
+     if (ret == DFB_UNSUPPORTED) {
+          *ret_ptr = buf;
+
+          return fetch_data( buffer, buf, len );
+     }
+
+     if (ret)
+          return ret;
+
+     if (size < len)
+          return DFB_EOF;
+
+     *ret_ptr = ptr;
+
+     return DFB_OK;
+}
+
 static DFBResult
 bmp_decode_header( IDirectFBImageProvider_BMP_data *data )
 {
@@ -270,11 +300,12 @@ bmp_decode_rgb_row( IDirectFBImageProvider_BMP_data *data, int row )
 {
      DFBResult  ret;
      int        pitch = (((data->width*data->depth + 7) >> 3) + 3) & ~3;
-     u8         buf[pitch];
+     u8         tmp[pitch];
+     const u8  *buf;
      u32       *dst;
      int        i;
 
-     ret = fetch_data( data->base.buffer, buf, pitch );
+     ret = borrow_data( data->base.buffer, tmp, pitch, &buf );
      if (ret)
           return ret;
 
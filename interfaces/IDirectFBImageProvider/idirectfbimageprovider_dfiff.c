@@ -80,7 +80,7 @@ DIRECT_INTERFACE_IMPLEMENTATION( IDirectFBImageProvider, DFIFF )
 typedef struct {
      IDirectFBImageProvider_data base;
 
-     void                *ptr;     /* pointer to raw file data (mapped) */
+     const void          *ptr;     /* pointer to raw file data (mapped or borrowed from the buffer) */
      int                  len;     /* data length, i.e. file size */
 } IDirectFBImageProvider_DFIFF_data;
 
@@ -93,7 +93,9 @@ IDirectFBImageProvider_DFIFF_Destruct( IDirectFBImageProvider *thiz )
 {
      IDirectFBImageProvider_DFIFF_data *data = thiz->priv;
 
-     munmap( data->ptr, data->len );
+     /* Borrowed data is owned by the buffer. */
+     if (!data->base.buffer)
+          munmap( (void*) data->ptr, data->len );
 }
 
 static DFBResult
@@ -264,6 +266,8 @@ Construct( IDirectFBImageProvider *thiz,
      DFBResult                 ret;
      struct stat               stat;
      void                     *ptr;
+     const void               *borrowed;
+     unsigned int              length;
      int                       fd = -1;
      IDirectFBDataBuffer_data *buffer_data;
 
@@ -287,6 +291,30 @@ Construct( IDirectFBImageProvider *thiz,
           goto error;
      }
 
+     data->base.ref = 1;
+     data->base.core = core;
+
+     data->base.Destruct = IDirectFBImageProvider_DFIFF_Destruct;
+
+     thiz->RenderTo              = IDirectFBImageProvider_DFIFF_RenderTo;
+     thiz->GetImageDescription   = IDirectFBImageProvider_DFIFF_GetImageDescription;
+     thiz->GetSurfaceDescription = IDirectFBImageProvider_DFIFF_GetSurfaceDescription;
+
+     /* Use the data in place if the buffer is memory or a mapped file. */
+     if (buffer->GetLength( buffer, &length ) == DFB_OK && length > sizeof(DFIFFHeader) &&
+         IDirectFBDataBuffer_Borrow( buffer, length, &borrowed, &length ) == DFB_OK &&
+         length > sizeof(DFIFFHeader) && !((unsigned long) borrowed & 3))
+     {
+          buffer->AddRef( buffer );
+
+          data->base.buffer = buffer;
+
+          data->ptr = borrowed;
+          data->len = length;
+
+          return DFB_OK;
+     }
+
      /* Check for valid filename. */
      if (!buffer_data->filename) {
           ret = DFB_UNSUPPORTED;
@@ -319,18 +347,9 @@ Construct( IDirectFBImageProvider *thiz,
      /* Already close, we still have the map. */
      close( fd );
 
-     data->base.ref = 1;
-     data->base.core = core;
-
      data->ptr = ptr;
      data->len = stat.st_size;
 
-     data->base.Destruct = IDirectFBImageProvider_DFIFF_Destruct;
-
-     thiz->RenderTo              = IDirectFBImageProvider_DFIFF_RenderTo;
-     thiz->GetImageDescription   = IDirectFBImageProvider_DFIFF_GetImageDescription;
-     thiz->GetSurfaceDescription = IDirectFBImageProvider_DFIFF_GetSurfaceDescription;
-
      return DFB_OK;
 
 error:
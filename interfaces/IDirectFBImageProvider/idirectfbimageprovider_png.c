@@ -62,6 +62,7 @@
 #include <gfx/clip.h>
 #include <gfx/convert.h>
 
+#include <direct/executor.h>
 #include <direct/interface.h>
 #include <direct/mem.h>
 #include <direct/memcpy.h>
@@ -124,6 +125,20 @@ typedef struct {
 } IDirectFBImageProvider_PNG_data;
 
 
+/*
+ * Indexed and gray images are expanded to ARGB in bands of rows using the shared executor
+ */
+#define EXPAND_BAND_ROWS 32
+
+typedef struct {
+     IDirectFBImageProvider_PNG_data *data;
+     void                            *image_argb;
+     int                              bit_depth;
+} ExpandContext;
+
+static void
+expand_band( void *ctx, unsigned int index );
+
 static DFBResult
 IDirectFBImageProvider_PNG_RenderTo( IDirectFBImageProvider *thiz,
                                      IDirectFBSurface       *destination,
@@ -425,63 +440,23 @@ IDirectFBImageProvider_PNG_RenderTo( IDirectFBImageProvider *thiz,
                               }
                          }
 
-                         switch (bit_depth) {
-                              case 8:
-                                   for (y = 0; y < data->height; y++) {
-                                        u8  *S = (u8*)data->image + data->pitch * y;
-                                        u32 *D = (u32*)((u8*)image_argb  + data->width * y * 4);
-
-                                        for (x = 0; x < data->width; x++)
-                                             D[x] = data->palette[ S[x] ];
-                                   }
-                                   break;
-
-                              case 4:
-                                   for (y = 0; y < data->height; y++) {
-                                        u8  *S = (u8*)data->image + data->pitch * y;
-                                        u32 *D = (u32*)((u8*)image_argb  + data->width * y * 4);
-
-                                        for (x = 0; x < data->width; x++) {
-                                             if (x & 1)
-                                                  D[x] = data->palette[ S[x>>1] & 0xf ];
-                                             else
-                                                  D[x] = data->palette[ S[x>>1] >> 4 ];
-                                        }
-                                   }
-                                   break;
-
-                              case 2:
-                                   for (y = 0; y < data->height; y++) {
-                                        int  n = 6;
-                                        u8  *S = (u8*)data->image + data->pitch * y;
-                                        u32 *D = (u32*)((u8*)image_argb  + data->width * y * 4);
-
-                                        for (x = 0; x < data->width; x++) {
-                                             D[x] = data->palette[ (S[x>>2] >> n) & 3 ];
-
-                                             n = (n ? n - 2 : 6);
-                                        }
-                                   }
-                                   break;
-
-                              case 1:
-                                   for (y = 0; y < data->height; y++) {
-                                        int  n = 7;
-                                        u8  *S = (u8*)data->image + data->pitch * y;
-                                        u32 *D = (u32*)((u8*)image_argb  + data->width * y * 4);
-
-                                        for (x = 0; x < data->width; x++) {
-                                             D[x] = data->palette[ (S[x>>3] >> n) & 1 ];
-
-                                             n = (n ? n - 1 : 7);
-                                        }
-                                   }
-                                   break;
-
-                              default:
-                                   D_ERROR( "ImageProvider/PNG: Unsupported indexed bit depth %d!\n",
-                                            bit_depth );
+                         if (bit_depth == 8 || bit_depth == 4 || bit_depth == 2 || bit_depth == 1) {
+                              ExpandContext   expand   = { data, image_argb, bit_depth };
+                              DirectExecutor *executor = direct_executor_default();
+                              unsigned int    bands    = (data->height + EXPAND_BAND_ROWS - 1) / EXPAND_BAND_ROWS;
+                              unsigned int    band;
+
+                              /* Expand in the caller if no workers could be created. */
+                              if (executor)
+                                   direct_executor_parallel( executor, expand_band, &expand, bands, DEP_NORMAL );
+                              else {
+                                   for (band = 0; band < bands; band++)
+                                        expand_band( &expand, band );
+                              }
                          }
+                         else
+                              D_ERROR( "ImageProvider/PNG: Unsupported indexed bit depth %d!\n",
+                                       bit_depth );
 
                          dfb_scale_linear_32( image_argb, data->width, data->height,
                                               lock.addr, lock.pitch, &rect, dst_surface, &clip );
@@ -569,6 +544,75 @@ IDirectFBImageProvider_PNG_GetImageDescription( IDirectFBImageProvider *thiz,
 
 #define MAXCOLORMAPSIZE 256
 
+static void
+expand_band( void *ctx, unsigned int index )
+{
+     ExpandContext                   *expand = ctx;
+     IDirectFBImageProvider_PNG_data *data   = expand->data;
+     int                              x, y;
+     int                              y1     = index * EXPAND_BAND_ROWS;
+     int                              y2     = MIN( y1 + EXPAND_BAND_ROWS, data->height );
+
+     switch (expand->bit_depth) {
+          case 8:
+               for (y = y1; y < y2; y++) {
+                    u8  *S = (u8*)data->image + data->pitch * y;
+                    u32 *D = (u32*)((u8*)expand->image_argb + data->width * y * 4);
+
+                    for (x = 0; x < data->width; x++)
+                         D[x] = data->palette[ S[x] ];
+               }
+               break;
+
+          case 4:
+               for (y = y1; y < y2; y++) {
+                    u8  *S = (u8*)data->image + data->pitch * y;
+                    u32 *D = (u32*)((u8*)expand->image_argb + data->width * y * 4);
+
+                    for (x = 0; x < data->width; x++) {
+                         if (x & 1)
+                              D[x] = data->palette[ S[x>>1] & 0xf ];
+                         else
+                              D[x] = data->palette[ S[x>>1] >> 4 ];
+                    }
+               }
+               break;
+
+          case 2:
+               for (y = y1; y < y2; y++) {
+                    int  n = 6;
+                    u8  *S = (u8*)data->image + data->pitch * y;
+                    u32 *D = (u32*)((u8*)expand->image_argb + data->width * y * 4);
+
+                    for (x = 0; x < data->width; x++) {
+                         D[x] = data->palette[ (S[x>>2] >> n) & 3 ];
+
+                         n = (n ? n - 2 : 6);
+                    }
+               }
+               break;
+
+          case 1:
+               for (y = y1; y < y2; y++) {
+                    int  n = 7;
+                    u8  *S = (u8*)data->image + data->pitch * y;
+                    u32 *D = (u32*)((u8*)expand->image_argb + data->width * y * 4);
+
+                    for (x = 0; x < data->width; x++) {
+                         D[x] = data->palette[ (S[x>>3] >> n) & 1 ];
+
+                         n = (n ? n - 1 : 7);
+                    }
+               }
+               break;
+
+          default:
+               D_BUG( "unexpected bit depth %d", expand->bit_depth );
+     }
+}
+
+/**********************************************************************************************************************/
+
 static int SortColors (const void *a, const void *b)
 {
      return (*((const u8 *) a) - *((const u8 *) b));
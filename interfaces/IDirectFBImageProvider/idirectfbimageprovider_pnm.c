@@ -29,6 +29,7 @@
 
 #include <display/idirectfbsurface.h>
 
+#include <media/idirectfbdatabuffer.h>
 #include <media/idirectfbimageprovider.h>
 
 #include <core/coredefs.h>
@@ -136,20 +137,41 @@ struct __IDirectFBImageProvider_PNM_data {
 
 
 
+#define P_ERROR( n ) \
+{\
+     if (err == DFB_EOF)\
+          return DFB_OK;\
+     D_ERROR( "DirectFB/ImageProvider_PNM: "\
+              "couldn't get %i bytes from data buffer...\n\t-> %s\n",\
+              n, DirectFBErrorString( err ) );\
+     return err;\
+}
+
 #define P_GET( buf, n ) \
 {\
      data->base.buffer->WaitForData( data->base.buffer, n );\
      err = data->base.buffer->GetData( data->base.buffer, n, buf, &len );\
      if (err) {\
-          if (err == DFB_EOF)\
-               return DFB_OK;\
-          D_ERROR( "DirectFB/ImageProvider_PNM: "\
-                   "couldn't get %i bytes from data buffer...\n\t-> %s\n",\
-                   n, DirectFBErrorString( err ) );\
-          return err;\
+          P_ERROR( n );\
      }\
 }
 
+/* like P_GET, but points 'ptr' into the data buffer instead of copying to 'buf' if possible */
+#define P_BORROW( ptr, buf, n ) \
+{\
+     const void *borrowed;\
+     err = IDirectFBDataBuffer_Borrow( data->base.buffer, n, &borrowed, &len );\
+     if (err == DFB_UNSUPPORTED) {\
+          P_GET( buf, n );\
+          ptr = buf;\
+     }\
+     else if (err) {\
+          P_ERROR( n );\
+     }\
+     else\
+          ptr = borrowed;\
+}
+
 #define P_LOADBUF() \
 {\
      int size = data->chunksize * data->width;\
@@ -184,10 +206,10 @@ __rawpbm_getrow( IDirectFBImageProvider_PNM_data *data,
      DFBResult     err;
      unsigned int  len;
      int           i, j;
-     u8           *s    = dest;
+     const u8     *s;
      u32          *d    = (u32*) dest;
 
-     P_GET( dest, data->width / 8 );
+     P_BORROW( s, dest, data->width / 8 );
 
      /* start from end */
      for (i = (len * 8), j = 0; --i >= 0; ) {
@@ -208,14 +230,15 @@ __rawpgm_getrow( IDirectFBImageProvider_PNM_data *data,
 {
      DFBResult     err;
      unsigned int  len;
-     u8           *s   = dest;
+     int           i;
+     const u8     *s;
      u32          *d   = (u32*) dest;
 
-     P_GET( dest, data->width );
+     P_BORROW( s, dest, data->width );
 
      /* start from end */
-     while (--len >= 0)
-          d[len] = PIXEL_ARGB( s[len], s[len], s[len], s[len] );
+     for (i = len; --i >= 0;)
+          d[i] = PIXEL_ARGB( s[i], s[i], s[i], s[i] );
 
      return DFB_OK;
 }
@@ -227,10 +250,10 @@ __rawppm_getrow( IDirectFBImageProvider_PNM_data *data,
      DFBResult     err;
      unsigned int  len;
      int           i;
-     u8           *s   = dest;
+     const u8     *s;
      u32          *d   = (u32*) dest;
 
-     P_GET( dest, data->width * 3 );
+     P_BORROW( s, dest, data->width * 3 );
 
      /* start from end */
      for (i = len/3; --i >= 0;)
@@ -0,0 +1,147 @@
+/*
+   (c) Copyright 2012-2013  DirectFB integrated media GmbH
+   (c) Copyright 2001-2013  The world wide DirectFB Open Source Community (directfb.org)
+   (c) Copyright 2000-2004  Convergence (integrated media) GmbH
+
+   All rights reserved.
+
+   Written by Denis Oliver Kropp <dok@directfb.org>,
+              Andreas Shimokawa <andi@directfb.org>,
+              Marek Pikarski <mass@directfb.org>,
+              Sven Neumann <neo@directfb.org>,
+              Ville Syrjälä <syrjala@sci.fi> and
+              Claudio Ciccani <klan@users.sf.net>.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the
+   Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+   Boston, MA 02111-1307, USA.
+*/
+
+
+
+#ifndef ___Direct__Executor__H___
+#define ___Direct__Executor__H___
+
+#include <direct/Types++.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <direct/executor.h>
+
+
+#ifdef __cplusplus
+}
+
+
+#include <functional>
+
+
+namespace Direct {
+
+
+/*
+ * C++ access to a DirectExecutor, by default the one shared by all subsystems.
+ *
+ * handle() is NULL if the executor could not be created, it has no workers then.
+ */
+class Executor
+{
+public:
+     typedef std::function<void()>             Func;
+     typedef std::function<void(unsigned int)> RangeFunc;
+
+     Executor()
+          :
+          executor( direct_executor_default() ),
+          owned( false )
+     {
+     }
+
+     Executor( const char *name, unsigned int num, DirectThreadType type = DTT_DEFAULT, DirectExecutorFlags flags = DEF_NONE )
+          :
+          executor( NULL ),
+          owned( true )
+     {
+          direct_executor_create( name, num, type, flags, &executor );
+     }
+
+     ~Executor()
+     {
+          if (owned && executor)
+               direct_executor_destroy( executor );
+     }
+
+     DirectExecutor *handle() const
+     {
+          return executor;
+     }
+
+     unsigned int Workers() const
+     {
+          return executor ? direct_executor_workers( executor ) : 0;
+     }
+
+     int WorkerIndex() const
+     {
+          return executor ? direct_executor_worker_index( executor ) : -1;
+     }
+
+     DirectResult Submit( const Func &func, DirectExecutorPriority priority = DEP_NORMAL )
+     {
+          Func         *copy = new Func( func );
+          DirectResult  ret  = direct_executor_submit( executor, run, copy, priority );
+
+          if (ret)
+               delete copy;
+
+          return ret;
+     }
+
+     DirectResult Parallel( unsigned int count, const RangeFunc &func, DirectExecutorPriority priority = DEP_NORMAL )
+     {
+          return direct_executor_parallel( executor, runRange, const_cast<RangeFunc*>( &func ), count, priority );
+     }
+
+private:
+     DirectExecutor *executor;
+     bool            owned;
+
+     Executor( const Executor & );
+     Executor &operator=( const Executor & );
+
+     static void run( void *ctx )
+     {
+          Func *func = (Func*) ctx;
+
+          (*func)();
+
+          delete func;
+     }
+
+     static void runRange( void *ctx, unsigned int index )
+     {
+          (*(RangeFunc*) ctx)( index );
+     }
+};
+
+
+}
+
+
+#endif // __cplusplus
+
+#endif
+
@@ -63,6 +63,8 @@ const char   *direct_config_usage =
      "  [no-]nm-for-trace              Enable running nm in a child process to retrieve symbols\n"
      "  log-file=<name>                Write all messages to a file\n"
      "  log-udp=<host>:<port>          Send all messages via UDP to host:port\n"
+     "  [no-]log-async                 Queue messages per thread and write them from a background thread\n"
+     "  log-async-buffer=<kb>          Size of the per thread message buffer (default 64)\n"
      "  fatal-level=<level>            Abort on NONE, ASSERT (default) or ASSUME (incl. assert)\n"
      "  [no-]fatal-break               Abort on BREAK (default)\n"
      "  dont-catch=<num>[[,<num>]...]  Don't catch these signals\n"
@@ -72,8 +74,11 @@ const char   *direct_config_usage =
      "  disable-module=<module_name>   suppress loading this module\n"
      "  module-dir=<directory>         Override default module search directory (default = $libdir/directfb-x.y-z)\n"
      "  thread-priority-scale=<100th>  Apply scaling factor on thread type based priorities\n"
+     "  executor-threads=<num>         Number of workers in the shared thread pool (default one per CPU)\n"
      "  default-interface-implementation=<type/name> Probe interface_type/implementation_name first\n"
      "  perf-dump-interval=<ms>        Create thread dumping performance counters every ms milli seconds\n"
+     "  perf-shm=<name>                Export performance counters into shared memory (/dev/shm/<name>)\n"
+     "  perf-shm-interval=<ms>         Update interval of the exported performance counters (default 100)\n"
      "  log-delay-rand-loops=<loops>   Add random busy loops (of max loops) to central logging code for testing purpose\n"
      "  log-delay-rand-us=<us>         Add random sleep (of max us) to central logging code for testing purpose\n"
      "  log-delay-min-loops=<loops>    Set minimum busy loops after each log message\n"
@@ -101,6 +106,8 @@ __D_conf_init()
      direct_config->fatal_break           = true;
      direct_config->thread_block_signals  = true;
      direct_config->thread_priority_scale = 100;
+     direct_config->perf_shm_interval     = 100;
+     direct_config->log_async_buffer      = 64 * 1024;
 
      char *args = getenv( "D_ARGS" );
 
@@ -359,8 +366,11 @@ direct_config_set( const char *name, const char *value )
 
                direct_log_domain_configure( value, &config );
           }
-          else if (direct_config->log_level < DIRECT_LOG_DEBUG)
+          else if (direct_config->log_level < DIRECT_LOG_DEBUG) {
                direct_config->log_level = DIRECT_LOG_DEBUG;
+
+               direct_log_domain_invalidate();
+          }
      }
      else
           if (direct_strcmp (name, "no-debug" ) == 0) {
@@ -371,16 +381,23 @@ direct_config_set( const char *name, const char *value )
                     
                direct_log_domain_configure( value, &config );
           }
-          else if (direct_config->log_level > DIRECT_LOG_DEBUG_0)
+          else if (direct_config->log_level > DIRECT_LOG_DEBUG_0) {
                direct_config->log_level = DIRECT_LOG_DEBUG_0;
+
+               direct_log_domain_invalidate();
+          }
      }
      else
           if (direct_strcmp (name, "log-all" ) == 0) {
           direct_config->log_all = true;
+
+          direct_log_domain_invalidate();
      }
      else
           if (direct_strcmp (name, "log-none" ) == 0) {
           direct_config->log_none = true;
+
+          direct_log_domain_invalidate();
      }
      else
           if (direct_strcmp (name, "debugmem" ) == 0) {
@@ -421,6 +438,8 @@ direct_config_set( const char *name, const char *value )
 
                direct_config->log = log;
 
+               direct_log_domain_invalidate();
+
                direct_log_set_default( log );
           }
           else {
@@ -431,6 +450,31 @@ direct_config_set( const char *name, const char *value )
                return DR_INVARG;
           }
      }
+     else
+          if (direct_strcmp (name, "log-async" ) == 0) {
+          direct_config->log_async = true;
+     }
+     else
+          if (direct_strcmp (name, "no-log-async" ) == 0) {
+          direct_config->log_async = false;
+     }
+     else
+          if (direct_strcmp (name, "log-async-buffer" ) == 0) {
+          if (value) {
+               int kb;
+
+               if (direct_sscanf( value, "%d", &kb ) < 1 || kb < 4) {
+                    D_ERROR("Direct/Config '%s': Could not parse value (minimum 4)!\n", name);
+                    return DR_INVARG;
+               }
+
+               direct_config->log_async_buffer = kb * 1024;
+          }
+          else {
+               D_ERROR("Direct/Config '%s': No value specified!\n", name);
+               return DR_INVARG;
+          }
+     }
      else
           if (direct_strcmp (name, "fatal-level" ) == 0) {
           if (direct_strcasecmp (value, "none" ) == 0) {
@@ -505,6 +549,22 @@ direct_config_set( const char *name, const char *value )
           if (direct_strcmp (name, "no-thread_block_signals") == 0) {
           direct_config->thread_block_signals = false;
      } else
+     if (direct_strcmp (name, "executor-threads" ) == 0) {
+          if (value) {
+               int num;
+
+               if (direct_sscanf( value, "%d", &num ) < 1 || num < 0) {
+                    D_ERROR("Direct/Config '%s': Could not parse value!\n", name);
+                    return DR_INVARG;
+               }
+
+               direct_config->executor_threads = num;
+          }
+          else {
+               D_ERROR("Direct/Config '%s': No value specified!\n", name);
+               return DR_INVARG;
+          }
+     } else
      if (direct_strcmp (name, "thread-priority-scale" ) == 0) {
           if (value) {
                int scale;
@@ -633,6 +693,33 @@ direct_config_set( const char *name, const char *value )
                return DR_INVARG;
           }
      } else
+     if (direct_strcmp (name, "perf-shm" ) == 0) {
+          if (value) {
+               if (direct_config->perf_shm)
+                    D_FREE( direct_config->perf_shm );
+               direct_config->perf_shm = D_STRDUP( value );
+          }
+          else {
+               D_ERROR("Direct/Config '%s': No name specified!\n", name);
+               return DR_INVARG;
+          }
+     } else
+     if (direct_strcmp (name, "perf-shm-interval" ) == 0) {
+          if (value) {
+               int interval;
+
+               if (direct_sscanf( value, "%d", &interval ) < 1 || interval < 1) {
+                    D_ERROR("Direct/Config '%s': Could not parse value!\n", name);
+                    return DR_INVARG;
+               }
+
+               direct_config->perf_shm_interval = interval;
+          }
+          else {
+               D_ERROR("Direct/Config '%s': No value specified!\n", name);
+               return DR_INVARG;
+          }
+     } else
      if (direct_strcmp (name, "log-delay-rand-loops" ) == 0) {
           if (value) {
                int max;
@@ -643,6 +730,8 @@ direct_config_set( const char *name, const char *value )
                }
 
                direct_config->log_delay_rand_loops = max;
+
+               direct_log_domain_invalidate();
           }
           else {
                D_ERROR("Direct/Config '%s': No value specified!\n", name);
@@ -659,6 +748,8 @@ direct_config_set( const char *name, const char *value )
                }
 
                direct_config->log_delay_rand_us = max;
+
+               direct_log_domain_invalidate();
           }
           else {
                D_ERROR("Direct/Config '%s': No value specified!\n", name);
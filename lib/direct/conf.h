@@ -72,6 +72,8 @@ struct __D_DirectConfig {
      DirectLogLevel                log_level;
      bool                          log_all;
      bool                          log_none;
+     bool                          log_async;         /* Queue messages per thread for a writer thread. */
+     unsigned int                  log_async_buffer;  /* Bytes per thread. */
 
      bool                          trace;
 
@@ -106,6 +108,8 @@ struct __D_DirectConfig {
      char                        **default_interface_implementation_names;
 
      unsigned int                  perf_dump_interval;
+     char                         *perf_shm;
+     unsigned int                  perf_shm_interval;
      int                           log_delay_rand_loops;
      int                           log_delay_rand_us;
      int                           log_delay_min_loops;
@@ -118,6 +122,8 @@ struct __D_DirectConfig {
      int                           delay_trap_ms;
 
      bool                          sighandler_thread;
+
+     unsigned int                  executor_threads;   /* Workers of the shared executor, 0 for one per CPU */
 };
 
 extern DirectConfig DIRECT_API *direct_config;
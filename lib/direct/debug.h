@@ -125,16 +125,21 @@ void DIRECT_API direct_assumption( const char *exp,
 
 #define D_DEBUG_ENABLED  (1)
 
+/*
+ * The domain check is done here to avoid evaluating the arguments of disabled messages.
+ */
 #define D_DEBUG_LOG(_Domain,_level,...)                                              \
      do {                                                                            \
-          direct_debug_log( &_Domain, _level, __VA_ARGS__ );                         \
+          if (direct_log_domain_enabled( &_Domain, (DirectLogLevel)                  \
+                                         ((_level) > 9 ? DIRECT_LOG_DEBUG_9 :        \
+                                          DIRECT_LOG_DEBUG_0 + (_level)) ))          \
+               direct_debug_log( &_Domain, _level, __VA_ARGS__ );                    \
      } while (0)
 
-
-// TODO: OPT: check domain etc here to avoid probably expensive parameter generation
 #define D_DEBUG_AT(d,...)                                                            \
      do {                                                                            \
-          direct_debug_at( &d, __VA_ARGS__ );                                        \
+          if (direct_log_domain_enabled( &d, DIRECT_LOG_DEBUG ))                     \
+               direct_debug_at( &d, __VA_ARGS__ );                                   \
      } while (0)
 
 #define D_DEBUG_ENTER(d,...)                                                         \
@@ -167,7 +172,7 @@ void DIRECT_API direct_assumption( const char *exp,
      } while (0)
 
 #define D_DEBUG_CHECK(d)                                                             \
-     direct_log_domain_check( &d )
+     direct_log_domain_enabled( &d, DIRECT_LOG_DEBUG )
 
 #elif defined(DIRECT_MINI_DEBUG)
 
@@ -0,0 +1,597 @@
+/*
+   (c) Copyright 2012-2013  DirectFB integrated media GmbH
+   (c) Copyright 2001-2013  The world wide DirectFB Open Source Community (directfb.org)
+   (c) Copyright 2000-2004  Convergence (integrated media) GmbH
+
+   All rights reserved.
+
+   Written by Denis Oliver Kropp <dok@directfb.org>,
+              Andreas Shimokawa <andi@directfb.org>,
+              Marek Pikarski <mass@directfb.org>,
+              Sven Neumann <neo@directfb.org>,
+              Ville Syrjälä <syrjala@sci.fi> and
+              Claudio Ciccani <klan@users.sf.net>.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the
+   Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+   Boston, MA 02111-1307, USA.
+*/
+
+
+
+//#define DIRECT_ENABLE_DEBUG
+
+#include <config.h>
+
+#include <direct/atomic.h>
+#include <direct/conf.h>
+#include <direct/debug.h>
+#include <direct/executor.h>
+#include <direct/mem.h>
+#include <direct/messages.h>
+#include <direct/system.h>
+#include <direct/thread.h>
+#include <direct/util.h>
+
+D_LOG_DOMAIN( Direct_Executor, "Direct/Executor", "Direct Executor" );
+
+/**********************************************************************************************************************/
+
+typedef struct {
+     DirectExecutorFunc   func;
+     void                *ctx;
+} ExecutorTask;
+
+/*
+ * Ring buffer of tasks, the owner pushes and pops at the tail, thieves take from the head.
+ */
+typedef struct {
+     ExecutorTask        *tasks;
+     unsigned int         size;       /* Power of two */
+     unsigned int         head;
+     unsigned int         tail;
+} ExecutorDeque;
+
+typedef struct {
+     int                  magic;
+
+     DirectExecutor      *executor;
+     unsigned int         index;
+     DirectThread        *thread;
+
+     DirectMutex          lock;       /* Protects the deques, only held for a push or pop. */
+     ExecutorDeque        deques[_DEP_NUM];
+     int                  queued[_DEP_NUM];   /* Number of tasks per deque, read without lock as a hint */
+
+     unsigned long        executed;
+     unsigned long        stolen;
+} ExecutorWorker;
+
+struct __D_DirectExecutor {
+     int                  magic;
+
+     char                *name;
+     DirectExecutorFlags  flags;
+
+     unsigned int         num;
+     ExecutorWorker      *workers;
+
+     int                  pending;    /* Number of tasks submitted, but not taken yet */
+     int                  idle;       /* Number of workers waiting (or about to wait) for tasks */
+     unsigned int         next;       /* Round robin distribution of tasks from other threads */
+
+     DirectMutex          lock;
+     DirectWaitQueue      cond;
+     bool                 shutdown;
+};
+
+typedef struct {
+     DirectExecutorRangeFunc  func;
+     void                    *ctx;
+     unsigned int             count;
+
+     int                      next;
+     int                      helpers;    /* Helper tasks still referencing this structure */
+
+     DirectMutex              lock;
+     DirectWaitQueue          cond;
+} ExecutorParallel;
+
+/**********************************************************************************************************************/
+
+static DirectTLS       executor_worker;
+
+static DirectMutex     default_lock;
+static DirectExecutor *default_executor;
+
+/**********************************************************************************************************************/
+
+static DirectResult
+deque_push( ExecutorDeque      *deque,
+            const ExecutorTask *task )
+{
+     if (deque->tail - deque->head == deque->size) {
+          unsigned int  i;
+          unsigned int  size  = deque->size ? deque->size * 2 : 64;
+          ExecutorTask *tasks = D_MALLOC( size * sizeof(ExecutorTask) );
+
+          if (!tasks)
+               return D_OOM();
+
+          for (i=deque->head; i!=deque->tail; i++)
+               tasks[i & (size - 1)] = deque->tasks[i & (deque->size - 1)];
+
+          if (deque->tasks)
+               D_FREE( deque->tasks );
+
+          deque->tasks = tasks;
+          deque->size  = size;
+     }
+
+     deque->tasks[deque->tail++ & (deque->size - 1)] = *task;
+
+     return DR_OK;
+}
+
+static bool
+executor_pop( ExecutorWorker         *worker,
+              DirectExecutorPriority  priority,
+              bool                    steal,
+              ExecutorTask           *ret_task )
+{
+     ExecutorDeque *deque = &worker->deques[priority];
+     bool           found = false;
+
+     /* Nothing to take, avoid the lock. */
+     if (!*(volatile int*) &worker->queued[priority])
+          return false;
+
+     direct_mutex_lock( &worker->lock );
+
+     if (deque->head != deque->tail) {
+          if (steal)
+               *ret_task = deque->tasks[deque->head++ & (deque->size - 1)];
+          else
+               *ret_task = deque->tasks[--deque->tail & (deque->size - 1)];
+
+          worker->queued[priority]--;
+
+          found = true;
+     }
+
+     direct_mutex_unlock( &worker->lock );
+
+     return found;
+}
+
+/*
+ * Takes the next task for 'self' (may be NULL for other threads), stealing from the other workers if needed.
+ */
+static bool
+executor_take( DirectExecutor *executor,
+               ExecutorWorker *self,
+               ExecutorTask   *ret_task )
+{
+     int          priority;
+     unsigned int i;
+     unsigned int start = self ? self->index : 0;
+
+     for (priority=DEP_HIGH; priority<_DEP_NUM; priority++) {
+          if (self && executor_pop( self, priority, false, ret_task ))
+               goto out;
+
+          for (i=1; i<=executor->num; i++) {
+               ExecutorWorker *victim = &executor->workers[(start + i) % executor->num];
+
+               if (victim != self && executor_pop( victim, priority, true, ret_task )) {
+                    if (self)
+                         self->stolen++;
+
+                    goto out;
+               }
+          }
+     }
+
+     return false;
+
+out:
+     D_SYNC_ADD_AND_FETCH( &executor->pending, -1 );
+
+     return true;
+}
+
+static ExecutorWorker *
+executor_self( const DirectExecutor *executor )
+{
+     ExecutorWorker *worker = direct_tls_get( executor_worker );
+
+     if (worker && worker->executor == executor)
+          return worker;
+
+     return NULL;
+}
+
+static void *
+executor_loop( DirectThread *thread,
+               void         *arg )
+{
+     ExecutorWorker *worker   = arg;
+     DirectExecutor *executor = worker->executor;
+     ExecutorTask    task;
+
+     D_DEBUG_AT( Direct_Executor, "%s( '%s' #%u )\n", __FUNCTION__, executor->name, worker->index );
+
+     direct_tls_set( executor_worker, worker );
+
+     if (executor->flags & DEF_AFFINITY) {
+          DirectResult ret = direct_thread_set_affinity( thread, worker->index % direct_num_cpus() );
+
+          if (ret)
+               D_DERROR( ret, "Direct/Executor: Could not set affinity of '%s' worker %u!\n", executor->name, worker->index );
+     }
+
+     while (true) {
+          if (executor_take( executor, worker, &task )) {
+               task.func( task.ctx );
+
+               worker->executed++;
+               continue;
+          }
+
+          direct_mutex_lock( &executor->lock );
+
+          /* Announce waiting before checking for tasks, see direct_executor_submit(). */
+          D_SYNC_ADD_AND_FETCH( &executor->idle, 1 );
+
+          while (!*(volatile int*) &executor->pending && !executor->shutdown)
+               direct_waitqueue_wait( &executor->cond, &executor->lock );
+
+          D_SYNC_ADD_AND_FETCH( &executor->idle, -1 );
+
+          if (executor->shutdown && !*(volatile int*) &executor->pending) {
+               direct_mutex_unlock( &executor->lock );
+               break;
+          }
+
+          direct_mutex_unlock( &executor->lock );
+     }
+
+     D_DEBUG_AT( Direct_Executor, "  -> '%s' #%u done, %lu executed, %lu stolen\n",
+                 executor->name, worker->index, worker->executed, worker->stolen );
+
+     return NULL;
+}
+
+/**********************************************************************************************************************/
+
+DirectResult
+direct_executor_create( const char           *name,
+                        unsigned int          num,
+                        DirectThreadType      type,
+                        DirectExecutorFlags   flags,
+                        DirectExecutor      **ret_executor )
+{
+     DirectExecutor *executor;
+     unsigned int    i;
+
+     D_DEBUG_AT( Direct_Executor, "%s( '%s', num %u, type %d, flags 0x%04x )\n", __FUNCTION__, name, num, type, flags );
+
+     D_ASSERT( name != NULL );
+     D_ASSERT( num > 0 );
+     D_FLAGS_ASSERT( flags, DEF_ALL );
+     D_ASSERT( ret_executor != NULL );
+
+     executor = D_CALLOC( 1, sizeof(DirectExecutor) );
+     if (!executor)
+          return D_OOM();
+
+     executor->workers = D_CALLOC( num, sizeof(ExecutorWorker) );
+     if (!executor->workers) {
+          D_FREE( executor );
+          return D_OOM();
+     }
+
+     executor->name  = D_STRDUP( name );
+     executor->flags = flags;
+     executor->num   = num;
+
+     direct_mutex_init( &executor->lock );
+     direct_waitqueue_init( &executor->cond );
+
+     D_MAGIC_SET( executor, DirectExecutor );
+
+     for (i=0; i<num; i++) {
+          ExecutorWorker *worker = &executor->workers[i];
+
+          worker->executor = executor;
+          worker->index    = i;
+
+          direct_mutex_init( &worker->lock );
+
+          D_MAGIC_SET( worker, ExecutorWorker );
+     }
+
+     for (i=0; i<num; i++) {
+          char thread_name[64];
+
+          direct_snprintf( thread_name, sizeof(thread_name), num > 1 ? "%s/%u" : "%s", name, i );
+
+          executor->workers[i].thread = direct_thread_create( type, executor_loop, &executor->workers[i], thread_name );
+     }
+
+     *ret_executor = executor;
+
+     return DR_OK;
+}
+
+void
+direct_executor_destroy( DirectExecutor *executor )
+{
+     unsigned int i, n;
+
+     D_DEBUG_AT( Direct_Executor, "%s( %p '%s' )\n", __FUNCTION__, executor, executor->name );
+
+     D_MAGIC_ASSERT( executor, DirectExecutor );
+     D_ASSUME( executor_self( executor ) == NULL );
+
+     direct_mutex_lock( &executor->lock );
+
+     executor->shutdown = true;
+
+     direct_waitqueue_broadcast( &executor->cond );
+
+     direct_mutex_unlock( &executor->lock );
+
+     for (i=0; i<executor->num; i++) {
+          ExecutorWorker *worker = &executor->workers[i];
+
+          if (worker->thread) {
+               direct_thread_join( worker->thread );
+               direct_thread_destroy( worker->thread );
+          }
+
+          for (n=0; n<_DEP_NUM; n++) {
+               if (worker->deques[n].tasks)
+                    D_FREE( worker->deques[n].tasks );
+          }
+
+          direct_mutex_deinit( &worker->lock );
+
+          D_MAGIC_CLEAR( worker );
+     }
+
+     direct_waitqueue_deinit( &executor->cond );
+     direct_mutex_deinit( &executor->lock );
+
+     D_MAGIC_CLEAR( executor );
+
+     D_FREE( executor->workers );
+     D_FREE( executor->name );
+     D_FREE( executor );
+}
+
+DirectExecutor *
+direct_executor_default( void )
+{
+     direct_mutex_lock( &default_lock );
+
+     if (!default_executor) {
+          unsigned int num = direct_config->executor_threads ?: direct_num_cpus();
+
+          D_DEBUG_AT( Direct_Executor, "%s() creating with %u workers\n", __FUNCTION__, num );
+
+          direct_executor_create( "Direct/Executor", num, DTT_DEFAULT, DEF_NONE, &default_executor );
+     }
+
+     direct_mutex_unlock( &default_lock );
+
+     return default_executor;
+}
+
+unsigned int
+direct_executor_workers( const DirectExecutor *executor )
+{
+     D_MAGIC_ASSERT( executor, DirectExecutor );
+
+     return executor->num;
+}
+
+int
+direct_executor_worker_index( const DirectExecutor *executor )
+{
+     ExecutorWorker *self;
+
+     D_MAGIC_ASSERT( executor, DirectExecutor );
+
+     self = executor_self( executor );
+
+     return self ? (int) self->index : -1;
+}
+
+/**********************************************************************************************************************/
+
+DirectResult
+direct_executor_submit( DirectExecutor         *executor,
+                        DirectExecutorFunc      func,
+                        void                   *ctx,
+                        DirectExecutorPriority  priority )
+{
+     DirectResult    ret;
+     ExecutorWorker *target;
+     ExecutorTask    task = { func, ctx };
+
+     D_DEBUG_AT( Direct_Executor, "%s( %p, %p, %p, priority %d )\n", __FUNCTION__, executor, func, ctx, priority );
+
+     D_MAGIC_ASSERT( executor, DirectExecutor );
+     D_ASSERT( func != NULL );
+     D_ASSERT( priority >= DEP_HIGH && priority < _DEP_NUM );
+
+     target = executor_self( executor );
+     if (!target)
+          target = &executor->workers[D_SYNC_ADD_AND_FETCH( &executor->next, 1 ) % executor->num];
+
+     /* Count before pushing, a worker taking the task right away must not see a negative count. */
+     D_SYNC_ADD_AND_FETCH( &executor->pending, 1 );
+
+     direct_mutex_lock( &target->lock );
+
+     ret = deque_push( &target->deques[priority], &task );
+     if (ret == DR_OK)
+          target->queued[priority]++;
+
+     direct_mutex_unlock( &target->lock );
+
+     if (ret) {
+          D_SYNC_ADD_AND_FETCH( &executor->pending, -1 );
+          return ret;
+     }
+
+     /*
+      * Workers increment 'idle' before checking 'pending', so either they see the task
+      * or we see them waiting. Only then the lock is needed for the wakeup.
+      */
+     if (D_SYNC_ADD_AND_FETCH( &executor->idle, 0 )) {
+          direct_mutex_lock( &executor->lock );
+          direct_waitqueue_signal( &executor->cond );
+          direct_mutex_unlock( &executor->lock );
+     }
+
+     return DR_OK;
+}
+
+static void
+parallel_run( ExecutorParallel *parallel )
+{
+     int index;
+
+     while ((index = D_SYNC_ADD_AND_FETCH( &parallel->next, 1 ) - 1) < (int) parallel->count)
+          parallel->func( parallel->ctx, index );
+}
+
+static void
+parallel_helper( void *ctx )
+{
+     ExecutorParallel *parallel = ctx;
+
+     parallel_run( parallel );
+
+     direct_mutex_lock( &parallel->lock );
+
+     if (!--parallel->helpers)
+          direct_waitqueue_broadcast( &parallel->cond );
+
+     direct_mutex_unlock( &parallel->lock );
+}
+
+DirectResult
+direct_executor_parallel( DirectExecutor          *executor,
+                          DirectExecutorRangeFunc  func,
+                          void                    *ctx,
+                          unsigned int             count,
+                          DirectExecutorPriority   priority )
+{
+     ExecutorParallel  parallel;
+     ExecutorWorker   *self;
+     ExecutorTask      task;
+     unsigned int      i;
+     int               helpers;
+
+     D_DEBUG_AT( Direct_Executor, "%s( %p, %p, %p, count %u, priority %d )\n", __FUNCTION__, executor, func, ctx, count, priority );
+
+     D_MAGIC_ASSERT( executor, DirectExecutor );
+     D_ASSERT( func != NULL );
+
+     if (count < 2) {
+          if (count)
+               func( ctx, 0 );
+
+          return DR_OK;
+     }
+
+     helpers = MIN( count - 1, executor->num );
+
+     parallel.func    = func;
+     parallel.ctx     = ctx;
+     parallel.count   = count;
+     parallel.next    = 0;
+     parallel.helpers = helpers;
+
+     direct_mutex_init( &parallel.lock );
+     direct_waitqueue_init( &parallel.cond );
+
+     for (i=0; i<helpers; i++) {
+          if (direct_executor_submit( executor, parallel_helper, &parallel, priority )) {
+               direct_mutex_lock( &parallel.lock );
+               parallel.helpers--;
+               direct_mutex_unlock( &parallel.lock );
+          }
+     }
+
+     parallel_run( &parallel );
+
+     self = executor_self( executor );
+
+     /* Wait for the helpers, running queued tasks in the meantime, e.g. helpers not started yet. */
+     while (true) {
+          direct_mutex_lock( &parallel.lock );
+
+          if (!parallel.helpers) {
+               direct_mutex_unlock( &parallel.lock );
+               break;
+          }
+
+          direct_mutex_unlock( &parallel.lock );
+
+          if (executor_take( executor, self, &task )) {
+               task.func( task.ctx );
+               continue;
+          }
+
+          direct_mutex_lock( &parallel.lock );
+
+          if (parallel.helpers)
+               direct_waitqueue_wait_timeout( &parallel.cond, &parallel.lock, 1000 );
+
+          direct_mutex_unlock( &parallel.lock );
+     }
+
+     direct_waitqueue_deinit( &parallel.cond );
+     direct_mutex_deinit( &parallel.lock );
+
+     return DR_OK;
+}
+
+/**********************************************************************************************************************/
+
+void
+__D_executor_init()
+{
+     direct_tls_register( &executor_worker, NULL );
+
+     direct_mutex_init( &default_lock );
+}
+
+void
+__D_executor_deinit()
+{
+     if (default_executor) {
+          direct_executor_destroy( default_executor );
+
+          default_executor = NULL;
+     }
+
+     direct_mutex_deinit( &default_lock );
+
+     direct_tls_unregister( &executor_worker );
+}
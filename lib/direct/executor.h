@@ -0,0 +1,120 @@
+/*
+   (c) Copyright 2012-2013  DirectFB integrated media GmbH
+   (c) Copyright 2001-2013  The world wide DirectFB Open Source Community (directfb.org)
+   (c) Copyright 2000-2004  Convergence (integrated media) GmbH
+
+   All rights reserved.
+
+   Written by Denis Oliver Kropp <dok@directfb.org>,
+              Andreas Shimokawa <andi@directfb.org>,
+              Marek Pikarski <mass@directfb.org>,
+              Sven Neumann <neo@directfb.org>,
+              Ville Syrjälä <syrjala@sci.fi> and
+              Claudio Ciccani <klan@users.sf.net>.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the
+   Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+   Boston, MA 02111-1307, USA.
+*/
+
+
+
+#ifndef __DIRECT__EXECUTOR_H__
+#define __DIRECT__EXECUTOR_H__
+
+#include <direct/thread.h>
+
+
+/*
+ * Work stealing thread pool
+ *
+ * Each worker has a deque per priority. Tasks submitted by a worker go to the end of its own deque
+ * and are taken from there again (most recent first), other tasks are distributed round robin.
+ * Idle workers steal the oldest task from the others, higher priorities first.
+ *
+ * Subsystems should share the pool returned by direct_executor_default() instead of creating
+ * threads of their own, its size is set with the "executor-threads" option.
+ */
+
+typedef enum {
+     DEP_HIGH       = 0,
+     DEP_NORMAL     = 1,
+     DEP_LOW        = 2,
+
+     _DEP_NUM       = 3
+} DirectExecutorPriority;
+
+typedef enum {
+     DEF_NONE       = 0x00000000,
+
+     DEF_AFFINITY   = 0x00000001,  /* Run each worker on one CPU, worker n on CPU n modulo the number of CPUs. */
+
+     DEF_ALL        = 0x00000001
+} DirectExecutorFlags;
+
+typedef void (*DirectExecutorFunc)     ( void         *ctx );
+
+typedef void (*DirectExecutorRangeFunc)( void         *ctx,
+                                         unsigned int  index );
+
+/**********************************************************************************************************************/
+
+DirectResult   DIRECT_API  direct_executor_create      ( const char               *name,
+                                                         unsigned int              num,
+                                                         DirectThreadType          type,
+                                                         DirectExecutorFlags       flags,
+                                                         DirectExecutor          **ret_executor );
+
+/*
+ * Runs all queued tasks before the workers are joined.
+ */
+void           DIRECT_API  direct_executor_destroy     ( DirectExecutor           *executor );
+
+/*
+ * Returns the pool shared by all subsystems, creating it on first use.
+ */
+DirectExecutor DIRECT_API *direct_executor_default     ( void );
+
+unsigned int   DIRECT_API  direct_executor_workers     ( const DirectExecutor     *executor );
+
+/*
+ * Returns the index of the calling worker or -1 if the caller is not a worker of the executor.
+ */
+int            DIRECT_API  direct_executor_worker_index( const DirectExecutor     *executor );
+
+/**********************************************************************************************************************/
+
+DirectResult   DIRECT_API  direct_executor_submit      ( DirectExecutor           *executor,
+                                                         DirectExecutorFunc        func,
+                                                         void                     *ctx,
+                                                         DirectExecutorPriority    priority );
+
+/*
+ * Calls 'func' for each index from 0 to count - 1 on the workers and the caller, returning when all are done.
+ *
+ * The caller runs other queued tasks while waiting, so it may be used from within tasks.
+ */
+DirectResult   DIRECT_API  direct_executor_parallel    ( DirectExecutor           *executor,
+                                                         DirectExecutorRangeFunc   func,
+                                                         void                     *ctx,
+                                                         unsigned int              count,
+                                                         DirectExecutorPriority    priority );
+
+/**********************************************************************************************************************/
+
+void __D_executor_init( void );
+void __D_executor_deinit( void );
+
+#endif
+
@@ -36,92 +36,218 @@
 #include <direct/hash.h>
 #include <direct/mem.h>
 #include <direct/messages.h>
+#include <direct/util.h>
 
 
 D_LOG_DOMAIN( Direct_Hash, "Direct/Hash", "Hash table implementation" );
 
 /**********************************************************************************************************************/
 
-static const unsigned int primes[] =
+#define DIRECT_HASH_MIN_SIZE      16
+#define DIRECT_HASH_MAX_SIZE      (1 << 24)
+
+#define DIRECT_HASH_MIGRATE_STEP  16    /* Slots of the old table moved per insertion or removal while growing. */
+
+/**********************************************************************************************************************/
+
+static DirectHashElement *
+elements_alloc( const DirectHash *hash, int size )
+{
+     if (hash->disable_debugging_alloc)
+          return direct_calloc( size, sizeof(DirectHashElement) );
+
+     return D_CALLOC( size, sizeof(DirectHashElement) );
+}
+
+static void
+elements_free( const DirectHash *hash, DirectHashElement *elements )
+{
+     if (hash->disable_debugging_alloc)
+          direct_free( elements );
+     else
+          D_FREE( elements );
+}
+
+/*
+ * Distance of the entry at the slot from its home slot.
+ */
+static __inline__ unsigned int
+element_distance( const DirectHashElement *element,
+                  unsigned int             pos,
+                  unsigned int             mask )
+{
+     return (pos - direct_hash_mix( element->key )) & mask;
+}
+
+/*
+ * Returns the slot of the key or -1. Removed entries of the old table keep their key, so searching
+ * can still stop at the first entry being closer to its home slot than the key would be.
+ */
+static __inline__ int
+elements_locate( const DirectHashElement *elements,
+                 int                      size,
+                 unsigned long            key )
+{
+     unsigned int mask = size - 1;
+     unsigned int pos  = direct_hash_mix( key ) & mask;
+     unsigned int distance;
+
+     for (distance = 0; ; distance++) {
+          const DirectHashElement *element = &elements[pos];
+
+          if (!element->value)
+               return -1;
+
+          if (element->key == key) {
+               if (element->value != DIRECT_HASH_ELEMENT_REMOVED)
+                    return pos;
+          }
+          else if (element_distance( element, pos, mask ) < distance)
+               return -1;
+
+          pos = (pos + 1) & mask;
+     }
+}
+
+/*
+ * Places a key that is not in the table, taking the slot of any entry being closer to its home slot.
+ */
+static void
+elements_place( DirectHashElement *elements,
+                int                size,
+                unsigned long      key,
+                void              *value )
 {
-     11,
-     19,
-     37,
-     73,
-     109,
-     163,
-     251,
-     367,
-     557,
-     823,
-     1237,
-     1861,
-     2777,
-     4177,
-     6247,
-     9371,
-     14057,
-     21089,
-     31627,
-     47431,
-     71143,
-     106721,
-     160073,
-     240101,
-     360163,
-     540217,
-     810343,
-     1215497,
-     1823231,
-     2734867,
-     4102283,
-     6153409,
-     9230113,
-     13845163,
-};
-
-static const unsigned int nprimes = D_ARRAY_SIZE( primes );
-
-static unsigned int
-spaced_primes_closest (unsigned int num)
+     unsigned int      mask     = size - 1;
+     unsigned int      pos      = direct_hash_mix( key ) & mask;
+     unsigned int      distance = 0;
+     DirectHashElement entry    = { key, value };
+
+     while (true) {
+          DirectHashElement *element = &elements[pos];
+          unsigned int       other;
+
+          if (!element->value) {
+               *element = entry;
+               return;
+          }
+
+          other = element_distance( element, pos, mask );
+          if (other < distance) {
+               DirectHashElement temp = *element;
+
+               *element = entry;
+               entry    = temp;
+               distance = other;
+          }
+
+          pos = (pos + 1) & mask;
+
+          distance++;
+     }
+}
+
+/*
+ * Removes the entry by shifting the following ones back, leaving no tombstones.
+ */
+static void
+elements_erase( DirectHashElement *elements,
+                int                size,
+                int                pos )
 {
-     unsigned int i;
-     for (i = 0; i < nprimes; i++)
-          if (primes[i] > num)
-               return primes[i];
-     return primes[nprimes - 1];
+     unsigned int mask = size - 1;
+     unsigned int next = (pos + 1) & mask;
+
+     while (elements[next].value && element_distance( &elements[next], next, mask )) {
+          elements[pos] = elements[next];
+
+          pos  = next;
+          next = (next + 1) & mask;
+     }
+
+     elements[pos].value = NULL;
 }
 
-#define DIRECT_HASH_MIN_SIZE 11
-#define DIRECT_HASH_MAX_SIZE 13845163
+/*
+ * Returns a slot where no cluster wraps around, i.e. an empty slot or an entry at its home slot.
+ */
+static int
+elements_start( const DirectHashElement *elements,
+                int                      size )
+{
+     int i;
+
+     for (i=0; i<size; i++) {
+          if (!elements[i].value || !element_distance( &elements[i], i, size - 1 ))
+               return i;
+     }
+
+     return 0;
+}
 
 /**********************************************************************************************************************/
 
-static __inline__ int
-locate_key( const DirectHash *hash, unsigned long key )
+static void
+hash_migrate( DirectHash *hash,
+              int         slots )
 {
-     int                      pos;
-     const DirectHashElement *element;
+     D_ASSERT( hash->old_elements != NULL );
 
-     D_MAGIC_ASSERT( hash, DirectHash );
-     D_ASSERT( hash->size > 0 );
-     D_ASSERT( hash->Elements != NULL );
+     while (slots-- && hash->migrate < hash->old_size) {
+          DirectHashElement *element = &hash->old_elements[hash->migrate++];
 
-     pos = key % hash->size;
+          if (element->value && element->value != DIRECT_HASH_ELEMENT_REMOVED) {
+               elements_place( hash->Elements, hash->size, element->key, element->value );
 
-     element = &hash->Elements[pos];
+               /* Keep the key for searching the rest of the old table. */
+               element->value = DIRECT_HASH_ELEMENT_REMOVED;
 
-     while (element->value) {
-          if (element->value != DIRECT_HASH_ELEMENT_REMOVED && element->key == key)
-               return pos;
+               hash->old_count--;
+          }
+     }
 
-          if (++pos == hash->size)
-               pos = 0;
+     if (hash->migrate == hash->old_size || !hash->old_count) {
+          D_DEBUG_AT( Direct_Hash, "Finished growing to %d (count %d).\n", hash->size, hash->count );
 
-          element = &hash->Elements[pos];
+          D_ASSERT( hash->old_count == 0 );
+
+          elements_free( hash, hash->old_elements );
+
+          hash->old_elements = NULL;
+          hash->old_size     = 0;
+          hash->migrate      = 0;
+          hash->removed      = 0;
      }
+}
+
+static DirectResult
+hash_grow( DirectHash *hash )
+{
+     DirectHashElement *elements;
+     int                size = hash->size * 2;
+
+     if (size > DIRECT_HASH_MAX_SIZE)
+          return DR_LIMITEXCEEDED;
 
-     return -1;
+     /* Still moving entries of the last growth, finish it now. */
+     if (hash->old_elements)
+          hash_migrate( hash, hash->old_size );
+
+     D_DEBUG_AT( Direct_Hash, "Growing from %d to %d... (count %d)\n", hash->size, size, hash->count );
+
+     elements = elements_alloc( hash, size );
+     if (!elements)
+          return D_OOM();
+
+     hash->old_elements = hash->Elements;
+     hash->old_size     = hash->size;
+     hash->old_count    = hash->count;
+     hash->migrate      = 0;
+
+     hash->Elements     = elements;
+     hash->size         = size;
+
+     return DR_OK;
 }
 
 /**********************************************************************************************************************/
@@ -164,8 +290,14 @@ direct_hash_init( DirectHash *hash,
 
      D_DEBUG_AT( Direct_Hash, "Creating hash table with initial capacity of %d...\n", size );
 
-     hash->size     = size;
-     hash->Elements = NULL;
+     hash->size         = size;
+     hash->count        = 0;
+     hash->removed      = 0;
+     hash->Elements     = NULL;
+     hash->old_size     = 0;
+     hash->old_count    = 0;
+     hash->migrate      = 0;
+     hash->old_elements = NULL;
 
      D_MAGIC_SET( hash, DirectHash );
 }
@@ -177,11 +309,14 @@ direct_hash_deinit( DirectHash *hash )
 
      D_MAGIC_CLEAR( hash );
 
+     if (hash->old_elements) {
+          elements_free( hash, hash->old_elements );
+
+          hash->old_elements = NULL;
+     }
+
      if (hash->Elements) {
-          if (hash->disable_debugging_alloc)
-               direct_free( hash->Elements );
-          else
-               D_FREE( hash->Elements );
+          elements_free( hash, hash->Elements );
 
           hash->Elements = NULL;
      }
@@ -202,102 +337,48 @@ direct_hash_insert( DirectHash    *hash,
                     unsigned long  key,
                     void          *value )
 {
-     int                pos;
-     DirectHashElement *element;
-
      D_MAGIC_ASSERT( hash, DirectHash );
      D_ASSERT( hash->size > 0 );
      D_ASSERT( value != NULL );
 
      if (!hash->Elements) {
-          if (hash->disable_debugging_alloc)
-               hash->Elements = direct_calloc( hash->size, sizeof(DirectHashElement) );
-          else
-               hash->Elements = D_CALLOC( hash->size, sizeof(DirectHashElement) );
+          /* Static initializers may use any size. */
+          hash->size = 1 << direct_log2( hash->size );
 
+          hash->Elements = elements_alloc( hash, hash->size );
           if (!hash->Elements)
                return D_OOM();
      }
 
-     /* Need to resize the hash table? */
-     if ((hash->count + hash->removed) > hash->size / 2) {
-          int                i, size;
-          DirectHashElement *elements;
-
-          size = spaced_primes_closest( hash->size );
-          if (size > DIRECT_HASH_MAX_SIZE)
-               size = DIRECT_HASH_MAX_SIZE;
-          if (size < DIRECT_HASH_MIN_SIZE)
-               size = DIRECT_HASH_MIN_SIZE;
-
-          D_DEBUG_AT( Direct_Hash, "Resizing from %d to %d... (count %d, removed %d)\n",
-                      hash->size, size, hash->count, hash->removed );
-
-          if (hash->disable_debugging_alloc)
-               elements = direct_calloc( size, sizeof(DirectHashElement) );
-          else
-               elements = D_CALLOC( size, sizeof(DirectHashElement) );
-          if (!elements) {
-               D_WARN( "out of memory" );
-               return DR_NOLOCALMEMORY;
-          }
+     D_DEBUG_AT( Direct_Hash, "Attempting to insert key 0x%08lx...\n", key );
 
-          for (i=0; i<hash->size; i++) {
-               DirectHashElement *element = &hash->Elements[i];
-               DirectHashElement *insertElement;
-
-               if (element->value && element->value != DIRECT_HASH_ELEMENT_REMOVED) {
-                    pos = element->key % size;
-
-                    insertElement = &elements[pos];
-                    while (insertElement->value && insertElement->value != DIRECT_HASH_ELEMENT_REMOVED) {
-                        if (++pos == size)
-                            pos = 0;
-                        insertElement = &elements[pos];
-                    }
-
-                    elements[pos] = *element;
-               }
-          }
-
-          if (hash->disable_debugging_alloc)
-               direct_free( hash->Elements );
-          else
-               D_FREE( hash->Elements );
-
-          hash->size     = size;
-          hash->Elements = elements;
-          hash->removed  = 0;
+     if (elements_locate( hash->Elements, hash->size, key ) != -1 ||
+         (hash->old_elements && elements_locate( hash->old_elements, hash->old_size, key ) != -1))
+     {
+          D_BUG( "key already exists" );
+          return DR_BUG;
      }
 
-     pos = key % hash->size;
+     if (hash->old_elements)
+          hash_migrate( hash, DIRECT_HASH_MIGRATE_STEP );
 
-     D_DEBUG_AT( Direct_Hash, "Attempting to insert key 0x%08lx at position %d...\n", key, pos );
+     /* Keep the load below 3/4, counting the entries still to be moved. */
+     if ((hash->count + 1) * 4 > hash->size * 3) {
+          DirectResult ret = hash_grow( hash );
 
-     element = &hash->Elements[pos];
-
-     while (element->value && element->value != DIRECT_HASH_ELEMENT_REMOVED) {
-          if (element->key == key) {
-               D_BUG( "key already exists" );
-               return DR_BUG;
+          /* Go on without growing while there is still a free slot. */
+          if (ret && hash->count - hash->old_count + 1 >= hash->size) {
+               D_WARN( "could not grow hash table" );
+               return ret;
           }
-
-          if (++pos == hash->size)
-               pos = 0;
-
-          element = &hash->Elements[pos];
      }
 
-     if (element->value == DIRECT_HASH_ELEMENT_REMOVED)
-          hash->removed--;
-
-     element->key   = key;
-     element->value = value;
+     elements_place( hash->Elements, hash->size, key, value );
 
      hash->count++;
 
-     D_DEBUG_AT( Direct_Hash, "...inserted at %d, new count = %d, removed = %d, size = %d, key = 0x%08lx.\n",
-                 pos, hash->count, hash->removed, hash->size, key );
+     D_DEBUG_AT( Direct_Hash, "...inserted, new count = %d, size = %d, old count = %d, key = 0x%08lx.\n",
+                 hash->count, hash->size, hash->old_count, key );
 
      return DR_OK;
 }
@@ -313,16 +394,30 @@ direct_hash_remove( DirectHash    *hash,
      if (!hash->Elements)
           return DR_BUFFEREMPTY;
 
-     pos = locate_key( hash, key );
-     if (pos == -1) {
-          D_WARN( "key not found" );
-          return DR_ITEMNOTFOUND;
+     pos = elements_locate( hash->Elements, hash->size, key );
+     if (pos != -1) {
+          elements_erase( hash->Elements, hash->size, pos );
      }
+     else {
+          if (hash->old_elements)
+               pos = elements_locate( hash->old_elements, hash->old_size, key );
+
+          if (pos == -1) {
+               D_WARN( "key not found" );
+               return DR_ITEMNOTFOUND;
+          }
+
+          /* Entries are moved in slot order, shifting them back could skip one. */
+          hash->old_elements[pos].value = DIRECT_HASH_ELEMENT_REMOVED;
 
-     hash->Elements[pos].value = DIRECT_HASH_ELEMENT_REMOVED;
+          hash->old_count--;
+          hash->removed++;
+     }
 
      hash->count--;
-     hash->removed++;
+
+     if (hash->old_elements)
+          hash_migrate( hash, DIRECT_HASH_MIGRATE_STEP );
 
      D_DEBUG_AT( Direct_Hash, "Removed key 0x%08lx at %d, new count = %d, removed = %d, size = %d.\n",
                  key, pos, hash->count, hash->removed, hash->size );
@@ -343,9 +438,17 @@ direct_hash_lookup( const DirectHash *hash,
      if (!hash->Elements)
           return NULL;
 
-     pos = locate_key( hash, key );
+     pos = elements_locate( hash->Elements, hash->size, key );
+     if (pos != -1)
+          return hash->Elements[pos].value;
+
+     if (hash->old_elements) {
+          pos = elements_locate( hash->old_elements, hash->old_size, key );
+          if (pos != -1)
+               return hash->old_elements[pos].value;
+     }
 
-     return (pos != -1) ? hash->Elements[pos].value : NULL;
+     return NULL;
 }
 
 void
@@ -353,21 +456,33 @@ direct_hash_iterate( DirectHash             *hash,
                      DirectHashIteratorFunc  func,
                      void                   *ctx )
 {
-     int i;
+     int i, start;
 
      D_MAGIC_ASSERT( hash, DirectHash );
 
      if (!hash->Elements)
           return;
 
-     for (i=0; i<hash->size; i++) {
-          DirectHashElement *element = &hash->Elements[i];
+     /* Removing entries moves others while growing, finish it first as all entries are visited anyway. */
+     if (hash->old_elements)
+          hash_migrate( hash, hash->old_size );
+
+     start = elements_start( hash->Elements, hash->size );
+
+     for (i=0; i<hash->size; ) {
+          DirectHashElement *element = &hash->Elements[(start + i) & (hash->size - 1)];
+          unsigned long      key     = element->key;
 
-          if (!element->value || element->value == DIRECT_HASH_ELEMENT_REMOVED)
+          if (!element->value) {
+               i++;
                continue;
+          }
 
-          if (!func( hash, element->key, element->value, ctx ) )
+          if (!func( hash, key, element->value, ctx ) )
                return;
+
+          /* The function may have removed the entry, visit the one shifted into its slot. */
+          if (!element->value || element->key == key)
+               i++;
      }
 }
-
@@ -45,17 +45,28 @@ typedef struct {
 #define DIRECT_HASH_ELEMENT_REMOVED  ((void *) -1)
 
 
+/*
+ * Robin Hood hash with open addressing in a power of two table.
+ *
+ * Growing allocates the doubled table and moves a few slots of the old one on each insertion
+ * or removal, all remaining ones when iterating. Until then lookups check both tables.
+ */
 struct __D_DirectHash {
      int                 magic;
 
-     int                 size;
+     int                 size;          /* Power of two, rounded up on first insertion. */
 
-     int                 count;
-     int                 removed;
+     int                 count;         /* Entries in both tables. */
+     int                 removed;       /* Removed entries still occupying slots of the old table. */
 
      DirectHashElement  *Elements;
 
      bool                disable_debugging_alloc;
+
+     int                 old_size;
+     int                 old_count;
+     int                 migrate;       /* Next slot of the old table to be moved. */
+     DirectHashElement  *old_elements;
 };
 
 /**********************************************************************************************************************/
@@ -63,7 +74,7 @@ struct __D_DirectHash {
 #define DIRECT_HASH_INIT( __size, __disable_debugging_alloc )    \
      {                                                           \
           0x0b161321,                                            \
-          (__size < 17 ? 17 : __size),                           \
+          (__size < 16 ? 16 : __size),                           \
           0,                                                     \
           0,                                                     \
           NULL,                                                  \
@@ -79,12 +90,29 @@ struct __D_DirectHash {
           D_MAGIC_ASSERT( hash, DirectHash );                                                            \
           D_ASSERT( (hash)->size > 0 );                                                                  \
           D_ASSERT( (hash)->Elements != NULL || (hash)->count == 0 );                                    \
-          D_ASSERT( (hash)->Elements != NULL || (hash)->removed == 0 );                                  \
-          D_ASSERT( (hash)->count + (hash)->removed < (hash)->size );                                    \
+          D_ASSERT( (hash)->old_elements != NULL || (hash)->old_count == 0 );                            \
+          D_ASSERT( (hash)->old_count <= (hash)->count );                                                \
+          D_ASSERT( (hash)->count - (hash)->old_count < (hash)->size );                                  \
      } while (0)
 
 /**********************************************************************************************************************/
 
+/*
+ * Folds the upper bits of the key into the lower ones used for indexing. Dense keys like IDs or
+ * character codes keep distinct slots and their locality, pointer alignment and strides are spread.
+ */
+static __inline__ unsigned int
+direct_hash_mix( unsigned long key )
+{
+     unsigned long long h = key;
+
+     h ^= h >> 32;
+
+     return (unsigned int)(h ^ (h >> 4) ^ (h >> 9) ^ (h >> 16));
+}
+
+/**********************************************************************************************************************/
+
 /*
  * Hash iteration callback, return false to abort iteration.
  */
@@ -34,6 +34,7 @@
 
 #include <direct/Base.h>
 #include <direct/direct.h>
+#include <direct/executor.h>
 #include <direct/log.h>
 #include <direct/log_domain.h>
 #include <direct/init.h>
@@ -63,6 +64,8 @@ static Func init_funcs[] = {
      DirectResult__init,
      __D_mem_init,
      __D_thread_init,
+     __D_executor_init,
+     __D_log_async_init,
      __D_log_init,
      __D_log_domain_init,
      __D_perf_init,
@@ -77,6 +80,8 @@ static Func deinit_funcs[] = {
      __D_interface_deinit,
      __D_log_domain_deinit,
      __D_perf_deinit,
+     __D_log_async_deinit,
+     __D_executor_deinit,
      __D_thread_deinit,
      __D_mem_deinit,
      DirectResult__deinit,
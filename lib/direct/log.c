@@ -32,7 +32,9 @@
 
 #include <config.h>
 
+#include <direct/atomic.h>
 #include <direct/debug.h>
+#include <direct/list.h>
 #include <direct/mem.h>
 #include <direct/log.h>
 #include <direct/print.h>
@@ -49,6 +51,12 @@
 static DirectLog  fallback_log;
 static DirectLog *default_log;
 
+static DirectResult log_async_write( DirectLog  *log,
+                                     const char *buffer,
+                                     size_t      bytes );
+
+static void         log_async_flush( bool        wait );
+
 void
 __D_log_init()
 {
@@ -121,6 +129,9 @@ direct_log_destroy( DirectLog *log )
      if (log == default_log)
           default_log = NULL;
 
+     /* Queued messages may still refer to this log. */
+     log_async_flush( true );
+
      direct_log_deinit( log );
 
      direct_mutex_deinit( &log->lock );
@@ -152,9 +163,12 @@ direct_log_write( DirectLog        *log,
      if (!D_MAGIC_CHECK( log, DirectLog ))
           return DR_BUG;
 
-//     direct_mutex_lock( &log->lock );
-     ret = log->write( log, buffer, bytes );
-//     direct_mutex_unlock( &log->lock );
+     ret = log_async_write( log, buffer, bytes );
+     if (ret == DR_UNSUPPORTED) {
+//          direct_mutex_lock( &log->lock );
+          ret = log->write( log, buffer, bytes );
+//          direct_mutex_unlock( &log->lock );
+     }
 
      direct_log_debug_delay( true );
 
@@ -208,11 +222,14 @@ direct_log_printf( DirectLog  *log,
      }
 
 
-//     direct_mutex_lock( &log->lock );
+     ret = log_async_write( log, ptr, len );
+     if (ret == DR_UNSUPPORTED) {
+//          direct_mutex_lock( &log->lock );
 
-     ret = log->write( log, ptr, len );
+          ret = log->write( log, ptr, len );
 
-//     direct_mutex_unlock( &log->lock );
+//          direct_mutex_unlock( &log->lock );
+     }
 
      if (ptr != buf)
           direct_free( ptr );
@@ -284,6 +301,8 @@ direct_log_flush( DirectLog *log,
      if (!D_MAGIC_CHECK( log, DirectLog ))
           return DR_BUG;
 
+     log_async_flush( true );
+
      if (!log->flush)
           return DR_UNSUPPORTED;
 
@@ -336,3 +355,368 @@ direct_log_debug_delay( bool min )
      }
 }
 
+/**********************************************************************************************************************/
+
+/*
+ * Asynchronous logging
+ *
+ * Each thread formats its messages into a ring buffer of its own, which only that thread writes to and only
+ * the writer thread reads from, so no lock is needed on either side. Messages that don't fit are dropped and
+ * counted, the writer reports the number once it catches up. Oversized messages and those of the writer
+ * thread itself are written synchronously.
+ */
+
+#ifdef __ATOMIC_ACQUIRE
+#define LOG_LOAD_ACQUIRE( ptr )           __atomic_load_n( ptr, __ATOMIC_ACQUIRE )
+#define LOG_STORE_RELEASE( ptr, value )   __atomic_store_n( ptr, value, __ATOMIC_RELEASE )
+#else
+#define LOG_LOAD_ACQUIRE( ptr )           ({ __typeof__(*(ptr)) __v = *(volatile __typeof__(*(ptr)) *)(ptr); \
+                                             __sync_synchronize(); __v; })
+#define LOG_STORE_RELEASE( ptr, value )   do { __sync_synchronize(); \
+                                               *(volatile __typeof__(*(ptr)) *)(ptr) = (value); } while (0)
+#endif
+
+#define LOG_ALIGN( bytes )                (((bytes) + 15) & ~15)
+
+/* Writer wakes up at least this often (micro seconds). */
+#define LOG_ASYNC_INTERVAL                20000
+
+typedef struct {
+     DirectLog      *log;            /* NULL for padding up to the end of the buffer */
+     unsigned int    bytes;          /* message length, or length of padding */
+} LogEntry;
+
+typedef struct {
+     DirectLink      link;
+
+     pid_t           tid;
+     bool            orphaned;       /* set when the thread has exited */
+
+     unsigned long   head;           /* written by the thread */
+     unsigned long   tail;           /* written by the writer */
+
+     unsigned long   dropped;        /* written by the thread */
+     unsigned long   reported;       /* written by the writer */
+
+     size_t          size;           /* power of two */
+     char           *data;
+} LogRing;
+
+static DirectMutex      async_lock;
+static DirectWaitQueue  async_cond;
+static DirectTLS        async_ring;
+static DirectLink      *async_rings;
+static DirectThread    *async_thread;
+static int              async_starting;
+static bool             async_ready;
+static bool             async_sleeping;
+static bool             async_stop;
+static bool             async_disabled;
+static bool             async_busy;          /* rings or their list are being modified, under the lock */
+static unsigned long    async_dropped;
+
+static void *log_async_loop( DirectThread *thread,
+                             void         *arg );
+
+static void
+log_ring_orphan( void *arg )
+{
+     LogRing *ring = arg;
+
+     LOG_STORE_RELEASE( &ring->orphaned, true );
+}
+
+static LogRing *
+log_ring_create( void )
+{
+     LogRing *ring;
+     size_t   size = 4096;
+
+     while (size < direct_config->log_async_buffer)
+          size <<= 1;
+
+     ring = direct_calloc( 1, sizeof(LogRing) + size );
+     if (!ring)
+          return NULL;
+
+     ring->tid  = direct_gettid();
+     ring->size = size;
+     ring->data = (char*)(ring + 1);
+
+     direct_mutex_lock( &async_lock );
+     async_busy = true;
+     direct_list_append( &async_rings, &ring->link );
+     async_busy = false;
+     direct_mutex_unlock( &async_lock );
+
+     direct_tls_set( async_ring, ring );
+
+     return ring;
+}
+
+/*
+ * Writes out all complete messages of a ring, called by one thread at a time.
+ */
+static void
+log_ring_drain( LogRing *ring )
+{
+     unsigned long head    = LOG_LOAD_ACQUIRE( &ring->head );
+     unsigned long tail    = ring->tail;
+     unsigned long dropped = *(volatile unsigned long *) &ring->dropped;
+
+     while (tail != head) {
+          LogEntry *entry = (LogEntry*)(ring->data + (tail & (ring->size - 1)));
+
+          if (entry->log) {
+               entry->log->write( entry->log, (const char*)(entry + 1), entry->bytes );
+
+               tail += LOG_ALIGN( sizeof(LogEntry) + entry->bytes );
+          }
+          else
+               tail += entry->bytes;
+
+          LOG_STORE_RELEASE( &ring->tail, tail );
+     }
+
+     if (dropped != ring->reported) {
+          DirectLog *log = direct_log_default();
+          char       buf[100];
+          int        len;
+
+          len = direct_snprintf( buf, sizeof(buf), "(!) Direct/Log: %lu messages of thread %d dropped (buffer full)\n",
+                                 dropped - ring->reported, ring->tid );
+
+          log->write( log, buf, len );
+
+          ring->reported = dropped;
+     }
+}
+
+/*
+ * Drains all rings and frees those of exited threads, called with the async lock.
+ */
+static void
+log_async_drain_all( void )
+{
+     LogRing *ring, *next;
+
+     async_busy = true;
+
+     direct_list_foreach_safe (ring, next, async_rings) {
+          bool orphaned = LOG_LOAD_ACQUIRE( &ring->orphaned );
+
+          log_ring_drain( ring );
+
+          if (orphaned) {
+               direct_list_remove( &async_rings, &ring->link );
+               direct_free( ring );
+          }
+     }
+
+     async_busy = false;
+}
+
+static DirectResult
+log_async_start( void )
+{
+     DirectThread *thread;
+
+     /* Messages logged while creating the thread are written synchronously. */
+     if (!D_SYNC_BOOL_COMPARE_AND_SWAP( &async_starting, 0, 1 ))
+          return DR_BUSY;
+
+     thread = direct_thread_create( DTT_OUTPUT, log_async_loop, NULL, "Log Writer" );
+     if (!thread) {
+          async_disabled = true;
+          return DR_FAILURE;
+     }
+
+     LOG_STORE_RELEASE( &async_thread, thread );
+
+     return DR_OK;
+}
+
+static DirectResult
+log_async_write( DirectLog  *log,
+                 const char *buffer,
+                 size_t      bytes )
+{
+     LogRing       *ring;
+     LogEntry      *entry;
+     unsigned long  head, tail;
+     size_t         need   = LOG_ALIGN( sizeof(LogEntry) + bytes );
+     size_t         offset;
+     size_t         pad    = 0;
+     DirectThread  *thread = LOG_LOAD_ACQUIRE( &async_thread );
+
+     if (!direct_config->log_async || !async_ready || async_disabled)
+          return DR_UNSUPPORTED;
+
+     if (!thread) {
+          if (async_stop || log_async_start())
+               return DR_UNSUPPORTED;
+
+          thread = async_thread;
+     }
+
+     if (direct_thread_self() == thread)
+          return DR_UNSUPPORTED;
+
+     ring = direct_tls_get( async_ring );
+     if (!ring) {
+          ring = log_ring_create();
+          if (!ring)
+               return DR_UNSUPPORTED;
+     }
+
+     if (need > ring->size / 4)
+          return DR_UNSUPPORTED;
+
+     head   = ring->head;
+     tail   = LOG_LOAD_ACQUIRE( &ring->tail );
+     offset = head & (ring->size - 1);
+
+     if (offset + need > ring->size)
+          pad = ring->size - offset;
+
+     if (head + pad + need - tail > ring->size) {
+          LOG_STORE_RELEASE( &ring->dropped, ring->dropped + 1 );
+
+          D_SYNC_ADD_AND_FETCH( &async_dropped, 1 );
+     }
+     else {
+          if (pad) {
+               entry = (LogEntry*)(ring->data + offset);
+
+               entry->log   = NULL;
+               entry->bytes = pad;
+
+               head += pad;
+          }
+
+          entry = (LogEntry*)(ring->data + (head & (ring->size - 1)));
+
+          entry->log   = log;
+          entry->bytes = bytes;
+
+          memcpy( entry + 1, buffer, bytes );
+
+          LOG_STORE_RELEASE( &ring->head, head + need );
+     }
+
+     /* Wake up the writer early when the buffer fills up. */
+     if (head + need - tail > ring->size / 2 && async_sleeping)
+          direct_waitqueue_signal( &async_cond );
+
+     return DR_OK;
+}
+
+static void
+log_async_flush( bool wait )
+{
+     if (!async_rings)
+          return;
+
+     /*
+      * Never block on a lock that could be held by a crashed thread. Without the lock the writer may be
+      * draining or freeing rings concurrently, so nothing is written then. As the lock is recursive, it is
+      * also taken if this thread crashed while holding it, e.g. the writer itself in the middle of a drain.
+      */
+     if (!wait) {
+          if (direct_mutex_trylock( &async_lock ))
+               return;
+
+          if (!async_busy && direct_thread_self() != LOG_LOAD_ACQUIRE( &async_thread ))
+               log_async_drain_all();
+
+          direct_mutex_unlock( &async_lock );
+
+          return;
+     }
+
+     direct_mutex_lock( &async_lock );
+
+     log_async_drain_all();
+
+     direct_mutex_unlock( &async_lock );
+}
+
+static void *
+log_async_loop( DirectThread *thread,
+                void         *arg )
+{
+     direct_mutex_lock( &async_lock );
+
+     while (!async_stop) {
+          log_async_drain_all();
+
+          async_sleeping = true;
+
+          direct_waitqueue_wait_timeout( &async_cond, &async_lock, LOG_ASYNC_INTERVAL );
+
+          async_sleeping = false;
+     }
+
+     log_async_drain_all();
+
+     direct_mutex_unlock( &async_lock );
+
+     return NULL;
+}
+
+void
+direct_log_flush_crash( void )
+{
+     async_disabled = true;
+
+     log_async_flush( false );
+}
+
+unsigned long
+direct_log_dropped( void )
+{
+     return async_dropped;
+}
+
+void
+__D_log_async_init()
+{
+     direct_recursive_mutex_init( &async_lock );
+     direct_waitqueue_init( &async_cond );
+     direct_tls_register( &async_ring, log_ring_orphan );
+
+     async_ready = true;
+}
+
+void
+__D_log_async_deinit()
+{
+     DirectThread *thread = async_thread;
+     LogRing      *ring, *next;
+
+     async_disabled = true;
+
+     if (thread) {
+          direct_mutex_lock( &async_lock );
+          async_stop = true;
+          direct_waitqueue_broadcast( &async_cond );
+          direct_mutex_unlock( &async_lock );
+
+          direct_thread_join( thread );
+          direct_thread_destroy( thread );
+
+          async_thread = NULL;
+     }
+
+     direct_tls_unregister( &async_ring );
+
+     log_async_flush( true );
+
+     direct_list_foreach_safe (ring, next, async_rings)
+          direct_free( ring );
+
+     async_rings = NULL;
+
+     direct_waitqueue_deinit( &async_cond );
+     direct_mutex_deinit( &async_lock );
+}
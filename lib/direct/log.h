@@ -108,6 +108,18 @@ DirectResult DIRECT_API direct_log_flush      ( DirectLog        *log,
  */
 DirectLog    DIRECT_API *direct_log_default( void );
 
+/*
+ * Writes out messages still queued by the asynchronous backend ("log-async") and makes all further
+ * logging synchronous. Meant for fatal signal handlers, it doesn't wait for locks held by other threads,
+ * so queued messages are lost if the writer thread is busy or the crash happened within the backend.
+ */
+void         DIRECT_API  direct_log_flush_crash( void );
+
+/*
+ * Returns the number of messages dropped by the asynchronous backend because of full buffers.
+ */
+unsigned long DIRECT_API direct_log_dropped( void );
+
 
 #define d_printf( ... )            direct_log_printf( NULL, __VA_ARGS__ )
 
@@ -115,4 +127,7 @@ DirectLog    DIRECT_API *direct_log_default( void );
 void __D_log_init( void );
 void __D_log_deinit( void );
 
+void __D_log_async_init( void );
+void __D_log_async_deinit( void );
+
 #endif
@@ -53,15 +53,14 @@ typedef struct {
 
 /**********************************************************************************************************************/
 
+unsigned int         direct_log_domains_age = 1;
+
 static DirectMutex   domains_lock;
-static unsigned int  domains_age;
 static DirectLink   *domains;      // FIXME: use hash table like in direct/result.c
 
 void
 __D_log_domain_init()
 {
-     domains_age = 1;
-
      direct_mutex_init( &domains_lock );
 }
 
@@ -115,22 +114,15 @@ check_domain( DirectLogDomain *domain );
 static DirectLogLevel
 check_domain( DirectLogDomain *domain )
 {
-     if (direct_config->log_none)
-          return DIRECT_LOG_NONE;
-
-     if (direct_config->log_all)
-          return DIRECT_LOG_ALL;
-
-     if (domain->age != domains_age) {
+     if (domain->age != direct_log_domains_age) {
           LogDomainEntry *entry;
+          DirectLogLevel  level;
 
           if (direct_mutex_lock( &domains_lock ))
                return DIRECT_LOG_ALL;
 
           entry = lookup_domain( domain->name, true );
 
-          domain->age = domains_age;
-
           if (entry) {
                domain->registered = true;
                domain->config     = entry->config;
@@ -140,10 +132,28 @@ check_domain( DirectLogDomain *domain )
                domain->config.level = direct_config->log_level;
           }
 
+          if (direct_config->log_none)
+               level = DIRECT_LOG_NONE;
+          else if (direct_config->log_all)
+               level = DIRECT_LOG_ALL;
+          else
+               level = domain->config.level;
+
+          domain->level = level;
+
+          /*
+           * Random delays have to be applied for disabled messages as well, so keep the
+           * cache invalid to have every check go through direct_log_domain_check_level().
+           */
+          if (!direct_config->log_delay_rand_loops && !direct_config->log_delay_rand_us)
+               domain->age = direct_log_domains_age;
+
           direct_mutex_unlock( &domains_lock );
+
+          return level;
      }
 
-     return domain->config.level;
+     return domain->level;
 }
 
 /**********************************************************************************************************************/
@@ -185,12 +195,24 @@ direct_log_domain_configure( const char *name, const DirectLogDomainConfig *conf
 
      entry->config = *config;
 
-     if (! ++domains_age)
-          domains_age++;
+     if (! ++direct_log_domains_age)
+          direct_log_domains_age++;
+
+     direct_mutex_unlock( &domains_lock );
+}
+
+void
+direct_log_domain_invalidate()
+{
+     if (direct_mutex_lock( &domains_lock ))
+          return;
+
+     if (! ++direct_log_domains_age)
+          direct_log_domains_age++;
 
      direct_mutex_unlock( &domains_lock );
 }
-  
+
 bool
 direct_log_domain_check( DirectLogDomain *domain )
 {
@@ -201,7 +223,12 @@ bool
 direct_log_domain_check_level( DirectLogDomain *domain,
                                DirectLogLevel   level )
 {
-     return check_domain( domain ) >= level;
+     if (check_domain( domain ) >= level)
+          return true;
+
+     direct_log_debug_delay( false );
+
+     return false;
 }
 
 /**********************************************************************************************************************/
@@ -370,12 +397,24 @@ direct_log_domain_configure( const char                  *name,
                              const DirectLogDomainConfig *config )
 {
 }
-  
+
+void
+direct_log_domain_invalidate()
+{
+}
+
 bool
 direct_log_domain_check( DirectLogDomain *domain )
 {
      return false;
 }
 
+bool
+direct_log_domain_check_level( DirectLogDomain *domain,
+                               DirectLogLevel   level )
+{
+     return false;
+}
+
 #endif /* DIRECT_BUILD_TEXT */
 
@@ -78,17 +78,19 @@ typedef struct {
      const char              *name;
      int                      name_len;
 
-     unsigned int             age;
+     unsigned int             age;           /* 'config' and 'level' are valid while equal to direct_log_domains_age */
      bool                     registered;
 
      DirectLogDomainConfig    config;
+
+     DirectLogLevel           level;         /* effective level, including log-all and log-none */
 } DirectLogDomain;
 
 /**********************************************************************************************************************/
 
 #define D_LOG_DOMAIN( _identifier, _name, _description )                                                           \
      static DirectLogDomain _identifier D_UNUSED = {                                                               \
-            _description, _name, sizeof(_name) - 1, 0, false, {DIRECT_LOG_NONE,0}                                  \
+            _description, _name, sizeof(_name) - 1, 0, false, {DIRECT_LOG_NONE,0}, DIRECT_LOG_NONE                 \
      }
 
 /**********************************************************************************************************************/
@@ -123,21 +125,45 @@ direct_log_domain_config_level( const char     *name,
      direct_log_domain_configure( name, &config );
 }
   
-bool DIRECT_API direct_log_domain_check( DirectLogDomain *domain );   // TODO: for non-debug builds use macro for better optimisations
+bool DIRECT_API direct_log_domain_check( DirectLogDomain *domain );
 
 bool DIRECT_API direct_log_domain_check_level( DirectLogDomain *domain,
                                                DirectLogLevel   level );
 
+/*
+ * Makes all domains look up their configuration again, e.g. after changing the global log level.
+ */
+void DIRECT_API direct_log_domain_invalidate( void );
+
+
+/* Incremented on every configuration change, never zero. */
+extern unsigned int DIRECT_API direct_log_domains_age;
+
+/*
+ * Checks the level cached in the domain, only calling into the library when the configuration has changed since.
+ */
+static __inline__ bool
+direct_log_domain_enabled( DirectLogDomain *domain,
+                           DirectLogLevel   level )
+{
+     if (domain->age == direct_log_domains_age)
+          return domain->level >= level;
+
+     return direct_log_domain_check_level( domain, level );
+}
+
 /**********************************************************************************************************************/
 
 #define D_LOG( _Domain, _LEVEL, ... )                                                                                 \
      do {                                                                                                             \
-          direct_log_domain_log( &(_Domain), DIRECT_LOG_ ## _LEVEL, __FUNCTION__, __FILE__, __LINE__, __VA_ARGS__ );  \
+          if (direct_log_domain_enabled( &(_Domain), DIRECT_LOG_ ## _LEVEL ))                                         \
+               direct_log_domain_log( &(_Domain), DIRECT_LOG_ ## _LEVEL, __FUNCTION__, __FILE__, __LINE__, __VA_ARGS__ ); \
      } while (0)
 
 #define D_LOG_( _Domain, _level, ... )                                                                                \
      do {                                                                                                             \
-          direct_log_domain_log( &(_Domain), _level, __FUNCTION__, __FILE__, __LINE__, __VA_ARGS__ );                 \
+          if (direct_log_domain_enabled( &(_Domain), _level ))                                                        \
+               direct_log_domain_log( &(_Domain), _level, __FUNCTION__, __FILE__, __LINE__, __VA_ARGS__ );            \
      } while (0)
 
 
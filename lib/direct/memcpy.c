@@ -42,8 +42,15 @@
 #include <direct/mem.h>
 #include <direct/memcpy.h>
 #include <direct/messages.h>
+#include <direct/system.h>
 
-#if defined (ARCH_PPC) || defined (ARCH_ARM) || (SIZEOF_LONG == 8)
+#if (defined (ARCH_X86) || defined (ARCH_X86_64)) && \
+    (defined (__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+# define USE_X86_SIMD  1
+# include <immintrin.h>
+#endif
+
+#if defined (ARCH_PPC) || defined (ARCH_ARM) || (SIZEOF_LONG == 8) || defined (USE_X86_SIMD)
 # define RUN_BENCHMARK  1
 #else
 # define RUN_BENCHMARK  0
@@ -134,6 +141,201 @@ static void * generic64_memcpy( void * to, const void * from, size_t len )
 #endif /* SIZEOF_LONG == 8 */
 
 
+#ifdef USE_X86_SIMD
+
+#define CPU_SSE2  0x00000001
+#define CPU_AVX2  0x00000002
+
+static u32
+cpu_flags( void )
+{
+     u32 flags = 0;
+
+     __builtin_cpu_init();
+
+     if (__builtin_cpu_supports( "sse2" ))
+          flags |= CPU_SSE2;
+
+     if (__builtin_cpu_supports( "avx2" ))
+          flags |= CPU_AVX2;
+
+     return flags;
+}
+
+/*
+ * The SIMD variants copy the unaligned head and the tail with libc and move the
+ * bulk with unaligned loads and aligned stores. The non-temporal (_nt) variants
+ * use streaming stores that bypass the cache, which only pays off for copies
+ * that would evict the whole last level cache anyway.
+ */
+
+__attribute__((target("sse2")))
+static void * sse2_memcpy( void * to, const void * from, size_t len )
+{
+     u8       *d = (u8*)to;
+     const u8 *s = (const u8*)from;
+     size_t    n;
+
+     if (len >= 128) {
+          n = -(unsigned long)d & 15;
+          if (n) {
+               memcpy( d, s, n );
+               d += n; s += n; len -= n;
+          }
+
+          for (n = len >> 6, len &= 63; n; n--) {
+               __m128i a = _mm_loadu_si128( (const __m128i*) s );
+               __m128i b = _mm_loadu_si128( (const __m128i*) s + 1 );
+               __m128i c = _mm_loadu_si128( (const __m128i*) s + 2 );
+               __m128i e = _mm_loadu_si128( (const __m128i*) s + 3 );
+
+               _mm_store_si128( (__m128i*) d,     a );
+               _mm_store_si128( (__m128i*) d + 1, b );
+               _mm_store_si128( (__m128i*) d + 2, c );
+               _mm_store_si128( (__m128i*) d + 3, e );
+
+               d += 64; s += 64;
+          }
+     }
+
+     if (len)
+          memcpy( d, s, len );
+
+     return to;
+}
+
+__attribute__((target("sse2")))
+static void * sse2_nt_memcpy( void * to, const void * from, size_t len )
+{
+     u8       *d = (u8*)to;
+     const u8 *s = (const u8*)from;
+     size_t    n;
+
+     if (len >= 128) {
+          n = -(unsigned long)d & 15;
+          if (n) {
+               memcpy( d, s, n );
+               d += n; s += n; len -= n;
+          }
+
+          for (n = len >> 6, len &= 63; n; n--) {
+               __m128i a, b, c, e;
+
+               _mm_prefetch( (const char*) s + 512, _MM_HINT_NTA );
+
+               a = _mm_loadu_si128( (const __m128i*) s );
+               b = _mm_loadu_si128( (const __m128i*) s + 1 );
+               c = _mm_loadu_si128( (const __m128i*) s + 2 );
+               e = _mm_loadu_si128( (const __m128i*) s + 3 );
+
+               _mm_stream_si128( (__m128i*) d,     a );
+               _mm_stream_si128( (__m128i*) d + 1, b );
+               _mm_stream_si128( (__m128i*) d + 2, c );
+               _mm_stream_si128( (__m128i*) d + 3, e );
+
+               d += 64; s += 64;
+          }
+
+          _mm_sfence();
+     }
+
+     if (len)
+          memcpy( d, s, len );
+
+     return to;
+}
+
+__attribute__((target("avx2")))
+static void * avx2_memcpy( void * to, const void * from, size_t len )
+{
+     u8       *d = (u8*)to;
+     const u8 *s = (const u8*)from;
+     size_t    n;
+
+     if (len >= 256) {
+          n = -(unsigned long)d & 31;
+          if (n) {
+               memcpy( d, s, n );
+               d += n; s += n; len -= n;
+          }
+
+          for (n = len >> 7, len &= 127; n; n--) {
+               __m256i a = _mm256_loadu_si256( (const __m256i*) s );
+               __m256i b = _mm256_loadu_si256( (const __m256i*) s + 1 );
+               __m256i c = _mm256_loadu_si256( (const __m256i*) s + 2 );
+               __m256i e = _mm256_loadu_si256( (const __m256i*) s + 3 );
+
+               _mm256_store_si256( (__m256i*) d,     a );
+               _mm256_store_si256( (__m256i*) d + 1, b );
+               _mm256_store_si256( (__m256i*) d + 2, c );
+               _mm256_store_si256( (__m256i*) d + 3, e );
+
+               d += 128; s += 128;
+          }
+
+          _mm256_zeroupper();
+     }
+
+     if (len)
+          memcpy( d, s, len );
+
+     return to;
+}
+
+__attribute__((target("avx2")))
+static void * avx2_nt_memcpy( void * to, const void * from, size_t len )
+{
+     u8       *d = (u8*)to;
+     const u8 *s = (const u8*)from;
+     size_t    n;
+
+     if (len >= 256) {
+          n = -(unsigned long)d & 31;
+          if (n) {
+               memcpy( d, s, n );
+               d += n; s += n; len -= n;
+          }
+
+          for (n = len >> 7, len &= 127; n; n--) {
+               __m256i a, b, c, e;
+
+               _mm_prefetch( (const char*) s + 512, _MM_HINT_NTA );
+               _mm_prefetch( (const char*) s + 576, _MM_HINT_NTA );
+
+               a = _mm256_loadu_si256( (const __m256i*) s );
+               b = _mm256_loadu_si256( (const __m256i*) s + 1 );
+               c = _mm256_loadu_si256( (const __m256i*) s + 2 );
+               e = _mm256_loadu_si256( (const __m256i*) s + 3 );
+
+               _mm256_stream_si256( (__m256i*) d,     a );
+               _mm256_stream_si256( (__m256i*) d + 1, b );
+               _mm256_stream_si256( (__m256i*) d + 2, c );
+               _mm256_stream_si256( (__m256i*) d + 3, e );
+
+               d += 128; s += 128;
+          }
+
+          _mm_sfence();
+          _mm256_zeroupper();
+     }
+
+     if (len)
+          memcpy( d, s, len );
+
+     return to;
+}
+
+#else
+
+static u32
+cpu_flags( void )
+{
+     return 0;
+}
+
+#endif /* USE_X86_SIMD */
+
+
 typedef void* (*memcpy_func)(void *to, const void *from, size_t len);
 
 
@@ -144,36 +346,121 @@ std_memcpy( void *to, const void *from, size_t len )
 }
 
 
+/*
+ * Size classes for dispatching, each benchmarked with copies of several sizes.
+ *
+ * Copies below MEMCPY_SMALL always use libc, the call overhead of a variant is not worth it.
+ * The limit of the "large" class is the size of the last level cache, copies above it are
+ * where the non-temporal variants are expected to win.
+ */
+#define MEMCPY_SMALL       256
+#define MEMCPY_CLASSES     3
+#define MEMCPY_SIZES       3
+
+static struct {
+     const char           *name;
+     size_t                limit;
+     size_t                bench[MEMCPY_SIZES];
+} memcpy_class[MEMCPY_CLASSES] = {
+     { "medium", 32768,   { 512, 4096, 16384 } },
+     { "large",  0,       { 65536, 131072, 262144 } },
+     { "huge",   ~0,      { 0, 0, 0 } }
+};
+
 static struct {
      char                 *name;
      char                 *desc;
      memcpy_func           function;
-     unsigned long long    time;
+     unsigned long long    time[MEMCPY_CLASSES];
      u32                   cpu_require;
+     bool                  non_temporal;  /* only benchmarked for copies beyond the cache */
 } memcpy_method[] =
 {
-     { NULL, NULL, NULL, 0, 0},
-     { "libc",     "libc memcpy()",             std_memcpy, 0, 0},
+     { NULL, NULL, NULL, {0}, 0, false},
+     { "libc",     "libc memcpy()",             std_memcpy, {0}, 0, false},
 #if SIZEOF_LONG == 8
-     { "generic64","Generic 64bit memcpy()",    generic64_memcpy, 0, 0},
+     { "generic64","Generic 64bit memcpy()",    generic64_memcpy, {0}, 0, false},
 #endif /* SIZEOF_LONG == 8 */
+#ifdef USE_X86_SIMD
+     { "sse2",     "SSE2 memcpy()",             sse2_memcpy, {0}, CPU_SSE2, false},
+     { "sse2nt",   "SSE2 non-temporal memcpy()", sse2_nt_memcpy, {0}, CPU_SSE2, true},
+     { "avx2",     "AVX2 memcpy()",             avx2_memcpy, {0}, CPU_AVX2, false},
+     { "avx2nt",   "AVX2 non-temporal memcpy()", avx2_nt_memcpy, {0}, CPU_AVX2, true},
+#endif /* USE_X86_SIMD */
 #ifdef USE_PPCASM
-     { "ppc",      "ppcasm_memcpy()",            direct_ppcasm_memcpy, 0, 0},
+     { "ppc",      "ppcasm_memcpy()",            direct_ppcasm_memcpy, {0}, 0, false},
 #ifdef __LINUX__
-     { "ppccache", "ppcasm_cacheable_memcpy()",  direct_ppcasm_cacheable_memcpy, 0, 0},
+     { "ppccache", "ppcasm_cacheable_memcpy()",  direct_ppcasm_cacheable_memcpy, {0}, 0, false},
 #endif /* __LINUX__ */
 #endif /* USE_PPCASM */
 #if defined(USE_ARMASM) && !defined(WORDS_BIGENDIAN)
-     { "arm",      "armasm_memcpy()",            direct_armasm_memcpy, 0, 0},
+     { "arm",      "armasm_memcpy()",            direct_armasm_memcpy, {0}, 0, false},
 #endif
-     { NULL, NULL, NULL, 0, 0}
+     { NULL, NULL, NULL, {0}, 0, false}
 };
 
 
 
 memcpy_func direct_memcpy = std_memcpy;
 
-#define BUFSIZE 1024
+#if RUN_BENCHMARK
+
+#define BUFSIZE        (1024 * 500)
+#define BENCH_VOLUME   (1024 * 1024)
+
+/* Best of this many runs per size, fewer beyond the cache as those dominate the startup time. */
+#define BENCH_RUNS        5
+#define BENCH_RUNS_HUGE   3
+
+/* Percentage a variant must be faster than libc by to be used instead. */
+#define BENCH_MARGIN      10
+
+/*
+ * Consecutive size classes using the same method are merged into one range.
+ */
+static struct {
+     size_t                limit;
+     int                   method;
+} memcpy_range[MEMCPY_CLASSES];
+
+static void *
+dispatch_memcpy( void *to, const void *from, size_t len )
+{
+     int i = 0;
+
+     if (len < MEMCPY_SMALL)
+          return memcpy( to, from, len );
+
+     while (len >= memcpy_range[i].limit)
+          i++;
+
+     return memcpy_method[memcpy_range[i].method].function( to, from, len );
+}
+
+static unsigned long long
+bench_memcpy( memcpy_func function, u8 *dst, const u8 *src, size_t bufsize, size_t size )
+{
+     unsigned long long t;
+     size_t             offset = 0;
+     size_t             count  = BENCH_VOLUME / size;
+
+     if (!count)
+          count = 1;
+
+     t = direct_clock_get_time( DIRECT_CLOCK_MONOTONIC );
+
+     for (; count; count--) {
+          function( dst + offset, src + offset, size );
+
+          offset += size;
+          if (offset + size > bufsize)
+               offset = 0;
+     }
+
+     return direct_clock_get_time( DIRECT_CLOCK_MONOTONIC ) - t;
+}
+
+#endif /* RUN_BENCHMARK */
 
 void
 direct_find_best_memcpy( void )
@@ -182,9 +469,14 @@ direct_find_best_memcpy( void )
         on platforms without a special memcpy() implementation. */
 #if RUN_BENCHMARK
      unsigned long long t;
-     char *buf1, *buf2;
-     int i, j, best = 0;
-     u32 config_flags = 0;
+     u8 *buf1, *buf2;
+     int i, c, k, n, classes = MEMCPY_CLASSES;
+     int best[MEMCPY_CLASSES];
+     u32 config_flags = cpu_flags();
+     size_t cache = direct_cache_size();
+     size_t huge;
+     char info[256];
+     int len;
 
      if (direct_config->memcpy) {
           for (i=1; memcpy_method[i].name; i++) {
@@ -201,46 +493,150 @@ direct_find_best_memcpy( void )
           }
      }
 
-     if (!(buf1 = D_MALLOC( BUFSIZE * 500 )))
-          return;
+     /*
+      * Copies above the last level cache are benchmarked with up to twice its size. That is limited
+      * to 8 MB, as touching and copying the buffers dominates the startup time otherwise. If the cache
+      * is not smaller than that, the copies would stay in the cache and the "huge" class is skipped.
+      */
+     if (!cache)
+          cache = 8 * 1024 * 1024;
 
-     if (!(buf2 = D_MALLOC( BUFSIZE * 500 ))) {
+     huge = cache * 2;
+     if (huge < BUFSIZE)
+          huge = BUFSIZE;
+     else if (huge > 8 * 1024 * 1024)
+          huge = 8 * 1024 * 1024;
+
+     memcpy_class[MEMCPY_CLASSES-2].limit = cache;
+
+     for (k=0; k<MEMCPY_SIZES; k++)
+          memcpy_class[MEMCPY_CLASSES-1].bench[k] = cache + (huge - cache) * (k + 1) / MEMCPY_SIZES;
+
+     if (huge <= cache)
+          classes--;
+     else if (!(buf1 = D_MALLOC( huge )))
+          classes--;
+     else if (!(buf2 = D_MALLOC( huge ))) {
           D_FREE( buf1 );
-          return;
+          classes--;
+     }
+
+     if (classes < MEMCPY_CLASSES) {
+          huge = BUFSIZE;
+
+          if (!(buf1 = D_MALLOC( BUFSIZE )))
+               return;
+
+          if (!(buf2 = D_MALLOC( BUFSIZE ))) {
+               D_FREE( buf1 );
+               return;
+          }
      }
 
      D_DEBUG_AT( Direct_Memcpy, "Benchmarking memcpy methods (smaller is better):\n");
 
+     for (c=0, len=0; c<classes; c++)
+          len += snprintf( info + len, sizeof(info) - len, "  %10s", memcpy_class[c].name );
+     D_DEBUG_AT( Direct_Memcpy, "\t%-10s%s\n", "", info );
+
+     for (c=0, len=0; c<classes; c++)
+          len += snprintf( info + len, sizeof(info) - len, "  %10zu", memcpy_class[c].bench[MEMCPY_SIZES-1] );
+     D_DEBUG_AT( Direct_Memcpy, "\t%-10s%s\n", "", info );
+
      /* make sure buffers are present on physical memory */
-     memcpy( buf1, buf2, BUFSIZE * 500 );
-     memcpy( buf2, buf1, BUFSIZE * 500 );
+     memset( buf1, 0, huge );
+     memcpy( buf2, buf1, huge );
 
      for (i=1; memcpy_method[i].name; i++) {
           if (memcpy_method[i].cpu_require & ~config_flags)
                continue;
 
-          t = direct_clock_get_time( DIRECT_CLOCK_MONOTONIC );
+          for (c=0, len=0; c<classes; c++) {
+               bool beyond_cache = (c == MEMCPY_CLASSES-1);
 
-          for (j=0; j<500; j++)
-               memcpy_method[i].function( buf1 + j*BUFSIZE, buf2 + j*BUFSIZE, BUFSIZE );
+               if (memcpy_method[i].non_temporal && !beyond_cache) {
+                    len += snprintf( info + len, sizeof(info) - len, "  %10s", "-" );
+                    continue;
+               }
 
-          t = direct_clock_get_time( DIRECT_CLOCK_MONOTONIC ) - t;
-          memcpy_method[i].time = t;
+               /* sum of the best runs of each size */
+               memcpy_method[i].time[c] = 0;
 
-          D_DEBUG_AT( Direct_Memcpy, "\t%-10s  %20lld\n", memcpy_method[i].name, t );
+               for (k=0; k<MEMCPY_SIZES; k++) {
+                    unsigned long long min = 0;
 
-          if (best == 0 || t < memcpy_method[best].time)
-               best = i;
-     }
+                    for (n=0; n<(beyond_cache ? BENCH_RUNS_HUGE : BENCH_RUNS); n++) {
+                         t = bench_memcpy( memcpy_method[i].function, buf1, buf2,
+                                           beyond_cache ? huge : BUFSIZE, memcpy_class[c].bench[k] );
 
-     if (best) {
-          direct_memcpy = memcpy_method[best].function;
+                         if (!n || t < min)
+                              min = t;
+                    }
+
+                    memcpy_method[i].time[c] += min;
+               }
 
-          D_INFO( "Direct/Memcpy: Using %s\n", memcpy_method[best].desc );
+               len += snprintf( info + len, sizeof(info) - len, "  %10lld", memcpy_method[i].time[c] );
+          }
+
+          D_DEBUG_AT( Direct_Memcpy, "\t%-10s%s\n", memcpy_method[i].name, info );
      }
 
      D_FREE( buf1 );
      D_FREE( buf2 );
+
+     /* Keep libc unless the fastest variant beats it by the margin. */
+     for (c=0; c<classes; c++) {
+          int fastest = 0;
+
+          for (i=2; memcpy_method[i].name; i++) {
+               if (memcpy_method[i].cpu_require & ~config_flags)
+                    continue;
+
+               if (memcpy_method[i].non_temporal && c < MEMCPY_CLASSES-1)
+                    continue;
+
+               if (!fastest || memcpy_method[i].time[c] < memcpy_method[fastest].time[c])
+                    fastest = i;
+          }
+
+          if (fastest && memcpy_method[fastest].time[c] * 100 < memcpy_method[1].time[c] * (100 - BENCH_MARGIN))
+               best[c] = fastest;
+          else
+               best[c] = 1;
+     }
+
+     for (c=0, n=0; c<classes; c++) {
+          if (n && memcpy_range[n-1].method == best[c])
+               memcpy_range[n-1].limit = memcpy_class[c].limit;
+          else {
+               memcpy_range[n].limit  = memcpy_class[c].limit;
+               memcpy_range[n].method = best[c];
+               n++;
+          }
+     }
+
+     memcpy_range[n-1].limit = ~0;
+
+     if (n == 1 && memcpy_range[0].method == 1) {
+          D_INFO( "Direct/Memcpy: Using %s\n", memcpy_method[1].desc );
+          return;
+     }
+
+     len = snprintf( info, sizeof(info), "%s", memcpy_method[1].desc );
+
+     for (i=0; i<n; i++) {
+          D_DEBUG_AT( Direct_Memcpy, "  -> %-10s from %10zu bytes\n",
+                      memcpy_method[memcpy_range[i].method].name, i ? memcpy_range[i-1].limit : MEMCPY_SMALL );
+
+          if ((i || memcpy_range[0].method != 1) && len < (int) sizeof(info))
+               len += snprintf( info + len, sizeof(info) - len, ", %s from %zu bytes",
+                                memcpy_method[memcpy_range[i].method].desc, i ? memcpy_range[i-1].limit : MEMCPY_SMALL );
+     }
+
+     direct_memcpy = dispatch_memcpy;
+
+     D_INFO( "Direct/Memcpy: Using %s\n", info );
 #endif
 }
 
@@ -248,7 +644,7 @@ void
 direct_print_memcpy_routines( void )
 {
      int i;
-     u32 config_flags = 0;
+     u32 config_flags = cpu_flags();
 
      direct_log_printf( NULL, "\nPossible values for memcpy option are:\n\n" );
 
@@ -42,6 +42,7 @@
 
 #include <direct/atomic.h>
 #include <direct/debug.h>
+#include <direct/log.h>
 #include <direct/signals.h>
 #include <direct/system.h>
 #include <direct/util.h>
@@ -71,6 +72,30 @@ direct_page_align( unsigned long value )
      return (value + mask) & ~mask;
 }
 
+unsigned int
+direct_num_cpus( void )
+{
+     long num = sysconf( _SC_NPROCESSORS_ONLN );
+
+     return num > 0 ? num : 1;
+}
+
+size_t
+direct_cache_size( void )
+{
+     long size = 0;
+
+#ifdef _SC_LEVEL3_CACHE_SIZE
+     size = sysconf( _SC_LEVEL3_CACHE_SIZE );
+#endif
+#ifdef _SC_LEVEL2_CACHE_SIZE
+     if (size <= 0)
+          size = sysconf( _SC_LEVEL2_CACHE_SIZE );
+#endif
+
+     return size > 0 ? size : 0;
+}
+
 /**********************************************************************************************************************/
 
 pid_t
@@ -119,6 +144,8 @@ direct_trap( const char *domain, int sig )
           return;
      }
 
+     direct_log_flush_crash();
+
      D_LOG( Direct_Trap, VERBOSE, "Raising signal %d from %s...\n", sig, domain );
 
      val.sival_int = direct_gettid();
@@ -234,6 +261,15 @@ direct_futex( int *uaddr, int op, int val, const struct timespec *timeout, int *
                D_DEBUG_AT( Direct_Futex, "###   WAKE UP =--> %p <--= %d (->%d) ### ### ### * %u\n", uaddr, *uaddr, val, count );
                break;
 
+          case FUTEX_LOCK_PI:
+          case FUTEX_TRYLOCK_PI:
+               D_DEBUG_AT( Direct_Futex, "## ## LOCK PI  --> %p <--  %d ## ## ## ## ##\n", uaddr, *uaddr );
+               break;
+
+          case FUTEX_UNLOCK_PI:
+               D_DEBUG_AT( Direct_Futex, "###   UNLOCK PI =--> %p <--= %d ### ### ###\n", uaddr, *uaddr );
+               break;
+
           default:
                D_DEBUG_AT( Direct_Futex, "# #  UNKNOWN FUTEX OP  # #\n" );
      }
@@ -379,6 +379,32 @@ direct_thread_sleep( long long micros )
      usleep( micros );
 }
 
+DirectResult
+direct_thread_set_affinity( DirectThread *thread,
+                            unsigned int  cpu )
+{
+#ifdef CPU_SET
+     int       err;
+     cpu_set_t set;
+
+     D_MAGIC_ASSERT( thread, DirectThread );
+     D_ASSERT( thread->handle.thread != -1 );
+
+     D_DEBUG_AT( Direct_Thread, "%s( %p, '%s' %d, cpu %u )\n", __FUNCTION__, thread->main, thread->name, thread->tid, cpu );
+
+     CPU_ZERO( &set );
+     CPU_SET( cpu, &set );
+
+     err = pthread_setaffinity_np( thread->handle.thread, sizeof(set), &set );
+     if (err)
+          return errno2result( err );
+
+     return DR_OK;
+#else
+     return DR_UNSUPPORTED;
+#endif
+}
+
 /**********************************************************************************************************************/
 /**********************************************************************************************************************/
 
@@ -65,6 +65,18 @@ direct_page_align( unsigned long value )
      return (value + mask) & ~mask;
 }
 
+unsigned int
+direct_num_cpus( void )
+{
+     return 1;
+}
+
+size_t
+direct_cache_size( void )
+{
+     return 0;
+}
+
 /**********************************************************************************************************************/
 
 pid_t
@@ -351,6 +351,13 @@ direct_thread_sleep( long long micros )
      sceKernelDelayThread( micros );
 }
 
+DirectResult
+direct_thread_set_affinity( DirectThread *thread,
+                            unsigned int  cpu )
+{
+     return DR_UNSUPPORTED;
+}
+
 /**********************************************************************************************************************/
 /**********************************************************************************************************************/
 
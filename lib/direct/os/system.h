@@ -45,6 +45,16 @@ long          DIRECT_API  direct_pagesize( void );
 
 unsigned long DIRECT_API  direct_page_align( unsigned long value );
 
+/*
+ * Returns the number of online CPUs.
+ */
+unsigned int  DIRECT_API  direct_num_cpus( void );
+
+/*
+ * Returns the size of the last level CPU cache in bytes, or zero if unknown.
+ */
+size_t        DIRECT_API  direct_cache_size( void );
+
 pid_t         DIRECT_API  direct_getpid( void );
 pid_t         DIRECT_API  direct_gettid( void );
 
@@ -76,6 +86,13 @@ DirectResult  DIRECT_API  direct_futex( int *uaddr, int op, int val, const struc
 
 #define FUTEX_WAIT              0
 #define FUTEX_WAKE              1
+#define FUTEX_LOCK_PI           6
+#define FUTEX_UNLOCK_PI         7
+#define FUTEX_TRYLOCK_PI        8
+
+#define FUTEX_WAITERS           0x80000000
+#define FUTEX_OWNER_DIED        0x40000000
+#define FUTEX_TID_MASK          0x3fffffff
 
 
 #endif
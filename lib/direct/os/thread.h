@@ -84,5 +84,11 @@ void         DIRECT_API   direct_thread_kill       ( DirectThread *thread,
 
 void         DIRECT_API   direct_thread_sleep      ( long long     micros );
 
+/*
+ * Restrict a thread to run on the given CPU only.
+ */
+DirectResult DIRECT_API   direct_thread_set_affinity( DirectThread *thread,
+                                                      unsigned int  cpu );
+
 #endif
 
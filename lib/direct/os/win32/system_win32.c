@@ -63,6 +63,22 @@ direct_page_align( unsigned long value )
      return (value + mask) & ~mask;
 }
 
+unsigned int
+direct_num_cpus( void )
+{
+     SYSTEM_INFO info;
+
+     GetSystemInfo( &info );
+
+     return info.dwNumberOfProcessors;
+}
+
+size_t
+direct_cache_size( void )
+{
+     return 0;
+}
+
 /**********************************************************************************************************************/
 
 pid_t
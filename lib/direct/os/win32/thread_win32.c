@@ -181,3 +181,10 @@ direct_thread_sleep( long long micros )
 {
      Sleep( (DWORD)(micros / 1000) );
 }
+
+DirectResult
+direct_thread_set_affinity( DirectThread *thread,
+                            unsigned int  cpu )
+{
+     return DR_UNSUPPORTED;
+}
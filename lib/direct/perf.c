@@ -31,137 +31,325 @@
 
 #include <config.h>
 
+#include <fcntl.h>
+#include <string.h>
+
+#include <direct/conf.h>
 #include <direct/clock.h>
 #include <direct/debug.h>
-#include <direct/hash.h>
+#include <direct/filesystem.h>
+#include <direct/list.h>
 #include <direct/mem.h>
 #include <direct/messages.h>
 #include <direct/perf.h>
+#include <direct/system.h>
+#include <direct/thread.h>
+#include <direct/util.h>
+
 
+D_LOG_DOMAIN( Direct_Perf, "Direct/Perf", "Direct Performance Counters" );
 
+/*
+ * Each slot is only written by its thread, so a relaxed load and store is enough for
+ * the increment, while readers summing up the slots just need untorn values.
+ */
+#ifdef __ATOMIC_RELAXED
+#define PERF_LOAD( ptr )          __atomic_load_n( ptr, __ATOMIC_RELAXED )
+#define PERF_STORE( ptr, value )  __atomic_store_n( ptr, value, __ATOMIC_RELAXED )
+#define PERF_FENCE()              __atomic_thread_fence( __ATOMIC_SEQ_CST )
+#else
+#define PERF_LOAD( ptr )          (*(volatile __typeof__(*(ptr)) *)(ptr))
+#define PERF_STORE( ptr, value )  (*(volatile __typeof__(*(ptr)) *)(ptr) = (value))
+#define PERF_FENCE()              __sync_synchronize()
+#endif
+
+typedef struct {
+     DirectLink     link;
+
+     long           counts[DIRECT_PERF_MAX_COUNTERS];
+} PerfSlot;
 
 static void *
 direct_perf_dump_thread( DirectThread *thread,
                          void         *arg );
 
+static void *
+direct_perf_export_thread( DirectThread *thread,
+                           void         *arg );
+
+static void
+perf_slot_destroy( void *arg );
+
 /**********************************************************************************************************************/
 
-static DirectHash     counter_hash;
-static DirectMutex    counter_lock;
-static unsigned long  counter_ids;
-static DirectThread  *counter_dump_thread;
+static DirectPerfCounter  counters[DIRECT_PERF_MAX_COUNTERS];
+static unsigned long      counter_ids;
+static DirectMutex        counter_lock;
+static bool               counter_shutdown;
+static DirectThread      *counter_dump_thread;
+
+static DirectTLS          counter_slot;
+static DirectLink        *counter_slots;
+static long               counter_retired[DIRECT_PERF_MAX_COUNTERS];
+
+static DirectThread      *export_thread;
+static DirectFile         export_file;
+static DirectPerfShm     *export_shm;
 
 /**********************************************************************************************************************/
 
+static DirectResult
+perf_export_open( const char *name )
+{
+     DirectResult  ret;
+     char          path[256];
+     size_t        written;
+     void         *map;
+     DirectPerfShm shm;
+
+     if (name[0] == '/')
+          direct_snputs( path, name, sizeof(path) );
+     else
+          direct_snprintf( path, sizeof(path), "/dev/shm/%s", name );
+
+     ret = direct_file_open( &export_file, path, O_RDWR | O_CREAT | O_TRUNC, 0644 );
+     if (ret) {
+          D_DERROR( ret, "Direct/Perf: Could not open '%s'!\n", path );
+          return ret;
+     }
+
+     memset( &shm, 0, sizeof(shm) );
+
+     shm.magic    = DIRECT_PERF_SHM_MAGIC;
+     shm.version  = DIRECT_PERF_SHM_VERSION;
+     shm.pid      = direct_getpid();
+     shm.interval = direct_config->perf_shm_interval;
+
+     ret = direct_file_write( &export_file, &shm, sizeof(shm), &written );
+     if (ret == DR_OK && written != sizeof(shm))
+          ret = DR_IO;
+
+     if (ret == DR_OK)
+          ret = direct_file_map( &export_file, NULL, 0, sizeof(shm), DFP_READ | DFP_WRTIE, &map );
+
+     if (ret) {
+          D_DERROR( ret, "Direct/Perf: Could not map '%s'!\n", path );
+          direct_file_close( &export_file );
+          return ret;
+     }
+
+     export_shm = map;
+
+     D_DEBUG_AT( Direct_Perf, "Exporting counters to '%s' every %u ms\n", path, direct_config->perf_shm_interval );
+
+     return DR_OK;
+}
+
 void
 __D_perf_init()
 {
-     direct_hash_init( &counter_hash, 7 );
      direct_mutex_init( &counter_lock );
+     direct_tls_register( &counter_slot, perf_slot_destroy );
 
      if (direct_config->perf_dump_interval)
-          direct_thread_create( DTT_DEFAULT, direct_perf_dump_thread, NULL, "Perf Dump" );
+          counter_dump_thread = direct_thread_create( DTT_DEFAULT, direct_perf_dump_thread, NULL, "Perf Dump" );
+
+     if (direct_config->perf_shm && perf_export_open( direct_config->perf_shm ) == DR_OK)
+          export_thread = direct_thread_create( DTT_DEFAULT, direct_perf_export_thread, NULL, "Perf Export" );
+}
+
+static void
+perf_stop_thread( DirectThread *thread )
+{
+     direct_thread_lock( thread );
+     counter_shutdown = true;
+     direct_thread_notify( thread );
+     direct_thread_unlock( thread );
+
+     direct_thread_join( thread );
+     direct_thread_destroy( thread );
 }
 
 void
 __D_perf_deinit()
 {
-     if (counter_dump_thread) {
-          DirectThread *thread = counter_dump_thread;
+     PerfSlot *slot, *next;
 
-          direct_thread_lock( thread );
+     if (counter_dump_thread) {
+          perf_stop_thread( counter_dump_thread );
           counter_dump_thread = NULL;
-          direct_thread_notify( thread );
-          direct_thread_unlock( thread );
+     }
 
-          direct_thread_join( thread );
-          direct_thread_destroy( thread );
+     if (export_thread) {
+          perf_stop_thread( export_thread );
+          export_thread = NULL;
      }
 
      //direct_perf_dump_all();
 
-     direct_hash_deinit( &counter_hash );
+     if (export_shm) {
+          export_shm->pid = 0;
+
+          direct_file_unmap( &export_file, export_shm, sizeof(DirectPerfShm) );
+          direct_file_close( &export_file );
+
+          export_shm = NULL;
+     }
+
+     direct_tls_unregister( &counter_slot );
+
+     /* slots of threads still running */
+     direct_list_foreach_safe (slot, next, counter_slots)
+          D_FREE( slot );
+
+     counter_slots = NULL;
+
      direct_mutex_deinit( &counter_lock );
 }
 
 /**********************************************************************************************************************/
 
-void
-direct_perf_count( DirectPerfCounterInstallation *installation, int diff )
+static unsigned long
+perf_register( DirectPerfCounterInstallation *installation )
 {
-     DirectPerfCounter *counter;
-
-     D_ASSERT( installation != NULL );
+     unsigned long id;
 
      direct_mutex_lock( &counter_lock );
 
-     if (installation->counter_id == 0) {
-          counter = D_CALLOC( 1, sizeof(DirectPerfCounter) );
-          if (!counter) {
-               direct_mutex_unlock( &counter_lock );
-               D_OOM();
-               return;
+     id = installation->counter_id;
+     if (id == 0) {
+          if (counter_ids == DIRECT_PERF_MAX_COUNTERS - 1) {
+               D_ONCE( "too many performance counters, ignoring '%s' and others", installation->name );
+               id = ~0UL;
           }
+          else {
+               DirectPerfCounter *counter = &counters[++counter_ids];
 
-          installation->counter_id = ++counter_ids;
-          D_ASSERT( installation->counter_id != 0 );
-          D_ASSERT( installation->counter_id != ~0 );   // FIXME: can there be more than 4 billion counters?
+               direct_snputs( counter->name, installation->name, sizeof(counter->name) );
 
-          direct_snputs( counter->name, installation->name, sizeof(counter->name) );
+               counter->reset_on_dump = installation->reset_on_dump;
+               counter->start         = direct_clock_get_time( DIRECT_CLOCK_SESSION );
 
-          counter->reset_on_dump = installation->reset_on_dump;
+               id = counter_ids;
+          }
 
-          direct_hash_insert( &counter_hash, installation->counter_id, counter );
+          installation->counter_id = id;
      }
-     else {
-          counter = direct_hash_lookup( &counter_hash, installation->counter_id );
-          if (!counter) {
-               direct_mutex_unlock( &counter_lock );
-               D_BUG( "unknown performance counter installation (%lu)", installation->counter_id );
-               return;
-          }
+
+     direct_mutex_unlock( &counter_lock );
+
+     return id;
+}
+
+static PerfSlot *
+perf_slot_create( void )
+{
+     PerfSlot *slot;
+
+     slot = D_CALLOC( 1, sizeof(PerfSlot) );
+     if (!slot) {
+          D_WARN( "out of memory" );
+          return NULL;
      }
 
-     counter->count += diff;
+     direct_mutex_lock( &counter_lock );
+     direct_list_append( &counter_slots, &slot->link );
+     direct_mutex_unlock( &counter_lock );
 
-     if (!counter->start)
-          counter->start = direct_clock_get_time( DIRECT_CLOCK_SESSION );
+     direct_tls_set( counter_slot, slot );
+
+     return slot;
+}
+
+static void
+perf_slot_destroy( void *arg )
+{
+     PerfSlot *slot = arg;
+     int       i;
+
+     direct_mutex_lock( &counter_lock );
+
+     for (i=1; i<=counter_ids; i++)
+          counter_retired[i] += slot->counts[i];
+
+     direct_list_remove( &counter_slots, &slot->link );
 
      direct_mutex_unlock( &counter_lock );
+
+     D_FREE( slot );
 }
 
-static bool
-perf_iterate( DirectHash    *hash,
-              unsigned long  key,
-              void          *value,
-              void          *ctx )
+void
+direct_perf_count( DirectPerfCounterInstallation *installation, int diff )
 {
-     DirectPerfCounter *counter = value;
+     unsigned long  id;
+     PerfSlot      *slot;
 
-     counter->stop = direct_clock_get_time( DIRECT_CLOCK_SESSION );
+     D_ASSERT( installation != NULL );
+
+     id = installation->counter_id;
+     if (id == 0)
+          id = perf_register( installation );
 
-     if (counter->count > 0)
-          direct_log_printf( NULL, "  %-60s  %12lu  (%7.3f/sec)  %9lld -%9lld\n", counter->name,
-                             counter->count, counter->count * 1000000.0 / (double)(counter->stop - counter->start),
-                             counter->start, counter->stop );
+     if (id == ~0UL)
+          return;
 
-     if (counter->reset_on_dump) {
-          counter->count = 0;
-          counter->start = 0;
+     slot = direct_tls_get( counter_slot );
+     if (!slot) {
+          slot = perf_slot_create();
+          if (!slot)
+               return;
      }
 
-     return true;
+     PERF_STORE( &slot->counts[id], PERF_LOAD( &slot->counts[id] ) + diff );
+}
+
+/*
+ * Sums up all slots, called with the counter lock held.
+ */
+static void
+perf_collect( void )
+{
+     PerfSlot     *slot;
+     unsigned long i;
+
+     for (i=1; i<=counter_ids; i++)
+          counters[i].count = counter_retired[i];
+
+     direct_list_foreach (slot, counter_slots) {
+          for (i=1; i<=counter_ids; i++)
+               counters[i].count += PERF_LOAD( &slot->counts[i] );
+     }
 }
 
 void
 direct_perf_dump_all()
 {
+     unsigned long i;
+
      direct_mutex_lock( &counter_lock );
 
-     if (direct_hash_count( &counter_hash )) {
+     if (counter_ids) {
+          perf_collect();
+
           direct_log_printf( NULL, "Performance Counters                                               Total count    rate           start        end\n" );
 
-          direct_hash_iterate( &counter_hash, perf_iterate, NULL );
+          for (i=1; i<=counter_ids; i++) {
+               DirectPerfCounter *counter = &counters[i];
+               unsigned long      count   = counter->count - counter->base;
+
+               counter->stop = direct_clock_get_time( DIRECT_CLOCK_SESSION );
+
+               if (count > 0)
+                    direct_log_printf( NULL, "  %-60s  %12lu  (%7.3f/sec)  %9lld -%9lld\n", counter->name,
+                                       count, count * 1000000.0 / (double)(counter->stop - counter->start),
+                                       counter->start, counter->stop );
+
+               if (counter->reset_on_dump) {
+                    counter->base  = counter->count;
+                    counter->start = counter->stop;
+               }
+          }
      }
 
      direct_mutex_unlock( &counter_lock );
@@ -171,15 +359,73 @@ static void *
 direct_perf_dump_thread( DirectThread *thread,
                          void         *arg )
 {
-     while (counter_dump_thread) {
+     direct_thread_lock( thread );
+
+     while (!counter_shutdown) {
+          direct_thread_unlock( thread );
+
           direct_perf_dump_all();
 
           direct_thread_lock( thread );
-          if (counter_dump_thread)
+
+          if (!counter_shutdown)
                direct_thread_wait( thread, direct_config->perf_dump_interval );
+     }
+
+     direct_thread_unlock( thread );
+
+     return NULL;
+}
+
+static void
+perf_export( void )
+{
+     unsigned long i;
+
+     direct_mutex_lock( &counter_lock );
+
+     perf_collect();
+
+     PERF_STORE( &export_shm->sequence, export_shm->sequence + 1 );
+     PERF_FENCE();
+
+     for (i=1; i<=counter_ids; i++) {
+          DirectPerfShmCounter *counter = &export_shm->counters[i-1];
+
+          if (i > export_shm->num_counters)
+               direct_snputs( counter->name, counters[i].name, sizeof(counter->name) );
+
+          counter->count = counters[i].count;
+     }
+
+     export_shm->num_counters = counter_ids;
+     export_shm->timestamp    = direct_clock_get_time( DIRECT_CLOCK_MONOTONIC );
+
+     PERF_FENCE();
+     PERF_STORE( &export_shm->sequence, export_shm->sequence + 1 );
+
+     direct_mutex_unlock( &counter_lock );
+}
+
+static void *
+direct_perf_export_thread( DirectThread *thread,
+                           void         *arg )
+{
+     direct_thread_lock( thread );
+
+     while (!counter_shutdown) {
           direct_thread_unlock( thread );
+
+          perf_export();
+
+          direct_thread_lock( thread );
+
+          if (!counter_shutdown)
+               direct_thread_wait( thread, direct_config->perf_shm_interval );
      }
 
+     direct_thread_unlock( thread );
+
      return NULL;
 }
 
@@ -38,8 +38,15 @@
 
 
 
+/*
+ * Counters are registered on first use and counted in per thread slots,
+ * which are summed up when the counters are dumped or exported.
+ */
+#define DIRECT_PERF_MAX_COUNTERS  1024
+
+
 typedef struct {
-     unsigned long  counter_id;    // maybe switch to direct pointer
+     unsigned long  counter_id;    // index into the counter table, ~0 if the table was full
      bool           reset_on_dump;
 
      char           name[100];
@@ -51,14 +58,13 @@ typedef struct {
      long long      stop;
 
      unsigned long  count;
+     unsigned long  base;          // total at the last reset
 
      char           name[100];
      bool           reset_on_dump;
 } DirectPerfCounter;
 
 
-#if D_DEBUG_ENABLED
-
 #define D_PERF_COUNTER( _identifier, _name )           \
      DirectPerfCounterInstallation _identifier = {     \
                               0,                       \
@@ -73,25 +79,42 @@ typedef struct {
 #define D_PERF_COUNT_N( _identifier, _diff )           \
      direct_perf_count( &_identifier, _diff )
 
-#else
 
-#define D_PERF_COUNTER( _identifier, _name )           \
-     D_UNUSED int _identifier
+void DIRECT_API direct_perf_count( DirectPerfCounterInstallation *installation, int diff );
 
 
-#define D_PERF_COUNT( _identifier )                    \
-     do {} while (0)
+void DIRECT_API direct_perf_dump_all( void );
 
-#define D_PERF_COUNT_N( _identifier, _diff )           \
-     do {} while (0)
 
-#endif
+/*
+ * Layout of the segment exported via "perf-shm=<name>"
+ *
+ * The exporting thread writes all counters every "perf-shm-interval" milli seconds. The sequence number
+ * is odd while an update is in progress, readers retry if it was odd or has changed after reading.
+ */
+#define DIRECT_PERF_SHM_MAGIC     0x44504653     /* "DPFS" */
+#define DIRECT_PERF_SHM_VERSION   1
+
+typedef struct {
+     char                name[100];
+     u32                 reserved;
+     s64                 count;                  // total since registration
+} DirectPerfShmCounter;
+
+typedef struct {
+     u32                 magic;
+     u32                 version;
 
+     u32                 pid;                    // zero after the process has stopped exporting
+     u32                 interval;               // update interval in milli seconds
 
-void direct_perf_count( DirectPerfCounterInstallation *installation, int index );
+     u32                 sequence;
+     u32                 num_counters;
 
+     s64                 timestamp;              // DIRECT_CLOCK_MONOTONIC at the last update (micro seconds)
 
-void direct_perf_dump_all( void );
+     DirectPerfShmCounter counters[DIRECT_PERF_MAX_COUNTERS];
+} DirectPerfShm;
 
 
 void __D_perf_init( void );
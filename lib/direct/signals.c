@@ -439,6 +439,9 @@ signal_handler( int num )
      void         *addr = NULL;
      sigset_t      mask;
 
+     /* Get out what's queued before reporting the crash synchronously. */
+     direct_log_flush_crash();
+
 #ifndef SA_SIGINFO
      D_LOG( Direct_Signals, FATAL, "    --> Caught signal %d <--\n", num );
 #else
@@ -34,6 +34,10 @@
 
 #include <sys/stat.h>
 
+#ifndef WIN32
+#include <sys/mman.h>
+#endif
+
 #include <direct/build.h>
 
 #include <direct/filesystem.h>
@@ -49,6 +53,13 @@
 D_LOG_DOMAIN( Direct_Stream, "Direct/Stream", "Stream wrapper" );
 
 
+/* Regular files up to this size are memory mapped for direct_stream_borrow(). */
+#define MAP_MAX_LENGTH   (64 * 1024 * 1024)
+
+/* Amount of a mapped file to read ahead right away. */
+#define MAP_WILLNEED     (2 * 1024 * 1024)
+
+
 #if DIRECT_BUILD_NETWORK
 #include <sys/select.h>
 #include <sys/socket.h>
@@ -73,6 +84,10 @@ struct __D_DirectStream {
      void                 *cache;
      unsigned int          cache_size;
 
+     /* mapping of regular files, created by the first direct_stream_borrow() */
+     void                 *map;
+     size_t                map_length;     /* zero if not mappable */
+
 #if DIRECT_BUILD_NETWORK
      /* remote streams data */
      struct {
@@ -1963,6 +1978,32 @@ file_seek( DirectStream *stream, unsigned int offset )
 
      return DR_OK;
 }
+
+static DirectResult
+map_open( DirectStream *stream )
+{
+     void *map;
+
+     map = mmap( NULL, stream->map_length, PROT_READ, MAP_PRIVATE, stream->fd, 0 );
+     if (map == MAP_FAILED) {
+          D_DEBUG_AT( Direct_Stream, "  -> mmap() failed (%s)\n", strerror( errno ) );
+          stream->map_length = 0;
+          return DR_UNSUPPORTED;
+     }
+
+#ifdef MADV_SEQUENTIAL
+     madvise( map, stream->map_length, MADV_SEQUENTIAL );
+#endif
+#ifdef MADV_WILLNEED
+     madvise( map, MIN( stream->map_length, MAP_WILLNEED ), MADV_WILLNEED );
+#endif
+
+     D_DEBUG_AT( Direct_Stream, "  -> mapped %zu bytes at %p\n", stream->map_length, map );
+
+     stream->map = map;
+
+     return DR_OK;
+}
 #else
 static DirectResult
 file_peek( DirectStream *stream,
@@ -2062,6 +2103,10 @@ file_open( DirectStream *stream, const char *filename, int fileno )
           stream->peek   = file_peek;
           stream->read   = file_read;
           stream->seek   = file_seek;
+
+          /* Files given by descriptor may not be at their start. */
+          if (filename && S_ISREG( s.st_mode ) && s.st_size > 0 && s.st_size <= MAP_MAX_LENGTH)
+               stream->map_length = s.st_size;
      }
 #else
      DirectResult   ret;
@@ -2299,6 +2344,58 @@ direct_stream_read( DirectStream *stream,
      return DR_UNSUPPORTED;
 }
 
+DirectResult
+direct_stream_borrow( DirectStream  *stream,
+                      unsigned int   length,
+                      int            offset,
+                      const void   **ret_ptr,
+                      unsigned int  *ret_length )
+{
+     off_t pos;
+     off_t end;
+#ifndef WIN32
+     struct stat s;
+#endif
+
+     D_ASSERT( stream != NULL );
+     D_ASSERT( length != 0 );
+     D_ASSERT( ret_ptr != NULL );
+
+     D_MAGIC_ASSERT( stream, DirectStream );
+
+     if (!stream->map) {
+#ifndef WIN32
+          if (!stream->map_length || map_open( stream ))
+#endif
+               return DR_UNSUPPORTED;
+     }
+
+     pos = stream->offset + offset;
+     if (pos < 0)
+          return DR_INVARG;
+
+     end = stream->map_length;
+
+#ifndef WIN32
+     /* The file may have been truncated meanwhile, touching pages beyond its end raises SIGBUS. */
+     if (fstat( stream->fd, &s ) == 0 && s.st_size < end)
+          end = s.st_size;
+#endif
+
+     if (pos >= end)
+          return DR_EOF;
+
+     if (length > end - pos)
+          length = end - pos;
+
+     *ret_ptr = (u8*) stream->map + pos;
+
+     if (ret_length)
+          *ret_length = length;
+
+     return DR_OK;
+}
+
 DirectResult
 direct_stream_seek( DirectStream *stream,
                     unsigned int  offset )
@@ -2376,6 +2473,11 @@ direct_stream_close( DirectStream *stream )
      }
 
 #ifndef WIN32
+     if (stream->map) {
+          munmap( stream->map, stream->map_length );
+          stream->map = NULL;
+     }
+
      if (stream->fd >= 0) {
           fcntl( stream->fd, F_SETFL,
                     fcntl( stream->fd, F_GETFL ) & ~O_NONBLOCK );
@@ -114,6 +114,19 @@ DirectResult DIRECT_API  direct_stream_read    ( DirectStream   *stream,
                                                  void           *buf,
                                                  unsigned int   *read_out );
 
+/*
+ * Get a pointer to 'length' bytes of data at offset 'offset' from the stream without copying.
+ * Like direct_stream_peek() the position is not changed, use direct_stream_seek() to skip the data.
+ * Only supported by regular files opened by name, which are memory mapped on first use. The pointer stays
+ * valid until the stream is destroyed, but accessing it raises SIGBUS if the file is truncated meanwhile.
+ * Less data is returned at the end of the stream.
+ */
+DirectResult DIRECT_API  direct_stream_borrow  ( DirectStream   *stream,
+                                                 unsigned int    length,
+                                                 int             offset,
+                                                 const void    **ret_ptr,
+                                                 unsigned int   *ret_length );
+
 /*
  * Seek to the specified absolute offset within the stream.
  */
@@ -69,6 +69,7 @@ typedef enum {
 
 typedef struct __D_DirectCleanupHandler      DirectCleanupHandler;
 typedef struct __D_DirectConfig              DirectConfig;
+typedef struct __D_DirectExecutor            DirectExecutor;
 typedef struct __D_DirectFifo                DirectFifo;
 typedef struct __D_DirectFifoItem            DirectFifoItem;
 typedef struct __D_DirectFile                DirectFile;
@@ -40,6 +40,7 @@
 
 #include <fusion/build.h>
 
+#include <direct/clock.h>
 #include <direct/debug.h>
 #include <direct/mem.h>
 #include <direct/memcpy.h>
@@ -888,6 +889,7 @@ _fusion_call_process( FusionWorld *world, int call_id, FusionCallMessage *msg, v
      FusionCallReturn        call_ret = {
           .val = 0
      };
+     long long               start;
 
 
      D_DEBUG_AT( Fusion_Call, "%s( call_id %d, msg %p, ptr %p)\n", __FUNCTION__, call_id, msg, ptr );
@@ -901,8 +903,13 @@ _fusion_call_process( FusionWorld *world, int call_id, FusionCallMessage *msg, v
      if (direct_log_domain_check( &Fusion_Call )) // avoid call to direct_trace_lookup_symbol_at
           D_DEBUG_AT( Fusion_Call, "  =-> %s\n", direct_trace_lookup_symbol_at( call_handler ) );
 
+     start  = world->shared->call_profile ? direct_clock_get_micros() : 0;
      result = call_handler( msg->caller, msg->call_arg, ptr ? ptr : msg->call_ptr, msg->ctx, msg->serial, &call_ret.val );
 
+     /* The kernel device does not tell the time of queueing. */
+     if (start)
+          _fusion_call_profile_add( world, call_handler, msg->call_arg, msg->caller, 0, start );
+
      switch (result) {
           case FCHR_RETURN:
                if (msg->serial) {
@@ -968,9 +975,15 @@ _fusion_call_process3( FusionWorld *world, int call_id, FusionCallMessage3 *msg,
                ret_ptr = alloca( msg->ret_length );
      }
 
-     if (ret_ptr)
+     if (ret_ptr) {
+          long long start = world->shared->call_profile ? direct_clock_get_micros() : 0;
+
           result = call_handler( msg->caller, msg->call_arg, ptr ? ptr : msg->call_ptr, msg->call_length, msg->ctx, msg->serial, ret_ptr, msg->ret_length, &ret_length );
 
+          if (start)
+               _fusion_call_profile_add( world, call_handler, msg->call_arg, msg->caller, 0, start );
+     }
+
      switch (result) {
           case FCHR_RETURN:
                if (msg->serial) {
@@ -1014,6 +1027,9 @@ out:
 #include <fcntl.h>
 #include <unistd.h>
 
+#include <direct/atomic.h>
+#include <direct/system.h>
+
 
 typedef struct {
      int       call_id;
@@ -1024,6 +1040,148 @@ typedef struct {
      void     *ctx;
 } CallInfo;
 
+/*
+ * Return slot in shared memory for calls queued in the ring of the callee.
+ *
+ * The serial of such a call is the offset of its slot within the main pool,
+ * so that fusion_call_return() finds it without an extra message.
+ */
+typedef struct {
+     int           done;     /* Futex, set when the return value has been written. */
+     unsigned int  size;
+     unsigned int  length;
+} CallSlot;
+
+#define CALL_SERIAL_SLOT  0x80000000
+
+static inline unsigned int
+call_slot_serial( const FusionWorldShared *shared,
+                  const CallSlot          *slot )
+{
+     D_ASSERT( (char*) slot - (char*) shared->main_pool->addr_base < CALL_SERIAL_SLOT );
+
+     return CALL_SERIAL_SLOT | (unsigned int)((char*) slot - (char*) shared->main_pool->addr_base);
+}
+
+static inline CallSlot *
+call_slot_lookup( const FusionWorldShared *shared,
+                  unsigned int             serial )
+{
+     if (!(serial & CALL_SERIAL_SLOT) || serial == (unsigned int) -1)
+          return NULL;
+
+     return (CallSlot*)((char*) shared->main_pool->addr_base + (serial & ~CALL_SERIAL_SLOT));
+}
+
+static void
+call_slot_return( CallSlot     *slot,
+                  const void   *ptr,
+                  unsigned int  length )
+{
+     D_ASSERT( length <= slot->size );
+
+     if (length && ptr != slot + 1)
+          direct_memcpy( slot + 1, ptr, length );
+
+     slot->length = length;
+
+     D_SYNC_ADD( &slot->done, 1 );
+
+     direct_futex_wake( &slot->done, 1 );
+}
+
+/*
+ * Allocate a return slot and queue the call in the ring of the callee.
+ */
+static DirectResult
+call_slot_send( FusionWorld       *world,
+                FusionCall        *call,
+                FusionCallMessage *msg,
+                unsigned int       ret_size,
+                CallSlot         **ret_slot )
+{
+     DirectResult  ret;
+     CallSlot     *slot;
+
+     slot = SHMALLOC( world->shared->main_pool, sizeof(CallSlot) + ret_size );
+     if (!slot)
+          return D_OOSHM();
+
+     slot->done   = 0;
+     slot->size   = ret_size;
+     slot->length = 0;
+
+     msg->serial = call_slot_serial( world->shared, slot );
+
+     ret = _fusion_ring_send( world, call->fusion_id, msg, sizeof(FusionCallMessage) + msg->call_length );
+     if (ret) {
+          SHFREE( world->shared->main_pool, slot );
+          return ret;
+     }
+
+     *ret_slot = slot;
+
+     return DR_OK;
+}
+
+/*
+ * Wait for the return of a call queued by call_slot_send() and free the slot.
+ */
+static void
+call_slot_wait( FusionWorld  *world,
+                CallSlot     *slot,
+                void         *ret_ptr,
+                unsigned int *ret_length )
+{
+     while (!slot->done)
+          direct_futex_wait( &slot->done, 0 );
+
+     if (slot->length) {
+          D_ASSERT( ret_ptr != NULL );
+
+          direct_memcpy( ret_ptr, slot + 1, slot->length );
+     }
+
+     if (ret_length)
+          *ret_length = slot->length;
+
+     SHFREE( world->shared->main_pool, slot );
+}
+
+static inline bool
+call_is_direct( FusionWorld         *world,
+                FusionCall          *call,
+                FusionCallExecFlags  flags )
+{
+     return call->fusion_id == fusion_id( world ) &&
+            (!(flags & FCEF_NODIRECT) || (call->handler3 && (direct_thread_self() == world->dispatch_loop)));
+}
+
+static void
+call_message_init( FusionWorld         *world,
+                   FusionCall          *call,
+                   FusionCallExecFlags  flags,
+                   int                  call_arg,
+                   const void          *call_ptr,
+                   unsigned int         length,
+                   unsigned int         ret_size,
+                   FusionCallMessage   *msg )
+{
+     msg->type        = FMT_CALL;
+     msg->caller      = world->fusion_id;
+     msg->call_id     = call->call_id;
+     msg->call_arg    = call_arg;
+     msg->call_length = length;
+     msg->ret_length  = ret_size;
+     msg->handler     = call->handler;
+     msg->handler3    = call->handler3;
+     msg->ctx         = call->ctx;
+     msg->flags       = flags;
+     msg->stamp       = world->shared->call_profile ? direct_clock_get_micros() : 0;
+
+     direct_memcpy( msg + 1, call_ptr, length );
+}
+
 DirectResult
 fusion_call_init (FusionCall        *call,
                   FusionCallHandler  handler,
@@ -1185,9 +1343,7 @@ fusion_call_execute_internal (FusionCall          *call,
      world = _fusion_world( call->shared );
 
      //D_INFO_LINE_MSG("call execute %d owner %lu, me %lu\n",call->call_id,call->fusion_id, _fusion_id( call->shared ));
-     if (call->fusion_id == fusion_id( world ) &&
-         (!(flags & FCEF_NODIRECT) || (call->handler3 && (direct_thread_self() == world->dispatch_loop))))
-     {
+     if (call_is_direct( world, call, flags )) {
           FusionCallHandlerResult result;
 
           if (call->handler) {
@@ -1206,22 +1362,15 @@ fusion_call_execute_internal (FusionCall          *call,
           return DR_OK;
      }
      
-     msg->type        = FMT_CALL;
-     msg->caller      = world->fusion_id;
-     msg->call_id     = call->call_id;
-     msg->call_arg    = call_arg;
-     msg->call_length = length;
-     msg->ret_length  = ret_size;
-     msg->handler     = call->handler;
-     msg->handler3    = call->handler3;
-     msg->ctx         = call->ctx;
-     msg->flags       = flags;
+     call_message_init( world, call, flags, call_arg, call_ptr, length, ret_size, msg );
 
-     direct_memcpy( msg + 1, call_ptr, length );
-     
      if (flags & FCEF_ONEWAY) {
           /* Invalidate serial. */
           msg->serial = -1;
+
+          ret = _fusion_ring_send( world, call->fusion_id, msg, sizeof(FusionCallMessage) + length );
+          if (ret != DR_UNSUPPORTED)
+               return ret;
           
           /* Send message. */
           addr.sun_family = AF_UNIX;
@@ -1234,6 +1383,18 @@ fusion_call_execute_internal (FusionCall          *call,
           int       fd;
           socklen_t len;
           int       err;
+          CallSlot *slot;
+
+          ret = call_slot_send( world, call, msg, ret_size, &slot );
+          if (ret == DR_OK) {
+               /* Wait for reply. */
+               call_slot_wait( world, slot, ret_ptr, ret_length );
+
+               return DR_OK;
+          }
+
+          if (ret != DR_UNSUPPORTED)
+               return ret;
 
           fd = socket( PF_LOCAL, SOCK_RAW, 0 );
           if (fd < 0) {
@@ -1342,12 +1503,19 @@ fusion_call_return_internal( FusionCall   *call,
                              unsigned int  length )
 {
      struct sockaddr_un addr;
+     CallSlot          *slot;
 
      char              buf[sizeof(FusionCallReturn) + length];
      FusionCallReturn *callret = (FusionCallReturn *) buf;
 
      D_ASSERT( call != NULL );
 
+     slot = call_slot_lookup( call->shared, serial );
+     if (slot) {
+          call_slot_return( slot, ptr, length );
+          return DR_OK;
+     }
+
      addr.sun_family = AF_UNIX;
      snprintf( addr.sun_path, sizeof(addr.sun_path), 
                "/tmp/.fusion-%d/call.%x.%x", call->shared->world_index, call->call_id, serial );
@@ -1448,7 +1616,10 @@ fusion_world_flush_calls( FusionWorld *world, int lock )
 void
 _fusion_call_process( FusionWorld *world, int call_id, FusionCallMessage *msg, void *ptr )
 {
-     FusionCallHandlerResult result;
+     FusionCallHandlerResult  result;
+     CallSlot                *slot;
+     void                    *ret_ptr;
+     long long                start;
 
      D_MAGIC_ASSERT( world, FusionWorld );
      D_ASSERT( msg != NULL );
@@ -1456,6 +1627,10 @@ _fusion_call_process( FusionWorld *world, int call_id, FusionCallMessage *msg, v
      char              buf[sizeof(FusionCallReturn) + msg->ret_length];
      FusionCallReturn *callret = (FusionCallReturn *) buf;
 
+     /* Let the handler write its return value into the slot directly. */
+     slot    = (msg->flags & FCEF_ONEWAY) ? NULL : call_slot_lookup( world->shared, msg->serial );
+     ret_ptr = slot ? (void*)(slot + 1) : (void*)(callret + 1);
+
      if (msg->handler) {
           FusionCallHandler call_handler = msg->handler;
 
@@ -1466,10 +1641,17 @@ _fusion_call_process( FusionWorld *world, int call_id, FusionCallMessage *msg, v
 
           D_ASSERT( msg->call_length == sizeof(void*) );
 
-          result = call_handler( msg->caller, msg->call_arg, ptr, msg->ctx, msg->serial, (int*)(callret + 1) );
+          start  = world->shared->call_profile ? direct_clock_get_micros() : 0;
+          result = call_handler( msg->caller, msg->call_arg, ptr, msg->ctx, msg->serial, ret_ptr );
+
+          if (start)
+               _fusion_call_profile_add( world, call_handler, msg->call_arg, msg->caller, msg->stamp, start );
+
           switch (result) {
                case FCHR_RETURN:
-                    if (!(msg->flags & FCEF_ONEWAY)) {
+                    if (slot)
+                         call_slot_return( slot, ret_ptr, callret->length );
+                    else if (!(msg->flags & FCEF_ONEWAY)) {
                          struct sockaddr_un addr;
 
                          addr.sun_family = AF_UNIX;
@@ -1497,10 +1679,17 @@ _fusion_call_process( FusionWorld *world, int call_id, FusionCallMessage *msg, v
           callret->type   = FMT_CALLRET;
           callret->length = 0;
 
-          result = call_handler3( msg->caller, msg->call_arg, ptr, msg->call_length, msg->ctx, msg->serial, callret + 1, msg->ret_length, &callret->length );
+          start  = world->shared->call_profile ? direct_clock_get_micros() : 0;
+          result = call_handler3( msg->caller, msg->call_arg, ptr, msg->call_length, msg->ctx, msg->serial, ret_ptr, msg->ret_length, &callret->length );
+
+          if (start)
+               _fusion_call_profile_add( world, call_handler3, msg->call_arg, msg->caller, msg->stamp, start );
+
           switch (result) {
                case FCHR_RETURN:
-                    if (!(msg->flags & FCEF_ONEWAY)) {
+                    if (slot)
+                         call_slot_return( slot, ret_ptr, callret->length );
+                    else if (!(msg->flags & FCEF_ONEWAY)) {
                          struct sockaddr_un addr;
 
                          addr.sun_family = AF_UNIX;
@@ -64,6 +64,9 @@ const char   *fusion_config_usage =
      "  trace-ref=<hexid>              Trace FusionRef up/down ('all' traces all)\n"
      "  call-bin-max-num=<n>           Set maximum call number for async call buffer (default 512, 0 = disable)\n"
      "  call-bin-max-data=<n>          Set maximum call data size for async call buffer (default 65536)\n"
+#if FUSION_BUILD_MULTI
+     "  [no-]call-profile              Collect latency statistics of calls (master only, see fusionprof)\n"
+#endif
      "\n";
 
 /**********************************************************************************************************************/
@@ -127,6 +130,12 @@ fusion_config_set( const char *name, const char *value )
      if (strcmp (name, "no-fork-handler" ) == 0) {
           fusion_config->fork_handler = false;
      } else
+     if (strcmp (name, "call-profile" ) == 0) {
+          fusion_config->call_profile = true;
+     } else
+     if (strcmp (name, "no-call-profile" ) == 0) {
+          fusion_config->call_profile = false;
+     } else
      if (strcmp (name, "debugshm" ) == 0) {
           fusion_config->debugshm = true;
      } else
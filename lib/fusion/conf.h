@@ -54,6 +54,8 @@ struct __Fusion_FusionConfig {
 
      bool  fork_handler;
 
+     bool  call_profile;      /* collect per call statistics, see fusion/profile.h */
+
      unsigned int call_bin_max_num;
      unsigned int call_bin_max_data;
      pid_t        skirmish_warn_on_thread;
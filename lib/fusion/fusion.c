@@ -500,6 +500,9 @@ fusion_fork_handler_child( void )
                case FFA_FORK:
                     D_DEBUG_AT( Fusion_Main, "  -> forking in world %d\n", i );
 
+                    /* Cached shared memory objects belong to the parent. */
+                    __shmalloc_magazines_forked( &world->shm );
+
                     fusion_world_fork( world );
 
                     break;
@@ -871,6 +874,9 @@ fusion_enter( int               world_index,
           fusion_call_set_name( &shared->refs_call, "world_refs" );
           fusion_call_add_permissions( &shared->refs_call, 0, FUSION_CALL_PERMIT_EXECUTE );
 
+          if (fusion_config->call_profile)
+               _fusion_call_profile_init( world );
+
           direct_map_create( 37, refs_map_compare, refs_map_hash, world, &world->refs_map );
      }
      else
@@ -1084,6 +1090,8 @@ fusion_exit( FusionWorld *world,
                fusion_skirmish_destroy( &shared->reactor_globals );
                fusion_skirmish_destroy( &shared->arenas_lock );
 
+               _fusion_call_profile_deinit( world );
+
                fusion_shm_pool_destroy( world, shared->main_pool );
           
                /* Deinitialize shared memory. */
@@ -1768,6 +1776,7 @@ fusion_sync( const FusionWorld *world )
 
 #include <dirent.h>
 
+#include <direct/atomic.h>
 #include <direct/system.h>
 
 typedef struct {
@@ -1785,8 +1794,68 @@ typedef struct {
      pid_t        pid;
 
      DirectLink  *refs;
+
+     FusionRing  *ring;
 } __Fusionee;
 
+/*
+ * Message ring of a fusionee in shared memory.
+ *
+ * Any number of producers (serialized by the lock) write records, which are read in place
+ * by the dispatcher of the fusionee. Messages not fitting into the ring are queued in the
+ * overflow list, and until it's drained all further messages go there to keep the order.
+ * Senders wait once FUSION_RING_OVERFLOW bytes are queued there, like for a full socket.
+ *
+ * This is a locked ring on purpose, not a lock-free one per pair of fusionees: coalescing
+ * rewrites pending records and the overflow list has to stay in order with the ring, both
+ * needing the producers to be serialized. The fusionees lock is only held by producers for
+ * looking up the ring, so it cannot be freed meanwhile, see _fusion_ring_queue().
+ *
+ * The socket is only used to wake up the dispatcher if it's about to sleep in select().
+ *
+ * Fusionees sharing the Fusion ID after FFA_FORK share the ring. Their dispatchers take turns,
+ * only one at a time may read it, like only one of them receives each message from the socket.
+ */
+struct __Fusion_FusionRing {
+     int                  magic;
+
+     int                  refs;        /* Fusionees sharing the Fusion ID, see FFA_FORK. */
+
+     FusionSkirmish       lock;
+
+     unsigned int         size;
+     unsigned int         head;        /* Written by producers. */
+     unsigned int         tail;        /* Written by the dispatcher. */
+
+     int                  sleeping;    /* Dispatcher is waiting for the socket. */
+     pid_t                consumer;    /* Fusionee (pid) of the dispatcher reading the ring, zero if none. */
+
+     DirectLink          *overflow;
+     unsigned int         overflow_bytes;
+     int                  drained;     /* Increased after handling an overflow list that made senders wait. */
+};
+
+typedef struct {
+     unsigned int         size;        /* Whole record, aligned. */
+     unsigned int         length;      /* Message, zero for padding at the end of the ring. */
+
+     unsigned int         key;         /* Leading bytes identifying the sender, zero if not coalescable. */
+     int                  started;     /* Set by the dispatcher before handling a coalescable message. */
+} FusionRingRecord;
+
+/* Number of pending records searched for a message to coalesce with. */
+#define FUSION_RING_COALESCE_MAX  64
+
+typedef struct {
+     DirectLink           link;
+
+     size_t               length;
+} FusionRingOverflow;
+
+
+static DirectResult _fusion_ring_attach( FusionWorld *world, __Fusionee *fusionee );
+static void         _fusion_ring_detach( FusionWorld *world, __Fusionee *fusionee );
+
 
 /**********************************************************************************************************************/
 
@@ -1817,6 +1886,13 @@ _fusion_add_fusionee( FusionWorld *world, FusionID fusion_id )
           SHFREE( shared->main_pool, fusionee );
           return ret;
      }
+
+     ret = _fusion_ring_attach( world, fusionee );
+     if (ret) {
+          fusion_skirmish_dismiss( &shared->fusionees_lock );
+          SHFREE( shared->main_pool, fusionee );
+          return ret;
+     }
      
      direct_list_append( &shared->fusionees, &fusionee->link );
      
@@ -1994,6 +2070,8 @@ _fusion_remove_fusionee( FusionWorld *world, FusionID fusion_id )
 
      direct_list_remove( &shared->fusionees, &fusionee->link );
 
+     _fusion_ring_detach( world, fusionee );
+
      fusion_skirmish_dismiss( &shared->fusionees_lock );
      
      direct_list_foreach_safe (fusionee_ref, temp, fusionee->refs) {
@@ -2004,6 +2082,10 @@ _fusion_remove_fusionee( FusionWorld *world, FusionID fusion_id )
           SHFREE( shared->main_pool, fusionee_ref );
      }
 
+     /* Objects cached by a dead fusionee would be lost otherwise. */
+     if (fusionee != world->fusionee)
+          __shmalloc_magazines_reclaim( &world->shm );
+
      SHFREE( shared->main_pool, fusionee );
 }
 
@@ -2072,6 +2154,394 @@ _fusion_recv_message( int                 fd,
 
 /**********************************************************************************************************************/
 
+#define RING_RECORD_SIZE(length)  (((unsigned int) sizeof(FusionRingRecord) + (length) + 7) & ~7)
+
+/*
+ * Called with the fusionees lock being held.
+ */
+static DirectResult
+_fusion_ring_attach( FusionWorld *world, __Fusionee *fusionee )
+{
+     FusionWorldShared *shared = world->shared;
+     FusionRing        *ring;
+
+     /* The lowest free Fusion ID is used, so this only happens with many fusionees at the same time. */
+     if (fusionee->id >= FUSION_RING_MAX_IDS) {
+          D_INFO( "Fusion/Main: Fusionee %lu has no message ring (limited to %d Fusion IDs), using the socket\n",
+                  fusionee->id, FUSION_RING_MAX_IDS );
+          return DR_OK;
+     }
+
+     ring = shared->rings[fusionee->id];
+     if (ring) {
+          D_MAGIC_ASSERT( ring, FusionRing );
+
+          ring->refs++;
+     }
+     else {
+          ring = SHCALLOC( shared->main_pool, 1, sizeof(FusionRing) + FUSION_RING_SIZE );
+          if (!ring)
+               return D_OOSHM();
+
+          ring->refs = 1;
+          ring->size = FUSION_RING_SIZE;
+
+          fusion_skirmish_init( &ring->lock, "Fusion Ring", world );
+
+          D_MAGIC_SET( ring, FusionRing );
+
+          shared->rings[fusionee->id] = ring;
+     }
+
+     D_DEBUG_AT( Fusion_Main, "  -> ring %p for fusionee %lu (%d refs)\n", ring, fusionee->id, ring->refs );
+
+     fusionee->ring = ring;
+
+     return DR_OK;
+}
+
+/*
+ * Called with the fusionees lock being held.
+ */
+static void
+_fusion_ring_detach( FusionWorld *world, __Fusionee *fusionee )
+{
+     FusionWorldShared  *shared = world->shared;
+     FusionRing         *ring   = fusionee->ring;
+     FusionRingOverflow *overflow, *next;
+
+     if (!ring)
+          return;
+
+     D_MAGIC_ASSERT( ring, FusionRing );
+
+     fusionee->ring = NULL;
+
+     /* Don't leave the ring to a dispatcher that died while reading it. */
+     D_SYNC_BOOL_COMPARE_AND_SWAP( &ring->consumer, fusionee->pid, 0 );
+
+     if (--ring->refs)
+          return;
+
+     shared->rings[fusionee->id] = NULL;
+
+     /* Wait for producers still writing. */
+     fusion_skirmish_prevail( &ring->lock );
+
+     direct_list_foreach_safe (overflow, next, ring->overflow)
+          SHFREE( shared->main_pool, overflow );
+
+     fusion_skirmish_dismiss( &ring->lock );
+     fusion_skirmish_destroy( &ring->lock );
+
+     D_MAGIC_CLEAR( ring );
+
+     SHFREE( shared->main_pool, ring );
+}
+
+/*
+ * Called with the ring lock being held.
+ *
+ * Looks for the latest pending message with the same key, which is the first key bytes
+ * of the message. If it is identical and the dispatcher hasn't started with it yet,
+ * the new message can be dropped.
+ */
+static bool
+_fusion_ring_coalesce( FusionRing   *ring,
+                       const void   *msg,
+                       size_t        msg_size,
+                       unsigned int  key )
+{
+     char             *data   = (char*)(ring + 1);
+     unsigned int      pos    = ring->tail;
+     FusionRingRecord *latest = NULL;
+     int               n;
+
+     for (n=0; pos != ring->head; n++) {
+          FusionRingRecord *record = (FusionRingRecord*)(data + (pos & (ring->size - 1)));
+
+          /* Don't know about the latest one. */
+          if (n == FUSION_RING_COALESCE_MAX)
+               return false;
+
+          if (record->key == key && record->length >= key && !memcmp( record + 1, msg, key ))
+               latest = record;
+
+          pos += record->size;
+     }
+
+     if (!latest || latest->length != msg_size || memcmp( latest + 1, msg, msg_size ))
+          return false;
+
+     return !D_SYNC_ADD_AND_FETCH( &latest->started, 0 );
+}
+
+static void
+_fusion_ring_wakeup( FusionWorld *world,
+                     FusionID     fusion_id )
+{
+     struct sockaddr_un addr;
+     FusionMessageType  type = FMT_SEND;
+
+     addr.sun_family = AF_UNIX;
+     snprintf( addr.sun_path, sizeof(addr.sun_path), "/tmp/.fusion-%d/%lx", world->shared->world_index, fusion_id );
+
+     _fusion_send_message( world->fusion_fd, &type, sizeof(type), &addr );
+}
+
+static DirectResult
+_fusion_ring_queue( FusionWorld  *world,
+                    FusionID      fusion_id,
+                    const void   *msg,
+                    size_t        msg_size,
+                    unsigned int  key )
+{
+     DirectResult        ret;
+     FusionWorldShared  *shared;
+     FusionRing         *ring;
+     FusionRingOverflow *overflow;
+     char               *data;
+     bool                wakeup;
+
+     D_MAGIC_ASSERT( world, FusionWorld );
+     D_ASSERT( msg != NULL );
+
+     shared = world->shared;
+
+     D_MAGIC_ASSERT( shared, FusionWorldShared );
+
+     if (fusion_id >= FUSION_RING_MAX_IDS)
+          return DR_UNSUPPORTED;
+
+retry:
+     ret = fusion_skirmish_prevail( &shared->fusionees_lock );
+     if (ret)
+          return ret;
+
+     ring = shared->rings[fusion_id];
+     if (!ring) {
+          fusion_skirmish_dismiss( &shared->fusionees_lock );
+          return DR_UNSUPPORTED;
+     }
+
+     D_MAGIC_ASSERT( ring, FusionRing );
+
+     fusion_skirmish_prevail( &ring->lock );
+
+     /* The ring stays valid while its lock is held, see _fusion_ring_detach(). */
+     fusion_skirmish_dismiss( &shared->fusionees_lock );
+
+     data = (char*)(ring + 1);
+
+     if (key && _fusion_ring_coalesce( ring, msg, msg_size, key )) {
+          fusion_skirmish_dismiss( &ring->lock );
+          return DR_OK;
+     }
+
+     if (!ring->overflow && RING_RECORD_SIZE( msg_size ) <= ring->size / 4) {
+          unsigned int      need   = RING_RECORD_SIZE( msg_size );
+          unsigned int      pos    = ring->head & (ring->size - 1);
+          unsigned int      contig = ring->size - pos;
+          unsigned int      total  = (contig < need) ? contig + need : need;
+          FusionRingRecord *record;
+
+          if (ring->size - (ring->head - ring->tail) >= total) {
+               /* Pad the end of the ring. */
+               if (contig < need) {
+                    record = (FusionRingRecord*)(data + pos);
+
+                    record->size   = contig;
+                    record->length = 0;
+                    record->key    = 0;
+
+                    pos = 0;
+               }
+
+               record = (FusionRingRecord*)(data + pos);
+
+               record->size    = need;
+               record->length  = msg_size;
+               record->key     = key;
+               record->started = 0;
+
+               direct_memcpy( record + 1, msg, msg_size );
+
+               /* Publish after the record has been written. */
+               D_SYNC_ADD( &ring->head, total );
+
+               goto queued;
+          }
+     }
+
+     /*
+      * Wait for the dispatcher to catch up, unless we are a dispatcher ourselves,
+      * which might be the one being waited for. The ring may be gone after waiting.
+      */
+     if (ring->overflow_bytes >= FUSION_RING_OVERFLOW && direct_thread_self() != world->dispatch_loop) {
+          int drained = ring->drained;
+
+          wakeup = D_SYNC_BOOL_COMPARE_AND_SWAP( &ring->sleeping, 1, 0 );
+
+          fusion_skirmish_dismiss( &ring->lock );
+
+          if (wakeup)
+               _fusion_ring_wakeup( world, fusion_id );
+
+          direct_futex_wait_timed( &ring->drained, drained, 100 );
+
+          goto retry;
+     }
+
+     overflow = SHMALLOC( shared->main_pool, sizeof(FusionRingOverflow) + msg_size );
+     if (!overflow) {
+          fusion_skirmish_dismiss( &ring->lock );
+          return D_OOSHM();
+     }
+
+     overflow->length = msg_size;
+
+     direct_memcpy( overflow + 1, msg, msg_size );
+
+     direct_list_append( &ring->overflow, &overflow->link );
+
+     ring->overflow_bytes += msg_size;
+
+
+queued:
+     wakeup = D_SYNC_BOOL_COMPARE_AND_SWAP( &ring->sleeping, 1, 0 );
+
+     fusion_skirmish_dismiss( &ring->lock );
+
+     if (wakeup)
+          _fusion_ring_wakeup( world, fusion_id );
+
+     return DR_OK;
+}
+
+DirectResult
+_fusion_ring_send( FusionWorld *world,
+                   FusionID     fusion_id,
+                   const void  *msg,
+                   size_t       msg_size )
+{
+     return _fusion_ring_queue( world, fusion_id, msg, msg_size, 0 );
+}
+
+DirectResult
+_fusion_ring_send_coalesced( FusionWorld  *world,
+                             FusionID      fusion_id,
+                             const void   *msg,
+                             size_t        msg_size,
+                             unsigned int  key )
+{
+     D_ASSERT( key > 0 );
+     D_ASSERT( key <= msg_size );
+
+     return _fusion_ring_queue( world, fusion_id, msg, msg_size, key );
+}
+
+static inline bool
+_fusion_ring_pending( const FusionRing *ring )
+{
+     return ring->head != ring->tail || ring->overflow;
+}
+
+/*
+ * Announces that the dispatcher is going to sleep, unless there are pending messages.
+ */
+static bool
+_fusion_ring_sleep( FusionRing *ring )
+{
+     if (!ring)
+          return true;
+
+     D_MAGIC_ASSERT( ring, FusionRing );
+
+     D_SYNC_BOOL_COMPARE_AND_SWAP( &ring->sleeping, 0, 1 );
+
+     /* Another dispatcher reading the ring handles the pending messages. */
+     if (_fusion_ring_pending( ring ) && !D_SYNC_ADD_AND_FETCH( &ring->consumer, 0 )) {
+          ring->sleeping = 0;
+          return false;
+     }
+
+     return true;
+}
+
+typedef void (*FusionRingHandler)( FusionWorld *world, FusionMessage *msg, size_t msg_size, struct sockaddr_un *addr );
+
+static void
+_fusion_ring_process( FusionWorld       *world,
+                      FusionRing        *ring,
+                      FusionRingHandler  handler )
+{
+     char               *data = (char*)(ring + 1);
+     pid_t               pid  = ((__Fusionee*) world->fusionee)->pid;
+     FusionRingOverflow *overflow, *next;
+     DirectLink         *list;
+     bool                full;
+
+     D_MAGIC_ASSERT( ring, FusionRing );
+
+     while (D_SYNC_BOOL_COMPARE_AND_SWAP( &ring->consumer, 0, pid )) {
+          while (_fusion_ring_pending( ring )) {
+               /* Messages are processed in place, the space is released afterwards. */
+               while (ring->head != ring->tail) {
+                    FusionRingRecord *record = (FusionRingRecord*)(data + (ring->tail & (ring->size - 1)));
+
+                    if (record->length) {
+                         /* Producers must not coalesce with it anymore. */
+                         if (record->key)
+                              D_SYNC_ADD( &record->started, 1 );
+
+                         handler( world, (FusionMessage*)(record + 1), record->length, NULL );
+                    }
+
+                    D_SYNC_ADD( &ring->tail, record->size );
+               }
+
+               if (ring->overflow) {
+                    fusion_skirmish_prevail( &ring->lock );
+
+                    /* The overflow is newer than anything in the ring, producers may have filled it meanwhile. */
+                    if (ring->head != ring->tail) {
+                         fusion_skirmish_dismiss( &ring->lock );
+                         continue;
+                    }
+
+                    list = ring->overflow;
+                    full = ring->overflow_bytes >= FUSION_RING_OVERFLOW;
+
+                    ring->overflow       = NULL;
+                    ring->overflow_bytes = 0;
+
+                    fusion_skirmish_dismiss( &ring->lock );
+
+                    direct_list_foreach_safe (overflow, next, list) {
+                         handler( world, (FusionMessage*)(overflow + 1), overflow->length, NULL );
+
+                         SHFREE( world->shared->main_pool, overflow );
+                    }
+
+                    /* Let waiting senders continue. */
+                    if (full) {
+                         D_SYNC_ADD( &ring->drained, 1 );
+
+                         direct_futex_wake( &ring->drained, INT_MAX );
+                    }
+               }
+          }
+
+          D_SYNC_BOOL_COMPARE_AND_SWAP( &ring->consumer, pid, 0 );
+
+          /* Messages queued after the last check, while others saw us reading, are ours. */
+          if (!_fusion_ring_pending( ring ))
+               break;
+     }
+}
+
+/**********************************************************************************************************************/
+
 static void
 fusion_fork_handler_prepare( void )
 {
@@ -2177,6 +2647,9 @@ fusion_fork_handler_child( void )
                     
                     D_DEBUG_AT( Fusion_Main, "  -> forking in world %d\n", i );
 
+                    /* Cached shared memory objects belong to the parent. */
+                    __shmalloc_magazines_forked( &world->shm );
+
                     fusionee = world->fusionee;
                     
                     D_DEBUG_AT( Fusion_Main, "  -> duplicating fusion id %lu\n", world->fusion_id );
@@ -2663,6 +3136,9 @@ retry:
           fusion_call_set_name( &shared->refs_call, "world_refs" );
           fusion_call_add_permissions( &shared->refs_call, 0, FUSION_CALL_PERMIT_EXECUTE );
 
+          if (fusion_config->call_profile)
+               _fusion_call_profile_init( world );
+
           direct_map_create( 37, refs_map_compare, refs_map_hash, world, &world->refs_map );
      }
      else {
@@ -2850,6 +3326,8 @@ fusion_exit( FusionWorld *world,
                fusion_skirmish_destroy( &shared->arenas_lock );
                fusion_skirmish_destroy( &shared->fusionees_lock );
 
+               _fusion_call_profile_deinit( world );
+
                fusion_shm_pool_destroy( world, shared->main_pool );
           
                /* Deinitialize shared memory. */
@@ -3084,10 +3562,92 @@ refs_iterate( DirectMap    *map,
      return DENUM_OK;
 }
 
+static void
+fusion_dispatch_message( FusionWorld        *world,
+                         FusionMessage      *msg,
+                         size_t              msg_size,
+                         struct sockaddr_un *addr )
+{
+     if (world->dispatch_stop) {
+          D_DEBUG_AT( Fusion_Main_Dispatch, "  -> IGNORING (dispatch_stop!)\n" );
+          return;
+     }
+
+     switch (msg->type) {
+          case FMT_SEND:
+               D_DEBUG_AT( Fusion_Main_Dispatch, "  -> FMT_SEND...\n" );
+               break;
+
+          case FMT_ENTER:
+               D_DEBUG_AT( Fusion_Main_Dispatch, "  -> FMT_ENTER...\n" ); 
+               if (!fusion_master( world )) {
+                    D_ERROR( "Fusion/Dispatch: Got ENTER request, but I'm not master!\n" );
+                    break;
+               }
+               if (msg->enter.fusion_id == world->fusion_id) {
+                    D_ERROR( "Fusion/Dispatch: Received ENTER request from myself!\n" );
+                    break;
+               }
+               if (!addr) {
+                    D_BUG( "ENTER request not received via socket" );
+                    break;
+               }
+               /* Nothing to do here. Send back message. */
+               _fusion_send_message( world->fusion_fd, msg, sizeof(FusionEnter), addr );
+               break;
+
+          case FMT_LEAVE:
+               D_DEBUG_AT( Fusion_Main_Dispatch, "  -> FMT_LEAVE...\n" );
+               if (!fusion_master( world )) {
+                    D_ERROR( "Fusion/Dispatch: Got LEAVE request, but I'm not master!\n" );
+                    break;
+               }
+               if (world->fusion_id == FUSION_ID_MASTER) {
+                    direct_mutex_lock( &world->refs_lock );
+                    direct_map_iterate( world->refs_map, refs_iterate, &msg->leave.fusion_id );
+                    direct_mutex_unlock( &world->refs_lock );
+               }
+               if (msg->leave.fusion_id == world->fusion_id) {
+                    D_ERROR( "Fusion/Dispatch: Received LEAVE request from myself!\n" );
+                    break;
+               }
+               _fusion_remove_fusionee( world, msg->leave.fusion_id );
+               break;
+
+          case FMT_CALL:
+               D_DEBUG_AT( Fusion_Main_Dispatch, "  -> FMT_CALL...\n" );
+
+               if (((FusionCallMessage*)msg)->caller == 0)    // FIXME: currently caller is set to non-zero even for ref_watch
+                    handle_dispatch_cleanups( world );
+
+               _fusion_call_process( world, msg->call.call_id, &msg->call,
+                                     (msg_size != sizeof(FusionCallMessage)) ? (((FusionCallMessage*)msg) + 1) : NULL );
+               break;
+
+          case FMT_REACTOR:
+               D_DEBUG_AT( Fusion_Main_Dispatch, "  -> FMT_REACTOR...\n" );
+               _fusion_reactor_process_message( world, msg->reactor.id, msg->reactor.channel, 
+                                                (char*) msg + sizeof(FusionReactorMessage) );
+               if (msg->reactor.ref) {
+                    fusion_ref_down( msg->reactor.ref, true );
+                    if (fusion_ref_zero_trylock( msg->reactor.ref ) == DR_OK) {
+                         fusion_ref_destroy( msg->reactor.ref );
+                         SHFREE( world->shared->main_pool, msg->reactor.ref );
+                    }
+               }
+               break;                    
+
+          default:
+               D_BUG( "unexpected message type (%d)", msg->type );
+               break;
+     }
+}
+
 static void *
 fusion_dispatch_loop( DirectThread *self, void *arg )
 {
      FusionWorld        *world = arg;
+     FusionRing         *ring;
      struct sockaddr_un  addr;
      socklen_t           addr_len = sizeof(addr); 
      fd_set              set;
@@ -3095,16 +3655,25 @@ fusion_dispatch_loop( DirectThread *self, void *arg )
 
      D_DEBUG_AT( Fusion_Main_Dispatch, "%s() running...\n", __FUNCTION__ );
 
+     D_MAGIC_ASSERT( world, FusionWorld );
+
+     ring = ((__Fusionee*) world->fusionee)->ring;
+
      while (true) {
-          int     result;
-          ssize_t msg_size;
+          int            result;
+          ssize_t        msg_size;
+          struct timeval timeout = { 0, 0 };
           
           D_MAGIC_ASSERT( world, FusionWorld );
 
           FD_ZERO( &set );
           FD_SET( world->fusion_fd, &set );
 
-          result = select( world->fusion_fd + 1, &set, NULL, NULL, NULL );
+          /* Only poll the socket while messages are pending in the ring. */
+          result = select( world->fusion_fd + 1, &set, NULL, NULL, _fusion_ring_sleep( ring ) ? NULL : &timeout );
+          if (ring)
+               ring->sleeping = 0;
+
           if (result < 0) {
                switch (errno) {
                     case EINTR:
@@ -3120,83 +3689,36 @@ fusion_dispatch_loop( DirectThread *self, void *arg )
 
           if (FD_ISSET( world->fusion_fd, &set ) && 
               (msg_size = recvfrom( world->fusion_fd, buf, sizeof(buf), 0, (struct sockaddr*)&addr, &addr_len )) > 0) {
-               FusionMessage *msg = (FusionMessage*)buf;               
-
                pthread_setcancelstate( PTHREAD_CANCEL_DISABLE, NULL );
 
                D_DEBUG_AT( Fusion_Main_Dispatch, " -> message from '%s'...\n", addr.sun_path );
 
                direct_thread_lock( self );
 
-               if (world->dispatch_stop) {
-                    D_DEBUG_AT( Fusion_Main_Dispatch, "  -> IGNORING (dispatch_stop!)\n" );
-               }
-               else {
-                    switch (msg->type) {
-                         case FMT_SEND:
-                              D_DEBUG_AT( Fusion_Main_Dispatch, "  -> FMT_SEND...\n" );
-                              break;
+               fusion_dispatch_message( world, (FusionMessage*) buf, msg_size, &addr );
 
-                         case FMT_ENTER:
-                              D_DEBUG_AT( Fusion_Main_Dispatch, "  -> FMT_ENTER...\n" ); 
-                              if (!fusion_master( world )) {
-                                   D_ERROR( "Fusion/Dispatch: Got ENTER request, but I'm not master!\n" );
-                                   break;
-                              }
-                              if (msg->enter.fusion_id == world->fusion_id) {
-                                   D_ERROR( "Fusion/Dispatch: Received ENTER request from myself!\n" );
-                                   break;
-                              }
-                              /* Nothing to do here. Send back message. */
-                              _fusion_send_message( world->fusion_fd, msg, sizeof(FusionEnter), &addr );
-                              break;
+               handle_dispatch_cleanups( world );
 
-                         case FMT_LEAVE:
-                              D_DEBUG_AT( Fusion_Main_Dispatch, "  -> FMT_LEAVE...\n" );
-                              if (!fusion_master( world )) {
-                                   D_ERROR( "Fusion/Dispatch: Got LEAVE request, but I'm not master!\n" );
-                                   break;
-                              }
-                              if (world->fusion_id == FUSION_ID_MASTER) {
-                                   direct_mutex_lock( &world->refs_lock );
-                                   direct_map_iterate( world->refs_map, refs_iterate, &msg->leave.fusion_id );
-                                   direct_mutex_unlock( &world->refs_lock );
-                              }
-                              if (msg->leave.fusion_id == world->fusion_id) {
-                                   D_ERROR( "Fusion/Dispatch: Received LEAVE request from myself!\n" );
-                                   break;
-                              }
-                              _fusion_remove_fusionee( world, msg->leave.fusion_id );
-                              break;
+               direct_thread_unlock( self );
 
-                         case FMT_CALL:
-                              D_DEBUG_AT( Fusion_Main_Dispatch, "  -> FMT_CALL...\n" );
+               if (!world->refs) {
+                    D_DEBUG_AT( Fusion_Main_Dispatch, "  -> good bye!\n" );
+                    return NULL;
+               }
 
-                              if (((FusionCallMessage*)msg)->caller == 0)    // FIXME: currently caller is set to non-zero even for ref_watch
-                                   handle_dispatch_cleanups( world );
+               D_DEBUG_AT( Fusion_Main_Dispatch, " ...done\n" );
 
-                              _fusion_call_process( world, msg->call.call_id, &msg->call,
-                                                    (msg_size != sizeof(FusionCallMessage)) ? (((FusionCallMessage*)msg) + 1) : NULL );
-                              break;
+               pthread_setcancelstate( PTHREAD_CANCEL_ENABLE, NULL );
+          }
 
-                         case FMT_REACTOR:
-                              D_DEBUG_AT( Fusion_Main_Dispatch, "  -> FMT_REACTOR...\n" );
-                              _fusion_reactor_process_message( world, msg->reactor.id, msg->reactor.channel, 
-                                                               &buf[sizeof(FusionReactorMessage)] );
-                              if (msg->reactor.ref) {
-                                   fusion_ref_down( msg->reactor.ref, true );
-                                   if (fusion_ref_zero_trylock( msg->reactor.ref ) == DR_OK) {
-                                        fusion_ref_destroy( msg->reactor.ref );
-                                        SHFREE( world->shared->main_pool, msg->reactor.ref );
-                                   }
-                              }
-                              break;                    
+          if (ring && _fusion_ring_pending( ring )) {
+               pthread_setcancelstate( PTHREAD_CANCEL_DISABLE, NULL );
 
-                         default:
-                              D_BUG( "unexpected message type (%d)", msg->type );
-                              break;
-                    }
-               }
+               D_DEBUG_AT( Fusion_Main_Dispatch, " -> messages in ring...\n" );
+
+               direct_thread_lock( self );
+
+               _fusion_ring_process( world, ring, fusion_dispatch_message );
 
                handle_dispatch_cleanups( world );
 
@@ -3207,8 +3729,6 @@ fusion_dispatch_loop( DirectThread *self, void *arg )
                     return NULL;
                }
 
-               D_DEBUG_AT( Fusion_Main_Dispatch, " ...done\n" );
-
                pthread_setcancelstate( PTHREAD_CANCEL_ENABLE, NULL );
           }
      }
@@ -60,6 +60,18 @@
 
 #define EXECUTE3_BIN_FLUSH_MILLIS    16
 
+#if FUSION_BUILD_MULTI && !FUSION_BUILD_KERNEL
+# define FUSION_RING_MAX_IDS  64           /* Fusion IDs having a message ring, others use the socket only (logged). */
+# define FUSION_RING_SIZE     (128 * 1024) /* Power of two. */
+# define FUSION_RING_OVERFLOW (64 * 1024)  /* Bytes queued beyond the ring before senders wait for the dispatcher (main pool is 1 MB). */
+
+typedef struct __Fusion_FusionRing FusionRing;
+#endif
+
+#if FUSION_BUILD_MULTI
+typedef struct __Fusion_FusionCallProfileTable FusionCallProfileTable;
+#endif
+
 /***************************************
  *  Fusion internal type declarations  *
  ***************************************/
@@ -103,6 +115,14 @@ struct __Fusion_FusionWorldShared {
      FusionCall           refs_call;
 
      FusionHash          *call_hash;
+
+#if FUSION_BUILD_MULTI
+     FusionCallProfileTable *call_profile;  /* Only with the "call-profile" option, see profile.c. */
+#endif
+
+#if FUSION_BUILD_MULTI && !FUSION_BUILD_KERNEL
+     FusionRing          *rings[FUSION_RING_MAX_IDS];  /* Message rings by Fusion ID, see _fusion_ring_send(). */
+#endif
 };
 
 #if !FUSION_BUILD_MULTI
@@ -167,6 +187,14 @@ struct __Fusion_FusionWorld {
      DirectLink          *reactor_nodes;
      DirectMutex          reactor_nodes_lock;
 
+     /*
+      * Published copies for lock-free dispatch, see reactor.c.
+      */
+     void                *reactor_index;       /* nodes sorted by reactor id */
+     int                  reactor_epoch;
+     int                  reactor_readers[2];  /* running dispatches per epoch */
+     DirectLink          *reactor_retired[2];  /* retired in current and previous epoch */
+
      FusionSHM            shm;
 
      FusionForkAction     fork_action;
@@ -299,6 +327,22 @@ void _fusion_call_process ( FusionWorld        *world,
                             FusionCallMessage  *call,
                             void               *ptr );
 
+/*
+ * from profile.c
+ */
+DirectResult _fusion_call_profile_init  ( FusionWorld *world );
+void         _fusion_call_profile_deinit( FusionWorld *world );
+
+/*
+ * Accounts a call that has been queued at 'queued' (or 0 if unknown) and was handled since 'start'.
+ */
+void         _fusion_call_profile_add   ( FusionWorld *world,
+                                          void        *handler,
+                                          int          call_arg,
+                                          FusionID     caller,
+                                          long long    queued,
+                                          long long    start );
+
 #if FUSION_BUILD_KERNEL
 
 void _fusion_call_process3( FusionWorld        *world,
@@ -335,6 +379,25 @@ DirectResult _fusion_recv_message( int                  fd,
                                    size_t               msg_size,
                                    struct sockaddr_un  *addr );
 
+/*
+ * Queues a message in the shared memory ring of the fusionee.
+ * Returns DR_UNSUPPORTED if the fusionee has no ring, the socket has to be used then.
+ */
+DirectResult _fusion_ring_send   ( FusionWorld         *world,
+                                   FusionID             fusion_id,
+                                   const void          *msg,
+                                   size_t               msg_size );
+
+/*
+ * Like _fusion_ring_send(), but drops the message if the latest pending one starting with
+ * the same key bytes is identical and not being handled yet.
+ */
+DirectResult _fusion_ring_send_coalesced( FusionWorld   *world,
+                                          FusionID       fusion_id,
+                                          const void    *msg,
+                                          size_t         msg_size,
+                                          unsigned int   key );
+
 /*
  * from ref.c
  */
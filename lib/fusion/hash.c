@@ -44,6 +44,7 @@
 #include <string.h>
 
 #include <direct/debug.h>
+#include <direct/hash.h>
 #include <direct/mem.h>
 #include <direct/memcpy.h>
 #include <direct/util.h>
@@ -62,98 +63,256 @@ D_DEBUG_DOMAIN( Fusion_Hash, "Fusion/Hash", "Hash table implementation" );
             h = (h << 5) - h + *p;\
 }\
 
-static const unsigned int primes[] =
-{
-     11,
-     19,
-     37,
-     73,
-     109,
-     163,
-     251,
-     367,
-     557,
-     823,
-     1237,
-     1861,
-     2777,
-     4177,
-     6247,
-     9371,
-     14057,
-     21089,
-     31627,
-     47431,
-     71143,
-     106721,
-     160073,
-     240101,
-     360163,
-     540217,
-     810343,
-     1215497,
-     1823231,
-     2734867,
-     4102283,
-     6153409,
-     9230113,
-     13845163,
-};
-
-
-static const unsigned int nprimes = D_ARRAY_SIZE( primes );
-
 static DirectResult
 fusion_hash_create_internal(bool type,FusionSHMPoolShared *pool,
                             FusionHashType key_type,
                             FusionHashType value_type,
                             int  size, FusionHash **ret_hash );
 
+#define FUSION_HASH_MIGRATE_STEP  16    /* Nodes of the old table moved per insertion or removal while growing. */
+
 static void
 fusion_hash_node_destroy (FusionHash *hash,FusionHashNode *node,
                           void **old_key,void **old_value);
 
-static unsigned int
-spaced_primes_closest (unsigned int num)
-{
-     unsigned int i;
-     for (i = 0; i < nprimes; i++)
-          if (primes[i] > num)
-               return primes[i];
-     return primes[nprimes - 1];
-}
-
-static __inline__ FusionHashNode**
-fusion_hash_lookup_node (FusionHash *hash,
-                         const void *key)
+static __inline__ unsigned int
+fusion_hash_key (const FusionHash *hash,
+                 const void       *key)
 {
-     FusionHashNode **node;
-
-     /*TODO We could also optimize pointer hashing*/
-     if (hash->key_type == HASH_STRING )
-     {
+     if (hash->key_type == HASH_STRING ) {
           unsigned int h;
           const signed char *p = key;
           HASH_STR(h,p)
-          node = &hash->nodes[h % hash->size];
+
+          /* Similar strings give similar values, mix them completely. */
+          h ^= h >> 16;
+          h *= 0x85ebca6b;
+          h ^= h >> 13;
+          h *= 0xc2b2ae35;
+          h ^= h >> 16;
+
+          return h;
      }
+
+     return direct_hash_mix( (unsigned long) key );
+}
+
+static FusionHashNode *
+fusion_hash_nodes_alloc (FusionHash *hash, int size)
+{
+     if (hash->local)
+          return D_CALLOC( size, sizeof(FusionHashNode) );
+
+     return SHCALLOC( hash->pool, size, sizeof(FusionHashNode) );
+}
+
+static void
+fusion_hash_nodes_free (FusionHash *hash, FusionHashNode *nodes)
+{
+     if (hash->local)
+          D_FREE( nodes );
      else
-          node = &hash->nodes[((unsigned long)key) % hash->size];
+          SHFREE( hash->pool, nodes );
+}
 
-     /* Hash table lookup needs to be fast.
-     *  We therefore remove the extra conditional of testing
-     *  whether to call the key_equal_func or not from
-     *  the inner loop.
-     */
-     if (hash->key_type == HASH_STRING ) {
-          while(*node && strcmp((const char *)(*node)->key,(const char*)key))
-               node = &(*node)->next;
-     } else
-          while (*node && (*node)->key != key)
-               node = &(*node)->next;
+/*
+ * Removed nodes of the old table keep their hash, so searching can still
+ * stop at the first node being closer to its home slot than the key would be.
+ */
+static __inline__ FusionHashNode *
+fusion_hash_nodes_locate (const FusionHash *hash,
+                          FusionHashNode   *nodes,
+                          int               size,
+                          const void       *key,
+                          unsigned int      h)
+{
+     unsigned int mask = size - 1;
+     unsigned int pos  = h & mask;
+     unsigned int distance;
+
+     for (distance = 0; ; distance++) {
+          FusionHashNode *node = &nodes[pos];
+
+          if (!node->used || ((pos - node->hash) & mask) < distance)
+               return NULL;
+
+          if (node->hash == h && !node->removed) {
+               if (hash->key_type == HASH_STRING) {
+                    if (!strcmp( (const char *) node->key, (const char *) key ))
+                         return node;
+               }
+               else if (node->key == key)
+                    return node;
+          }
+
+          pos = (pos + 1) & mask;
+     }
+}
+
+/*
+ * Places a key that is not in the table, taking the slot of any node being
+ * closer to its home slot.
+ */
+static void
+fusion_hash_nodes_place (FusionHashNode *nodes,
+                         int             size,
+                         void           *key,
+                         void           *value,
+                         unsigned int    h)
+{
+     unsigned int   mask     = size - 1;
+     unsigned int   pos      = h & mask;
+     unsigned int   distance = 0;
+     FusionHashNode entry    = { key, value, h, 1, 0 };
+
+     while (true) {
+          FusionHashNode *node = &nodes[pos];
+          unsigned int    other;
+
+          if (!node->used) {
+               *node = entry;
+               return;
+          }
+
+          other = (pos - node->hash) & mask;
+          if (other < distance) {
+               FusionHashNode temp = *node;
+
+               *node    = entry;
+               entry    = temp;
+               distance = other;
+          }
+
+          pos = (pos + 1) & mask;
+
+          distance++;
+     }
+}
+
+/*
+ * Removes the node by shifting the following ones back, leaving no tombstones.
+ */
+static void
+fusion_hash_nodes_erase (FusionHashNode *nodes,
+                         int             size,
+                         FusionHashNode *node)
+{
+     unsigned int mask = size - 1;
+     unsigned int pos  = node - nodes;
+     unsigned int next = (pos + 1) & mask;
+
+     while (nodes[next].used && ((next - nodes[next].hash) & mask)) {
+          nodes[pos] = nodes[next];
+
+          pos  = next;
+          next = (next + 1) & mask;
+     }
+
+     memset( &nodes[pos], 0, sizeof(FusionHashNode) );
+}
+
+static FusionHashNode *
+fusion_hash_lookup_node (FusionHash   *hash,
+                         const void   *key,
+                         unsigned int  h)
+{
+     FusionHashNode *node;
+
+     node = fusion_hash_nodes_locate( hash, hash->nodes, hash->size, key, h );
+
+     if (!node && hash->old_nodes)
+          node = fusion_hash_nodes_locate( hash, hash->old_nodes, hash->old_size, key, h );
 
      return node;
+}
+
+static void
+fusion_hash_migrate (FusionHash *hash,
+                     int         count)
+{
+     D_ASSERT( hash->old_nodes != NULL );
+
+     while (count-- && hash->migrate < hash->old_size) {
+          FusionHashNode *node = &hash->old_nodes[hash->migrate++];
+
+          if (node->used && !node->removed) {
+               fusion_hash_nodes_place( hash->nodes, hash->size, node->key, node->value, node->hash );
+
+               node->removed = 1;
 
+               hash->old_nnodes--;
+          }
+     }
+
+     if (hash->migrate == hash->old_size || !hash->old_nnodes) {
+          D_DEBUG_AT( Fusion_Hash, "Finished resizing to %d (nnodes %d).\n", hash->size, hash->nnodes );
+
+          D_ASSERT( hash->old_nnodes == 0 );
+
+          fusion_hash_nodes_free( hash, hash->old_nodes );
+
+          hash->old_nodes = NULL;
+          hash->old_size  = 0;
+          hash->migrate   = 0;
+     }
+}
+
+/*
+ * Starts moving the nodes into a table of the new size.
+ */
+static DirectResult
+fusion_hash_start_resize (FusionHash *hash,
+                          int         new_size)
+{
+     FusionHashNode *new_nodes;
+
+     /* Still moving nodes of the last resize, finish it now. */
+     if (hash->old_nodes)
+          fusion_hash_migrate( hash, hash->old_size );
+
+     D_DEBUG_AT( Fusion_Hash, "Resizing from %d to %d... (nnodes %d)\n", hash->size, new_size, hash->nnodes );
+
+     new_nodes = fusion_hash_nodes_alloc( hash, new_size );
+     if (!new_nodes)
+          return hash->local?DR_NOLOCALMEMORY:DR_NOSHAREDMEMORY;
+
+     hash->old_nodes  = hash->nodes;
+     hash->old_size   = hash->size;
+     hash->old_nnodes = hash->nnodes;
+     hash->migrate    = 0;
+
+     hash->nodes      = new_nodes;
+     hash->size       = new_size;
+
+     return DR_OK;
+}
+
+static DirectResult
+fusion_hash_add (FusionHash   *hash,
+                 void         *key,
+                 void         *value,
+                 unsigned int  h)
+{
+     if (hash->old_nodes)
+          fusion_hash_migrate( hash, FUSION_HASH_MIGRATE_STEP );
+
+     /* Keep the load below 3/4, counting the nodes still to be moved. */
+     if ((hash->nnodes + 1) * 4 > hash->size * 3 && hash->size < FUSION_HASH_MAX_SIZE) {
+          DirectResult ret = fusion_hash_start_resize( hash, hash->size * 2 );
+
+          /* Go on without growing while there is still a free slot. */
+          if (ret && hash->nnodes - hash->old_nnodes + 1 >= hash->size)
+               return ret;
+     }
+
+     if (hash->nnodes - hash->old_nnodes + 1 >= hash->size)
+          return DR_LIMITEXCEEDED;
+
+     fusion_hash_nodes_place( hash->nodes, hash->size, key, value, h );
+
+     hash->nnodes++;
+
+     return DR_OK;
 }
 
 /**
@@ -210,6 +369,8 @@ fusion_hash_create_internal (bool local,FusionSHMPoolShared *pool,
 
      if (size < FUSION_HASH_MIN_SIZE)
           size = FUSION_HASH_MIN_SIZE;
+     if (size > FUSION_HASH_MAX_SIZE)
+          size = FUSION_HASH_MAX_SIZE;
 
      if (local)
           hash = D_CALLOC(1, sizeof (FusionHash) );
@@ -223,12 +384,9 @@ fusion_hash_create_internal (bool local,FusionSHMPoolShared *pool,
      hash->pool               = pool;
      hash->key_type           = key_type;
      hash->value_type         = value_type;
-     hash->size               = size;
+     hash->size               = 1 << direct_log2( size );
      hash->nnodes             = 0;
-     if (local)
-          hash->nodes = D_CALLOC(size,sizeof (FusionHashNode*) );
-     else
-          hash->nodes = SHCALLOC(pool, size, sizeof(FusionHashNode*) );
+     hash->nodes              = fusion_hash_nodes_alloc( hash, hash->size );
 
      if (!hash->nodes) {
           if (local)
@@ -249,19 +407,22 @@ void
 fusion_hash_destroy( FusionHash *hash )
 {
      int i;
-     FusionHashNode *node, *next;
      D_MAGIC_ASSERT( hash, FusionHash );
 
      for (i = 0; i < hash->size; i++) {
-          for (node = hash->nodes[i]; node; node = next) {
-               next = node->next;
-               fusion_hash_node_destroy(hash, node, NULL, NULL);
+          if (hash->nodes[i].used)
+               fusion_hash_node_destroy(hash, &hash->nodes[i], NULL, NULL);
+     }
+     fusion_hash_nodes_free( hash, hash->nodes );
+
+     if (hash->old_nodes) {
+          for (i = 0; i < hash->old_size; i++) {
+               if (hash->old_nodes[i].used && !hash->old_nodes[i].removed)
+                    fusion_hash_node_destroy(hash, &hash->old_nodes[i], NULL, NULL);
           }
+          fusion_hash_nodes_free( hash, hash->old_nodes );
      }
-     if (hash->local)
-          D_FREE(hash->nodes);
-     else
-          SHFREE( hash->pool, hash->nodes );
+
      D_MAGIC_CLEAR( hash );
      if (hash->local)
           D_FREE(hash);
@@ -295,7 +456,7 @@ fusion_hash_lookup (FusionHash *hash, const void * key)
 {
      FusionHashNode *node;
      D_MAGIC_ASSERT( hash, FusionHash );
-     node = *fusion_hash_lookup_node (hash, key);
+     node = fusion_hash_lookup_node (hash, key, fusion_hash_key (hash, key));
      return node ? node->value : NULL;
 }
 
@@ -315,30 +476,17 @@ fusion_hash_insert( FusionHash *hash,
                     void       *key,
                     void       *value )
 {
-     FusionHashNode **node;
+     unsigned int h;
      D_MAGIC_ASSERT( hash, FusionHash );
 
-     node = fusion_hash_lookup_node (hash, key);
+     h = fusion_hash_key (hash, key);
 
-     if (*node) {
+     if (fusion_hash_lookup_node (hash, key, h)) {
           D_BUG( "key already exists" );
           return DR_BUG;
      }
-     else {
-          if (hash->local)
-               (*node) = D_CALLOC(1,sizeof(FusionHashNode));
-          else
-               (*node) = SHCALLOC(hash->pool, 1, sizeof(FusionHashNode));
-          if ( !(*node) )
-               return hash->local?DR_NOLOCALMEMORY:DR_NOSHAREDMEMORY;
-
-          (*node)->key = key;
-          (*node)->value = value;
-          hash->nnodes++;
-          if ( fusion_hash_should_resize(hash) )
-               fusion_hash_resize(hash);
-     }
-     return DR_OK;
+
+     return fusion_hash_add (hash, key, value, h);
 }
 
 /**
@@ -361,56 +509,43 @@ fusion_hash_replace (FusionHash *hash,
                      void **old_key,
                      void **old_value)
 {
-     FusionHashNode **node;
+     unsigned int    h;
+     FusionHashNode *node;
      D_MAGIC_ASSERT( hash, FusionHash );
 
-     node = fusion_hash_lookup_node (hash, key);
+     h    = fusion_hash_key (hash, key);
+     node = fusion_hash_lookup_node (hash, key, h);
 
-     if (*node) {
+     if (node) {
           if ( old_key)
-               *old_key = (*node)->key;
+               *old_key = node->key;
           else if ( hash->key_type != HASH_INT ) {
                if (hash->free_keys) {
                     if (hash->local)
-                         D_FREE((*node)->key);
+                         D_FREE(node->key);
                     else
-                         SHFREE(hash->pool, (*node)->key );
+                         SHFREE(hash->pool, node->key );
                }
           }
 
           if ( old_value)
-               *old_value = (*node)->value;
+               *old_value = node->value;
           else if ( hash->value_type != HASH_INT ) {
                if (hash->free_values) {
                     if (hash->local)
-                         D_FREE((*node)->value);
+                         D_FREE(node->value);
                     else
-                         SHFREE(hash->pool, (*node)->value );
+                         SHFREE(hash->pool, node->value );
                }
           }
 
-          (*node)->key = (void*)key;
-          (*node)->value = (void*)value;
-     }
-     else {
-          if (hash->local)
-               *node = D_CALLOC(1, sizeof(FusionHashNode));
-          else
-               *node = SHCALLOC(hash->pool, 1, sizeof(FusionHashNode));
+          node->key = (void*)key;
+          node->value = (void*)value;
 
-          if ( !(*node) )
-               return hash->local?DR_NOLOCALMEMORY:DR_NOSHAREDMEMORY;
-
-          (*node)->key = (void*)key;
-          (*node)->value = (void*)value;
-
-          hash->nnodes++;
-
-          if (fusion_hash_should_resize(hash))
-               fusion_hash_resize(hash);
+          return DR_OK;
      }
 
-     return DR_OK;
+     return fusion_hash_add (hash, key, value, h);
 }
 
 /**
@@ -436,17 +571,31 @@ fusion_hash_remove (FusionHash    *hash,
                     void **old_key,
                     void **old_value)
 {
-     FusionHashNode **node, *dest;
+     unsigned int    h;
+     FusionHashNode *node;
      D_MAGIC_ASSERT( hash, FusionHash );
 
-     node = fusion_hash_lookup_node (hash, key);
-     if (*node) {
-          dest = *node;
-          (*node) = dest->next;
-          fusion_hash_node_destroy(hash, dest, old_key, old_value);
+     h    = fusion_hash_key (hash, key);
+     node = fusion_hash_nodes_locate (hash, hash->nodes, hash->size, key, h);
+     if (node) {
+          fusion_hash_node_destroy(hash, node, old_key, old_value);
+          fusion_hash_nodes_erase(hash->nodes, hash->size, node);
           hash->nnodes--;
-          return DR_OK;
      }
+     else if (hash->old_nodes) {
+          node = fusion_hash_nodes_locate (hash, hash->old_nodes, hash->old_size, key, h);
+          if (node) {
+               /* Nodes are moved in slot order, shifting them back could skip one. */
+               fusion_hash_node_destroy(hash, node, old_key, old_value);
+               node->removed = 1;
+               hash->old_nnodes--;
+               hash->nnodes--;
+          }
+     }
+
+     if (hash->old_nodes)
+          fusion_hash_migrate( hash, FUSION_HASH_MIGRATE_STEP );
+
      return DR_OK;
 }
 
@@ -460,27 +609,50 @@ fusion_hash_remove (FusionHash    *hash,
  * #FusionHash.  The function is passed the key and value of each
  * pair, and the given @user_data parameter.  The hash table may not
  * be modified while iterating over it (you can't add/remove
- * items). To remove all items matching a predicate, use
- * hash_foreach_remove().
+ * items) except for removing the current one.
  **/
 void
 fusion_hash_iterate( FusionHash             *hash,
                      FusionHashIteratorFunc  func,
                      void                   *ctx )
 {
-     int i;
+     int i, start;
      FusionHashNode *node;
-     FusionHashNode *next;
 
      D_MAGIC_ASSERT( hash, FusionHash );
 
-     for (i = 0; i < hash->size; i++) {
-          for (node = hash->nodes[i]; node; node = next) {
-               next = node->next;
+     /* Removing nodes moves others while growing, finish it first as all nodes are visited anyway. */
+     if (hash->old_nodes)
+          fusion_hash_migrate( hash, hash->old_size );
+
+     /* Start where no cluster wraps around, i.e. at an empty node or one at its home slot. */
+     for (start = 0; start < hash->size; start++) {
+          node = &hash->nodes[start];
+
+          if (!node->used || !((start - node->hash) & (hash->size - 1)))
+               break;
+     }
+
+     if (start == hash->size)
+          start = 0;
+
+     for (i = 0; i < hash->size; ) {
+          void *key;
+
+          node = &hash->nodes[(start + i) & (hash->size - 1)];
+          key  = node->key;
 
-               if ( func(hash, node->key, node->value, ctx))
-                    return;
+          if (!node->used) {
+               i++;
+               continue;
           }
+
+          if ( func(hash, key, node->value, ctx))
+               return;
+
+          /* Removing the node shifts the next one into its slot. */
+          if (!node->used || node->key == key)
+               i++;
      }
 }
 
@@ -501,17 +673,15 @@ fusion_hash_size (FusionHash *hash)
 
 /**
  * fusion_hash_should_resize:
- * Call the function after adding or removing several
- * values it has a decent heurisitc to determine if
- * the hash has grown to large
+ * Call the function after removing several values,
+ * it has a decent heurisitc to determine if the hash
+ * has become too large. Growing happens on insertion.
  */
 bool fusion_hash_should_resize ( FusionHash    *hash)
 {
      D_MAGIC_ASSERT( hash, FusionHash );
-     if ((hash->size >= 3 * hash->nnodes &&
-          hash->size > FUSION_HASH_MIN_SIZE) ||
-         (3 * hash->size <= hash->nnodes &&
-          hash->size < FUSION_HASH_MAX_SIZE))
+     if (hash->size >= 8 * hash->nnodes &&
+         hash->size > FUSION_HASH_MIN_SIZE)
           return true;
      return false;
 }
@@ -522,50 +692,27 @@ bool fusion_hash_should_resize ( FusionHash    *hash)
 DirectResult
 fusion_hash_resize (FusionHash *hash)
 {
-     FusionHashNode **new_nodes;
-     FusionHashNode *node;
-     FusionHashNode *next;
-     unsigned int hash_val;
-     int new_size;
-     int i;
+     DirectResult ret;
+     int          new_size;
      D_MAGIC_ASSERT( hash, FusionHash );
 
-     new_size = spaced_primes_closest (hash->nnodes);
+     new_size = 1 << direct_log2( hash->nnodes * 2 );
      if (new_size > FUSION_HASH_MAX_SIZE )
           new_size = FUSION_HASH_MAX_SIZE;
      if (new_size <  FUSION_HASH_MIN_SIZE)
           new_size = FUSION_HASH_MIN_SIZE;
 
-     if (hash->local)
-          new_nodes = D_CALLOC (new_size, sizeof(FusionHashNode*));
-     else
-          new_nodes = SHCALLOC (hash->pool, new_size, sizeof(FusionHashNode*));
-     if (!new_nodes)
-          return hash->local?DR_NOLOCALMEMORY:DR_NOSHAREDMEMORY;
+     if (new_size == hash->size)
+          return DR_OK;
 
-     for (i = 0; i < hash->size; i++)
-          for (node = hash->nodes[i]; node; node = next) {
-               next = node->next;
-               /*TODO We could also optimize pointer hashing*/
-               if (hash->key_type == HASH_STRING ) {
-                    unsigned int h;
-                    const signed char *p = node->key;
-                    HASH_STR(h, p)
-                    hash_val = h % new_size;
-               }
-               else
-                    hash_val = ((unsigned long)node->key) % new_size;
+     ret = fusion_hash_start_resize( hash, new_size );
+     if (ret)
+          return ret;
 
-               node->next = new_nodes[hash_val];
-               new_nodes[hash_val] = node;
-          }
-     if (hash->local)
-          D_FREE(hash->nodes);
-     else
-          SHFREE(hash->pool, hash->nodes);
-     hash->nodes = new_nodes;
-     hash->size = new_size;
-     return true;
+     /* Explicit resizing does it at once. */
+     fusion_hash_migrate( hash, hash->old_size );
+
+     return DR_OK;
 }
 
 
@@ -597,10 +744,4 @@ fusion_hash_node_destroy (FusionHash *hash,FusionHashNode *node,
                     SHFREE(hash->pool,node->value );
           }
      }
-
-     if ( hash->local)
-          D_FREE(node);
-     else
-          SHFREE(hash->pool,node);
 }
-
@@ -45,8 +45,8 @@
 #include <fusion/shmalloc.h>
 #include <string.h>
 
-#define FUSION_HASH_MIN_SIZE 11
-#define FUSION_HASH_MAX_SIZE 13845163
+#define FUSION_HASH_MIN_SIZE 16
+#define FUSION_HASH_MAX_SIZE (1 << 24)
 
 typedef enum {
 HASH_PTR,
@@ -59,11 +59,20 @@ typedef struct _FusionHashNode  FusionHashNode;
 
 struct _FusionHashNode
 {
-    void      *key;
-    void      *value;
-    FusionHashNode *next;
+    void           *key;
+    void           *value;
+    unsigned int    hash;     /* mixed hash of the key, the home slot is hash & (size - 1) */
+    unsigned short  used;
+    unsigned short  removed;  /* moved or removed node of the old table */
 };
 
+/*
+ * Robin Hood hash with open addressing in a power of two table.
+ *
+ * Growing allocates the doubled table and moves a few nodes of the old one on
+ * each insertion or removal, all remaining ones when iterating. Until then
+ * lookups check both tables.
+ */
 struct __Fusion_FusionHash
 {
     int       magic;
@@ -71,12 +80,17 @@ struct __Fusion_FusionHash
     FusionHashType key_type;
     FusionHashType value_type;
     int             size;
-    int             nnodes;
-    FusionHashNode      **nodes;
+    int             nnodes;     /* entries in both tables */
+    FusionHashNode      *nodes;
     FusionSHMPoolShared *pool;
 
     bool  free_keys;
     bool  free_values;
+
+    int             old_size;
+    int             old_nnodes;
+    int             migrate;    /* next node of the old table to be moved */
+    FusionHashNode *old_nodes;
 };
 
 typedef bool (*FusionHashIteratorFunc)( FusionHash *hash,
@@ -137,34 +151,28 @@ bool FUSION_API fusion_hash_should_resize ( FusionHash    *hash);
 typedef struct {
      FusionHash     *hash;
      int             index;
-     FusionHashNode *next;
 } FusionHashIterator;
 
 static inline void *
 fusion_hash_iterator_next( FusionHashIterator *iterator )
 {
-     FusionHashNode *node = NULL;
+     FusionHash     *hash = iterator->hash;
+     FusionHashNode *node;
 
-     if (iterator->next) {
-          node           = iterator->next;
-          iterator->next = node->next;
-     }
-     else {
-          FusionHash *hash = iterator->hash;
-
-          D_MAGIC_ASSERT( hash, FusionHash );
+     D_MAGIC_ASSERT( hash, FusionHash );
 
-          for (iterator->index++; iterator->index < hash->size; iterator->index++) {
-               node = hash->nodes[iterator->index];
-               if (node) {
-                    iterator->next = node->next;
+     /* Indices beyond the size refer to nodes of the old table. */
+     while (++iterator->index < hash->size + hash->old_size) {
+          if (iterator->index < hash->size)
+               node = &hash->nodes[iterator->index];
+          else
+               node = &hash->old_nodes[iterator->index - hash->size];
 
-                    break;
-               }
-          }
+          if (node->used && !node->removed)
+               return node->value;
      }
 
-     return node ? node->value : NULL;
+     return NULL;
 }
 
 static inline void *
@@ -175,7 +183,6 @@ fusion_hash_iterator_init( FusionHashIterator *iterator,
 
      iterator->hash  = hash;
      iterator->index = -1;
-     iterator->next  = NULL;
 
      return fusion_hash_iterator_next( iterator );
 }
@@ -37,6 +37,7 @@
 #include <fusion/call.h>
 #include <fusion/conf.h>
 #include <fusion/init.h>
+#include <fusion/reactor.h>
 
 /**********************************************************************************************************************/
 
@@ -46,9 +47,11 @@ typedef void (*Func)( void );
 static Func init_funcs[] = {
      __Fusion_conf_init,
      __Fusion_call_init,
+     __Fusion_reactor_init,
 };
 
 static Func deinit_funcs[] = {
+     __Fusion_reactor_deinit,
      __Fusion_call_deinit,
      __Fusion_conf_deinit,
 };
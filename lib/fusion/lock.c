@@ -536,17 +536,93 @@ fusion_skirmish_add_permissions( FusionSkirmish            *skirmish,
 
 #else /* FUSION_BUILD_KERNEL */
 
+#include <direct/atomic.h>
 #include <direct/clock.h>
-#include <direct/list.h>
 #include <direct/system.h>
 
-typedef struct {
-     DirectLink  link;
-     
-     pid_t       pid;
-     bool        notified;
-} WaitNode;
+/*
+ * The builtin implementation uses a priority inheriting futex in shared memory.
+ *
+ * The futex holds the thread id of the owner, so the kernel knows whom to boost and
+ * reports when the owner is gone. Waiters that are blocked at that time get the lock
+ * handed over, all others see ESRCH and take it over.
+ */
+
+static DirectResult
+skirmish_lock( FusionSkirmish *skirmish,
+               int             tid,
+               bool            block )
+{
+     DirectResult  ret;
+     int          *futex = &skirmish->multi.builtin.futex;
+
+     while (!D_SYNC_BOOL_COMPARE_AND_SWAP( futex, 0, tid )) {
+          int val;
+
+          ret = direct_futex( futex, block ? FUTEX_LOCK_PI : FUTEX_TRYLOCK_PI, 0, NULL, NULL, 0 );
+          if (ret == DR_OK)
+               break;
+
+          switch (ret) {
+               case DR_SIGNALLED:
+                    continue;
+
+               case DR_BUSY:
+                    /* Locked by another thread (trylock) or the owner is just exiting. */
+                    if (!block)
+                         return DR_BUSY;
+
+                    direct_sched_yield();
+                    continue;
 
+               default:
+                    if (errno != ESRCH) {
+                         D_DERROR( ret, "Fusion/Skirmish: FUTEX_%sLOCK_PI failed!\n", block ? "" : "TRY" );
+                         return ret;
+                    }
+          }
+
+          /*
+           * The owner exited without unlocking. Keep FUTEX_WAITERS, so that unlocking
+           * goes through the kernel for waiters which queued up meanwhile.
+           */
+          val = *futex;
+
+          if (val && D_SYNC_BOOL_COMPARE_AND_SWAP( futex, val, tid | (val & FUTEX_WAITERS) ))
+               break;
+     }
+
+     /* The recursion count is only left behind by a dead owner. */
+     if (skirmish->multi.builtin.locked) {
+          D_WARN( "skirmish 0x%08x taken over from dead owner", skirmish->multi.id );
+
+          skirmish->multi.builtin.locked = 0;
+     }
+
+     return DR_OK;
+}
+
+static void
+skirmish_unlock( FusionSkirmish *skirmish,
+                 int             tid )
+{
+     DirectResult  ret;
+     int          *futex = &skirmish->multi.builtin.futex;
+
+     /* Let the kernel pick the next owner if there are waiters. */
+     if (!D_SYNC_BOOL_COMPARE_AND_SWAP( futex, tid, 0 )) {
+          ret = direct_futex( futex, FUTEX_UNLOCK_PI, 0, NULL, NULL, 0 );
+          if (ret)
+               D_DERROR( ret, "Fusion/Skirmish: FUTEX_UNLOCK_PI failed!\n" );
+     }
+}
+
+static inline bool
+skirmish_owned( const FusionSkirmish *skirmish,
+                int                   tid )
+{
+     return (skirmish->multi.builtin.futex & FUTEX_TID_MASK) == tid;
+}
 
 DirectResult
 fusion_skirmish_init( FusionSkirmish    *skirmish,
@@ -563,12 +639,10 @@ fusion_skirmish_init( FusionSkirmish    *skirmish,
      skirmish->multi.id = ++world->shared->lock_ids;
      
      /* Set state to unlocked. */
+     skirmish->multi.builtin.futex  = 0;
      skirmish->multi.builtin.locked = 0;
-     skirmish->multi.builtin.owner  = 0;
+     skirmish->multi.builtin.notify = 0;
 
-     skirmish->multi.builtin.waiting = NULL;
-    
-     skirmish->multi.builtin.requested = false;
      skirmish->multi.builtin.destroyed = false;
      
      /* Keep back pointer to shared world data. */
@@ -614,6 +688,9 @@ fusion_skirmish_init2( FusionSkirmish    *skirmish,
 DirectResult
 fusion_skirmish_prevail( FusionSkirmish *skirmish )
 {
+     DirectResult ret;
+     int          tid;
+
      D_ASSERT( skirmish != NULL );
      
      D_DEBUG_AT( Fusion_Skirmish, "fusion_skirmish_prevail( %p )\n", skirmish );
@@ -634,43 +711,21 @@ fusion_skirmish_prevail( FusionSkirmish *skirmish )
 
      if (skirmish->multi.builtin.destroyed)
           return DR_DESTROYED;
-          
-     asm( "" ::: "memory" );
 
-     if (skirmish->multi.builtin.locked &&
-         skirmish->multi.builtin.owner != direct_gettid())
-     {
-          int count = 0;
-          
-          while (skirmish->multi.builtin.locked) {
-               /* Check whether owner exited without unlocking. */
-               if (kill( skirmish->multi.builtin.owner, 0 ) < 0 && errno == ESRCH) { 
-                    skirmish->multi.builtin.locked = 0;
-                    skirmish->multi.builtin.requested = false; 
-                    break;
-               }
+     tid = direct_gettid();
 
-               skirmish->multi.builtin.requested = true;
-               
-               asm( "" ::: "memory" );
-               
-               if (++count > 1000) {
-                    usleep( 10000 );
-                    count = 0;
-               }
-               else {
-                    direct_sched_yield();
-               }
-               
-               if (skirmish->multi.builtin.destroyed)
-                    return DR_DESTROYED;
+     if (!skirmish_owned( skirmish, tid )) {
+          ret = skirmish_lock( skirmish, tid, true );
+          if (ret)
+               return ret;
+
+          if (skirmish->multi.builtin.destroyed) {
+               skirmish_unlock( skirmish, tid );
+               return DR_DESTROYED;
           }
      }
-     
+
      skirmish->multi.builtin.locked++;
-     skirmish->multi.builtin.owner = direct_gettid();
-     
-     asm( "" ::: "memory" );
 
      return DR_OK;
 }
@@ -678,6 +733,9 @@ fusion_skirmish_prevail( FusionSkirmish *skirmish )
 DirectResult
 fusion_skirmish_swoop( FusionSkirmish *skirmish )
 {
+     DirectResult ret;
+     int          tid;
+
      D_ASSERT( skirmish != NULL );
      
      if (skirmish->single) {
@@ -693,24 +751,16 @@ fusion_skirmish_swoop( FusionSkirmish *skirmish )
 
      if (skirmish->multi.builtin.destroyed)
           return DR_DESTROYED;
-          
-     asm( "" ::: "memory" );
-          
-     if (skirmish->multi.builtin.locked &&
-         skirmish->multi.builtin.owner != direct_gettid()) {
-          /* Check whether owner exited without unlocking. */
-          if (kill( skirmish->multi.builtin.owner, 0 ) < 0 && errno == ESRCH) { 
-               skirmish->multi.builtin.locked = 0;
-               skirmish->multi.builtin.requested = false;
-          }
-          else
-               return DR_BUSY;
+
+     tid = direct_gettid();
+
+     if (!skirmish_owned( skirmish, tid )) {
+          ret = skirmish_lock( skirmish, tid, false );
+          if (ret)
+               return ret;
      }
-          
+
      skirmish->multi.builtin.locked++;
-     skirmish->multi.builtin.owner = direct_gettid();
-     
-     asm( "" ::: "memory" );
 
      return DR_OK;
 }
@@ -748,6 +798,8 @@ fusion_skirmish_lock_count( FusionSkirmish *skirmish, int *lock_count )
 DirectResult
 fusion_skirmish_dismiss (FusionSkirmish *skirmish)
 {
+     int tid;
+
      D_ASSERT( skirmish != NULL );
      
      if (skirmish->single) {
@@ -763,28 +815,20 @@ fusion_skirmish_dismiss (FusionSkirmish *skirmish)
 
      if (skirmish->multi.builtin.destroyed)
           return DR_DESTROYED;
-          
-     asm( "" ::: "memory" );
+
+     tid = direct_gettid();
 
      if (skirmish->multi.builtin.locked) {
-          if (skirmish->multi.builtin.owner != direct_gettid()) {
+          if (!skirmish_owned( skirmish, tid )) {
                D_ERROR( "Fusion/Skirmish: "
                         "Tried to dismiss a skirmish not owned by current process!\n" );
                return DR_ACCESSDENIED;
           }
           
-          if (--skirmish->multi.builtin.locked == 0) {
-               skirmish->multi.builtin.owner = 0;
-
-               if (skirmish->multi.builtin.requested) {
-                    skirmish->multi.builtin.requested = false;
-                    direct_sched_yield();
-               }
-          }
+          if (--skirmish->multi.builtin.locked == 0)
+               skirmish_unlock( skirmish, tid );
      }
      
-     asm( "" ::: "memory" );
-     
      return DR_OK;
 }
 
@@ -814,31 +858,23 @@ fusion_skirmish_destroy (FusionSkirmish *skirmish)
 
      if (skirmish->multi.builtin.destroyed)
           return DR_DESTROYED;
-          
-     if (skirmish->multi.builtin.waiting)
-          fusion_skirmish_notify( skirmish );
-          
+
      skirmish->multi.builtin.destroyed = true;
 
-     return DR_OK;
-}
+     /* Wake up waiting threads, they will see the skirmish being destroyed. */
+     D_SYNC_ADD( &skirmish->multi.builtin.notify, 1 );
 
-#ifdef SIGRTMAX
-# define SIGRESTART  SIGRTMAX
-#else
-# define SIGRESTART  SIGCONT
-#endif
+     direct_futex_wake( &skirmish->multi.builtin.notify, INT_MAX );
 
-static void restart_handler( int s ) {}
+     return DR_OK;
+}
 
 DirectResult
 fusion_skirmish_wait( FusionSkirmish *skirmish, unsigned int timeout )
 {
-     WaitNode         *node;
-     long long         stop;
-     struct sigaction  act, oldact;
-     sigset_t          mask, set;
-     DirectResult      ret = DR_OK;
+     int               notify;
+     long long         stop = 0;
+     DirectResult      ret  = DR_OK;
      
      D_ASSERT( skirmish != NULL );
      
@@ -856,62 +892,36 @@ fusion_skirmish_wait( FusionSkirmish *skirmish, unsigned int timeout )
           return DR_DESTROYED;
  
      /* Set timeout. */
-     stop = direct_clock_get_micros() + timeout * 1000ll;
-      
-     /* Add ourself to the list of waiting processes. */    
-     node = SHMALLOC( skirmish->multi.shared->main_pool, sizeof(WaitNode) );
-     if (!node)
-          return D_OOSHM();
-     
-     node->pid      = direct_gettid();
-     node->notified = false;
-     
-     direct_list_append( &skirmish->multi.builtin.waiting, &node->link );
-      
-     /* Install a (fake) signal handler for SIGRESTART. */
-     act.sa_handler = restart_handler;
-     act.sa_flags   = SA_RESETHAND | SA_RESTART | SA_NOMASK;
-     
-     sigaction( SIGRESTART, &act, &oldact );
-     
-     /* Unblock SIGRESTART. */
-     direct_sigprocmask( SIG_SETMASK, NULL, &mask );
-     sigdelset( &mask, SIGRESTART );
+     if (timeout)
+          stop = direct_clock_get_micros() + timeout * 1000ll;
+
+     /* Notifications after this point wake us up, as they change the sequence. */
+     notify = skirmish->multi.builtin.notify;
 
      fusion_skirmish_dismiss( skirmish );
 
-     while (!node->notified) {
+     while (skirmish->multi.builtin.notify == notify) {
           if (timeout) {
                long long now = direct_clock_get_micros();
 
                if (now >= stop) {
-                    /* Stop notifying us. */
-                    node->notified = true;
                     ret = DR_TIMEOUT;
                     break;
                }
-               
-               direct_sigprocmask( SIG_SETMASK, &mask, &set );
-               usleep( stop - now );
-               direct_sigprocmask( SIG_SETMASK, &set, NULL );           
-          }
-          else {
-               sigsuspend( &mask );
+
+               ret = direct_futex_wait_timed( &skirmish->multi.builtin.notify, notify, (stop - now + 999) / 1000 );
+               if (ret == DR_TIMEOUT)
+                    ret = DR_OK;
           }
+          else
+               ret = direct_futex_wait( &skirmish->multi.builtin.notify, notify );
+
+          if (ret)
+               break;
      }
 
-     /* Flush pending signals. */
-     if (!sigpending( &set ) && sigismember( &set, SIGRESTART ) > 0)
-          sigsuspend( &mask );
-     
      if (fusion_skirmish_prevail( skirmish ))
           ret = DR_DESTROYED;
-     
-     direct_list_remove( &skirmish->multi.builtin.waiting, &node->link );
-
-     SHFREE( skirmish->multi.shared->main_pool, node );
-     
-     sigaction( SIGRESTART, &oldact, NULL );
 
      return ret;
 }
@@ -919,8 +929,6 @@ fusion_skirmish_wait( FusionSkirmish *skirmish, unsigned int timeout )
 DirectResult
 fusion_skirmish_notify( FusionSkirmish *skirmish )
 {
-     WaitNode *node, *temp;
-     
      D_ASSERT( skirmish != NULL );
 
      if (skirmish->single) {
@@ -934,25 +942,9 @@ fusion_skirmish_notify( FusionSkirmish *skirmish )
      if (skirmish->multi.builtin.destroyed)
           return DR_DESTROYED;
 
-     direct_list_foreach_safe (node, temp, skirmish->multi.builtin.waiting) {
-          if (node->notified)
-               continue;
-
-          node->notified = true;
+     D_SYNC_ADD( &skirmish->multi.builtin.notify, 1 );
 
-          if (kill( node->pid, SIGRESTART ) < 0) {
-               if (errno == ESRCH) {
-                    /* Remove dead process. */
-                    direct_list_remove( &skirmish->multi.builtin.waiting, &node->link );
-                    SHFREE( skirmish->multi.shared->main_pool, node );
-               }
-               else {
-                    D_PERROR( "Fusion/Skirmish: Couldn't send notification signal!\n" );
-               }
-          }
-     }
-
-     return DR_OK;
+     return direct_futex_wake( &skirmish->multi.builtin.notify, INT_MAX );
 }
 
 DirectResult
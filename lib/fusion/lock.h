@@ -54,10 +54,9 @@ typedef struct {
           const FusionWorldShared *shared;
           /* builtin impl */
           struct {
-               unsigned int        locked;
-               pid_t               owner;
-               DirectLink         *waiting;
-               bool                requested;
+               int                 futex;         /* owner's tid and FUTEX_WAITERS, see FUTEX_LOCK_PI */
+               unsigned int        locked;        /* recursion count of the owner */
+               int                 notify;        /* sequence for fusion_skirmish_wait/notify() */
                bool                destroyed;
           } builtin;
      } multi;
@@ -37,6 +37,7 @@
 extern "C" {
 #include <sys/param.h>
 
+#include <direct/atomic.h>
 #include <direct/debug.h>
 #include <direct/messages.h>
 #include <direct/thread.h>
@@ -61,6 +62,157 @@ namespace Fusion {
 extern "C" {
 
 
+/*
+ * The slot functions are called with the pool lock being held, except object_slot_find().
+ */
+
+static inline FusionObjectSlot *
+object_slot( FusionObjectPool *pool,
+             unsigned int      index )
+{
+     FusionObjectSlot *chunk = pool->slots[index / FUSION_OBJECT_SLOT_CHUNK];
+
+     return chunk ? &chunk[index % FUSION_OBJECT_SLOT_CHUNK] : NULL;
+}
+
+/*
+ * Assigns an ID to the object, which isn't found before object_slot_publish().
+ */
+static DirectResult
+object_slot_reserve( FusionObjectPool *pool,
+                     FusionObject     *object )
+{
+     int               index;
+     FusionObjectSlot *slot;
+
+     if (pool->slots_free >= 0) {
+          index = pool->slots_free;
+          slot  = object_slot( pool, index );
+
+          pool->slots_free = slot->next_free;
+          if (pool->slots_free < 0)
+               pool->slots_free_last = -1;
+     }
+     else {
+          FusionObjectSlot *chunk;
+
+          index = pool->slots_used;
+
+          if (index == 1 << FUSION_OBJECT_SLOT_BITS) {
+               D_ERROR( "Fusion/Object: Too many objects in '%s'!\n", pool->name );
+               return DR_LIMITEXCEEDED;
+          }
+
+          chunk = pool->slots[index / FUSION_OBJECT_SLOT_CHUNK];
+          if (!chunk) {
+               chunk = (FusionObjectSlot*) SHCALLOC( pool->shared->main_pool,
+                                                     FUSION_OBJECT_SLOT_CHUNK, sizeof(FusionObjectSlot) );
+               if (!chunk)
+                    return D_OOSHM();
+
+               /* Publish the cleared chunk. */
+               D_SYNC_BOOL_COMPARE_AND_SWAP( &pool->slots[index / FUSION_OBJECT_SLOT_CHUNK], (FusionObjectSlot*) NULL, chunk );
+          }
+
+          slot = &chunk[index % FUSION_OBJECT_SLOT_CHUNK];
+
+          D_SYNC_ADD( &pool->slots_used, 1 );
+     }
+
+     /* Slots are retired before their generation wraps, zero is never used as an ID. */
+     slot->generation++;
+
+     D_ASSERT( slot->generation <= FUSION_OBJECT_GENERATION_MASK );
+
+     slot->object = object;
+
+     object->id = (slot->generation << FUSION_OBJECT_SLOT_BITS) | index;
+
+     return DR_OK;
+}
+
+static void
+object_slot_publish( FusionObjectPool *pool,
+                     FusionObject     *object )
+{
+     FusionObjectSlot *slot = object_slot( pool, object->id & ((1 << FUSION_OBJECT_SLOT_BITS) - 1) );
+
+     D_ASSERT( slot != NULL );
+     D_ASSERT( slot->object == object );
+     D_ASSERT( slot->id == 0 );
+
+     D_SYNC_BOOL_COMPARE_AND_SWAP( &slot->id, 0, object->id );
+}
+
+static void
+object_slot_release( FusionObjectPool *pool,
+                     FusionObject     *object )
+{
+     unsigned int      index = object->id & ((1 << FUSION_OBJECT_SLOT_BITS) - 1);
+     FusionObjectSlot *slot  = object_slot( pool, index );
+
+     D_ASSERT( slot != NULL );
+     D_ASSERT( slot->object == object );
+
+     /* Readers check the ID before and after reading the object. */
+     D_SYNC_FETCH_AND_CLEAR( &slot->id );
+
+     slot->object = NULL;
+
+     /* Retire the slot when its generation is used up, an older ID would match again otherwise. */
+     if (slot->generation == FUSION_OBJECT_GENERATION_MASK) {
+          D_DEBUG_AT( Fusion_Object, "  -> retiring slot %u of '%s'\n", index, pool->name );
+          return;
+     }
+
+     /* Reuse slots in the order of release, stale IDs of a slot are not seen again for a long time. */
+     slot->next_free = -1;
+
+     if (pool->slots_free_last >= 0)
+          object_slot( pool, pool->slots_free_last )->next_free = index;
+     else
+          pool->slots_free = index;
+
+     pool->slots_free_last = index;
+}
+
+static FusionObject *
+object_slot_find( FusionObjectPool *pool,
+                  FusionObjectID    object_id )
+{
+     unsigned int      index = object_id & ((1 << FUSION_OBJECT_SLOT_BITS) - 1);
+     FusionObjectSlot *slot;
+     FusionObject     *object;
+
+     if (!object_id || index >= (unsigned int) pool->slots_used)
+          return NULL;
+
+     slot = object_slot( pool, index );
+     if (!slot)
+          return NULL;
+
+     if (D_SYNC_ADD_AND_FETCH( &slot->id, 0 ) != object_id)
+          return NULL;
+
+     object = slot->object;
+
+     /* The slot might have been released and reused meanwhile. */
+     if (D_SYNC_ADD_AND_FETCH( &slot->id, 0 ) != object_id)
+          return NULL;
+
+     return object;
+}
+
+static void
+object_remove( FusionObjectPool *pool,
+               FusionObject     *object )
+{
+     pool->objects->erase( object->id );
+
+     object_slot_release( pool, object );
+}
+
+
 #if 0
 static FusionCallHandlerResult
 object_reference_watcher( int           caller,   /* fusion id of the caller */
@@ -103,10 +255,7 @@ object_reference_watcher( int caller, int call_arg, void *call_ptr, void *ctx, u
      D_MAGIC_ASSERT( pool, FusionObjectPool );
 
      /* Lookup the object. */
-     ObjectMap::iterator it = pool->objects->find( call_arg );
-
-     if (it != pool->objects->end())
-          object = (*it).second;
+     object = object_slot_find( pool, (FusionObjectID) call_arg );
 
      D_DEBUG_AT( Fusion_Object, "  -> lookup as %p\n", object );
 
@@ -134,7 +283,7 @@ object_reference_watcher( int caller, int call_arg, void *call_ptr, void *ctx, u
                case DR_DESTROYED:
                     D_BUG( "already destroyed %p [%u] in '%s'", object, object->id, pool->name );
 
-                    pool->objects->erase( it );
+                    object_remove( pool, object );
                     fusion_skirmish_dismiss( &pool->lock );
                     return FCHR_RETURN;
 
@@ -155,7 +304,7 @@ object_reference_watcher( int caller, int call_arg, void *call_ptr, void *ctx, u
           if (object->state == FOS_INIT) {
                D_BUG( "== %s == incomplete object: %d (%p)", pool->name, call_arg, object );
                D_WARN( "won't destroy incomplete object, leaking some memory" );
-               pool->objects->erase( it );
+               object_remove( pool, object );
                fusion_skirmish_dismiss( &pool->lock );
                return FCHR_RETURN;
           }
@@ -165,7 +314,7 @@ object_reference_watcher( int caller, int call_arg, void *call_ptr, void *ctx, u
 
           /* Remove the object from the pool. */
           object->pool = NULL;
-          pool->objects->erase( it );
+          object_remove( pool, object );
 
           /* Unlock the pool. */
           fusion_skirmish_dismiss( &pool->lock );
@@ -238,6 +387,19 @@ fusion_object_pool_create( const char             *name,
      pool->secure       = fusion_config->secure_fusion;
      pool->objects      = new ObjectMap;
 
+     pool->slots_free      = -1;
+     pool->slots_free_last = -1;
+
+     pool->slots = (FusionObjectSlot**) SHCALLOC( shared->main_pool, FUSION_OBJECT_SLOT_CHUNKS, sizeof(FusionObjectSlot*) );
+     if (!pool->slots) {
+          D_OOSHM();
+          delete pool->objects;
+          fusion_skirmish_destroy( &pool->lock );
+          SHFREE( shared->main_pool, pool->name );
+          SHFREE( shared->main_pool, pool );
+          return NULL;
+     }
+
      /* Destruction call from Fusion. */
      fusion_call_init( &pool->call, object_reference_watcher, pool, world );
      fusion_call_set_name( &pool->call, "object_reference_watcher" );
@@ -316,6 +478,13 @@ fusion_object_pool_destroy( FusionObjectPool *pool,
 
      delete pool->objects;
 
+     for (int i=0; i<FUSION_OBJECT_SLOT_CHUNKS; i++) {
+          if (pool->slots[i])
+               SHFREE( shared->main_pool, pool->slots[i] );
+     }
+
+     SHFREE( shared->main_pool, pool->slots );
+
      D_MAGIC_CLEAR( pool );
 
      D_DEBUG_AT( Fusion_Object, "  -> pool destroyed (%s)\n", pool->name );
@@ -417,7 +586,11 @@ fusion_object_create( FusionObjectPool  *pool,
      object->state = FOS_INIT;
 
      /* Set object id. */
-     object->id = ++pool->id_pool;
+     if (object_slot_reserve( pool, object )) {
+          SHFREE( shared->main_pool, object );
+          fusion_skirmish_dismiss( &pool->lock );
+          return NULL;
+     }
 
      object->identity = identity;
 
@@ -426,6 +599,7 @@ fusion_object_create( FusionObjectPool  *pool,
 
      /* Initialize the reference counter. */
      if (fusion_ref_init2( &object->ref, pool->name, pool->secure, world )) {
+          object_slot_release( pool, object );
           SHFREE( shared->main_pool, object );
           fusion_skirmish_dismiss( &pool->lock );
           return NULL;
@@ -437,6 +611,7 @@ fusion_object_create( FusionObjectPool  *pool,
      /* Install handler for automatic destruction. */
      if (fusion_ref_watch( &object->ref, &pool->call, object->id )) {
           fusion_ref_destroy( &object->ref );
+          object_slot_release( pool, object );
           SHFREE( shared->main_pool, object );
           fusion_skirmish_dismiss( &pool->lock );
           return NULL;
@@ -446,6 +621,7 @@ fusion_object_create( FusionObjectPool  *pool,
      object->reactor = fusion_reactor_new( pool->message_size, pool->name, world );
      if (!object->reactor) {
           fusion_ref_destroy( &object->ref );
+          object_slot_release( pool, object );
           SHFREE( shared->main_pool, object );
           fusion_skirmish_dismiss( &pool->lock );
           return NULL;
@@ -463,6 +639,8 @@ fusion_object_create( FusionObjectPool  *pool,
      /* Add the object to the pool. */
      pool->objects->insert( std::pair<FusionObjectID,FusionObject*>( object->id, object ) );
 
+     object_slot_publish( pool, object );
+
      D_DEBUG_AT( Fusion_Object, "== %s ==\n", pool->name );
      D_DEBUG_AT( Fusion_Object, "  -> added object %p [%u] (ref %x)\n", object, object->id, object->ref.multi.id );
 
@@ -480,24 +658,27 @@ fusion_object_get( FusionObjectPool  *pool,
                    FusionObject     **ret_object )
 {
      DirectResult  ret;
-     FusionObject *object = NULL;
+     FusionObject *object;
 
      D_MAGIC_ASSERT( pool, FusionObjectPool );
      D_ASSERT( ret_object != NULL );
 
      D_DEBUG_AT( Fusion_Object, "%s( %p '%s', object_id %u )\n", __FUNCTION__, pool, pool->name, object_id );
 
-     /* Lock the pool. */
+     /* Unknown and stale IDs don't need the lock. */
+     if (!object_slot_find( pool, object_id )) {
+          D_DEBUG_AT( Fusion_Object, "  -> NOT FOUND\n" );
+          return DR_IDNOTFOUND;
+     }
+
+     /* Lock the pool, taking the reference must not race with the destruction. */
      ret = fusion_skirmish_prevail( &pool->lock );
      if (ret == DR_OK) {
-          /* Lookup the object. */
-          ObjectMap::iterator it = pool->objects->find( object_id );
-
-          if (it != pool->objects->end()) {
+          /* Lookup the object again. */
+          object = object_slot_find( pool, object_id );
+          if (object) {
                int refs;
 
-               object = (*it).second;
-
                D_DEBUG_AT( Fusion_Object, "  -> %s\n", ToString_FusionObject(object) );
 
                ret = fusion_ref_stat( &object->ref, &refs );
@@ -514,13 +695,13 @@ fusion_object_get( FusionObjectPool  *pool,
                D_DEBUG_AT( Fusion_Object, "  -> NOT FOUND\n" );
                ret = DR_IDNOTFOUND;
           }
-     }
 
-     if (ret == DR_OK)
-          *ret_object = object;
+          if (ret == DR_OK)
+               *ret_object = object;
 
-     /* Unlock the pool. */
-     fusion_skirmish_dismiss( &pool->lock );
+          /* Unlock the pool. */
+          fusion_skirmish_dismiss( &pool->lock );
+     }
 
      return ret;
 }
@@ -530,37 +711,26 @@ fusion_object_lookup( FusionObjectPool  *pool,
                       FusionObjectID     object_id,
                       FusionObject     **ret_object )
 {
-     DirectResult  ret    = DR_IDNOTFOUND;
-     FusionObject *object = NULL;
+     FusionObject *object;
 
      D_MAGIC_ASSERT( pool, FusionObjectPool );
      D_ASSERT( ret_object != NULL );
 
      D_DEBUG_AT( Fusion_Object, "%s( %p '%s', object_id %u )\n", __FUNCTION__, pool, pool->name, object_id );
 
-     /* Lock the pool. */
-     if (fusion_skirmish_prevail( &pool->lock ))
-          return DR_FUSION;
+     /* Lookup the object, no lock needed. */
+     object = object_slot_find( pool, object_id );
 
-     /* Lookup the object. */
-     ObjectMap::iterator it = pool->objects->find( object_id );
-
-     if (it != pool->objects->end()) {
-          object = (*it).second;
-
-          D_DEBUG_AT( Fusion_Object, "  -> %s\n", ToString_FusionObject(object) );
+     *ret_object = object;
 
-          ret = DR_OK;
-     }
-     else
+     if (!object) {
           D_DEBUG_AT( Fusion_Object, "  -> NOT FOUND\n" );
+          return DR_IDNOTFOUND;
+     }
 
-     *ret_object = object;
-
-     /* Unlock the pool. */
-     fusion_skirmish_dismiss( &pool->lock );
+     D_DEBUG_AT( Fusion_Object, "  -> %s\n", ToString_FusionObject(object) );
 
-     return ret;
+     return DR_OK;
 }
 
 DirectResult
@@ -631,7 +801,7 @@ fusion_object_destroy( FusionObject *object )
 
                object->pool = NULL;
 
-               pool->objects->erase( object->id );
+               object_remove( pool, object );
           }
 
           /* Unlock the pool. */
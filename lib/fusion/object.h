@@ -101,6 +101,24 @@ struct __Fusion_FusionObject {
      void              *type_instance;
 };
 
+/*
+ * Object IDs consist of the index of a slot in the pool's table and the slot's generation,
+ * which is increased whenever the slot is reused. IDs of destroyed objects are not found.
+ * Free slots are reused in FIFO order and retired when their generation is used up.
+ */
+#define FUSION_OBJECT_SLOT_BITS        20
+#define FUSION_OBJECT_GENERATION_MASK  ((1 << (32 - FUSION_OBJECT_SLOT_BITS)) - 1)
+
+#define FUSION_OBJECT_SLOT_CHUNK       1024
+#define FUSION_OBJECT_SLOT_CHUNKS      ((1 << FUSION_OBJECT_SLOT_BITS) / FUSION_OBJECT_SLOT_CHUNK)
+
+typedef struct {
+     FusionObjectID          id;          /* zero while the slot is free */
+     unsigned int            generation;
+     int                     next_free;
+     FusionObject           *object;
+} FusionObjectSlot;
+
 struct __Fusion_FusionObjectPool {
      int                     magic;
 
@@ -108,7 +126,11 @@ struct __Fusion_FusionObjectPool {
 
      FusionSkirmish          lock;
      Fusion_ObjectMap       *objects;
-     FusionObjectID          id_pool;
+
+     FusionObjectSlot      **slots;            /* chunks allocated on demand, read without locking */
+     int                     slots_used;
+     int                     slots_free;       /* first free slot or -1 */
+     int                     slots_free_last;  /* last free slot or -1 */
 
      char                   *name;
      int                     object_size;
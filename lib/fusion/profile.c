@@ -0,0 +1,392 @@
+/*
+   (c) Copyright 2012-2013  DirectFB integrated media GmbH
+   (c) Copyright 2001-2013  The world wide DirectFB Open Source Community (directfb.org)
+   (c) Copyright 2000-2004  Convergence (integrated media) GmbH
+
+   All rights reserved.
+
+   Written by Denis Oliver Kropp <dok@directfb.org>,
+              Andreas Shimokawa <andi@directfb.org>,
+              Marek Pikarski <mass@directfb.org>,
+              Sven Neumann <neo@directfb.org>,
+              Ville Syrjälä <syrjala@sci.fi> and
+              Claudio Ciccani <klan@users.sf.net>.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the
+   Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+   Boston, MA 02111-1307, USA.
+*/
+
+
+
+
+
+
+//#define DIRECT_ENABLE_DEBUG
+
+#include <config.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <direct/atomic.h>
+#include <direct/clock.h>
+#include <direct/debug.h>
+#include <direct/messages.h>
+#include <direct/trace.h>
+#include <direct/util.h>
+
+#include <fusion/build.h>
+#include <fusion/conf.h>
+#include <fusion/lock.h>
+#include <fusion/profile.h>
+#include <fusion/shmalloc.h>
+
+#include "fusion_internal.h"
+
+
+D_DEBUG_DOMAIN( Fusion_Profile, "Fusion/Profile", "Fusion Call Profile" );
+
+/**********************************************************************************************************************/
+
+#if FUSION_BUILD_MULTI
+
+#define PROFILE_ENTRIES  256     /* Power of two. */
+
+typedef struct {
+     void              *handler;
+     int                ready;   /* Set after handler, call_arg and name are written. */
+
+     FusionCallProfile  profile;
+} ProfileEntry;
+
+struct __Fusion_FusionCallProfileTable {
+     int                magic;
+
+     FusionSkirmish     lock;    /* Serializes inserting entries, lookups don't lock. */
+
+     unsigned int       dropped;
+
+     ProfileEntry       entries[PROFILE_ENTRIES];
+};
+
+static __inline__ unsigned int
+profile_hash( const void *handler, int call_arg )
+{
+     return ((unsigned long) handler >> 4) ^ ((unsigned int) call_arg * 2654435761u);
+}
+
+static ProfileEntry *
+profile_find( FusionCallProfileTable *table,
+              void                   *handler,
+              int                     call_arg )
+{
+     unsigned int i;
+     unsigned int index = profile_hash( handler, call_arg );
+
+     for (i=0; i<PROFILE_ENTRIES; i++) {
+          ProfileEntry *entry = &table->entries[(index + i) & (PROFILE_ENTRIES - 1)];
+
+          if (!entry->ready)
+               return NULL;
+
+          if (entry->handler == handler && entry->profile.call_arg == call_arg)
+               return entry;
+     }
+
+     return NULL;
+}
+
+static ProfileEntry *
+profile_insert( FusionWorld            *world,
+                FusionCallProfileTable *table,
+                void                   *handler,
+                int                     call_arg )
+{
+     unsigned int  i;
+     unsigned int  index = profile_hash( handler, call_arg );
+     ProfileEntry *entry = NULL;
+     const char   *symbol;
+
+     /* Resolve the name before taking the lock, it may have to load the symbol table. */
+     symbol = direct_trace_lookup_symbol_at( handler );
+
+     if (fusion_skirmish_prevail( &table->lock ))
+          return NULL;
+
+     for (i=0; i<PROFILE_ENTRIES; i++) {
+          entry = &table->entries[(index + i) & (PROFILE_ENTRIES - 1)];
+
+          if (!entry->ready)
+               break;
+
+          if (entry->handler == handler && entry->profile.call_arg == call_arg)
+               goto out;
+     }
+
+     if (i == PROFILE_ENTRIES) {
+          if (!table->dropped++)
+               D_WARN( "call profile table full, dropping calls to %p", handler );
+
+          entry = NULL;
+          goto out;
+     }
+
+     D_DEBUG_AT( Fusion_Profile, "  -> new entry %u for %p (%s) arg %d\n",
+                 (index + i) & (PROFILE_ENTRIES - 1), handler, symbol, call_arg );
+
+     entry->handler          = handler;
+     entry->profile.call_arg = call_arg;
+
+     if (symbol)
+          direct_snputs( entry->profile.name, symbol, FUSION_CALL_PROFILE_NAME );
+     else
+          snprintf( entry->profile.name, FUSION_CALL_PROFILE_NAME, "%p", handler );
+
+     /* Full barrier, publishes the key before lookups can match it. */
+     D_SYNC_ADD( &entry->ready, 1 );
+
+out:
+     fusion_skirmish_dismiss( &table->lock );
+
+     return entry;
+}
+
+static void
+profile_add_caller( FusionCallProfile  *profile,
+                    FusionID            caller,
+                    unsigned long long  time )
+{
+     int i;
+
+     for (i=0; i<FUSION_CALL_PROFILE_CALLERS; i++) {
+          FusionCallProfileCaller *slot = &profile->callers[i];
+
+          /* Claim a free slot, another thread may claim it for the same caller meanwhile. */
+          if (!slot->fusion_id)
+               D_SYNC_BOOL_COMPARE_AND_SWAP( &slot->fusion_id, 0, caller );
+
+          if (slot->fusion_id != caller)
+               continue;
+
+          D_SYNC_ADD( &slot->count, 1 );
+          D_SYNC_ADD( &slot->time, time );
+          return;
+     }
+
+     D_SYNC_ADD( &profile->other_callers, 1 );
+}
+
+/**********************************************************************************************************************/
+
+DirectResult
+_fusion_call_profile_init( FusionWorld *world )
+{
+     DirectResult            ret;
+     FusionWorldShared      *shared;
+     FusionCallProfileTable *table;
+
+     D_MAGIC_ASSERT( world, FusionWorld );
+
+     shared = world->shared;
+
+     D_MAGIC_ASSERT( shared, FusionWorldShared );
+
+     D_DEBUG_AT( Fusion_Profile, "%s( %p )\n", __FUNCTION__, world );
+
+     table = SHCALLOC( shared->main_pool, 1, sizeof(FusionCallProfileTable) );
+     if (!table)
+          return D_OOSHM();
+
+     ret = fusion_skirmish_init2( &table->lock, "Fusion Call Profile", world, fusion_config->secure_fusion );
+     if (ret) {
+          SHFREE( shared->main_pool, table );
+          return ret;
+     }
+
+     D_MAGIC_SET( table, FusionCallProfileTable );
+
+     shared->call_profile = table;
+
+     return DR_OK;
+}
+
+void
+_fusion_call_profile_deinit( FusionWorld *world )
+{
+     FusionWorldShared      *shared;
+     FusionCallProfileTable *table;
+
+     D_MAGIC_ASSERT( world, FusionWorld );
+
+     shared = world->shared;
+     table  = shared->call_profile;
+
+     D_DEBUG_AT( Fusion_Profile, "%s( %p ) <- table %p\n", __FUNCTION__, world, table );
+
+     if (!table)
+          return;
+
+     D_MAGIC_ASSERT( table, FusionCallProfileTable );
+
+     shared->call_profile = NULL;
+
+     fusion_skirmish_destroy( &table->lock );
+
+     D_MAGIC_CLEAR( table );
+
+     SHFREE( shared->main_pool, table );
+}
+
+void
+_fusion_call_profile_add( FusionWorld *world,
+                          void        *handler,
+                          int          call_arg,
+                          FusionID     caller,
+                          long long    queued,
+                          long long    start )
+{
+     FusionCallProfileTable *table;
+     ProfileEntry           *entry;
+     FusionCallProfile      *profile;
+     unsigned long long      time;
+     unsigned long long      max;
+     int                     bucket;
+
+     D_MAGIC_ASSERT( world, FusionWorld );
+
+     table = world->shared->call_profile;
+     if (!table)
+          return;
+
+     D_MAGIC_ASSERT( table, FusionCallProfileTable );
+
+     time = direct_clock_get_micros() - start;
+
+     entry = profile_find( table, handler, call_arg );
+     if (!entry) {
+          entry = profile_insert( world, table, handler, call_arg );
+          if (!entry)
+               return;
+     }
+
+     profile = &entry->profile;
+
+     for (bucket=0; bucket<FUSION_CALL_PROFILE_BUCKETS-1; bucket++) {
+          if (time < (1ULL << bucket))
+               break;
+     }
+
+     D_SYNC_ADD( &profile->count, 1 );
+     D_SYNC_ADD( &profile->time, time );
+     D_SYNC_ADD( &profile->histogram[bucket], 1 );
+
+     if (queued && queued < start)
+          D_SYNC_ADD( &profile->wait, start - queued );
+
+     do {
+          max = profile->time_max;
+     } while (time > max && !D_SYNC_BOOL_COMPARE_AND_SWAP( &profile->time_max, max, time ));
+
+     profile_add_caller( profile, caller, time );
+}
+
+/**********************************************************************************************************************/
+
+DirectResult
+fusion_call_profile_enum( FusionWorld               *world,
+                          FusionCallProfileCallback  callback,
+                          void                      *ctx )
+{
+     int                     i;
+     FusionCallProfileTable *table;
+
+     D_MAGIC_ASSERT( world, FusionWorld );
+     D_ASSERT( callback != NULL );
+
+     table = world->shared->call_profile;
+     if (!table)
+          return DR_UNSUPPORTED;
+
+     D_MAGIC_ASSERT( table, FusionCallProfileTable );
+
+     for (i=0; i<PROFILE_ENTRIES; i++) {
+          FusionCallProfile profile;
+
+          if (!table->entries[i].ready)
+               continue;
+
+          /* Counters keep running, the snapshot is not atomic as a whole. */
+          profile = table->entries[i].profile;
+
+          if (!callback( &profile, ctx ))
+               break;
+     }
+
+     return DR_OK;
+}
+
+DirectResult
+fusion_call_profile_reset( FusionWorld *world )
+{
+     int                     i;
+     FusionCallProfileTable *table;
+
+     D_MAGIC_ASSERT( world, FusionWorld );
+
+     table = world->shared->call_profile;
+     if (!table)
+          return DR_UNSUPPORTED;
+
+     D_MAGIC_ASSERT( table, FusionCallProfileTable );
+
+     D_DEBUG_AT( Fusion_Profile, "%s( %p )\n", __FUNCTION__, world );
+
+     for (i=0; i<PROFILE_ENTRIES; i++) {
+          FusionCallProfile *profile = &table->entries[i].profile;
+
+          if (!table->entries[i].ready)
+               continue;
+
+          profile->count         = 0;
+          profile->wait          = 0;
+          profile->time          = 0;
+          profile->time_max      = 0;
+          profile->other_callers = 0;
+
+          memset( profile->histogram, 0, sizeof(profile->histogram) );
+          memset( profile->callers, 0, sizeof(profile->callers) );
+     }
+
+     table->dropped = 0;
+
+     return DR_OK;
+}
+
+#else /* FUSION_BUILD_MULTI */
+
+DirectResult
+fusion_call_profile_enum( FusionWorld               *world,
+                          FusionCallProfileCallback  callback,
+                          void                      *ctx )
+{
+     return DR_UNSUPPORTED;
+}
+
+DirectResult
+fusion_call_profile_reset( FusionWorld *world )
+{
+     return DR_UNSUPPORTED;
+}
+
+#endif
@@ -0,0 +1,87 @@
+/*
+   (c) Copyright 2012-2013  DirectFB integrated media GmbH
+   (c) Copyright 2001-2013  The world wide DirectFB Open Source Community (directfb.org)
+   (c) Copyright 2000-2004  Convergence (integrated media) GmbH
+
+   All rights reserved.
+
+   Written by Denis Oliver Kropp <dok@directfb.org>,
+              Andreas Shimokawa <andi@directfb.org>,
+              Marek Pikarski <mass@directfb.org>,
+              Sven Neumann <neo@directfb.org>,
+              Ville Syrjälä <syrjala@sci.fi> and
+              Claudio Ciccani <klan@users.sf.net>.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the
+   Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+   Boston, MA 02111-1307, USA.
+*/
+
+
+
+
+
+
+#ifndef __FUSION__PROFILE_H__
+#define __FUSION__PROFILE_H__
+
+#include <fusion/types.h>
+
+#define FUSION_CALL_PROFILE_NAME     64
+#define FUSION_CALL_PROFILE_BUCKETS  24    /* Bucket n counts calls taking less than 2^n micro seconds. */
+#define FUSION_CALL_PROFILE_CALLERS  8
+
+typedef struct {
+     FusionID            fusion_id;
+     unsigned int        count;
+     unsigned long long  time;      /* Accumulated handler time in micro seconds. */
+} FusionCallProfileCaller;
+
+/*
+ * Statistics of one call handler and call argument, e.g. one method of a flux dispatcher.
+ */
+typedef struct {
+     char                     name[FUSION_CALL_PROFILE_NAME];  /* Symbol of the handler. */
+     int                      call_arg;
+
+     unsigned int             count;
+     unsigned long long       wait;          /* Accumulated time in the queue, builtin multi app only. */
+     unsigned long long       time;          /* Accumulated time in the handler. */
+     unsigned long long       time_max;
+
+     unsigned int             histogram[FUSION_CALL_PROFILE_BUCKETS];
+
+     FusionCallProfileCaller  callers[FUSION_CALL_PROFILE_CALLERS];
+     unsigned int             other_callers; /* Calls from fusionees not having a slot above. */
+} FusionCallProfile;
+
+typedef bool (*FusionCallProfileCallback)( const FusionCallProfile *profile,
+                                           void                    *ctx );
+
+/*
+ * Enumerates a snapshot of each profiled call until the callback returns false.
+ *
+ * Returns DR_UNSUPPORTED if the master did not enable the "call-profile" option.
+ */
+DirectResult FUSION_API fusion_call_profile_enum ( FusionWorld               *world,
+                                                   FusionCallProfileCallback  callback,
+                                                   void                      *ctx );
+
+/*
+ * Clears the statistics of all profiled calls.
+ */
+DirectResult FUSION_API fusion_call_profile_reset( FusionWorld               *world );
+
+#endif
+
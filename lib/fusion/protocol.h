@@ -86,6 +86,8 @@ typedef struct {
      void                *ctx;
      
      FusionCallExecFlags  flags;
+
+     long long            stamp;         /* time of queueing if profiling calls, otherwise 0 */
 } FusionCallMessage, FusionCallExecute;
 
 /*
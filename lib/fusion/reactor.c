@@ -43,6 +43,7 @@
 
 #include <fusion/build.h>
 
+#include <direct/atomic.h>
 #include <direct/debug.h>
 #include <direct/list.h>
 #include <direct/mem.h>
@@ -69,6 +70,7 @@ struct __Fusion_FusionReactor {
      int                id;        /* reactor id                          */
      int                msg_size;  /* size of each message                */
      bool               direct;
+     bool               coalesce;  /* see fusion_reactor_coalesce()       */
      bool               destroyed;
 
      DirectLink        *globals;
@@ -84,38 +86,105 @@ struct __Fusion_FusionReactor {
 #endif
 };
 
+/*
+ * Dispatch walks published copies of the reaction lists and doesn't take any lock.
+ *
+ * Attach and detach modify the lists under the node's lock and publish a new array when
+ * unlocking the node. Replaced arrays, removed links and empty nodes are retired and freed
+ * once no dispatch which could still see them is running, see reactor_reclaim().
+ */
+typedef enum {
+     REACTOR_RETIRED_ARRAY,
+     REACTOR_RETIRED_LINK,
+     REACTOR_RETIRED_NODE
+} ReactorRetiredType;
+
+typedef struct {
+     DirectLink         link;
+
+     ReactorRetiredType type;
+} ReactorRetired;
+
+typedef struct {
+     DirectLink         link;
+
+     ReactorRetiredType type;
+
+     int                count;
+     void              *items[];  /* NodeLink or, for the node index, ReactorNode sorted by id */
+} ReactorArray;
+
 typedef struct {
      DirectLink         link;
 
+     ReactorRetiredType type;
+
      int                magic;
 
-     pthread_rwlock_t   lock;
+     pthread_rwlock_t   lock;     /* serializes modifications of the links */
 
      int                reactor_id;
      FusionReactor     *reactor;
+     FusionWorld       *world;
+
+     DirectLink        *links;    /* reactor listeners attached to node  */
+     DirectLink        *removed;  /* links removed while locked, retired by unlock_node() */
+     bool               changed;
+
+     ReactorArray      *array;    /* published copy of the links */
 
-     DirectLink        *links; /* reactor listeners attached to node  */
+     int                epoch;    /* selects the reader counter of new dispatches */
+     int                readers[2];
+     DirectMutex        sync_lock;
 } ReactorNode;
 
 typedef struct {
      DirectLink         link;
 
+     ReactorRetiredType type;
+
      int                magic;
 
      Reaction          *reaction;
      int                channel;
 } NodeLink;
 
+/*
+ * Running dispatches of the calling thread, to let a reaction detach from its own node.
+ */
+typedef struct __ReactorDispatch ReactorDispatch;
+
+struct __ReactorDispatch {
+     ReactorDispatch   *prev;
+
+     FusionWorld       *world;
+     int                world_idx;
+
+     ReactorNode       *node;
+     int                node_idx;
+};
+
+static DirectTLS reactor_dispatch_tls;
+
 /**************************************************************************************************/
 
 static ReactorNode *lock_node      ( int                 reactor_id,
                                      bool                add_it,
-                                     bool                wlock,
-                                     FusionReactor      *reactor, /* one of reactor and world must not be NULL */
-                                     FusionWorld        *world );
+                                     FusionReactor      *reactor );
 
 static void         unlock_node    ( ReactorNode        *node );
 
+static ReactorNode *dispatch_enter ( FusionWorld        *world,
+                                     int                 reactor_id,
+                                     ReactorDispatch    *dispatch );
+
+static void         dispatch_leave ( ReactorDispatch    *dispatch );
+
+static void         retire_node    ( FusionWorld        *world,
+                                     ReactorNode        *node );
+
+static void         reactor_free_retired( DirectLink    *list );
+
 static void         process_globals( FusionReactor      *reactor,
                                      const void         *msg_data,
                                      const ReactionFunc *globals );
@@ -270,7 +339,7 @@ fusion_reactor_attach_channel( FusionReactor *reactor,
      if (!link)
           return D_OOM();
 
-     node = lock_node( reactor->id, true, true, reactor, NULL );
+     node = lock_node( reactor->id, true, reactor );
      if (!node) {
           D_FREE( link );
           return DR_FUSION;
@@ -305,11 +374,15 @@ fusion_reactor_attach_channel( FusionReactor *reactor,
      link->reaction = reaction;
      link->channel  = channel;
 
+     link->type     = REACTOR_RETIRED_LINK;
+
      D_MAGIC_SET( link, NodeLink );
 
      /* prepend the reaction to the local reaction list */
      direct_list_prepend( &node->links, &link->link );
 
+     node->changed = true;
+
      unlock_node( node );
 
      return DR_OK;
@@ -326,9 +399,10 @@ remove_node_link( ReactorNode *node,
 
      direct_list_remove( &node->links, &link->link );
 
-     D_MAGIC_CLEAR( link );
+     /* Dispatch might still be using it, see unlock_node(). */
+     direct_list_prepend( &node->removed, &link->link );
 
-     D_FREE( link );
+     node->changed = true;
 }
 
 DirectResult
@@ -345,7 +419,7 @@ fusion_reactor_detach( FusionReactor *reactor,
                  "fusion_reactor_detach( %p [%d], reaction %p ) <- func %p, ctx %p\n",
                  reactor, reactor->id, reaction, reaction->func, reaction->ctx );
 
-     node = lock_node( reactor->id, false, true, reactor, NULL );
+     node = lock_node( reactor->id, false, reactor );
      if (!node) {
           D_BUG( "node not found" );
           return DR_BUG;
@@ -567,8 +641,10 @@ _fusion_reactor_process_message( FusionWorld *world,
                                  int          channel,
                                  const void  *msg_data )
 {
-     ReactorNode *node;
-     NodeLink    *link;
+     int              i;
+     ReactorNode     *node;
+     ReactorArray    *array;
+     ReactorDispatch  dispatch;
 
      D_MAGIC_ASSERT( world, FusionWorld );
      D_ASSERT( msg_data != NULL );
@@ -577,21 +653,24 @@ _fusion_reactor_process_message( FusionWorld *world,
                  "  _fusion_reactor_process_message( [%d], msg_data %p )\n", reactor_id, msg_data );
 
      /* Find the local counter part of the reactor. */
-     node = lock_node( reactor_id, false, false, NULL, world );
+     node = dispatch_enter( world, reactor_id, &dispatch );
      if (!node)
           return;
 
      D_DEBUG_AT( Fusion_Reactor, "    -> node %p, reactor %p\n", node, node->reactor );
 
-     D_ASSUME( node->links != NULL );
+     array = node->array;
 
-     if (!node->links) {
+     D_ASSUME( array != NULL && array->count > 0 );
+
+     if (!array || !array->count) {
           D_DEBUG_AT( Fusion_Reactor, "    -> no local reactions!?!\n" );
-          unlock_node( node );
+          dispatch_leave( &dispatch );
           return;
      }
 
-     direct_list_foreach (link, node->links) {
+     for (i=0; i<array->count; i++) {
+          NodeLink *link = array->items[i];
           Reaction *reaction;
 
           D_MAGIC_ASSERT( link, NodeLink );
@@ -619,7 +698,7 @@ _fusion_reactor_process_message( FusionWorld *world,
 
                link->reaction = NULL;
 
-               /* We can't remove the link as we only have read lock, to avoid dead locks. */
+               /* The link is removed by the next attach or detach, dispatch doesn't lock. */
 
                while (ioctl( world->fusion_fd, FUSION_REACTOR_DETACH, &detach )) {
                     switch (errno) {
@@ -640,7 +719,7 @@ _fusion_reactor_process_message( FusionWorld *world,
           }
      }
 
-     unlock_node( node );
+     dispatch_leave( &dispatch );
 }
 
 #else /* FUSION_BUILD_KERNEL */
@@ -785,7 +864,7 @@ fusion_reactor_attach_channel( FusionReactor *reactor,
      if (!link)
           return D_OOM();
 
-     node = lock_node( reactor->id, true, true, reactor, NULL );
+     node = lock_node( reactor->id, true, reactor );
      if (!node) {
           D_FREE( link );
           return DR_FUSION;
@@ -829,11 +908,15 @@ fusion_reactor_attach_channel( FusionReactor *reactor,
      link->reaction = reaction;
      link->channel  = channel;
 
+     link->type     = REACTOR_RETIRED_LINK;
+
      D_MAGIC_SET( link, NodeLink );
 
      /* prepend the reaction to the local reaction list */
      direct_list_prepend( &node->links, &link->link );
 
+     node->changed = true;
+
      unlock_node( node );
 
      return DR_OK;
@@ -850,9 +933,10 @@ remove_node_link( ReactorNode *node,
 
      direct_list_remove( &node->links, &link->link );
 
-     D_MAGIC_CLEAR( link );
+     /* Dispatch might still be using it, see unlock_node(). */
+     direct_list_prepend( &node->removed, &link->link );
 
-     D_FREE( link );
+     node->changed = true;
 }
 
 DirectResult
@@ -875,7 +959,7 @@ fusion_reactor_detach( FusionReactor *reactor,
                           
      shared = reactor->shared;
 
-     node = lock_node( reactor->id, false, true, reactor, NULL );
+     node = lock_node( reactor->id, false, reactor );
      if (!node) {
           D_BUG( "node not found" );
           return DR_BUG;
@@ -978,6 +1062,9 @@ fusion_reactor_dispatch_channel( FusionReactor      *reactor,
      }
      
      msg = alloca( sizeof(FusionReactorMessage) + msg_size );
+
+     /* Padding is compared when coalescing. */
+     memset( msg, 0, sizeof(FusionReactorMessage) );
      
      msg->type    = FMT_REACTOR;
      msg->id      = reactor->id;
@@ -1005,8 +1092,14 @@ fusion_reactor_dispatch_channel( FusionReactor      *reactor,
                snprintf( addr.sun_path+len, sizeof(addr.sun_path)-len, "%lx", listener->fusion_id );
 
                D_DEBUG_AT( Fusion_Reactor, " -> sending to '%s'\n", addr.sun_path );
-               
-               ret = _fusion_send_message( world->fusion_fd, msg, sizeof(FusionReactorMessage)+msg_size, &addr );
+
+               if (reactor->coalesce && !ref)
+                    ret = _fusion_ring_send_coalesced( world, listener->fusion_id, msg, sizeof(FusionReactorMessage)+msg_size,
+                                                       sizeof(FusionReactorMessage) );
+               else
+                    ret = _fusion_ring_send( world, listener->fusion_id, msg, sizeof(FusionReactorMessage)+msg_size );
+               if (ret == DR_UNSUPPORTED)
+                    ret = _fusion_send_message( world->fusion_fd, msg, sizeof(FusionReactorMessage)+msg_size, &addr );
                if (ret == DR_FUSION) {
                     D_DEBUG_AT( Fusion_Reactor, " -> removing dead listener %lu\n", listener->fusion_id );
                     
@@ -1083,8 +1176,10 @@ _fusion_reactor_process_message( FusionWorld *world,
                                  int          channel,
                                  const void  *msg_data )
 {
-     ReactorNode *node;
-     NodeLink    *link;
+     int              i;
+     ReactorNode     *node;
+     ReactorArray    *array;
+     ReactorDispatch  dispatch;
 
      D_MAGIC_ASSERT( world, FusionWorld );
      D_ASSERT( msg_data != NULL );
@@ -1093,21 +1188,24 @@ _fusion_reactor_process_message( FusionWorld *world,
                  "  _fusion_reactor_process_message( [%d], msg_data %p )\n", reactor_id, msg_data );
 
      /* Find the local counter part of the reactor. */
-     node = lock_node( reactor_id, false, false, NULL, world );
+     node = dispatch_enter( world, reactor_id, &dispatch );
      if (!node)
           return;
 
      D_DEBUG_AT( Fusion_Reactor, "    -> node %p, reactor %p\n", node, node->reactor );
 
-     D_ASSUME( node->links != NULL );
+     array = node->array;
 
-     if (!node->links) {
+     D_ASSUME( array != NULL && array->count > 0 );
+
+     if (!array || !array->count) {
           D_DEBUG_AT( Fusion_Reactor, "    -> no local reactions!?!\n" );
-          unlock_node( node );
+          dispatch_leave( &dispatch );
           return;
      }
 
-     direct_list_foreach (link, node->links) {
+     for (i=0; i<array->count; i++) {
+          NodeLink *link = array->items[i];
           Reaction *reaction;
 
           D_MAGIC_ASSERT( link, NodeLink );
@@ -1142,7 +1240,7 @@ _fusion_reactor_process_message( FusionWorld *world,
           }
      }
 
-     unlock_node( node );
+     dispatch_leave( &dispatch );
 }
 
 #endif /* FUSION_BUILD_KERNEL */
@@ -1341,6 +1439,28 @@ fusion_reactor_direct( FusionReactor *reactor, bool direct )
      return DR_OK;
 }
 
+DirectResult
+fusion_reactor_coalesce( FusionReactor *reactor, bool coalesce )
+{
+     D_MAGIC_ASSERT( reactor, FusionReactor );
+
+     reactor->coalesce = coalesce;
+
+     return DR_OK;
+}
+
+void
+__Fusion_reactor_init( void )
+{
+     direct_tls_register( &reactor_dispatch_tls, NULL );
+}
+
+void
+__Fusion_reactor_deinit( void )
+{
+     direct_tls_unregister( &reactor_dispatch_tls );
+}
+
 
 void
 _fusion_reactor_free_all( FusionWorld *world )
@@ -1354,30 +1474,37 @@ _fusion_reactor_free_all( FusionWorld *world )
 
      direct_mutex_lock( &world->reactor_nodes_lock );
 
-     direct_list_foreach_safe (node, node_temp, world->reactor_nodes) {
-          NodeLink *link, *link_temp;
+     D_ASSUME( world->reactor_readers[0] == 0 && world->reactor_readers[1] == 0 );
 
+     direct_list_foreach_safe (node, node_temp, world->reactor_nodes) {
           D_MAGIC_ASSERT( node, ReactorNode );
 
           pthread_rwlock_wrlock( &node->lock );
 
-          direct_list_foreach_safe (link, link_temp, node->links) {
-               D_MAGIC_ASSERT( link, NodeLink );
+          while (node->links) {
+               NodeLink *link = (NodeLink*) node->links;
 
-               D_MAGIC_CLEAR( link );
+               link->reaction = NULL;
 
-               D_FREE( link );
+               remove_node_link( node, link );
           }
 
           pthread_rwlock_unlock( &node->lock );
-          pthread_rwlock_destroy( &node->lock );
-
-          D_MAGIC_CLEAR( node );
 
-          D_FREE( node );
+          retire_node( world, node );
      }
 
-     world->reactor_nodes = NULL;
+     reactor_free_retired( world->reactor_retired[0] );
+     reactor_free_retired( world->reactor_retired[1] );
+
+     world->reactor_retired[0] = NULL;
+     world->reactor_retired[1] = NULL;
+
+     if (world->reactor_index) {
+          D_FREE( world->reactor_index );
+
+          world->reactor_index = NULL;
+     }
 
      direct_mutex_unlock( &world->reactor_nodes_lock );
 }
@@ -1453,171 +1580,440 @@ process_globals( FusionReactor      *reactor,
  *  File internal functions  *
  *****************************/
 
-static ReactorNode *
-lock_node( int reactor_id, bool add_it, bool wlock, FusionReactor *reactor, FusionWorld *world )
+static ReactorArray *
+array_new( int count )
 {
-     DirectLink        *n;
-     ReactorNode       *node;
-     FusionWorldShared *shared;
+     ReactorArray *array;
 
-     D_DEBUG_AT( Fusion_Reactor, "    lock_node( [%d], add %s, reactor %p )\n",
-                 reactor_id, add_it ? "true" : "false", reactor );
+     array = D_MALLOC( sizeof(ReactorArray) + count * sizeof(void*) );
+     if (!array) {
+          D_OOM();
+          return NULL;
+     }
 
-     D_ASSERT( reactor != NULL || (!add_it && world != NULL) );
+     array->type  = REACTOR_RETIRED_ARRAY;
+     array->count = count;
 
-     if (reactor) {
-          D_MAGIC_ASSERT( reactor, FusionReactor );
+     return array;
+}
 
-          shared = reactor->shared;
+static int
+compare_nodes( const void *a, const void *b )
+{
+     const ReactorNode *node_a = *(ReactorNode * const *) a;
+     const ReactorNode *node_b = *(ReactorNode * const *) b;
 
-          D_MAGIC_ASSERT( shared, FusionWorldShared );
+     return (node_a->reactor_id > node_b->reactor_id) - (node_a->reactor_id < node_b->reactor_id);
+}
 
-          world = _fusion_world( shared );
+/*
+ * The following functions are called with the nodes lock of the world being held.
+ */
+
+static void
+reactor_retire( FusionWorld *world,
+                DirectLink  *link )
+{
+     direct_list_prepend( &world->reactor_retired[0], link );
+}
 
-          D_MAGIC_ASSERT( world, FusionWorld );
+static void
+reactor_free_retired( DirectLink *list )
+{
+     ReactorRetired *retired, *next;
+
+     direct_list_foreach_safe (retired, next, list) {
+          if (retired->type == REACTOR_RETIRED_NODE) {
+               ReactorNode *node = (ReactorNode*) retired;
+
+               D_MAGIC_ASSERT( node, ReactorNode );
+
+               pthread_rwlock_destroy( &node->lock );
+               direct_mutex_deinit( &node->sync_lock );
+
+               D_MAGIC_CLEAR( node );
+          }
+#if DIRECT_BUILD_DEBUGS
+          else if (retired->type == REACTOR_RETIRED_LINK) {
+               NodeLink *link = (NodeLink*) retired;
+
+               D_MAGIC_ASSERT( link, NodeLink );
+
+               D_MAGIC_CLEAR( link );
+          }
+#endif
+
+          D_FREE( retired );
      }
-     else {
-          D_MAGIC_ASSERT( world, FusionWorld );
+}
 
-          shared = world->shared;
+/*
+ * Each dispatch counts itself as a reader of the epoch it has entered in. The epoch is only
+ * flipped when no reader of the previous one is left. Things are retired in the current epoch
+ * and freed at the second flip, when no dispatch that might have seen them is running anymore.
+ */
+static void
+reactor_reclaim( FusionWorld *world )
+{
+     int         epoch = world->reactor_epoch;
+     DirectLink *old;
+
+     if (!world->reactor_retired[0] && !world->reactor_retired[1])
+          return;
+
+     if (D_SYNC_ADD_AND_FETCH( &world->reactor_readers[(epoch & 1) ^ 1], 0 ))
+          return;
 
-          D_MAGIC_ASSERT( shared, FusionWorldShared );
+     old = world->reactor_retired[1];
+
+     world->reactor_retired[1] = world->reactor_retired[0];
+     world->reactor_retired[0] = NULL;
+
+     D_SYNC_ADD( &world->reactor_epoch, 1 );
+
+     reactor_free_retired( old );
+}
+
+static void
+publish_index( FusionWorld *world )
+{
+     int           count = 0;
+     ReactorNode  *node;
+     ReactorArray *index;
+     ReactorArray *old = world->reactor_index;
+
+     direct_list_foreach (node, world->reactor_nodes)
+          count++;
+
+     /* Without an index dispatch won't find any node, it's rebuilt by the next lock_node(). */
+     index = array_new( count );
+     if (index) {
+          count = 0;
+
+          direct_list_foreach (node, world->reactor_nodes)
+               index->items[count++] = node;
+
+          qsort( index->items, count, sizeof(void*), compare_nodes );
      }
 
+     D_SYNC_BOOL_COMPARE_AND_SWAP( &world->reactor_index, old, index );
 
-     direct_mutex_lock( &world->reactor_nodes_lock );
+     if (old)
+          reactor_retire( world, &old->link );
+}
+
+static void
+retire_node( FusionWorld *world,
+             ReactorNode *node )
+{
+     D_MAGIC_ASSERT( node, ReactorNode );
 
-     // FIXME: there's a deadlock case where during dispatch via one node
-     //        the outer lock is given up, taken by another thread blocking
-     //        on our node. the problem occurs when we try to get the outer
-     //        lock again for attach/detach etc...
+     D_ASSERT( node->links == NULL );
+
+     D_DEBUG_AT( Fusion_Reactor, "    -> retiring node %p [%d]\n", node, node->reactor_id );
+
+     direct_list_remove( &world->reactor_nodes, &node->link );
+
+     if (node->array) {
+          reactor_retire( world, &node->array->link );
+
+          node->array = NULL;
+     }
+
+     while (node->removed) {
+          DirectLink *link = node->removed;
+
+          direct_list_remove( &node->removed, link );
+
+          reactor_retire( world, link );
+     }
+
+     reactor_retire( world, &node->link );
+}
+
+/**************************************************************************************************/
+
+static ReactorNode *
+lock_node( int reactor_id, bool add_it, FusionReactor *reactor )
+{
+     DirectLink        *n;
+     ReactorNode       *node;
+     ReactorNode       *found   = NULL;
+     bool               changed = false;
+     FusionWorld       *world;
+
+     D_DEBUG_AT( Fusion_Reactor, "    lock_node( [%d], add %s, reactor %p )\n",
+                 reactor_id, add_it ? "true" : "false", reactor );
+
+     D_MAGIC_ASSERT( reactor, FusionReactor );
+     D_MAGIC_ASSERT( reactor->shared, FusionWorldShared );
+
+     world = _fusion_world( reactor->shared );
+
+     D_MAGIC_ASSERT( world, FusionWorld );
+
+
+     direct_mutex_lock( &world->reactor_nodes_lock );
 
      direct_list_foreach_safe (node, n, world->reactor_nodes) {
           D_MAGIC_ASSERT( node, ReactorNode );
 
           if (node->reactor_id == reactor_id) {
-               if (wlock) {
-                    DirectLink *n;
-                    NodeLink   *link;
+               DirectLink *n;
+               NodeLink   *link;
 
-                    pthread_rwlock_wrlock( &node->lock );
+               pthread_rwlock_wrlock( &node->lock );
 
-                    /* FIXME: don't cleanup asynchronously */
-                    direct_list_foreach_safe (link, n, node->links) {
-                         D_MAGIC_ASSERT( link, NodeLink );
+               /* FIXME: don't cleanup asynchronously */
+               direct_list_foreach_safe (link, n, node->links) {
+                    D_MAGIC_ASSERT( link, NodeLink );
 
-                         if (!link->reaction) {
-                              D_DEBUG_AT( Fusion_Reactor, "    -> cleaning up %p\n", link );
-                         
-                              remove_node_link( node, link );
-                         }
-                         else
-                              D_ASSERT( link->reaction->node_link == link );
+                    if (!link->reaction) {
+                         D_DEBUG_AT( Fusion_Reactor, "    -> cleaning up %p\n", link );
+
+                         remove_node_link( node, link );
                     }
+                    else
+                         D_ASSERT( link->reaction->node_link == link );
                }
-               else
-                    pthread_rwlock_rdlock( &node->lock );
 
                /* FIXME: Don't cleanup asynchronously. */
                if (!node->links && !add_it) {
-//                    D_DEBUG_AT( Fusion_Reactor, "      -> cleaning up mine %p\n", node );
-
-                    direct_list_remove( &world->reactor_nodes, &node->link );
+                    retire_node( world, node );
 
                     pthread_rwlock_unlock( &node->lock );
-                    pthread_rwlock_destroy( &node->lock );
 
-                    D_MAGIC_CLEAR( node );
-
-                    D_FREE( node );
-
-                    node = NULL;
+                    changed = true;
                }
                else {
-/*                    D_DEBUG_AT( Fusion_Reactor, "      -> found %p (%d reactions)\n",
-                                node, direct_list_count_elements_EXPENSIVE( node->reactions ) );*/
-
-                    D_ASSERT( node->reactor == reactor || reactor == NULL );
+                    D_ASSERT( node->reactor == reactor );
 
                     direct_list_move_to_front( &world->reactor_nodes, &node->link );
-               }
 
-               direct_mutex_unlock( &world->reactor_nodes_lock );
+                    found = node;
+               }
 
-               return node;
+               break;
           }
 
           /* FIXME: Don't cleanup asynchronously. */
           if (!pthread_rwlock_trywrlock( &node->lock )) {
                if (!node->links) {
-//                    D_DEBUG_AT( Fusion_Reactor, "      -> cleaning up other %p\n", node );
-
-                    direct_list_remove( &world->reactor_nodes, &node->link );
-
-                    pthread_rwlock_unlock( &node->lock );
-                    pthread_rwlock_destroy( &node->lock );
-
-                    D_MAGIC_CLEAR( node );
+                    retire_node( world, node );
 
-                    D_FREE( node );
+                    changed = true;
                }
-               else {
-                    /*D_DEBUG_AT( Fusion_Reactor, "      -> keeping other %p (%d reactions)\n",
-                                node, direct_list_count_elements_EXPENSIVE( node->reactions ) );*/
 
-                    pthread_rwlock_unlock( &node->lock );
-               }
+               pthread_rwlock_unlock( &node->lock );
           }
      }
 
-//     D_DEBUG_AT( Fusion_Reactor, "      -> not found%s adding\n", add_it ? ", but" : " and not" );
+     if (!found && add_it) {
+          node = D_CALLOC( 1, sizeof(ReactorNode) );
+          if (node) {
+               pthread_rwlock_init( &node->lock, NULL );
+               pthread_rwlock_wrlock( &node->lock );
 
-     if (add_it) {
-          D_MAGIC_ASSERT( reactor, FusionReactor );
+               direct_mutex_init( &node->sync_lock );
 
-          node = D_CALLOC( 1, sizeof(ReactorNode) );
-          if (!node) {
-               D_OOM();
-               return NULL;
-          }
+               node->type       = REACTOR_RETIRED_NODE;
+               node->reactor_id = reactor_id;
+               node->reactor    = reactor;
+               node->world      = world;
 
-          //direct_util_recursive_pthread_mutex_init( &node->lock );
-          pthread_rwlock_init( &node->lock, NULL );
+               D_MAGIC_SET( node, ReactorNode );
 
+               direct_list_prepend( &world->reactor_nodes, &node->link );
 
-          if (wlock)
-               pthread_rwlock_wrlock( &node->lock );
+               found   = node;
+               changed = true;
+          }
           else
-               pthread_rwlock_rdlock( &node->lock );
+               D_OOM();
+     }
+
+     if (changed || (!world->reactor_index && world->reactor_nodes))
+          publish_index( world );
 
-          node->reactor_id = reactor_id;
-          node->reactor    = reactor;
+     reactor_reclaim( world );
 
-          D_MAGIC_SET( node, ReactorNode );
+     direct_mutex_unlock( &world->reactor_nodes_lock );
 
-          direct_list_prepend( &world->reactor_nodes, &node->link );
+     return found;
+}
 
-          direct_mutex_unlock( &world->reactor_nodes_lock );
+static void
+node_wait_readers( ReactorNode *node,
+                   int          idx )
+{
+     int              own = 0;
+     ReactorDispatch *dispatch;
 
-          return node;
+     /* Don't wait for dispatches of the calling thread, e.g. when detaching from a reaction. */
+     for (dispatch = direct_tls_get( reactor_dispatch_tls ); dispatch; dispatch = dispatch->prev) {
+          if (dispatch->node == node && dispatch->node_idx == idx)
+               own++;
      }
 
-     direct_mutex_unlock( &world->reactor_nodes_lock );
+     while (D_SYNC_ADD_AND_FETCH( &node->readers[idx], 0 ) > own)
+          direct_thread_sleep( 100 );
+}
 
-     return NULL;
+/*
+ * Waits until no dispatch that might still see the previous links is running.
+ */
+static void
+node_synchronize( ReactorNode *node )
+{
+     int idx;
+
+     direct_mutex_lock( &node->sync_lock );
+
+     idx = node->epoch & 1;
+
+     node_wait_readers( node, idx ^ 1 );
+
+     D_SYNC_ADD( &node->epoch, 1 );
+
+     node_wait_readers( node, idx );
+
+     direct_mutex_unlock( &node->sync_lock );
 }
 
 static void
 unlock_node( ReactorNode *node )
 {
-     D_ASSERT( node != NULL );
+     int           idx;
+     FusionWorld  *world;
+     ReactorArray *old = NULL;
+     DirectLink   *removed;
+
+     D_MAGIC_ASSERT( node, ReactorNode );
+
+     world = node->world;
+
+     D_MAGIC_ASSERT( world, FusionWorld );
+
+     /* Publish a copy of the links for dispatch. */
+     if (node->changed) {
+          ReactorArray *array = array_new( direct_list_count_elements_EXPENSIVE( node->links ) );
+
+          if (array) {
+               NodeLink *link;
+               int       i = 0;
+
+               direct_list_foreach (link, node->links)
+                    array->items[i++] = link;
+          }
+
+          old = node->array;
+
+          D_SYNC_BOOL_COMPARE_AND_SWAP( &node->array, old, array );
+
+          node->changed = !array;
+     }
+
+     removed = node->removed;
+
+     node->removed = NULL;
+
+     if (!old && !removed) {
+          pthread_rwlock_unlock( &node->lock );
+          return;
+     }
 
-//     D_MAGIC_ASSERT( node->reactor, FusionReactor );
+     /* Keep the node from being freed after unlocking it. */
+     idx = world->reactor_epoch & 1;
 
-/*     D_DEBUG_AT( Fusion_Reactor, "    unlock_node( %p, reactor %p [%d] )\n",
-                 node, node->reactor, node->reactor->id );*/
+     D_SYNC_ADD( &world->reactor_readers[idx], 1 );
 
      pthread_rwlock_unlock( &node->lock );
+
+     /* Removed reactions must not be called after returning from detach. */
+     if (removed)
+          node_synchronize( node );
+
+     direct_mutex_lock( &world->reactor_nodes_lock );
+
+     if (old)
+          reactor_retire( world, &old->link );
+
+     while (removed) {
+          DirectLink *link = removed;
+
+          direct_list_remove( &removed, link );
+
+          reactor_retire( world, link );
+     }
+
+     D_SYNC_ADD( &world->reactor_readers[idx], -1 );
+
+     reactor_reclaim( world );
+
+     direct_mutex_unlock( &world->reactor_nodes_lock );
+}
+
+static ReactorNode *
+dispatch_enter( FusionWorld     *world,
+                int              reactor_id,
+                ReactorDispatch *dispatch )
+{
+     int           lower = 0;
+     int           upper;
+     ReactorArray *index;
+     ReactorNode  *node = NULL;
+
+     dispatch->world     = world;
+     dispatch->world_idx = world->reactor_epoch & 1;
+
+     D_SYNC_ADD( &world->reactor_readers[dispatch->world_idx], 1 );
+
+     index = world->reactor_index;
+     if (index) {
+          upper = index->count - 1;
+
+          while (lower <= upper) {
+               int          pivot = (lower + upper) / 2;
+               ReactorNode *item  = index->items[pivot];
+
+               if (item->reactor_id == reactor_id) {
+                    node = item;
+                    break;
+               }
+
+               if (item->reactor_id < reactor_id)
+                    lower = pivot + 1;
+               else
+                    upper = pivot - 1;
+          }
+     }
+
+     if (!node) {
+          D_SYNC_ADD( &world->reactor_readers[dispatch->world_idx], -1 );
+          return NULL;
+     }
+
+     D_MAGIC_ASSERT( node, ReactorNode );
+
+     dispatch->node     = node;
+     dispatch->node_idx = node->epoch & 1;
+
+     D_SYNC_ADD( &node->readers[dispatch->node_idx], 1 );
+
+     dispatch->prev = direct_tls_get( reactor_dispatch_tls );
+
+     direct_tls_set( reactor_dispatch_tls, dispatch );
+
+     return node;
+}
+
+static void
+dispatch_leave( ReactorDispatch *dispatch )
+{
+     direct_tls_set( reactor_dispatch_tls, dispatch->prev );
+
+     D_SYNC_ADD( &dispatch->node->readers[dispatch->node_idx], -1 );
+     D_SYNC_ADD( &dispatch->world->reactor_readers[dispatch->world_idx], -1 );
 }
 
 #else /* FUSION_BUILD_MULTI */
@@ -1864,6 +2260,24 @@ fusion_reactor_direct( FusionReactor *reactor, bool direct )
      return DR_OK;
 }
 
+DirectResult
+fusion_reactor_coalesce( FusionReactor *reactor, bool coalesce )
+{
+     D_MAGIC_ASSERT( reactor, FusionReactor );
+
+     return DR_OK;
+}
+
+void
+__Fusion_reactor_init( void )
+{
+}
+
+void
+__Fusion_reactor_deinit( void )
+{
+}
+
 DirectResult
 fusion_reactor_destroy (FusionReactor *reactor)
 {
@@ -222,6 +222,15 @@ DirectResult  FUSION_API  fusion_reactor_set_name             ( FusionReactor  *
 DirectResult  FUSION_API  fusion_reactor_direct        ( FusionReactor      *reactor,
                                                          bool                direct );
 
+/*
+ * Allow identical messages to be dropped while an earlier one is still pending at the receiver.
+ *
+ * Only for reactors whose messages are idempotent notifications. Has an effect where messages
+ * are queued in user space, i.e. the builtin multi application implementation.
+ */
+DirectResult  FUSION_API  fusion_reactor_coalesce      ( FusionReactor      *reactor,
+                                                         bool                coalesce );
+
 
 typedef enum {
      FUSION_REACTOR_PERMIT_NONE              = 0x00000000,
@@ -239,5 +248,9 @@ DirectResult  FUSION_API  fusion_reactor_add_permissions( FusionReactor
                                                           FusionID                  fusion_id,
                                                           FusionReactorPermissions  permissions );
 
+
+void __Fusion_reactor_init( void );
+void __Fusion_reactor_deinit( void );
+
 #endif
 
@@ -39,6 +39,7 @@
 #include <sys/param.h>
 #include <sys/types.h>
 
+#include <direct/atomic.h>
 #include <direct/map.h>
 #include <direct/mem.h>
 
@@ -60,6 +61,43 @@
 
 D_DEBUG_DOMAIN( Fusion_Ref, "Fusion/Ref", "Fusion's Reference Counter" );
 
+/**********************************************************************************************************************/
+
+/*
+ * Lock free fast path for counters that are neither reaching nor leaving zero.
+ *
+ * Only the transitions from or to zero need the lock, as they race with zero_lock()
+ * and trigger the watch call. Those are always done with the lock held, so the fast
+ * path never changes a counter that another thread checked for zero under the lock.
+ */
+static __inline__ bool
+ref_count_up_fast( int *count )
+{
+     int value;
+
+     while ((value = *(volatile int *) count) > 0) {
+          if (D_SYNC_BOOL_COMPARE_AND_SWAP( count, value, value + 1 ))
+               return true;
+     }
+
+     return false;
+}
+
+static __inline__ bool
+ref_count_down_fast( int *count )
+{
+     int value;
+
+     while ((value = *(volatile int *) count) > 1) {
+          if (D_SYNC_BOOL_COMPARE_AND_SWAP( count, value, value - 1 ))
+               return true;
+     }
+
+     return false;
+}
+
+/**********************************************************************************************************************/
+
 
 #if FUSION_BUILD_MULTI
 
@@ -1022,7 +1060,8 @@ _fusion_ref_change (FusionRef *ref, int add, bool global)
                return DR_BUG;
           }
 
-          ref->multi.builtin.global += add;
+          /* Racing with the lock free fast path, which never crosses zero. */
+          D_SYNC_ADD( &ref->multi.builtin.global, add );
      }
      else {
           if (ref->multi.builtin.local+add < 0) {
@@ -1069,6 +1108,9 @@ fusion_ref_up (FusionRef *ref, bool global)
           FusionWorld *world = _fusion_world( ref->multi.shared );
 
           if (world->fusion_id == FUSION_ID_MASTER) {
+               if (ref_count_up_fast( &ref->single.refs ))
+                    return DR_OK;
+
                direct_mutex_lock (&ref->single.lock);
 
                if (ref->single.destroyed)
@@ -1076,7 +1118,7 @@ fusion_ref_up (FusionRef *ref, bool global)
                else if (ref->single.locked)
                     ret = DR_LOCKED;
                else
-                    ref->single.refs++;
+                    D_SYNC_ADD( &ref->single.refs, 1 );
 
                direct_mutex_unlock (&ref->single.lock);
           }
@@ -1103,6 +1145,8 @@ fusion_ref_up (FusionRef *ref, bool global)
                direct_mutex_unlock( &world->refs_lock );
           }
      }
+     else if (global && ref_count_up_fast( &ref->multi.builtin.global ))
+          return DR_OK;
      else
           return _fusion_ref_change( ref, +1, global );
 
@@ -1125,6 +1169,9 @@ fusion_ref_down (FusionRef *ref, bool global)
           FusionWorld *world = _fusion_world( ref->multi.shared );
 
           if (world->fusion_id == FUSION_ID_MASTER) {
+               if (ref_count_down_fast( &ref->single.refs ))
+                    return DR_OK;
+
                direct_mutex_lock (&ref->single.lock);
 
                if (!ref->single.refs) {
@@ -1138,7 +1185,7 @@ fusion_ref_down (FusionRef *ref, bool global)
                     return DR_DESTROYED;
                }
 
-               if (! --ref->single.refs) {
+               if (!D_SYNC_ADD_AND_FETCH( &ref->single.refs, -1 )) {
                     ref->single.dead++;
 
                     if (fusion_config->trace_ref == -1 || ref->multi.id == fusion_config->trace_ref) {
@@ -1205,6 +1252,8 @@ fusion_ref_down (FusionRef *ref, bool global)
                direct_mutex_unlock( &world->refs_lock );
           }
      }
+     else if (global && ref_count_down_fast( &ref->multi.builtin.global ))
+          return DR_OK;
      else
           return _fusion_ref_change( ref, -1, global );
 
@@ -1252,17 +1301,10 @@ fusion_ref_catch (FusionRef *ref)
                /*
                 * If catcher is master, then we are most likely running in always-indirect mode!
                 */
-               direct_mutex_lock (&ref->single.lock);
-
-               if (ref->single.refs < 2) {
+               if (!ref_count_down_fast( &ref->single.refs )) {
                     D_BUG( "master->master catch with less than two refs" );
-                    direct_mutex_unlock (&ref->single.lock);
                     return DR_BUG;
                }
-
-               ref->single.refs--;
-
-               direct_mutex_unlock (&ref->single.lock);
           }
           else {
                FusionRefSlaveSlaveEntry *entry;
@@ -1655,6 +1697,9 @@ fusion_ref_up (FusionRef *ref, bool global)
           direct_trace_print_stack( NULL );
      }
 
+     if (ref_count_up_fast( &ref->single.refs ))
+          return DR_OK;
+
      direct_mutex_lock (&ref->single.lock);
 
      if (ref->single.destroyed)
@@ -1662,7 +1707,7 @@ fusion_ref_up (FusionRef *ref, bool global)
      else if (ref->single.locked)
           ret = DR_LOCKED;
      else
-          ref->single.refs++;
+          D_SYNC_ADD( &ref->single.refs, 1 );
 
      direct_mutex_unlock (&ref->single.lock);
 
@@ -1681,6 +1726,9 @@ fusion_ref_down (FusionRef *ref, bool global)
           direct_trace_print_stack( NULL );
      }
 
+     if (ref_count_down_fast( &ref->single.refs ))
+          return DR_OK;
+
      direct_mutex_lock (&ref->single.lock);
 
      if (!ref->single.refs) {
@@ -1694,7 +1742,7 @@ fusion_ref_down (FusionRef *ref, bool global)
           return DR_DESTROYED;
      }
 
-     if (! --ref->single.refs) {
+     if (!D_SYNC_ADD_AND_FETCH( &ref->single.refs, -1 )) {
           if (ref->single.call) {
                FusionCall *call = ref->single.call;
 
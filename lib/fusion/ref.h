@@ -87,12 +87,12 @@ DirectResult FUSION_API fusion_ref_set_name     (FusionRef         *ref,
                                                  const char        *name);
 
 /*
- * Lock, increase, unlock.
+ * Increase, only locking when the counter leaves zero.
  */
 DirectResult FUSION_API fusion_ref_up           (FusionRef *ref, bool global);
 
 /*
- * Lock, decrease, unlock.
+ * Decrease, only locking when the counter reaches zero.
  */
 DirectResult FUSION_API fusion_ref_down         (FusionRef *ref, bool global);
 
@@ -32,13 +32,17 @@
 
 #include <config.h>
 
+#include <errno.h>
+#include <signal.h>
 #include <unistd.h>
 #include <sys/mman.h>
 
 #include <direct/debug.h>
 #include <direct/list.h>
 #include <direct/mem.h>
+#include <direct/memcpy.h>
 #include <direct/messages.h>
+#include <direct/util.h>
 
 #include <fusion/conf.h>
 #include <fusion/shmalloc.h>
@@ -73,6 +77,249 @@ static void         shutdown_pool( FusionSHM           *shm,
 
 /**********************************************************************************************************************/
 
+static inline FusionSHMPool *
+local_pool( FusionSHMPoolShared *pool )
+{
+     FusionWorld *world = _fusion_world( pool->shm->world );
+
+     return &world->shm.pools[pool->index];
+}
+
+static void
+magazines_init( FusionSHMPool *pool )
+{
+     direct_mutex_init( &pool->magazine_lock );
+
+     pool->depot = NULL;
+}
+
+/*
+ * Return all objects of a depot to their slabs and free it, the pool lock must be held.
+ */
+static void
+depot_free( FusionSHMPoolShared *shared,
+            shmalloc_depot      *depot )
+{
+     int i;
+
+     for (i=0; i<SHMALLOC_SLAB_CLASSES; i++) {
+          shmalloc_magazine *magazine = &depot->magazines[i];
+
+          while (magazine->count)
+               _fusion_shfree_slab( shared->heap, magazine->objects[--magazine->count] );
+     }
+
+     direct_list_remove( &shared->depots, &depot->link );
+
+     _fusion_shfree( shared->heap, depot );
+}
+
+/*
+ * Return all cached objects to their slabs and destroy the magazines.
+ */
+static void
+magazines_deinit( FusionSHMPool       *pool,
+                  FusionSHMPoolShared *shared )
+{
+     if (pool->depot && fusion_skirmish_prevail( &shared->lock ) == DR_OK) {
+          __shmalloc_brk( shared->heap, 0 );
+
+          depot_free( shared, pool->depot );
+
+          fusion_skirmish_dismiss( &shared->lock );
+     }
+
+     pool->depot = NULL;
+
+     direct_mutex_deinit( &pool->magazine_lock );
+}
+
+/*
+ * Create the depot of this process, the pool lock must be held.
+ */
+static shmalloc_depot *
+depot_create( FusionSHMPool       *pool,
+              FusionSHMPoolShared *shared )
+{
+     shmalloc_depot *depot;
+
+     depot = _fusion_shmalloc( shared->heap, sizeof(shmalloc_depot) );
+     if (!depot)
+          return NULL;
+
+     memset( depot, 0, sizeof(shmalloc_depot) );
+
+     depot->pid = getpid();
+
+     direct_list_append( &shared->depots, &depot->link );
+
+     pool->depot = depot;
+
+     return depot;
+}
+
+/*
+ * Take an object from the magazine, refilling it with half its capacity if empty.
+ */
+static void *
+magazine_get( FusionSHMPoolShared *shared,
+              int                  size_class )
+{
+     void              *data = NULL;
+     FusionSHMPool     *pool = local_pool( shared );
+     shmalloc_magazine *magazine;
+
+     D_MAGIC_ASSERT( pool, FusionSHMPool );
+
+     direct_mutex_lock( &pool->magazine_lock );
+
+     if (!pool->depot || !pool->depot->magazines[size_class].count) {
+          if (fusion_skirmish_prevail( &shared->lock )) {
+               direct_mutex_unlock( &pool->magazine_lock );
+               return NULL;
+          }
+
+          __shmalloc_brk( shared->heap, 0 );
+
+          if (!pool->depot && !depot_create( pool, shared )) {
+               data = _fusion_shmalloc_slab( shared->heap, size_class );
+
+               fusion_skirmish_dismiss( &shared->lock );
+               direct_mutex_unlock( &pool->magazine_lock );
+
+               return data;
+          }
+
+          magazine = &pool->depot->magazines[size_class];
+
+          while (magazine->count < SHMALLOC_MAGAZINE_SIZE / 2) {
+               void *object = _fusion_shmalloc_slab( shared->heap, size_class );
+
+               if (!object)
+                    break;
+
+               magazine->objects[magazine->count++] = object;
+          }
+
+          fusion_skirmish_dismiss( &shared->lock );
+     }
+
+     magazine = &pool->depot->magazines[size_class];
+
+     if (magazine->count)
+          data = magazine->objects[--magazine->count];
+
+     direct_mutex_unlock( &pool->magazine_lock );
+
+     return data;
+}
+
+/*
+ * Put an object into the magazine, returning half of it to the slabs if full.
+ */
+static DirectResult
+magazine_put( FusionSHMPoolShared *shared,
+              int                  size_class,
+              void                *data )
+{
+     FusionSHMPool     *pool = local_pool( shared );
+     shmalloc_magazine *magazine;
+
+     D_MAGIC_ASSERT( pool, FusionSHMPool );
+
+     direct_mutex_lock( &pool->magazine_lock );
+
+     if (!pool->depot || pool->depot->magazines[size_class].count == SHMALLOC_MAGAZINE_SIZE) {
+          DirectResult ret;
+
+          ret = fusion_skirmish_prevail( &shared->lock );
+          if (ret) {
+               direct_mutex_unlock( &pool->magazine_lock );
+               return ret;
+          }
+
+          __shmalloc_brk( shared->heap, 0 );
+
+          if (!pool->depot && !depot_create( pool, shared )) {
+               _fusion_shfree_slab( shared->heap, data );
+
+               fusion_skirmish_dismiss( &shared->lock );
+               direct_mutex_unlock( &pool->magazine_lock );
+
+               return DR_OK;
+          }
+
+          magazine = &pool->depot->magazines[size_class];
+
+          while (magazine->count > SHMALLOC_MAGAZINE_SIZE / 2)
+               _fusion_shfree_slab( shared->heap, magazine->objects[--magazine->count] );
+
+          fusion_skirmish_dismiss( &shared->lock );
+     }
+
+     magazine = &pool->depot->magazines[size_class];
+
+     magazine->objects[magazine->count++] = data;
+
+     direct_mutex_unlock( &pool->magazine_lock );
+
+     return DR_OK;
+}
+
+/*
+ * Drop the depots inherited by a forked child, their objects belong to the parent.
+ */
+void
+__shmalloc_magazines_forked( FusionSHM *shm )
+{
+     int i;
+
+     D_MAGIC_ASSERT( shm, FusionSHM );
+
+     for (i=0; i<FUSION_SHM_MAX_POOLS; i++) {
+          if (shm->pools[i].attached)
+               magazines_init( &shm->pools[i] );
+     }
+}
+
+/*
+ * Return the objects cached by processes that died without detaching from the pools.
+ *
+ * Pools not attached by the caller are skipped.
+ */
+void
+__shmalloc_magazines_reclaim( FusionSHM *shm )
+{
+     int i;
+
+     D_MAGIC_ASSERT( shm, FusionSHM );
+
+     for (i=0; i<FUSION_SHM_MAX_POOLS; i++) {
+          FusionSHMPoolShared *shared = &shm->shared->pools[i];
+          shmalloc_depot      *depot, *next;
+
+          if (!shm->pools[i].attached || !shared->active)
+               continue;
+
+          if (fusion_skirmish_prevail( &shared->lock ))
+               continue;
+
+          __shmalloc_brk( shared->heap, 0 );
+
+          direct_list_foreach_safe (depot, next, shared->depots) {
+               if (kill( depot->pid, 0 ) < 0 && errno == ESRCH) {
+                    D_DEBUG_AT( Fusion_SHMPool, "  -> reclaiming depot of dead process %d in '%s'\n", depot->pid, shared->name );
+
+                    depot_free( shared, depot );
+               }
+          }
+
+          fusion_skirmish_dismiss( &shared->lock );
+     }
+}
+
+/**********************************************************************************************************************/
+
 DirectResult
 fusion_shm_pool_create( FusionWorld          *world,
                         const char           *name,
@@ -138,9 +385,13 @@ fusion_shm_pool_create( FusionWorld          *world,
 
      shared->pools[i].index = i;
 
+     magazines_init( &shm->pools[i] );
+
      ret = init_pool( shm, &shm->pools[i], &shared->pools[i], name, max_size, debug );
-     if (ret)
+     if (ret) {
+          direct_mutex_deinit( &shm->pools[i].magazine_lock );
           goto error;
+     }
 
      shared->num_pools++;
 
@@ -182,6 +433,8 @@ fusion_shm_pool_destroy( FusionWorld         *world,
 
      D_ASSERT( shared == pool->shm );
 
+     magazines_deinit( &shm->pools[pool->index], pool );
+
      ret = fusion_skirmish_prevail( &shared->lock );
      if (ret)
           return ret;
@@ -213,6 +466,7 @@ DirectResult
 fusion_shm_pool_attach( FusionSHM           *shm,
                         FusionSHMPoolShared *pool )
 {
+     DirectResult     ret;
      FusionSHMShared *shared;
 
      (void)shared;
@@ -234,7 +488,13 @@ fusion_shm_pool_attach( FusionSHM           *shm,
      D_ASSERT( pool == &shared->pools[pool->index] );
      D_ASSERT( !shm->pools[pool->index].attached );
 
-     return join_pool( shm, &shm->pools[pool->index], pool );
+     magazines_init( &shm->pools[pool->index] );
+
+     ret = join_pool( shm, &shm->pools[pool->index], pool );
+     if (ret)
+          direct_mutex_deinit( &shm->pools[pool->index].magazine_lock );
+
+     return ret;
 }
 
 DirectResult
@@ -265,6 +525,8 @@ fusion_shm_pool_detach( FusionSHM           *shm,
 
      D_MAGIC_ASSERT( &shm->pools[pool->index], FusionSHMPool );
 
+     magazines_deinit( &shm->pools[pool->index], pool );
+
      leave_pool( shm, &shm->pools[pool->index], pool );
 
      return DR_OK;
@@ -279,6 +541,7 @@ fusion_shm_pool_allocate( FusionSHMPoolShared  *pool,
 {
      DirectResult  ret;
      void         *data;
+     int           size_class;
 
      D_DEBUG_AT( Fusion_SHMPool, "%s( %p, %d, %sclear, %p )\n", __FUNCTION__,
                  pool, size, clear ? "" : "un", ret_data );
@@ -288,6 +551,22 @@ fusion_shm_pool_allocate( FusionSHMPoolShared  *pool,
      D_ASSERT( size > 0 );
      D_ASSERT( ret_data != NULL );
 
+     size_class = __shmalloc_slab_class( size );
+
+     /* Small objects come from the magazine, unless the caller holds the pool lock. */
+     if (size_class >= 0 && lock) {
+          data = magazine_get( pool, size_class );
+          if (!data)
+               return DR_NOSHAREDMEMORY;
+
+          if (clear)
+               memset( data, 0, size );
+
+          *ret_data = data;
+
+          return DR_OK;
+     }
+
      if (lock) {
           ret = fusion_skirmish_prevail( &pool->lock );
           if (ret)
@@ -296,7 +575,10 @@ fusion_shm_pool_allocate( FusionSHMPoolShared  *pool,
 
      __shmalloc_brk( pool->heap, 0 );
 
-     data = _fusion_shmalloc( pool->heap, size );
+     if (size_class >= 0)
+          data = _fusion_shmalloc_slab( pool->heap, size_class );
+     else
+          data = _fusion_shmalloc( pool->heap, size );
      if (!data) {
           if (lock)
                fusion_skirmish_dismiss( &pool->lock );
@@ -323,6 +605,7 @@ fusion_shm_pool_reallocate( FusionSHMPoolShared  *pool,
 {
      DirectResult  ret;
      void         *new_data;
+     int           size_class;
 
      D_DEBUG_AT( Fusion_SHMPool, "%s( %p, %p, %d, %p )\n",
                  __FUNCTION__, pool, data, size, ret_data );
@@ -343,7 +626,31 @@ fusion_shm_pool_reallocate( FusionSHMPoolShared  *pool,
 
      __shmalloc_brk( pool->heap, 0 );
 
-     new_data = _fusion_shrealloc( pool->heap, data, size );
+     size_class = _fusion_shslab_lookup( pool->heap, data );
+     if (size_class >= 0) {
+          size_t old_size = __shmalloc_slab_size( size_class );
+
+          /* Keep the object if the new size falls into the same class. */
+          if (__shmalloc_slab_class( size ) == size_class)
+               new_data = data;
+          else {
+               int new_class = __shmalloc_slab_class( size );
+
+               if (new_class >= 0)
+                    new_data = _fusion_shmalloc_slab( pool->heap, new_class );
+               else
+                    new_data = _fusion_shmalloc( pool->heap, size );
+
+               if (new_data) {
+                    direct_memcpy( new_data, data, MIN( old_size, (size_t) size ) );
+
+                    _fusion_shfree_slab( pool->heap, data );
+               }
+          }
+     }
+     else
+          new_data = _fusion_shrealloc( pool->heap, data, size );
+
      if (!new_data) {
           if (lock)
                fusion_skirmish_dismiss( &pool->lock );
@@ -364,6 +671,7 @@ fusion_shm_pool_deallocate( FusionSHMPoolShared *pool,
                             bool                 lock )
 {
      DirectResult ret;
+     int          size_class;
 
      D_DEBUG_AT( Fusion_SHMPool, "%s( %p, %p )\n", __FUNCTION__, pool, data );
 
@@ -373,15 +681,25 @@ fusion_shm_pool_deallocate( FusionSHMPoolShared *pool,
      D_ASSERT( data >= pool->addr_base );
      D_ASSERT( data < pool->addr_base + pool->max_size );
 
+     /* Slab objects go to the magazine, recognized by the slab header without the pool lock. */
      if (lock) {
+          size_class = _fusion_shslab_class( pool->heap, data );
+          if (size_class >= 0)
+               return magazine_put( pool, size_class, data );
+
           ret = fusion_skirmish_prevail( &pool->lock );
           if (ret)
                return ret;
      }
 
+     /* The block info table is relocated when the heap grows, map it before looking up the block type. */
      __shmalloc_brk( pool->heap, 0 );
 
-     _fusion_shfree( pool->heap, data );
+     size_class = _fusion_shslab_lookup( pool->heap, data );
+     if (size_class >= 0)
+          _fusion_shfree_slab( pool->heap, data );
+     else
+          _fusion_shfree( pool->heap, data );
 
      if (lock)
           fusion_skirmish_dismiss( &pool->lock );
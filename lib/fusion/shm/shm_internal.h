@@ -34,8 +34,10 @@
 #define __FUSION__SHM__SHM_INTERNAL_H__
 
 #include <limits.h>
+#include <sys/types.h>
 
 #include <direct/list.h>
+#include <direct/os/mutex.h>
 
 #include <fusion/build.h>
 #include <fusion/lock.h>
@@ -48,6 +50,30 @@
 typedef struct __shmalloc_heap shmalloc_heap;
 
 
+/* Small requests are served from slabs, i.e. single blocks of the heap
+   split into objects of one size class. Each process keeps a magazine of
+   free objects per size class, so that most small allocations and frees
+   do not need to take the pool lock. The magazines of a process live in
+   the pool (its depot), to be reclaimed once the process has died. */
+#define SHMALLOC_SLAB            (-1)     /* Block type of slabs in the block information table. */
+#define SHMALLOC_SLAB_CLASSES    10
+#define SHMALLOC_SLAB_MAX        512      /* Largest size served from slabs. */
+#define SHMALLOC_MAGAZINE_SIZE   32
+
+typedef struct {
+     int                  count;
+     void                *objects[SHMALLOC_MAGAZINE_SIZE];
+} shmalloc_magazine;
+
+typedef struct {
+     DirectLink           link;
+
+     pid_t                pid;          /* Process owning the magazines. */
+
+     shmalloc_magazine    magazines[SHMALLOC_SLAB_CLASSES];
+} shmalloc_depot;
+
+
 /*
  * Local pool data.
  */
@@ -63,6 +89,9 @@ struct __Fusion_FusionSHMPool {
      int                  pool_id;      /* The pool's ID within the world. */
 
      char                *filename;     /* Name of the shared memory file. */
+
+     DirectMutex          magazine_lock;
+     shmalloc_depot      *depot;        /* Free slab objects cached by this process, created on demand. */
 };
 
 /*
@@ -89,6 +118,8 @@ struct __Fusion_FusionSHMPoolShared {
      char                *name;         /* Name of the pool (allocated in the pool). */
 
      DirectLink          *allocs;       /* Used for debugging. */
+
+     DirectLink          *depots;       /* Magazines of all attached processes. */
 };
 
 
@@ -225,6 +256,9 @@ struct __shmalloc_heap {
      /* Free list headers for each fragment size.  */
      struct list fraghead[BLOCKLOG];
 
+     /* Slabs with free objects for each slab size class.  */
+     DirectLink *slabs[SHMALLOC_SLAB_CLASSES];
+
      /* Instrumentation.  */
      size_t chunks_used;
      size_t bytes_used;
@@ -248,6 +282,27 @@ void *_fusion_shrealloc (shmalloc_heap *heap, void *__ptr, size_t __size);
 void  _fusion_shfree (shmalloc_heap *heap, void *__ptr);
 
 
+int   __shmalloc_slab_class( size_t         size );
+
+void *_fusion_shmalloc_slab( shmalloc_heap *heap,
+                             int            size_class );
+
+void  _fusion_shfree_slab  ( shmalloc_heap *heap,
+                             void          *ptr );
+
+int   _fusion_shslab_lookup( shmalloc_heap *heap,
+                             const void    *ptr );
+
+int   _fusion_shslab_class ( shmalloc_heap *heap,
+                             const void    *ptr );
+
+size_t __shmalloc_slab_size( int            size_class );
+
+void  __shmalloc_magazines_forked( FusionSHM *shm );
+
+void  __shmalloc_magazines_reclaim( FusionSHM *shm );
+
+
 DirectResult __shmalloc_init_heap( FusionSHM     *shm,
                                    const char    *filename,
                                    void          *addr_base,
@@ -0,0 +1,284 @@
+/*
+   (c) Copyright 2012-2013  DirectFB integrated media GmbH
+   (c) Copyright 2001-2013  The world wide DirectFB Open Source Community (directfb.org)
+   (c) Copyright 2000-2004  Convergence (integrated media) GmbH
+
+   All rights reserved.
+
+   Written by Denis Oliver Kropp <dok@directfb.org>,
+              Andreas Shimokawa <andi@directfb.org>,
+              Marek Pikarski <mass@directfb.org>,
+              Sven Neumann <neo@directfb.org>,
+              Ville Syrjälä <syrjala@sci.fi> and
+              Claudio Ciccani <klan@users.sf.net>.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the
+   Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+   Boston, MA 02111-1307, USA.
+*/
+
+
+
+
+#include <config.h>
+
+#include <direct/debug.h>
+#include <direct/list.h>
+#include <direct/messages.h>
+
+#include <fusion/shm/pool.h>
+#include <fusion/shm/shm_internal.h>
+
+
+D_DEBUG_DOMAIN( Fusion_SHMSlab, "Fusion/SHMSlab", "Fusion Shared Memory Slabs" );
+
+/**********************************************************************************************************************/
+
+/*
+ * A slab occupies exactly one block of the heap, which is marked with
+ * SHMALLOC_SLAB in the block information table. The header is followed
+ * by the objects, so the slab of any object is found via its block.
+ *
+ * The tag and the slab's own address are set in all builds, they let
+ * _fusion_shslab_class() recognize a slab without the block information
+ * table, which needs the pool lock.
+ */
+typedef struct {
+     DirectLink    link;
+
+     int           magic;
+
+     unsigned int  tag;
+     const void   *self;
+
+     int           size_class;
+     unsigned int  used;         /* Objects handed out, including those in magazines. */
+     unsigned int  total;
+
+     void         *free;         /* Singly linked list of free objects. */
+} shmalloc_slab;
+
+#define SLAB_HEADER_SIZE  ((sizeof(shmalloc_slab) + 15) & ~15)
+
+#define SLAB_TAG          0x51ab51ab
+
+/* Address to block number, see shm_internal.h. */
+#define SLAB_OF(A)        ((shmalloc_slab*) ADDRESS( BLOCK(A) ))
+
+static const unsigned int slab_sizes[SHMALLOC_SLAB_CLASSES] = {
+     16, 32, 48, 64, 96, 128, 192, 256, 384, SHMALLOC_SLAB_MAX
+};
+
+/**********************************************************************************************************************/
+
+int
+__shmalloc_slab_class( size_t size )
+{
+     int i;
+
+     if (size > SHMALLOC_SLAB_MAX)
+          return -1;
+
+     for (i=0; i<SHMALLOC_SLAB_CLASSES; i++) {
+          if (size <= slab_sizes[i])
+               return i;
+     }
+
+     return -1;
+}
+
+size_t
+__shmalloc_slab_size( int size_class )
+{
+     D_ASSERT( size_class >= 0 );
+     D_ASSERT( size_class < SHMALLOC_SLAB_CLASSES );
+
+     return slab_sizes[size_class];
+}
+
+static shmalloc_slab *
+slab_create( shmalloc_heap *heap,
+             int            size_class )
+{
+     unsigned int   i;
+     unsigned int   size = slab_sizes[size_class];
+     char          *objects;
+     shmalloc_slab *slab;
+
+     slab = _fusion_shmalloc( heap, BLOCKSIZE );
+     if (!slab)
+          return NULL;
+
+     D_ASSERT( heap->heapinfo[BLOCK(slab)].busy.type == 0 );
+     D_ASSERT( heap->heapinfo[BLOCK(slab)].busy.info.size == 1 );
+
+     heap->heapinfo[BLOCK(slab)].busy.type = SHMALLOC_SLAB;
+
+     slab->tag        = SLAB_TAG;
+     slab->self       = slab;
+     slab->size_class = size_class;
+     slab->used       = 0;
+     slab->total      = (BLOCKSIZE - SLAB_HEADER_SIZE) / size;
+     slab->free       = NULL;
+
+     objects = (char*) slab + SLAB_HEADER_SIZE;
+
+     for (i=slab->total; i>0; i--) {
+          void **object = (void**)(objects + (i - 1) * size);
+
+          *object    = slab->free;
+          slab->free = object;
+     }
+
+     D_MAGIC_SET( slab, shmalloc_slab );
+
+     direct_list_prepend( &heap->slabs[size_class], &slab->link );
+
+     D_DEBUG_AT( Fusion_SHMSlab, "  -> new slab %p for %u byte objects (%u)\n", slab, size, slab->total );
+
+     return slab;
+}
+
+static void
+slab_destroy( shmalloc_heap *heap,
+              shmalloc_slab *slab )
+{
+     D_MAGIC_ASSERT( slab, shmalloc_slab );
+     D_ASSERT( slab->used == 0 );
+
+     D_DEBUG_AT( Fusion_SHMSlab, "  -> releasing slab %p\n", slab );
+
+     direct_list_remove( &heap->slabs[slab->size_class], &slab->link );
+
+     D_MAGIC_CLEAR( slab );
+
+     slab->tag  = 0;
+     slab->self = NULL;
+
+     heap->heapinfo[BLOCK(slab)].busy.type = 0;
+
+     _fusion_shfree( heap, slab );
+}
+
+/**********************************************************************************************************************/
+
+/* Allocate an object of the size class, the pool lock must be held. */
+void *
+_fusion_shmalloc_slab( shmalloc_heap *heap,
+                       int            size_class )
+{
+     void          **object;
+     shmalloc_slab  *slab;
+
+     D_MAGIC_ASSERT( heap, shmalloc_heap );
+     D_ASSERT( size_class >= 0 );
+     D_ASSERT( size_class < SHMALLOC_SLAB_CLASSES );
+
+     slab = (shmalloc_slab*) heap->slabs[size_class];
+     if (!slab) {
+          slab = slab_create( heap, size_class );
+          if (!slab)
+               return NULL;
+     }
+
+     D_MAGIC_ASSERT( slab, shmalloc_slab );
+     D_ASSERT( slab->free != NULL );
+
+     object     = slab->free;
+     slab->free = *object;
+
+     slab->used++;
+
+     /* Full slabs are not kept in the list. */
+     if (!slab->free)
+          direct_list_remove( &heap->slabs[size_class], &slab->link );
+
+     return object;
+}
+
+/* Free an object allocated from a slab, the pool lock must be held. */
+void
+_fusion_shfree_slab( shmalloc_heap *heap,
+                     void          *ptr )
+{
+     void          **object = ptr;
+     shmalloc_slab  *slab;
+
+     D_MAGIC_ASSERT( heap, shmalloc_heap );
+     D_ASSERT( ptr != NULL );
+     D_ASSERT( heap->heapinfo[BLOCK(ptr)].busy.type == SHMALLOC_SLAB );
+
+     slab = SLAB_OF( ptr );
+
+     D_MAGIC_ASSERT( slab, shmalloc_slab );
+     D_ASSERT( slab->used > 0 );
+     D_ASSERT( ((char*) ptr - (char*) slab - SLAB_HEADER_SIZE) % slab_sizes[slab->size_class] == 0 );
+
+     if (!slab->free)
+          direct_list_prepend( &heap->slabs[slab->size_class], &slab->link );
+
+     *object    = slab->free;
+     slab->free = object;
+
+     slab->used--;
+
+     /* Return empty slabs to the heap, unless it's the only one left. */
+     if (!slab->used && (heap->slabs[slab->size_class] != &slab->link || slab->link.next))
+          slab_destroy( heap, slab );
+}
+
+/* Return the size class of a slab object, or -1 if allocated otherwise. */
+int
+_fusion_shslab_lookup( shmalloc_heap *heap,
+                       const void    *ptr )
+{
+     shmalloc_slab *slab;
+
+     D_MAGIC_ASSERT( heap, shmalloc_heap );
+
+     if (heap->heapinfo[BLOCK(ptr)].busy.type != SHMALLOC_SLAB)
+          return -1;
+
+     slab = SLAB_OF( ptr );
+
+     D_MAGIC_ASSERT( slab, shmalloc_slab );
+
+     return slab->size_class;
+}
+
+/*
+ * Return the size class of a slab object, or -1 if allocated otherwise, without the pool lock.
+ *
+ * The object must be allocated, which keeps its slab alive. Blocks other than slabs start
+ * with arbitrary data, so the header has to match the tag and its own address.
+ */
+int
+_fusion_shslab_class( shmalloc_heap *heap,
+                      const void    *ptr )
+{
+     const shmalloc_slab *slab;
+
+     D_MAGIC_ASSERT( heap, shmalloc_heap );
+
+     slab = SLAB_OF( ptr );
+
+     if (slab->tag != SLAB_TAG || slab->self != slab)
+          return -1;
+
+     D_MAGIC_ASSERT( slab, shmalloc_slab );
+     D_ASSERT( slab->size_class >= 0 );
+     D_ASSERT( slab->size_class < SHMALLOC_SLAB_CLASSES );
+
+     return slab->size_class;
+}
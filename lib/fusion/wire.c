@@ -0,0 +1,435 @@
+/*
+   (c) Copyright 2012-2013  DirectFB integrated media GmbH
+   (c) Copyright 2001-2013  The world wide DirectFB Open Source Community (directfb.org)
+   (c) Copyright 2000-2004  Convergence (integrated media) GmbH
+
+   All rights reserved.
+
+   Written by Denis Oliver Kropp <dok@directfb.org>,
+              Andreas Shimokawa <andi@directfb.org>,
+              Marek Pikarski <mass@directfb.org>,
+              Sven Neumann <neo@directfb.org>,
+              Ville Syrjälä <syrjala@sci.fi> and
+              Claudio Ciccani <klan@users.sf.net>.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the
+   Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+   Boston, MA 02111-1307, USA.
+*/
+
+
+
+//#define DIRECT_ENABLE_DEBUG
+
+#include <config.h>
+
+#include <string.h>
+
+#include <direct/clock.h>
+#include <direct/debug.h>
+#include <direct/memcpy.h>
+#include <direct/messages.h>
+
+#include <fusion/wire.h>
+
+
+D_DEBUG_DOMAIN( Fusion_Wire, "Fusion/Wire", "Fusion Wire Format" );
+
+/**********************************************************************************************************************/
+
+#define WIRE_DESCRIPTOR(type,size)         ((u32)(type) | ((u32)(size) << 8))
+#define WIRE_DESCRIPTOR_TYPE(descriptor)   ((FusionWireItemType)((descriptor) & 0xff))
+#define WIRE_DESCRIPTOR_SIZE(descriptor)   ((descriptor) >> 8)
+
+#define WIRE_ELEMENT_SIZE_MAX              0xffffff
+
+/**********************************************************************************************************************/
+
+unsigned int
+fusion_wire_message_length( const void   *data,
+                            unsigned int  available )
+{
+     const FusionWireHeader *header = data;
+
+     D_ASSERT( data != NULL );
+
+     if (available < sizeof(FusionWireHeader))
+          return 0;
+
+     return header->length;
+}
+
+/**********************************************************************************************************************/
+
+static DirectResult
+encode_item( FusionWireEncoder  *encoder,
+             FusionWireItemType  type,
+             const void         *value,
+             unsigned int        size )
+{
+     u32 *words;
+
+     D_MAGIC_ASSERT( encoder, FusionWireEncoder );
+     D_ASSERT( size == 4 || size == 8 );
+
+     if (encoder->size - encoder->length < FUSION_WIRE_ALIGN + (size == 8 ? 8 : 0))
+          return DR_LIMITEXCEEDED;
+
+     words = (u32*)(encoder->buffer + encoder->length);
+
+     words[0] = WIRE_DESCRIPTOR( type, size );
+
+     if (size == 4) {
+          words[1] = *(const u32*) value;
+
+          encoder->length += 8;
+     }
+     else {
+          words[1] = 0;
+
+          *(u64*)(words + 2) = *(const u64*) value;
+
+          encoder->length += 16;
+     }
+
+     return DR_OK;
+}
+
+DirectResult
+fusion_wire_encode_init( FusionWireEncoder      *encoder,
+                         void                   *buffer,
+                         unsigned int            size,
+                         u32                     call_id,
+                         s32                     call_arg,
+                         FusionWireMessageFlags  flags )
+{
+     FusionWireHeader *header = buffer;
+
+     D_ASSERT( encoder != NULL );
+     D_ASSERT( buffer != NULL );
+     D_FLAGS_ASSERT( flags, FWMF_ALL );
+
+     D_DEBUG_AT( Fusion_Wire, "%s( %p, size %u, call %u, arg %d )\n", __FUNCTION__, buffer, size, call_id, call_arg );
+
+     if ((unsigned long) buffer & (FUSION_WIRE_ALIGN - 1))
+          return DR_INVARG;
+
+     if (size < sizeof(FusionWireHeader))
+          return DR_LIMITEXCEEDED;
+
+     header->magic       = FUSION_WIRE_MAGIC;
+     header->version     = FUSION_WIRE_VERSION;
+     header->header_size = sizeof(FusionWireHeader);
+     header->length      = sizeof(FusionWireHeader);
+     header->flags       = flags;
+     header->call_id     = call_id;
+     header->call_arg    = call_arg;
+     header->object_id   = 0;
+     header->fusion_id   = 0;
+     header->timestamp   = direct_clock_get_time( DIRECT_CLOCK_MONOTONIC );
+
+     encoder->buffer = buffer;
+     encoder->size   = size & ~(FUSION_WIRE_ALIGN - 1);
+     encoder->length = sizeof(FusionWireHeader);
+     encoder->header = header;
+
+     D_MAGIC_SET( encoder, FusionWireEncoder );
+
+     return DR_OK;
+}
+
+DirectResult
+fusion_wire_encode_u32( FusionWireEncoder *encoder,
+                        u32                value )
+{
+     return encode_item( encoder, FWIT_U32, &value, 4 );
+}
+
+DirectResult
+fusion_wire_encode_s32( FusionWireEncoder *encoder,
+                        s32                value )
+{
+     return encode_item( encoder, FWIT_S32, &value, 4 );
+}
+
+DirectResult
+fusion_wire_encode_u64( FusionWireEncoder *encoder,
+                        u64                value )
+{
+     return encode_item( encoder, FWIT_U64, &value, 8 );
+}
+
+DirectResult
+fusion_wire_encode_s64( FusionWireEncoder *encoder,
+                        s64                value )
+{
+     return encode_item( encoder, FWIT_S64, &value, 8 );
+}
+
+DirectResult
+fusion_wire_encode_object( FusionWireEncoder *encoder,
+                           u32                object_id )
+{
+     return encode_item( encoder, FWIT_OBJECT, &object_id, 4 );
+}
+
+DirectResult
+fusion_wire_encode_reserve( FusionWireEncoder  *encoder,
+                            unsigned int        element_size,
+                            unsigned int        count,
+                            void              **ret_elements )
+{
+     u32 *words;
+     u64  bytes;
+
+     D_MAGIC_ASSERT( encoder, FusionWireEncoder );
+     D_ASSERT( ret_elements != NULL );
+
+     if (!element_size || element_size > WIRE_ELEMENT_SIZE_MAX)
+          return DR_INVARG;
+
+     /* Computed in 64 bit, the product may not fit into an unsigned long. */
+     bytes = (u64) element_size * count;
+
+     if (encoder->size - encoder->length < FUSION_WIRE_ALIGN ||
+         FUSION_WIRE_ALIGNED( bytes ) > encoder->size - encoder->length - FUSION_WIRE_ALIGN)
+          return DR_LIMITEXCEEDED;
+
+     words = (u32*)(encoder->buffer + encoder->length);
+
+     words[0] = WIRE_DESCRIPTOR( FWIT_ARRAY, element_size );
+     words[1] = count;
+
+     encoder->length += FUSION_WIRE_ALIGN + FUSION_WIRE_ALIGNED( bytes );
+
+     /* Clear the padding, the message may be written to a file. */
+     if (bytes & (FUSION_WIRE_ALIGN - 1))
+          memset( (u8*)(words + 2) + bytes, 0, FUSION_WIRE_ALIGN - (bytes & (FUSION_WIRE_ALIGN - 1)) );
+
+     *ret_elements = words + 2;
+
+     return DR_OK;
+}
+
+DirectResult
+fusion_wire_encode_array( FusionWireEncoder *encoder,
+                          const void        *elements,
+                          unsigned int       element_size,
+                          unsigned int       count )
+{
+     DirectResult  ret;
+     void         *data;
+
+     D_ASSERT( elements != NULL || count == 0 );
+
+     ret = fusion_wire_encode_reserve( encoder, element_size, count, &data );
+     if (ret)
+          return ret;
+
+     if (count)
+          direct_memcpy( data, elements, element_size * count );
+
+     return DR_OK;
+}
+
+DirectResult
+fusion_wire_encode_finish( FusionWireEncoder *encoder,
+                           unsigned int      *ret_length )
+{
+     D_MAGIC_ASSERT( encoder, FusionWireEncoder );
+
+     D_DEBUG_AT( Fusion_Wire, "%s( %p ) -> length %u\n", __FUNCTION__, encoder->buffer, encoder->length );
+
+     encoder->header->length = encoder->length;
+
+     if (ret_length)
+          *ret_length = encoder->length;
+
+     D_MAGIC_CLEAR( encoder );
+
+     return DR_OK;
+}
+
+/**********************************************************************************************************************/
+
+DirectResult
+fusion_wire_decode_init( FusionWireDecoder *decoder,
+                         const void        *buffer,
+                         unsigned int       length )
+{
+     const FusionWireHeader *header = buffer;
+
+     D_ASSERT( decoder != NULL );
+     D_ASSERT( buffer != NULL );
+
+     if ((unsigned long) buffer & (FUSION_WIRE_ALIGN - 1))
+          return DR_INVARG;
+
+     if (length < sizeof(FusionWireHeader))
+          return DR_INCOMPLETE;
+
+     if (header->magic != FUSION_WIRE_MAGIC) {
+          D_DEBUG_AT( Fusion_Wire, "  -> bad magic 0x%08x\n", header->magic );
+          return DR_VERSIONMISMATCH;
+     }
+
+     if ((header->version >> 8) != FUSION_WIRE_VERSION_MAJOR) {
+          D_DEBUG_AT( Fusion_Wire, "  -> unsupported version %d.%d\n", header->version >> 8, header->version & 0xff );
+          return DR_VERSIONMISMATCH;
+     }
+
+     if (header->header_size < sizeof(FusionWireHeader) || header->header_size & (FUSION_WIRE_ALIGN - 1) ||
+         header->length < header->header_size || header->length & (FUSION_WIRE_ALIGN - 1))
+          return DR_INVARG;
+
+     if (header->length > length)
+          return DR_INCOMPLETE;
+
+     decoder->buffer = buffer;
+     decoder->length = header->length;
+     decoder->offset = header->header_size;
+     decoder->header = header;
+
+     /* Decoders need no cleanup and may be initialized again. */
+     D_MAGIC_SET_ONLY( decoder, FusionWireDecoder );
+
+     return DR_OK;
+}
+
+FusionWireItemType
+fusion_wire_decode_peek( FusionWireDecoder *decoder,
+                         unsigned int      *ret_element_size )
+{
+     u32 descriptor;
+
+     D_MAGIC_ASSERT( decoder, FusionWireDecoder );
+
+     if (decoder->length - decoder->offset < FUSION_WIRE_ALIGN)
+          return FWIT_NONE;
+
+     descriptor = *(const u32*)(decoder->buffer + decoder->offset);
+
+     if (ret_element_size)
+          *ret_element_size = WIRE_DESCRIPTOR_SIZE( descriptor );
+
+     return WIRE_DESCRIPTOR_TYPE( descriptor );
+}
+
+static DirectResult
+decode_item( FusionWireDecoder  *decoder,
+             FusionWireItemType  type,
+             void               *ret_value,
+             unsigned int        size )
+{
+     const u32 *words;
+
+     D_MAGIC_ASSERT( decoder, FusionWireDecoder );
+     D_ASSERT( ret_value != NULL );
+
+     if (decoder->length - decoder->offset < FUSION_WIRE_ALIGN + (size == 8 ? 8 : 0))
+          return DR_EOF;
+
+     words = (const u32*)(decoder->buffer + decoder->offset);
+
+     if (words[0] != WIRE_DESCRIPTOR( type, size )) {
+          D_DEBUG_AT( Fusion_Wire, "  -> expected item 0x%08x, got 0x%08x at %u\n",
+                      WIRE_DESCRIPTOR( type, size ), words[0], decoder->offset );
+          return DR_INVARG;
+     }
+
+     if (size == 4) {
+          *(u32*) ret_value = words[1];
+
+          decoder->offset += 8;
+     }
+     else {
+          *(u64*) ret_value = *(const u64*)(words + 2);
+
+          decoder->offset += 16;
+     }
+
+     return DR_OK;
+}
+
+DirectResult
+fusion_wire_decode_u32( FusionWireDecoder *decoder,
+                        u32               *ret_value )
+{
+     return decode_item( decoder, FWIT_U32, ret_value, 4 );
+}
+
+DirectResult
+fusion_wire_decode_s32( FusionWireDecoder *decoder,
+                        s32               *ret_value )
+{
+     return decode_item( decoder, FWIT_S32, ret_value, 4 );
+}
+
+DirectResult
+fusion_wire_decode_u64( FusionWireDecoder *decoder,
+                        u64               *ret_value )
+{
+     return decode_item( decoder, FWIT_U64, ret_value, 8 );
+}
+
+DirectResult
+fusion_wire_decode_s64( FusionWireDecoder *decoder,
+                        s64               *ret_value )
+{
+     return decode_item( decoder, FWIT_S64, ret_value, 8 );
+}
+
+DirectResult
+fusion_wire_decode_object( FusionWireDecoder *decoder,
+                           u32               *ret_object_id )
+{
+     return decode_item( decoder, FWIT_OBJECT, ret_object_id, 4 );
+}
+
+DirectResult
+fusion_wire_decode_array( FusionWireDecoder  *decoder,
+                          unsigned int        element_size,
+                          const void        **ret_elements,
+                          unsigned int       *ret_count )
+{
+     const u32 *words;
+     u64        bytes;
+
+     D_MAGIC_ASSERT( decoder, FusionWireDecoder );
+     D_ASSERT( ret_elements != NULL );
+     D_ASSERT( ret_count != NULL );
+
+     if (decoder->length - decoder->offset < FUSION_WIRE_ALIGN)
+          return DR_EOF;
+
+     words = (const u32*)(decoder->buffer + decoder->offset);
+
+     if (words[0] != WIRE_DESCRIPTOR( FWIT_ARRAY, element_size )) {
+          D_DEBUG_AT( Fusion_Wire, "  -> expected array of %u, got 0x%08x at %u\n", element_size, words[0], decoder->offset );
+          return DR_INVARG;
+     }
+
+     /* Computed in 64 bit, the count comes from the message. */
+     bytes = (u64) element_size * words[1];
+
+     if (FUSION_WIRE_ALIGNED( bytes ) > decoder->length - decoder->offset - FUSION_WIRE_ALIGN)
+          return DR_INVARG;
+
+     *ret_elements = words + 2;
+     *ret_count    = words[1];
+
+     decoder->offset += FUSION_WIRE_ALIGN + FUSION_WIRE_ALIGNED( bytes );
+
+     return DR_OK;
+}
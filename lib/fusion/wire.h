@@ -0,0 +1,209 @@
+/*
+   (c) Copyright 2012-2013  DirectFB integrated media GmbH
+   (c) Copyright 2001-2013  The world wide DirectFB Open Source Community (directfb.org)
+   (c) Copyright 2000-2004  Convergence (integrated media) GmbH
+
+   All rights reserved.
+
+   Written by Denis Oliver Kropp <dok@directfb.org>,
+              Andreas Shimokawa <andi@directfb.org>,
+              Marek Pikarski <mass@directfb.org>,
+              Sven Neumann <neo@directfb.org>,
+              Ville Syrjälä <syrjala@sci.fi> and
+              Claudio Ciccani <klan@users.sf.net>.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the
+   Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+   Boston, MA 02111-1307, USA.
+*/
+
+
+
+#ifndef __FUSION__WIRE_H__
+#define __FUSION__WIRE_H__
+
+#include <fusion/types.h>
+
+/*
+ * Versioned binary encoding of calls, e.g. flux traffic for recording or sending over Voodoo.
+ *
+ * A message is a fixed size header followed by self describing items. Every item starts
+ * with a descriptor word (type and element size) at an eight byte boundary. Scalars up to
+ * 32 bits follow the descriptor inline, 64 bit scalars and arrays are eight byte aligned.
+ * Arrays carry their element count and are padded to the next boundary.
+ *
+ * Decoding returns pointers into the message, no data is copied. Messages use the
+ * byte order of the writer, a swapped magic is rejected.
+ */
+
+#define FUSION_WIRE_MAGIC            0x46585731      /* 'FXW1' */
+
+#define FUSION_WIRE_VERSION_MAJOR    1
+#define FUSION_WIRE_VERSION_MINOR    0
+#define FUSION_WIRE_VERSION          ((FUSION_WIRE_VERSION_MAJOR << 8) | FUSION_WIRE_VERSION_MINOR)
+
+#define FUSION_WIRE_ALIGN            8
+#define FUSION_WIRE_ALIGNED(n)       (((n) + FUSION_WIRE_ALIGN - 1) & ~(FUSION_WIRE_ALIGN - 1))
+
+typedef enum {
+     FWMF_NONE      = 0x00000000,
+
+     FWMF_ONEWAY    = 0x00000001,    /* No return data expected, e.g. queued call */
+     FWMF_RETURN    = 0x00000002,    /* Message carries the return data of a call */
+
+     FWMF_ALL       = 0x00000003
+} FusionWireMessageFlags;
+
+typedef enum {
+     FWIT_NONE      = 0,
+
+     FWIT_U32       = 1,             /* Also enums and flags */
+     FWIT_S32       = 2,
+     FWIT_U64       = 3,
+     FWIT_S64       = 4,
+     FWIT_OBJECT    = 5,             /* Object id, zero for none */
+     FWIT_ARRAY     = 6              /* Element size and count, followed by the elements */
+} FusionWireItemType;
+
+typedef struct {
+     u32            magic;
+     u16            version;
+     u16            header_size;     /* Size of this header, allows newer minor versions to extend it */
+
+     u32            length;          /* Total length including header and padding */
+     u32            flags;           /* FusionWireMessageFlags */
+
+     u32            call_id;         /* Call or interface the message belongs to */
+     s32            call_arg;        /* Method */
+
+     u32            object_id;
+     u32            fusion_id;       /* Sender */
+
+     s64            timestamp;       /* Micro seconds, direct_clock_get_time( DIRECT_CLOCK_MONOTONIC ) */
+} FusionWireHeader;
+
+
+typedef struct {
+     int                 magic;
+
+     u8                 *buffer;
+     unsigned int        size;
+     unsigned int        length;
+
+     FusionWireHeader   *header;
+} FusionWireEncoder;
+
+typedef struct {
+     int                 magic;
+
+     const u8           *buffer;
+     unsigned int        length;
+     unsigned int        offset;
+
+     const FusionWireHeader *header;
+} FusionWireDecoder;
+
+
+/*
+ * Returns the length of the message at the start of 'data', or zero if 'available' bytes
+ * do not hold a complete header. Does not validate the message.
+ */
+unsigned int FUSION_API fusion_wire_message_length ( const void              *data,
+                                                     unsigned int             available );
+
+
+/*
+ * Starts a message in 'buffer', the header stays accessible via encoder->header.
+ */
+DirectResult FUSION_API fusion_wire_encode_init    ( FusionWireEncoder       *encoder,
+                                                     void                    *buffer,
+                                                     unsigned int             size,
+                                                     u32                      call_id,
+                                                     s32                      call_arg,
+                                                     FusionWireMessageFlags   flags );
+
+DirectResult FUSION_API fusion_wire_encode_u32     ( FusionWireEncoder       *encoder,
+                                                     u32                      value );
+
+DirectResult FUSION_API fusion_wire_encode_s32     ( FusionWireEncoder       *encoder,
+                                                     s32                      value );
+
+DirectResult FUSION_API fusion_wire_encode_u64     ( FusionWireEncoder       *encoder,
+                                                     u64                      value );
+
+DirectResult FUSION_API fusion_wire_encode_s64     ( FusionWireEncoder       *encoder,
+                                                     s64                      value );
+
+DirectResult FUSION_API fusion_wire_encode_object  ( FusionWireEncoder       *encoder,
+                                                     u32                      object_id );
+
+DirectResult FUSION_API fusion_wire_encode_array   ( FusionWireEncoder       *encoder,
+                                                     const void              *elements,
+                                                     unsigned int             element_size,
+                                                     unsigned int             count );
+
+/*
+ * Adds an array item and returns where to write its elements, avoiding a copy.
+ */
+DirectResult FUSION_API fusion_wire_encode_reserve ( FusionWireEncoder       *encoder,
+                                                     unsigned int             element_size,
+                                                     unsigned int             count,
+                                                     void                   **ret_elements );
+
+/*
+ * Finishes the message and returns its total length.
+ */
+DirectResult FUSION_API fusion_wire_encode_finish  ( FusionWireEncoder       *encoder,
+                                                     unsigned int            *ret_length );
+
+
+/*
+ * Validates header and length of a message.
+ *
+ * Returns DR_VERSIONMISMATCH for a different major version or byte order.
+ */
+DirectResult FUSION_API fusion_wire_decode_init    ( FusionWireDecoder       *decoder,
+                                                     const void              *buffer,
+                                                     unsigned int             length );
+
+/*
+ * Returns type and element size of the next item, FWIT_NONE at the end of the message.
+ */
+FusionWireItemType FUSION_API fusion_wire_decode_peek( FusionWireDecoder     *decoder,
+                                                       unsigned int          *ret_element_size );
+
+DirectResult FUSION_API fusion_wire_decode_u32     ( FusionWireDecoder       *decoder,
+                                                     u32                     *ret_value );
+
+DirectResult FUSION_API fusion_wire_decode_s32     ( FusionWireDecoder       *decoder,
+                                                     s32                     *ret_value );
+
+DirectResult FUSION_API fusion_wire_decode_u64     ( FusionWireDecoder       *decoder,
+                                                     u64                     *ret_value );
+
+DirectResult FUSION_API fusion_wire_decode_s64     ( FusionWireDecoder       *decoder,
+                                                     s64                     *ret_value );
+
+DirectResult FUSION_API fusion_wire_decode_object  ( FusionWireDecoder       *decoder,
+                                                     u32                     *ret_object_id );
+
+/*
+ * Returns a pointer to the elements inside the message, 'element_size' must match.
+ */
+DirectResult FUSION_API fusion_wire_decode_array   ( FusionWireDecoder       *decoder,
+                                                     unsigned int             element_size,
+                                                     const void             **ret_elements,
+                                                     unsigned int            *ret_count );
+
+#endif
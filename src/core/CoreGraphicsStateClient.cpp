@@ -37,10 +37,12 @@
 #include <direct/Types++.h>
 
 extern "C" {
+#include <direct/atomic.h>
 #include <direct/debug.h>
 #include <direct/mem.h>
 #include <direct/memcpy.h>
 #include <direct/messages.h>
+#include <direct/util.h>
 
 #include <core/core.h>
 #include <core/graphics_state.h>
@@ -65,6 +67,11 @@ D_DEBUG_DOMAIN( Core_GraphicsStateClient,          "Core/GfxState/Client",
 D_DEBUG_DOMAIN( Core_GraphicsStateClient_Flush,    "Core/GfxState/Client/Flush",    "DirectFB Core Graphics State Client Flush" );
 D_DEBUG_DOMAIN( Core_GraphicsStateClient_Throttle, "Core/GfxState/Client/Throttle", "DirectFB Core Graphics State Client Throttle" );
 
+/*
+ * Minimum size of bulk arguments for passing them via the shared arena
+ */
+#define CGSC_ARENA_THRESHOLD  1024
+
 /**********************************************************************************************************************/
 
 namespace DirectFB {
@@ -257,6 +264,44 @@ extern "C" {
 static ReactionResult CoreGraphicsStateClient_Reaction( const void *msg_data,
                                                         void       *ctx );
 
+/*
+ * Values last sent to the master, surfaces are not referenced as the master's state holds them
+ */
+typedef struct {
+     StateModificationFlags   valid;
+
+     DFBSurfaceDrawingFlags   drawingflags;
+     DFBSurfaceBlittingFlags  blittingflags;
+     DFBRegion                clip;
+     DFBColor                 color;
+     DFBSurfaceBlendFunction  src_blend;
+     DFBSurfaceBlendFunction  dst_blend;
+     u32                      src_colorkey;
+     u32                      dst_colorkey;
+
+     CoreSurface             *destination;
+     DirectSerial             dst_serial;
+     CoreSurface             *source;
+     DirectSerial             src_serial;
+     CoreSurface             *source_mask;
+     DirectSerial             src_mask_serial;
+     DFBPoint                 src_mask_offset;
+     DFBSurfaceMaskFlags      src_mask_flags;
+     CoreSurface             *source2;
+     DirectSerial             src2_serial;
+
+     DFBColorKey              colorkey;
+     DFBSurfaceRenderOptions  render_options;
+     s32                      matrix[9];
+
+     CoreSurfaceBufferRole    from;
+     DFBSurfaceStereoEye      from_eye;
+     CoreSurfaceBufferRole    to;
+     DFBSurfaceStereoEye      to_eye;
+
+     DFBConvolutionFilter     src_convolution;
+} StateShadow;
+
 class CoreGraphicsStateClientPrivate
 {
 private:
@@ -265,20 +310,181 @@ private:
      Reaction                 gfx_reaction;
      u32                      cookie_received;
      u32                      cookie_sent;
+     u32                      arena_head;
+     StateShadow              shadow;
+     unsigned int             dropped;
+
+     static bool surfaceSent( const CoreSurface  *sent,
+                              const DirectSerial *sent_serial,
+                              const CoreSurface  *surface )
+     {
+          return sent == surface && (!surface || direct_serial_check( sent_serial, &surface->serial ));
+     }
+
+     static void surfaceShadow( CoreSurface       **sent,
+                                DirectSerial       *sent_serial,
+                                CoreSurface        *surface )
+     {
+          *sent = surface;
+
+          if (surface)
+               direct_serial_copy( sent_serial, &surface->serial );
+     }
 
 public:
      CoreGraphicsStateClientPrivate( CoreGraphicsStateClient *client )
           :
           client( client ),
           cookie_received(0),
-          cookie_sent(0)
+          cookie_sent(0),
+          arena_head(0),
+          shadow(),
+          dropped(0)
      {
+          direct_serial_init( &shadow.dst_serial );
+          direct_serial_init( &shadow.src_serial );
+          direct_serial_init( &shadow.src_mask_serial );
+          direct_serial_init( &shadow.src2_serial );
+
           dfb_graphics_state_attach( client->gfx_state, CoreGraphicsStateClient_Reaction, this, &gfx_reaction );
      }
 
      virtual ~CoreGraphicsStateClientPrivate()
      {
+          D_DEBUG_AT( Core_GraphicsStateClient, "  -> dropped %u redundant state calls\n", dropped );
+
           dfb_graphics_state_detach( client->gfx_state, &gfx_reaction );
+
+          direct_serial_deinit( &shadow.dst_serial );
+          direct_serial_deinit( &shadow.src_serial );
+          direct_serial_deinit( &shadow.src_mask_serial );
+          direct_serial_deinit( &shadow.src2_serial );
+     }
+
+     /*
+      * Removes flags of values that equal the ones last sent to the master.
+      */
+     StateModificationFlags filterState( const CardState        *state,
+                                         StateModificationFlags  flags )
+     {
+          unsigned int           check     = flags & shadow.valid;
+          unsigned int           redundant = SMF_NONE;
+
+#define SHADOW_CHECK(flag,equal)                  \
+          if ((check & (flag)) && (equal))        \
+               redundant |= (flag)
+
+          SHADOW_CHECK( SMF_DRAWING_FLAGS,    shadow.drawingflags == state->drawingflags );
+          SHADOW_CHECK( SMF_BLITTING_FLAGS,   shadow.blittingflags == state->blittingflags );
+          SHADOW_CHECK( SMF_CLIP,             DFB_REGION_EQUAL( shadow.clip, state->clip ) );
+          SHADOW_CHECK( SMF_COLOR,            DFB_COLOR_EQUAL( shadow.color, state->color ) );
+          SHADOW_CHECK( SMF_SRC_BLEND,        shadow.src_blend == state->src_blend );
+          SHADOW_CHECK( SMF_DST_BLEND,        shadow.dst_blend == state->dst_blend );
+          SHADOW_CHECK( SMF_SRC_COLORKEY,     shadow.src_colorkey == state->src_colorkey );
+          SHADOW_CHECK( SMF_DST_COLORKEY,     shadow.dst_colorkey == state->dst_colorkey );
+          SHADOW_CHECK( SMF_DESTINATION,      surfaceSent( shadow.destination, &shadow.dst_serial, state->destination ) );
+          SHADOW_CHECK( SMF_SOURCE,           surfaceSent( shadow.source, &shadow.src_serial, state->source ) );
+          SHADOW_CHECK( SMF_SOURCE_MASK,      surfaceSent( shadow.source_mask, &shadow.src_mask_serial, state->source_mask ) );
+          SHADOW_CHECK( SMF_SOURCE_MASK_VALS, DFB_POINT_EQUAL( shadow.src_mask_offset, state->src_mask_offset ) &&
+                                              shadow.src_mask_flags == state->src_mask_flags );
+          SHADOW_CHECK( SMF_COLORKEY,         !memcmp( &shadow.colorkey, &state->colorkey, sizeof(DFBColorKey) ) );
+          SHADOW_CHECK( SMF_RENDER_OPTIONS,   shadow.render_options == state->render_options );
+          SHADOW_CHECK( SMF_MATRIX,           !memcmp( shadow.matrix, state->matrix, sizeof(shadow.matrix) ) );
+          SHADOW_CHECK( SMF_SOURCE2,          surfaceSent( shadow.source2, &shadow.src2_serial, state->source2 ) );
+          SHADOW_CHECK( SMF_FROM,             shadow.from == state->from && shadow.from_eye == state->from_eye );
+          SHADOW_CHECK( SMF_TO,               shadow.to == state->to && shadow.to_eye == state->to_eye );
+          SHADOW_CHECK( SMF_SRC_CONVOLUTION,  !memcmp( &shadow.src_convolution, &state->src_convolution,
+                                                       sizeof(DFBConvolutionFilter) ) );
+
+#undef SHADOW_CHECK
+
+          if (redundant) {
+               dropped += direct_util_count_bits( redundant );
+
+               D_DEBUG_AT( Core_GraphicsStateClient, "  -> dropping redundant 0x%08x (%u dropped so far)\n", redundant, dropped );
+          }
+
+          return (StateModificationFlags)(flags & ~redundant);
+     }
+
+     /*
+      * Remembers the values that have been sent to the master.
+      */
+     void shadowState( const CardState        *state,
+                       StateModificationFlags  flags )
+     {
+          if (flags & SMF_DRAWING_FLAGS)
+               shadow.drawingflags = state->drawingflags;
+
+          if (flags & SMF_BLITTING_FLAGS)
+               shadow.blittingflags = state->blittingflags;
+
+          if (flags & SMF_CLIP)
+               shadow.clip = state->clip;
+
+          if (flags & SMF_COLOR)
+               shadow.color = state->color;
+
+          if (flags & SMF_SRC_BLEND)
+               shadow.src_blend = state->src_blend;
+
+          if (flags & SMF_DST_BLEND)
+               shadow.dst_blend = state->dst_blend;
+
+          if (flags & SMF_SRC_COLORKEY)
+               shadow.src_colorkey = state->src_colorkey;
+
+          if (flags & SMF_DST_COLORKEY)
+               shadow.dst_colorkey = state->dst_colorkey;
+
+          if (flags & SMF_DESTINATION)
+               surfaceShadow( &shadow.destination, &shadow.dst_serial, state->destination );
+
+          if (flags & SMF_SOURCE)
+               surfaceShadow( &shadow.source, &shadow.src_serial, state->source );
+
+          if (flags & SMF_SOURCE_MASK)
+               surfaceShadow( &shadow.source_mask, &shadow.src_mask_serial, state->source_mask );
+
+          if (flags & SMF_SOURCE_MASK_VALS) {
+               shadow.src_mask_offset = state->src_mask_offset;
+               shadow.src_mask_flags  = state->src_mask_flags;
+          }
+
+          if (flags & SMF_COLORKEY)
+               shadow.colorkey = state->colorkey;
+
+          if (flags & SMF_RENDER_OPTIONS)
+               shadow.render_options = state->render_options;
+
+          if (flags & SMF_MATRIX)
+               direct_memcpy( shadow.matrix, state->matrix, sizeof(shadow.matrix) );
+
+          if (flags & SMF_SOURCE2)
+               surfaceShadow( &shadow.source2, &shadow.src2_serial, state->source2 );
+
+          if (flags & SMF_FROM) {
+               shadow.from     = state->from;
+               shadow.from_eye = state->from_eye;
+          }
+
+          if (flags & SMF_TO) {
+               shadow.to     = state->to;
+               shadow.to_eye = state->to_eye;
+          }
+
+          if (flags & SMF_SRC_CONVOLUTION)
+               shadow.src_convolution = state->src_convolution;
+
+          shadow.valid = (StateModificationFlags)(shadow.valid | (flags & ~SMF_INDEX_TRANSLATION));
+     }
+
+     /*
+      * Forgets values changed by other means than the state setters.
+      */
+     void invalidateState( StateModificationFlags flags )
+     {
+          shadow.valid = (StateModificationFlags)(shadow.valid & ~flags);
      }
 
      void handleDone( u32 cookie )
@@ -324,6 +530,58 @@ public:
 
           return cookie;
      }
+
+     /*
+      * Copies arguments into the shared arena for the master to read them in place,
+      * returns false if they are too small to be worth it or the space is not recycled yet.
+      */
+     bool arenaPut( const void *data1,
+                    u32         length1,
+                    const void *data2,
+                    u32         length2,
+                    u32        *ret_position )
+     {
+          CoreGraphicsStateArena *arena = client->gfx_state->arena;
+          u32                     length;
+          u32                     position;
+          u32                     offset;
+          u32                     consumed;
+
+          if (!arena || length1 + length2 < CGSC_ARENA_THRESHOLD)
+               return false;
+
+          length = CORE_GRAPHICS_STATE_ARENA_ALIGN( length1 + length2 );
+          if (length > arena->size)
+               return false;
+
+          position = arena_head;
+          offset   = CORE_GRAPHICS_STATE_ARENA_OFFSET( arena, position );
+
+          /* Arguments are contiguous, skip the tail if they don't fit before wrapping around */
+          if (offset + length > arena->size)
+               position += arena->size - offset;
+
+          consumed = D_SYNC_ADD_AND_FETCH( &arena->consumed, 0 );
+
+          if (position + length - consumed > arena->size) {
+               D_DEBUG_AT( Core_GraphicsStateClient, "  -> arena full (head %u, consumed %u, length %u)\n",
+                           arena_head, consumed, length );
+               return false;
+          }
+
+          offset = CORE_GRAPHICS_STATE_ARENA_OFFSET( arena, position );
+
+          direct_memcpy( arena->data + offset, data1, length1 );
+
+          if (length2)
+               direct_memcpy( arena->data + offset + length1, data2, length2 );
+
+          arena_head = position + length;
+
+          *ret_position = position;
+
+          return true;
+     }
 };
 
 static ReactionResult
@@ -584,8 +842,13 @@ CoreGraphicsStateClient_ReleaseSource( CoreGraphicsStateClient *client )
 
      DirectFB::IGraphicsState_Requestor *requestor = (DirectFB::IGraphicsState_Requestor*) client->requestor;
 
-     if (requestor)
+     if (requestor) {
+          CoreGraphicsStateClientPrivate *priv = (CoreGraphicsStateClientPrivate *) client->priv;
+
+          priv->invalidateState( (StateModificationFlags)(SMF_SOURCE | SMF_SOURCE_MASK | SMF_SOURCE2) );
+
           return requestor->ReleaseSource();
+     }
 
      return DFB_OK;
 }
@@ -601,8 +864,13 @@ CoreGraphicsStateClient_SetColorAndIndex( CoreGraphicsStateClient *client,
 
      DirectFB::IGraphicsState_Requestor *requestor = (DirectFB::IGraphicsState_Requestor*) client->requestor;
 
-     if (requestor)
+     if (requestor) {
+          CoreGraphicsStateClientPrivate *priv = (CoreGraphicsStateClientPrivate *) client->priv;
+
+          priv->invalidateState( SMF_COLOR );
+
           return requestor->SetColorAndIndex( color, index );
+     }
 
      return DFB_OK;
 }
@@ -620,9 +888,12 @@ CoreGraphicsStateClient_SetState( CoreGraphicsStateClient *client,
      D_MAGIC_ASSERT( state, CardState );
 
      DirectFB::IGraphicsState_Requestor *requestor = (DirectFB::IGraphicsState_Requestor*) client->requestor;
+     CoreGraphicsStateClientPrivate     *priv      = (CoreGraphicsStateClientPrivate *) client->priv;
 
      D_ASSERT( requestor != NULL );
 
+     flags = priv->filterState( state, flags );
+
      if (flags & SMF_DRAWING_FLAGS) {
           ret = requestor->SetDrawingFlags( state->drawingflags );
           if (ret)
@@ -745,6 +1016,8 @@ CoreGraphicsStateClient_SetState( CoreGraphicsStateClient *client,
                return ret;
      }
 
+     priv->shadowState( state, flags );
+
      return DFB_OK;
 }
 
@@ -945,8 +1218,13 @@ CoreGraphicsStateClient_FillRectangles( CoreGraphicsStateClient *client,
                CoreGraphicsStateClient_Update( client, DFXL_FILLRECTANGLE, client->state );
 
                DirectFB::IGraphicsState_Requestor *requestor = (DirectFB::IGraphicsState_Requestor*) client->requestor;
+               CoreGraphicsStateClientPrivate     *priv      = (CoreGraphicsStateClientPrivate *) client->priv;
+               u32                                 position;
 
-               ret = requestor->FillRectangles( rects, num );
+               if (priv->arenaPut( rects, num * sizeof(DFBRectangle), NULL, 0, &position ))
+                    ret = requestor->FillRectanglesShared( position, num );
+               else
+                    ret = requestor->FillRectangles( rects, num );
                if (ret)
                     return ret;
           }
@@ -1075,10 +1353,15 @@ CoreGraphicsStateClient_Blit( CoreGraphicsStateClient *client,
           else {
                DFBResult    ret;
                unsigned int i;
+               u32          position;
 
                CoreGraphicsStateClient_Update( client, DFXL_BLIT, client->state );
 
                DirectFB::IGraphicsState_Requestor *requestor = (DirectFB::IGraphicsState_Requestor*) client->requestor;
+               CoreGraphicsStateClientPrivate     *priv      = (CoreGraphicsStateClientPrivate *) client->priv;
+
+               if (priv->arenaPut( rects, num * sizeof(DFBRectangle), points, num * sizeof(DFBPoint), &position ))
+                    return requestor->BlitShared( position, num );
 
                for (i=0; i<num; i+=200) {
                     ret = requestor->Blit( &rects[i], &points[i], MIN(200, num-i) );
@@ -1250,8 +1533,13 @@ CoreGraphicsStateClient_TextureTriangles( CoreGraphicsStateClient *client,
                CoreGraphicsStateClient_Update( client, DFXL_TEXTRIANGLES, client->state );
 
                DirectFB::IGraphicsState_Requestor *requestor = (DirectFB::IGraphicsState_Requestor*) client->requestor;
+               CoreGraphicsStateClientPrivate     *priv      = (CoreGraphicsStateClientPrivate *) client->priv;
+               u32                                 position;
 
-               ret = requestor->TextureTriangles( vertices, num, formation );
+               if (priv->arenaPut( vertices, num * sizeof(DFBVertex), NULL, 0, &position ))
+                    ret = requestor->TextureTrianglesShared( position, num, formation );
+               else
+                    ret = requestor->TextureTriangles( vertices, num, formation );
                if (ret)
                     return ret;
           }
@@ -720,6 +720,81 @@ IGraphicsState_Real::TextureTriangles(
 }
 
 
+/**********************************************************************************************************************
+ * Arguments passed in the shared arena
+ */
+
+DFBResult
+IGraphicsState_Real::FillRectanglesShared(
+                    u32                                        position,
+                    u32                                        num
+)
+{
+    const DFBRectangle *rects;
+    DFBResult           ret;
+
+    D_DEBUG_AT( DirectFB_CoreGraphicsState, "IGraphicsState_Real::%s( position %u, num %u )\n", __FUNCTION__, position, num );
+
+    rects = (const DFBRectangle*) dfb_graphics_state_arena_get( obj, position, num, sizeof(DFBRectangle) );
+    if (!rects)
+         return DFB_INVARG;
+
+    ret = FillRectangles( rects, num );
+
+    dfb_graphics_state_arena_release( obj, position, num, sizeof(DFBRectangle) );
+
+    return ret;
+}
+
+
+DFBResult
+IGraphicsState_Real::BlitShared(
+                    u32                                        position,
+                    u32                                        num
+)
+{
+    const DFBRectangle *rects;
+    DFBResult           ret;
+
+    D_DEBUG_AT( DirectFB_CoreGraphicsState, "IGraphicsState_Real::%s( position %u, num %u )\n", __FUNCTION__, position, num );
+
+    /* Rectangles followed by points */
+    rects = (const DFBRectangle*) dfb_graphics_state_arena_get( obj, position, num, sizeof(DFBRectangle) + sizeof(DFBPoint) );
+    if (!rects)
+         return DFB_INVARG;
+
+    ret = Blit( rects, (const DFBPoint*) (rects + num), num );
+
+    dfb_graphics_state_arena_release( obj, position, num, sizeof(DFBRectangle) + sizeof(DFBPoint) );
+
+    return ret;
+}
+
+
+DFBResult
+IGraphicsState_Real::TextureTrianglesShared(
+                    u32                                        position,
+                    u32                                        num,
+                    DFBTriangleFormation                       formation
+)
+{
+    const DFBVertex *vertices;
+    DFBResult        ret;
+
+    D_DEBUG_AT( DirectFB_CoreGraphicsState, "IGraphicsState_Real::%s( position %u, num %u )\n", __FUNCTION__, position, num );
+
+    vertices = (const DFBVertex*) dfb_graphics_state_arena_get( obj, position, num, sizeof(DFBVertex) );
+    if (!vertices)
+         return DFB_INVARG;
+
+    ret = TextureTriangles( vertices, num, formation );
+
+    dfb_graphics_state_arena_release( obj, position, num, sizeof(DFBVertex) );
+
+    return ret;
+}
+
+
 /**********************************************************************************************************************
  * Flush
  */
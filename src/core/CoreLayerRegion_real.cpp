@@ -283,6 +283,9 @@ dfb_layer_region_flip_update2( CoreLayerRegion      *region,
 
                dfb_back_to_front_copy_stereo( surface, eyes, left_update, right_update, surface->rotation );
 
+               /* The back buffer keeps its content, which is now being shown. */
+               dfb_surface_presented( surface, CSBR_BACK, surface->flips );
+
                if ((flags & DSFLIP_WAITFORSYNC) == DSFLIP_WAIT) {
                     D_DEBUG_AT( DirectFB_Task_Display, "  -> Waiting for VSync...\n" );
 
@@ -56,7 +56,7 @@ ISurfaceAllocation_Real::Update(
 {
      D_DEBUG_AT( DirectFB_CoreSurfaceAllocation, "ISurfaceAllocation_Real::%s( obj %p, region %p )\n", __FUNCTION__, obj, region );
 
-     return dfb_surface_allocation_update( obj, CSAF_WRITE );
+     return dfb_surface_allocation_update_region( obj, CSAF_WRITE, region );
 }
 
 DFBResult
@@ -98,12 +98,20 @@ ISurfaceAllocation_Real::Updated( const DFBBox *updates,
                     D_DEBUG_AT( DirectFB_CoreSurfaceAllocation, "  <- read    %p\n", buffer->read );
                     D_DEBUG_AT( DirectFB_CoreSurfaceAllocation, "  <- serial  %lu (this %lu)\n", buffer->serial.value, obj->serial.value );
 
-                    direct_serial_increase( &buffer->serial );
+                    if (updates && num_updates > 0 && num_updates <= CORE_SURFACE_DAMAGE_REGIONS) {
+                         DFBRegion    regions[CORE_SURFACE_DAMAGE_REGIONS];
+                         unsigned int num = 0;
 
-                    direct_serial_copy( &obj->serial, &buffer->serial );
+                         for (u32 i=0; i<num_updates; i++) {
+                              if (DFB_BOX_WIDTH( &updates[i] ) > 0 && DFB_BOX_HEIGHT( &updates[i] ) > 0)
+                                   regions[num++] = DFB_REGION_INIT_FROM_BOX( &updates[i] );
+                         }
 
-                    buffer->written = obj;
-                    buffer->read    = NULL;
+                         if (num)
+                              dfb_surface_allocation_written( obj, regions, num );
+                    }
+                    else
+                         dfb_surface_allocation_written( obj, NULL, 0 );
 
                     D_DEBUG_AT( DirectFB_CoreSurfaceAllocation, "  -> serial  %lu\n", buffer->serial.value );
                }
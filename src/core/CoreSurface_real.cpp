@@ -305,6 +305,84 @@ private:
 
 
 
+/*
+ * Holds the lock of the source a duplicate shares buffers with during a call, see dfb_surface_cow_lock_source().
+ */
+class SourceLock {
+public:
+     SourceLock( CoreSurface *surface )
+          :
+          source( dfb_surface_cow_lock_source( surface ) )
+     {
+     }
+
+     ~SourceLock()
+     {
+          dfb_surface_cow_unlock_source( source );
+     }
+
+private:
+     CoreSurface *source;
+};
+
+/*
+ * Prelocks the source's buffer shared by a duplicate for reading instead of copying it.
+ *
+ * The returned allocation is lent to the duplicate, i.e. the source won't write to it anymore but
+ * to another allocation, see dfb_surface_buffer_find_allocation(). Returns DFB_BUSY if the source is
+ * not locked already or the allocation cannot be lent, in which case the content needs to be copied.
+ */
+static DFBResult
+PreLockSharedBuffer( CoreDFB                 *core,
+                     CoreSurfaceBuffer       *buffer,
+                     CoreSurfaceAccessorID    accessor,
+                     CoreSurfaceAccessFlags   access,
+                     CoreSurfaceAllocation  **ret_allocation )
+{
+     DFBResult              ret;
+     CoreSurfaceBuffer     *shared;
+     CoreSurface           *source;
+     CoreSurfaceAllocation *allocation;
+
+     D_MAGIC_ASSERT( buffer, CoreSurfaceBuffer );
+     D_ASSERT( !(access & CSAF_WRITE) );
+
+     shared = buffer->cow;
+     D_MAGIC_ASSERT( shared, CoreSurfaceBuffer );
+
+     source = shared->surface;
+     D_MAGIC_ASSERT( source, CoreSurface );
+
+     if (dfb_surface_trylock( source ))
+          return DFB_BUSY;
+
+     D_DEBUG_AT( DirectFB_CoreSurface, "  -> shared    %s\n", ToString_CoreSurfaceBuffer(shared) );
+
+     ISurface_Real real( core, source );
+
+     ret = real.PreLockBuffer( shared, accessor, access, &allocation );
+     if (ret == DFB_OK) {
+          /*
+           * Preallocated memory is written by the application and layer allocations may be shown,
+           * so these cannot be lent.
+           */
+          if (allocation->flags & CSALF_PREALLOCATED || allocation->type & CSTF_LAYER) {
+               dfb_surface_allocation_unref( allocation );
+
+               ret = DFB_BUSY;
+          }
+          else {
+               allocation->flags |= CSALF_COW_LENT;
+
+               *ret_allocation = allocation;
+          }
+     }
+
+     dfb_surface_unlock( source );
+
+     return ret;
+}
+
 DFBResult
 ISurface_Real::PreLockBuffer(
                          CoreSurfaceBuffer                         *buffer,
@@ -324,6 +402,8 @@ ISurface_Real::PreLockBuffer(
 
      D_ASSERT( !dfb_config->task_manager || accessor == CSAID_CPU );
 
+     SourceLock source_lock( surface );
+
      dfb_surface_lock( surface );
 
      if (surface->state & CSSF_DESTROYED) {
@@ -336,6 +416,14 @@ ISurface_Real::PreLockBuffer(
           return DFB_BUFFEREMPTY;
      }
 
+     if (buffer->cow && !(access & CSAF_WRITE)) {
+          ret = PreLockSharedBuffer( core, buffer, accessor, access, ret_allocation );
+          if (ret != DFB_BUSY) {
+               dfb_surface_unlock( surface );
+               return ret;
+          }
+     }
+
      /* Look for allocation with proper access. */
      allocation = dfb_surface_buffer_find_allocation( buffer, accessor, access, true );
      if (!allocation) {
@@ -418,6 +506,8 @@ ISurface_Real::PreLockBuffer2(
 
      D_ASSERT( !dfb_config->task_manager || accessor == CSAID_CPU );
 
+     SourceLock source_lock( surface );
+
      ret = (DFBResult) dfb_surface_lock( surface );
      if (ret)
           return ret;
@@ -437,7 +527,15 @@ ISurface_Real::PreLockBuffer2(
 
      D_DEBUG_AT( DirectFB_CoreSurface, "  -> buffer %p\n", buffer );
 
-     if (!lock && access & CSAF_READ) {
+     if (buffer->cow && !(access & CSAF_WRITE)) {
+          ret = PreLockSharedBuffer( core, buffer, accessor, access, ret_allocation );
+          if (ret != DFB_BUSY) {
+               dfb_surface_unlock( surface );
+               return ret;
+          }
+     }
+
+     if (!lock && access & CSAF_READ && !buffer->cow) {
           if (fusion_vector_is_empty( &buffer->allocs )) {
                dfb_surface_unlock( surface );
                return DFB_NOALLOCATION;
@@ -533,6 +631,8 @@ ISurface_Real::PreReadBuffer(
 
      D_MAGIC_ASSERT( buffer, CoreSurfaceBuffer );
 
+     SourceLock source_lock( surface );
+
      dfb_surface_lock( surface );
 
      if (surface->state & CSSF_DESTROYED) {
@@ -624,6 +724,8 @@ ISurface_Real::PreWriteBuffer(
 
      D_MAGIC_ASSERT( buffer, CoreSurfaceBuffer );
 
+     SourceLock source_lock( surface );
+
      dfb_surface_lock( surface );
 
      if (surface->state & CSSF_DESTROYED) {
@@ -656,8 +758,14 @@ ISurface_Real::PreWriteBuffer(
 
      CORE_SURFACE_ALLOCATION_ASSERT( allocation );
 
-     /* Synchronize with other allocations. */
-     ret = dfb_surface_allocation_update( allocation, CSAF_WRITE );
+     /* Synchronize with other allocations, only the written rectangle gets damaged. */
+     if (rect) {
+          DFBRegion region = DFB_REGION_INIT_FROM_RECTANGLE( rect );
+
+          ret = dfb_surface_allocation_update_region( allocation, CSAF_WRITE, &region );
+     }
+     else
+          ret = dfb_surface_allocation_update( allocation, CSAF_WRITE );
      if (ret) {
           /* Destroy if newly created. */
           if (allocated)
@@ -709,6 +817,21 @@ ISurface_Real::PreLockBuffer3(
                          DFBBoolean                                 lock,
                          CoreSurfaceAllocation                    **ret_allocation
                          )
+{
+     return PreLockBuffer4( role, flip_count, eye, accessor, access, lock, NULL, ret_allocation );
+}
+
+DFBResult
+ISurface_Real::PreLockBuffer4(
+                         CoreSurfaceBufferRole                      role,
+                         u32                                        flip_count,
+                         DFBSurfaceStereoEye                        eye,
+                         CoreSurfaceAccessorID                      accessor,
+                         CoreSurfaceAccessFlags                     access,
+                         DFBBoolean                                 lock,
+                         const DFBRegion                           *damage,
+                         CoreSurfaceAllocation                    **ret_allocation
+                         )
 {
      DFBResult              ret;
      CoreSurfaceBuffer     *buffer;
@@ -719,6 +842,10 @@ ISurface_Real::PreLockBuffer3(
      D_DEBUG_AT( DirectFB_CoreSurface, "ISurface_Real::%s( surface %p, role %d, count %u, eye %d, accessor 0x%02x, access 0x%02x, %slock )\n",
                  __FUNCTION__, surface, role, flip_count, eye, accessor, access, lock ? "" : "no " );
 
+     DFB_REGION_ASSERT_IF( damage );
+
+     SourceLock source_lock( surface );
+
      ret = (DFBResult) dfb_surface_lock( surface );
      if (ret)
           return ret;
@@ -733,7 +860,15 @@ ISurface_Real::PreLockBuffer3(
 
      D_DEBUG_AT( DirectFB_CoreSurface, "  -> buffer    %s\n", ToString_CoreSurfaceBuffer(buffer) );
 
-     if (!lock && access & CSAF_READ) {
+     if (buffer->cow && !(access & CSAF_WRITE)) {
+          ret = PreLockSharedBuffer( core, buffer, accessor, access, ret_allocation );
+          if (ret != DFB_BUSY) {
+               dfb_surface_unlock( surface );
+               return ret;
+          }
+     }
+
+     if (!lock && access & CSAF_READ && !buffer->cow) {
           if (fusion_vector_is_empty( &buffer->allocs )) {
                dfb_surface_unlock( surface );
                return DFB_NOALLOCATION;
@@ -760,7 +895,7 @@ ISurface_Real::PreLockBuffer3(
      D_DEBUG_AT( DirectFB_CoreSurface, "  -> allocation %s\n", ToString_CoreSurfaceAllocation(allocation) );
 
      /* Synchronize with other allocations. */
-     ret = dfb_surface_allocation_update( allocation, access );
+     ret = dfb_surface_allocation_update_region( allocation, access, damage );
      if (ret) {
           /* Destroy if newly created. */
           if (allocated)
@@ -883,6 +1018,8 @@ ISurface_Real::Flip2(
                       dfb_gfx_copy_regions_client( obj, CSBR_BACK, DSSE_RIGHT,
                                                    obj, CSBR_FRONT, DSSE_RIGHT,
                                                    &r, 1, 0, 0, NULL );
+
+                  dfb_surface_presented( obj, CSBR_BACK, obj->flips );
               }
          }
          else {
@@ -900,6 +1037,8 @@ ISurface_Real::Flip2(
                   dfb_gfx_copy_regions_client( obj, CSBR_BACK, DSSE_LEFT,
                                                obj, CSBR_FRONT, DSSE_LEFT,
                                                &l, 1, 0, 0, NULL );
+
+                  dfb_surface_presented( obj, CSBR_BACK, obj->flips );
              }
          }
      }
@@ -1070,9 +1209,12 @@ ISurface_Real::DispatchUpdate(
      else
           r = l;
 
-     if (!(flags & DSFLIP_UPDATE))
+     if (!(flags & DSFLIP_UPDATE)) {
           obj->flips = flip_count;
 
+          dfb_surface_presented( obj, CSBR_FRONT, flip_count );
+     }
+
      // FIXME: this always updates full when a side is empty
      dfb_surface_dispatch_update( obj, &l, &r, timestamp, flags );
 
@@ -1292,6 +1434,60 @@ ISurface_Real::DispatchUpdate2(
      return ret;
 }
 
+DFBResult
+ISurface_Real::GetBufferAge(
+                   CoreSurfaceBufferRole                      role,
+                   DFBSurfaceStereoEye                        eye,
+                   u32                                        flip_count,
+                   u32                                       *ret_age
+                   )
+{
+     D_DEBUG_AT( DirectFB_CoreSurface, "ISurface_Real::%s( role %d, eye %d, flip_count %u )\n",
+                 __FUNCTION__, role, eye, flip_count );
+
+     D_ASSERT( ret_age != NULL );
+
+     if (role != CSBR_FRONT && role != CSBR_BACK && role != CSBR_IDLE)
+          return DFB_INVARG;
+
+     if (eye != DSSE_LEFT && eye != DSSE_RIGHT)
+          return DFB_INVARG;
+
+     dfb_surface_lock( obj );
+
+     *ret_age = dfb_surface_buffer_age( obj, role, eye, flip_count );
+
+     dfb_surface_unlock( obj );
+
+     D_DEBUG_AT( DirectFB_CoreSurface, "  -> age %u\n", *ret_age );
+
+     return DFB_OK;
+}
+
+DFBResult
+ISurface_Real::Duplicate(
+                    CoreSurface                              **ret_surface
+                    )
+{
+     DFBResult ret;
+
+     D_DEBUG_AT( DirectFB_CoreSurface, "ISurface_Real::%s( %p )\n", __FUNCTION__, obj );
+
+     D_ASSERT( ret_surface != NULL );
+
+     ret = Core_Resource_CheckSurface( &obj->config, CSTF_NONE, 0, obj->palette );
+     if (ret)
+          return ret;
+
+     ret = dfb_surface_duplicate( core, obj, ret_surface );
+     if (ret)
+          return ret;
+
+     Core_Resource_AddSurface( *ret_surface );
+
+     return DFB_OK;
+}
+
 
 }
 
@@ -2295,14 +2295,21 @@ Renderer::update( DFBAccelerationMask accel )
      if (state_mod & SMF_DESTINATION) {
           D_ASSERT( state->destination != NULL );
 
+          /* nothing outside the clip gets written */
           ret = engine->updateLock( setup, &state->dst, state->destination, state->to, state->to_eye,
                                     state->destination_flip_count_used ? state->destination_flip_count : state->destination->flips,
-                                    (CoreSurfaceAccessFlags)( CSAF_WRITE | CSAF_READ ) );
+                                    (CoreSurfaceAccessFlags)( CSAF_WRITE | CSAF_READ ), &state->clip );
           if (ret)
                return ret;
 
           state_mod = (StateModificationFlags)(state_mod & ~SMF_DESTINATION);
      }
+     else if (state_mod & SMF_CLIP) {
+          /* extend the damage of the destination if the clip grows */
+          ret = engine->damageLock( setup, &state->dst, &state->clip );
+          if (ret)
+               return ret;
+     }
 
      if (DFB_BLITTING_FUNCTION( accel )) {
           D_ASSERT( state->source != NULL );
@@ -3008,6 +3015,8 @@ Renderer::flushTask( u32                               cookie,
      operations = 0;
 
      setup->allocations.clear();
+
+     setup->damaged = NULL;
 }
 
 /*********************************************************************************************************************/
@@ -3053,7 +3062,8 @@ Engine::updateLock( Renderer::Setup        *setup,
                     CoreSurfaceBufferRole   role,
                     DFBSurfaceStereoEye     eye,
                     u32                     flips,
-                    CoreSurfaceAccessFlags  flags )
+                    CoreSurfaceAccessFlags  flags,
+                    const DFBRegion        *damage )
 {
      DFBResult                       ret;
      CoreSurfaceAllocation          *allocation;
@@ -3080,13 +3090,18 @@ Engine::updateLock( Renderer::Setup        *setup,
 
      }
      else {
-          ret = getAllocation( surface, key, flags, allocation );
+          ret = getAllocation( surface, key, flags, allocation, damage );
           if (ret)
                return ret;
 
           setup->tasks[0]->AddAccess( allocation, flags );
 
           setup->allocations.insert( SurfaceAllocationMapPair( key, allocation ) );
+
+          if (damage && (flags & CSAF_WRITE)) {
+               setup->damaged = allocation;
+               setup->damage  = *damage;
+          }
      }
 
 
@@ -3094,12 +3109,70 @@ Engine::updateLock( Renderer::Setup        *setup,
      if (ret)
           return ret;
 
+     /* Allocation may have been written with a different clip before. */
+     if (damage && (flags & CSAF_WRITE)) {
+          ret = damageLock( setup, lock, damage );
+          if (ret)
+               return ret;
+     }
+
 
      D_DEBUG_AT( DirectFB_Renderer, "  => lock %s\n", *ToString<CoreSurfaceBufferLock>(*lock) );
 
      return DFB_OK;
 }
 
+DFBResult
+Engine::damageLock( Renderer::Setup        *setup,
+                    CoreSurfaceBufferLock  *lock,
+                    const DFBRegion        *damage )
+{
+     DFBResult              ret;
+     CoreSurfaceAllocation *allocation;
+     CoreSurface           *surface;
+
+     D_DEBUG_AT( DirectFB_Renderer, "Engine::%s( %p, setup %p, lock %p, damage %d,%d-%dx%d )\n", __FUNCTION__, this,
+                 setup, lock, DFB_RECTANGLE_VALS_FROM_REGION( damage ) );
+
+     D_ASSERT( lock != NULL );
+     DFB_REGION_ASSERT( damage );
+
+     if (!lock->buffer || !(lock->access & CSAF_WRITE))
+          return DFB_OK;
+
+     allocation = lock->allocation;
+     D_ASSERT( allocation != NULL );
+
+     /*
+      * Mark the union of all regions written via this setup, skipping
+      * the (usual) case of the region being covered already.
+      */
+     if (setup->damaged == allocation) {
+          if (dfb_region_region_contains( &setup->damage, damage ))
+               return DFB_OK;
+
+          dfb_region_region_union( &setup->damage, damage );
+     }
+     else {
+          setup->damaged = allocation;
+          setup->damage  = *damage;
+     }
+
+     D_DEBUG_AT( DirectFB_Renderer, "  -> marking %d,%d-%dx%d\n", DFB_RECTANGLE_VALS_FROM_REGION( &setup->damage ) );
+
+     surface = allocation->surface;
+
+     ret = (DFBResult) dfb_surface_lock( surface );
+     if (ret)
+          return ret;
+
+     dfb_surface_allocation_written( allocation, &setup->damage, 1 );
+
+     dfb_surface_unlock( surface );
+
+     return DFB_OK;
+}
+
 DFBResult
 Engine::enterLock( CoreSurfaceBufferLock  *lock,
                    CoreSurfaceAllocation  *allocation,
@@ -3153,10 +3226,12 @@ DFBResult
 Engine::getAllocation( CoreSurface             *surface,
                        SurfaceAllocationKey    &key,
                        CoreSurfaceAccessFlags   flags,
-                       CoreSurfaceAllocation  *&allocation )
+                       CoreSurfaceAllocation  *&allocation,
+                       const DFBRegion         *damage )
 {
      DFBResult          ret;
      CoreSurfaceBuffer *buffer;
+     CoreSurface       *source;
 
      D_DEBUG_AT( DirectFB_Renderer, "Engine::%s( %p, surface %p, role %d, eye %d, flips %u, flags %s )\n", __FUNCTION__, this,
                  surface, key.role, key.eye, key.flips, *ToString<CoreSurfaceAccessFlags>(flags) );
@@ -3164,15 +3239,21 @@ Engine::getAllocation( CoreSurface             *surface,
      D_ASSERT( surface != NULL );
      D_DEBUG_AT( DirectFB_Renderer, "  -> surface %s\n", *ToString<CoreSurface>(*surface) );
 
+     /* Content shared with the source of a duplicate is copied with the source locked. */
+     source = dfb_surface_cow_lock_source( surface );
+
      ret = (DFBResult) dfb_surface_lock( surface );
-     if (ret)
+     if (ret) {
+          dfb_surface_cow_unlock_source( source );
           return ret;
+     }
 
      // FIXME: move to helper class, e.g. to SurfaceTask
      //
 
      if (surface->num_buffers == 0) {
           dfb_surface_unlock( surface );
+          dfb_surface_cow_unlock_source( source );
           return DFB_BUFFEREMPTY;
      }
 
@@ -3191,17 +3272,19 @@ Engine::getAllocation( CoreSurface             *surface,
                D_DERROR( ret, "DirectFB/Renderer: Buffer allocation failed (%s)!\n", ToString<CoreSurfaceBuffer>(*buffer).buffer() );
                Core_PopIdentity();
                dfb_surface_unlock( surface );
+               dfb_surface_cow_unlock_source( source );
                return ret;
           }
      }
 
-     ret = dfb_surface_allocation_update( allocation, flags );
+     ret = dfb_surface_allocation_update_region( allocation, flags, damage );
      if (ret)
           D_DERROR( ret, "DirectFB/Renderer: Allocation update failed!\n" );
 
      Core_PopIdentity();
 
      dfb_surface_unlock( surface );
+     dfb_surface_cow_unlock_source( source );
 
      return DFB_OK;
 }
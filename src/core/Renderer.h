@@ -170,10 +170,14 @@ public:
 
           SurfaceAllocationMap     allocations;
 
+          CoreSurfaceAllocation   *damaged;  /* destination allocation marked as written within 'damage' */
+          DFBRegion                damage;
+
           Setup( int width, int height, unsigned int tiles = 1 )
                :
                tiles( tiles ),
-               tiles_render( tiles )
+               tiles_render( tiles ),
+               damaged( NULL )
           {
                D_ASSERT( tiles > 0 );
 
@@ -426,7 +430,12 @@ public:
                                          CoreSurfaceBufferRole   role,
                                          DFBSurfaceStereoEye     eye,
                                          u32                     flips,
-                                         CoreSurfaceAccessFlags  flags );
+                                         CoreSurfaceAccessFlags  flags,
+                                         const DFBRegion        *damage = NULL );
+
+     virtual DFBResult damageLock      ( Renderer::Setup        *setup,
+                                         CoreSurfaceBufferLock  *lock,
+                                         const DFBRegion        *damage );
 
      virtual DFBResult enterLock       ( CoreSurfaceBufferLock  *lock,
                                          CoreSurfaceAllocation  *allocation,
@@ -436,7 +445,8 @@ public:
      virtual DFBResult getAllocation   ( CoreSurface             *surface,
                                          SurfaceAllocationKey    &key,
                                          CoreSurfaceAccessFlags   flags,
-                                         CoreSurfaceAllocation  *&allocation );
+                                         CoreSurfaceAllocation  *&allocation,
+                                         const DFBRegion         *damage = NULL );
 
 
      virtual DFBResult DrawRectangles  ( SurfaceTask            *task,
@@ -74,45 +74,39 @@ extern "C" {
 
 /*********************************************************************************************************************/
 
-TaskThreadsQ::Runner::Runner( TaskThreadsQ         *threads,
-                              unsigned int          index,
-                              DirectThreadType      type,
-                              const Direct::String &name )
+TaskThreadsQ::TaskThreadsQ( const std::string &name, size_t num, DirectThreadType type )
      :
-     threads( threads ),
-     index( index )
+     submitted( 0 )
 {
-     thread = direct_thread_create( type, taskLoop, this, name.buffer() );
-}
+     D_DEBUG_AT( DirectFB_TaskThreadsQ, "TaskThreadsQ::%s( '%s', num %zu, type %d )\n", __FUNCTION__, name.c_str(), num, type );
 
-TaskThreadsQ::Runner::~Runner()
-{
-     direct_thread_join( thread );
-     direct_thread_destroy( thread );
-}
+     executor = new Direct::Executor();
 
-/*********************************************************************************************************************/
+     if (type != DTT_DEFAULT || !executor->handle() || executor->Workers() < num) {
+          delete executor;
 
-TaskThreadsQ::TaskThreadsQ( const std::string &name, size_t num, DirectThreadType type )
-{
-     D_DEBUG_AT( DirectFB_TaskThreadsQ, "TaskThreadsQ::%s( '%s', num %zu, type %d )\n", __FUNCTION__, name.c_str(), num, type );
+          executor = new Direct::Executor( name.c_str(), num, type );
 
-     for (size_t i=0; i<num; i++) {
-          runners.push_back( new Runner( this, i, type, (num > 1) ?
-                                                            Direct::String::F( "%s/%zu", name.c_str(), i ) :
-                                                            Direct::String::F( "%s", name.c_str() ) ) );
+          if (!executor->handle())
+               D_ERROR( "TaskThreadsQ: Could not create executor, running tasks synchronously!\n" );
      }
 
-     D_ASSUME( runners.size() == num );
+     D_DEBUG_AT( DirectFB_TaskThreadsQ, "  -> using %u workers\n", executor->Workers() );
 }
 
 TaskThreadsQ::~TaskThreadsQ()
 {
-     for (size_t i=0; i<runners.size(); i++)
-          fifo.push( NULL );
+     D_ASSUME( executor->WorkerIndex() < 0 );
+
+     /* The shared executor outlives us, wait for the tasks still referring to us. */
+     Direct::LockWQ::Lock l1( lwq );
 
-     for (std::vector<Runner*>::const_iterator it = runners.begin(); it != runners.end(); it++)
-          delete *it;
+     while (submitted)
+          l1.wait();
+
+     l1.unlock();
+
+     delete executor;
 }
 
 
@@ -128,7 +122,14 @@ void TaskThreadsQ::Push( Task *task )
 
      D_ASSERT( task->qid != 0 );
 
-     D_PERF_COUNT_N( perfs[task->qid].counter, +1 );
+#if D_DEBUG_ENABLED
+     /* Not using perf counters, queue IDs are unbounded and would fill up the global table. */
+     {
+          Direct::LockWQ::Lock l1( lwq );
+
+          D_DEBUG_AT( DirectFB_TaskThreadsQ, "  -> %d tasks pending in queue\n", ++pending[task->qid] );
+     }
+#endif
 
 
      Task *last = queues[task->qid];
@@ -144,7 +145,7 @@ void TaskThreadsQ::Push( Task *task )
      else {
           D_DEBUG_AT( DirectFB_TaskThreadsQ, "  -> pushing task %p\n", task );
 
-          fifo.push( task );
+          submit( task );
      }
 }
 
@@ -173,7 +174,7 @@ void TaskThreadsQ::Finalise( Task *task )
 
                D_DEBUG_AT( DirectFB_TaskThreadsQ, "  -> pushing task %p to resume operation\n", task->next );
 
-               fifo.push( task->next );
+               submit( task->next );
           }
           else {
                D_ASSERT( queues[task->qid] == task );
@@ -185,74 +186,88 @@ void TaskThreadsQ::Finalise( Task *task )
      D_ASSERT( queues[task->qid] != task );
 }
 
-void *
-TaskThreadsQ::taskLoop( DirectThread *thread,
-                        void         *arg )
+void
+TaskThreadsQ::submit( Task *task )
 {
-     DFBResult     ret;
-     Runner       *runner = (Runner *)arg;
-     TaskThreadsQ *thiz   = runner->threads;
-     Task         *task, *next;
-
-     D_DEBUG_AT( DirectFB_TaskThreadsQ, "TaskThreadsQ::%s()\n", __FUNCTION__ );
-
-     while (true) {
-          task = thiz->fifo.pull();
-          if (!task) {
-               D_DEBUG_AT( DirectFB_TaskThreadsQ, "TaskThreadsQ::%s()  -> got NULL task (exit signal)\n", __FUNCTION__ );
-               return NULL;
-          }
+     DirectResult ret;
 
-          D_DEBUG_AT( DirectFB_TaskThreadsQ, "TaskThreadsQ::%s()  -> got task [%s]\n", __FUNCTION__, *task->Description() );
+     if (!executor->handle()) {
+          run( task );
+          return;
+     }
 
-          task->hwid = runner->index;
+     {
+          Direct::LockWQ::Lock l1( lwq );
 
-          //bool foo=false;
-next:
-          D_MAGIC_ASSERT( task, Task );
+          submitted++;
+     }
 
-          next = task->next;
+     ret = executor->Submit( [this, task] () { run( task ); release(); } );
+     if (ret) {
+          D_DERROR( ret, "TaskThreadsQ: Could not submit task! [%s]\n", *task->Description() );
 
-          if (!next) {
-               D_DEBUG_AT( DirectFB_TaskThreadsQ, "TaskThreadsQ::%s()  -> NO NEXT\n", __FUNCTION__ );
-               //if (foo) {
-                    D_FLAGS_SET( task->flags, TASK_FLAG_LAST_IN_QUEUE );
-               //}
-               //else {
-               //     foo = true;
-               //     direct_thread_sleep( 1000 );
-               //     goto next;
-               //}
-          }
-          else
-               D_DEBUG_AT( DirectFB_TaskThreadsQ, "TaskThreadsQ::%s()  -> next will be [%s]\n", __FUNCTION__, *next->Description() );
+          release();
 
-          D_MAGIC_ASSERT_IF( next, Task );
+          task->Done( (DFBResult) ret );
+     }
+}
 
-          D_PERF_COUNT_N( thiz->perfs[task->qid].counter, -1 );  // not fully thread safe
+void
+TaskThreadsQ::release()
+{
+     Direct::LockWQ::Lock l1( lwq );
 
-          ret = task->Run();
-          if (ret) {
-               D_DERROR( ret, "TaskThreadsQ: Task::Run() failed! [%s]\n", *task->Description() );
-               task->Done( ret );
-          }
+     if (!--submitted)
+          lwq.notifyAll();
+}
+
+void
+TaskThreadsQ::run( Task *task )
+{
+     DFBResult  ret;
+     Task      *next;
+     int        index = executor->WorkerIndex();
 
-          if (next) {
-               if (0) {
-                    D_DEBUG_AT( DirectFB_TaskThreadsQ, "TaskThreadsQ::%s()  -> running next (%p)...\n", __FUNCTION__, next );
-                    task = next;
-                    goto next;
-               }
+     D_MAGIC_ASSERT( task, Task );
 
-               D_DEBUG_AT( DirectFB_TaskThreadsQ, "TaskThreadsQ::%s()  -> pushing next [%s]...\n", __FUNCTION__, *next->Description() );
+     D_DEBUG_AT( DirectFB_TaskThreadsQ, "TaskThreadsQ::%s( task [%s] )\n", __FUNCTION__, *task->Description() );
 
-               D_MAGIC_ASSERT( next, Task );
+     task->hwid = index < 0 ? 0 : index;
 
-               thiz->fifo.push( next );
-          }
+     next = task->next;
+
+     if (!next) {
+          D_DEBUG_AT( DirectFB_TaskThreadsQ, "TaskThreadsQ::%s()  -> NO NEXT\n", __FUNCTION__ );
+
+          D_FLAGS_SET( task->flags, TASK_FLAG_LAST_IN_QUEUE );
      }
+     else
+          D_DEBUG_AT( DirectFB_TaskThreadsQ, "TaskThreadsQ::%s()  -> next will be [%s]\n", __FUNCTION__, *next->Description() );
 
-     return NULL;
+     D_MAGIC_ASSERT_IF( next, Task );
+
+#if D_DEBUG_ENABLED
+     {
+          Direct::LockWQ::Lock l1( lwq );
+
+          if (!--pending[task->qid])
+               pending.erase( task->qid );
+     }
+#endif
+
+     ret = task->Run();
+     if (ret) {
+          D_DERROR( ret, "TaskThreadsQ: Task::Run() failed! [%s]\n", *task->Description() );
+          task->Done( ret );
+     }
+
+     if (next) {
+          D_DEBUG_AT( DirectFB_TaskThreadsQ, "TaskThreadsQ::%s()  -> pushing next [%s]...\n", __FUNCTION__, *next->Description() );
+
+          D_MAGIC_ASSERT( next, Task );
+
+          submit( next );
+     }
 }
 
 
@@ -56,6 +56,8 @@ extern "C" {
 }
 
 
+#include <direct/Executor.h>
+#include <direct/LockWQ.h>
 #include <direct/Magic.h>
 #include <direct/Mutex.h>
 #include <direct/Performer.h>
@@ -79,27 +81,21 @@ class TaskManager;
 class TaskThreads;
 
 
+/*
+ * Runs the tasks of each queue in order, different queues in parallel.
+ *
+ * Uses the executor shared by all subsystems unless it has less than 'num' workers or another thread type is needed.
+ * Runs the tasks in the caller if no executor could be created.
+ */
 class TaskThreadsQ : public Direct::Magic<TaskThreadsQ> {
-private:
-     class Runner : public Direct::Magic<Runner> {
-     public:
-          TaskThreadsQ *threads;
-          unsigned int  index;
-          DirectThread *thread;
-
-          Runner( TaskThreadsQ         *threads,
-                  unsigned int          index,
-                  DirectThreadType      type,
-                  const Direct::String &name );
-
-          ~Runner();
-     };
-
 public:
-     DirectFB::FIFO<Task*>              fifo;   // TODO: try to find better structure without lock, maybe futex
-     std::vector<Runner*>               runners;
+     Direct::Executor                  *executor;
      std::map<u64,Task*>                queues;
-     std::map<u64,Direct::PerfCounter>  perfs;
+     std::map<u64,int>                  pending;     /* tasks per queue not run yet, debug builds only, protected by 'lwq' */
+
+private:
+     Direct::LockWQ                     lwq;
+     unsigned int                       submitted;   /* tasks on the executor referring to us */
 
 public:
      TaskThreadsQ( const std::string &name, size_t num, DirectThreadType type = DTT_DEFAULT );
@@ -111,9 +107,11 @@ public:
      void Finalise( Task *task );
 
 private:
-     static void *
-     taskLoop( DirectThread *thread,
-               void         *arg );
+     void submit( Task *task );
+
+     void run( Task *task );
+
+     void release();
 };
 
 
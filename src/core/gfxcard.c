@@ -848,11 +848,11 @@ dfb_gfxcard_state_acquire( CardState *state, DFBAccelerationMask accel )
       */
      Core_PushIdentity( 0 );
 
-     /* lock destination */
-     ret = dfb_surface_lock_buffer2( dst, state->to,
+     /* lock destination, nothing outside the clip gets written */
+     ret = dfb_surface_lock_buffer3( dst, state->to,
                                      state->destination_flip_count_used ? state->destination_flip_count : state->destination->flips,
                                      state->to_eye,
-                                     CSAID_GPU, access, &state->dst );
+                                     CSAID_GPU, access, &state->clip, &state->dst );
      if (ret) {
           D_DEBUG_AT( Core_Graphics, "Could not lock destination for GPU access!\n" );
           Core_PopIdentity();
@@ -1014,6 +1014,69 @@ dfb_gfxcard_state_acquire( CardState *state, DFBAccelerationMask accel )
      return true;
 }
 
+/*
+ * The source of a duplicate sharing buffers must be locked before it, which locking in address order does
+ * not guarantee. Written duplicates get their own copy beforehand, read ones stay shared and are tried to be
+ * locked afterwards along with their source, see multi_lock_shared().
+ */
+static __inline__ void
+multi_lock_surface( CoreSurface     *surface,
+                    bool             write,
+                    FusionSkirmish **locks,
+                    unsigned int    *num_locks,
+                    CoreSurface    **clones,
+                    unsigned int    *num_clones )
+{
+     if (surface && surface->cow_source) {
+          if (!write) {
+               clones[(*num_clones)++] = surface;
+               return;
+          }
+
+          dfb_surface_cow_detach( surface );
+     }
+
+     locks[(*num_locks)++] = &surface->lock;
+}
+
+/*
+ * Tries to lock the duplicates read from and their sources in addition to the locks already held,
+ * returning false with all locks released if one is not available.
+ */
+static bool
+multi_lock_shared( FusionSkirmish **locks,
+                   unsigned int    *num_locks,
+                   CoreSurface    **clones,
+                   unsigned int     num_clones )
+{
+     unsigned int i;
+
+     for (i = 0; i < num_clones; i++) {
+          CoreSurface *source;
+
+          if (fusion_skirmish_swoop( &clones[i]->lock ))
+               break;
+
+          locks[(*num_locks)++] = &clones[i]->lock;
+
+          /* The link can only be removed with the duplicate locked. */
+          source = clones[i]->cow_source;
+          if (source) {
+               if (fusion_skirmish_swoop( &source->lock ))
+                    break;
+
+               locks[(*num_locks)++] = &source->lock;
+          }
+     }
+
+     if (i < num_clones) {
+          fusion_skirmish_dismiss_multi( locks, *num_locks );
+          return false;
+     }
+
+     return true;
+}
+
 static bool
 dfb_gfxcard_state_check_acquire( CardState *state, DFBAccelerationMask accel )
 {
@@ -1026,8 +1089,10 @@ dfb_gfxcard_state_check_acquire( CardState *state, DFBAccelerationMask accel )
      CoreSurfaceAccessFlags  access = CSAF_WRITE;
      int                     cx2;
      int                     cy2;
-     FusionSkirmish         *locks[4];
+     FusionSkirmish         *locks[7];
      unsigned int            num_locks = 0;
+     CoreSurface            *clones[3];
+     unsigned int            num_clones = 0;
 
      D_ASSERT( card != NULL );
      D_ASSERT( card->shared != NULL );
@@ -1047,7 +1112,7 @@ dfb_gfxcard_state_check_acquire( CardState *state, DFBAccelerationMask accel )
      src    = state->source;
      shared = card->shared;
 
-     locks[num_locks++] = &dst->lock;
+     multi_lock_surface( dst, true, locks, &num_locks, clones, &num_clones );
 
      /* find locking flags */
      if (DFB_BLITTING_FUNCTION( accel )) {
@@ -1063,15 +1128,15 @@ dfb_gfxcard_state_check_acquire( CardState *state, DFBAccelerationMask accel )
           D_DEBUG_AT( Core_GfxState, "%s( %p, 0x%08x )  blitting %p -> %p\n", __FUNCTION__,
                       state, accel, state->source, state->destination );
 
-          locks[num_locks++] = &src->lock;
+          multi_lock_surface( src, false, locks, &num_locks, clones, &num_clones );
 
           /* if using a mask... */
           if (state->blittingflags & (DSBLIT_SRC_MASK_ALPHA | DSBLIT_SRC_MASK_COLOR))
-               locks[num_locks++] = &state->source_mask->lock;
+               multi_lock_surface( state->source_mask, false, locks, &num_locks, clones, &num_clones );
 
           /* if using source2... */
           if (accel == DFXL_BLIT2)
-               locks[num_locks++] = &state->source2->lock;
+               multi_lock_surface( state->source2, false, locks, &num_locks, clones, &num_clones );
      }
      else {
           D_DEBUG_AT( Core_GfxState, "%s( %p, 0x%08x )  drawing -> %p\n", __FUNCTION__,
@@ -1164,6 +1229,10 @@ dfb_gfxcard_state_check_acquire( CardState *state, DFBAccelerationMask accel )
      if (fusion_skirmish_prevail_multi( locks, num_locks ))
           return false;
 
+     /* Let the software fallback lock them one after another otherwise. */
+     if (num_clones && !multi_lock_shared( locks, &num_locks, clones, num_clones ))
+          return false;
+
      dfb_state_update_destination( state );
 
      /* If destination or blend functions have been changed... */
@@ -37,7 +37,10 @@
 #include <directfb.h>
 
 #include <direct/String.h>
+#include <direct/atomic.h>
+#include <direct/util.h>
 
+#include <fusion/conf.h>
 #include <fusion/shmalloc.h>
 
 #include <core/coredefs.h>
@@ -58,6 +61,47 @@ D_DEBUG_DOMAIN( Core_GraphicsState, "Core/GraphicsState", "DirectFB Graphics Sta
 
 extern void CoreGraphicsState_Destruct( CoreGraphicsState *state );
 
+static void
+state_arena_create( CoreDFB           *core,
+                    CoreGraphicsState *state )
+{
+     CoreGraphicsStateArena *arena;
+     FusionSHMPoolShared    *pool = dfb_core_shmpool_data( core );
+     u32                     size = 1 << direct_log2( dfb_config->graphics_state_arena * 1024 );
+
+     D_DEBUG_AT( Core_GraphicsState, "%s( %p, size %u )\n", __FUNCTION__, state, size );
+
+     arena = SHCALLOC( pool, 1, sizeof(CoreGraphicsStateArena) + size );
+     if (!arena) {
+          D_OOSHM();
+          return;
+     }
+
+     arena->shmpool = pool;
+     arena->size    = size;
+     arena->data    = (u8*) (arena + 1);
+
+     D_MAGIC_SET( arena, CoreGraphicsStateArena );
+
+     state->arena = arena;
+}
+
+static void
+state_arena_destroy( CoreGraphicsState *state )
+{
+     CoreGraphicsStateArena *arena = state->arena;
+
+     D_MAGIC_ASSERT( arena, CoreGraphicsStateArena );
+
+     D_DEBUG_AT( Core_GraphicsState, "%s( %p, consumed %u )\n", __FUNCTION__, state, arena->consumed );
+
+     D_MAGIC_CLEAR( arena );
+
+     SHFREE( arena->shmpool, arena );
+
+     state->arena = NULL;
+}
+
 static void
 state_destructor( FusionObject *object, bool zombie, void *ctx )
 {
@@ -78,6 +122,9 @@ state_destructor( FusionObject *object, bool zombie, void *ctx )
 
      CoreGraphicsState_Deinit_Dispatch( &state->call );
 
+     if (state->arena)
+          state_arena_destroy( state );
+
      D_MAGIC_CLEAR( state );
 
      fusion_object_destroy( object );
@@ -131,6 +178,10 @@ dfb_graphics_state_create( CoreDFB            *core,
 
      CoreGraphicsState_Init_Dispatch( core, state, &state->call );
 
+     /* Clients in a secure world cannot write to the pool, nor would the master trust data it reads in place */
+     if (dfb_config->graphics_state_arena && !fusion_config->secure_fusion)
+          state_arena_create( core, state );
+
      if (dfb_config->graphics_state_call_limit)
           fusion_call_set_quota( &state->call, state->object.identity, dfb_config->graphics_state_call_limit );
 
@@ -163,4 +214,57 @@ dfb_graphics_state_dispatch_done( CoreGraphicsState *state,
      dfb_graphics_state_dispatch( state, &notification, NULL );
 }
 
+const void *
+dfb_graphics_state_arena_get( CoreGraphicsState *state,
+                              u32                position,
+                              u32                num,
+                              u32                size )
+{
+     CoreGraphicsStateArena *arena;
+     u32                     offset;
+
+     D_DEBUG_AT( Core_GraphicsState, "%s( %p, position %u, num %u, size %u )\n", __FUNCTION__, state, position, num, size );
+
+     D_MAGIC_ASSERT( state, CoreGraphicsState );
+     D_ASSERT( size > 0 );
+
+     arena = state->arena;
+     if (!arena) {
+          D_BUG( "no arena" );
+          return NULL;
+     }
+
+     D_MAGIC_ASSERT( arena, CoreGraphicsStateArena );
+
+     offset = CORE_GRAPHICS_STATE_ARENA_OFFSET( arena, position );
+
+     if (num > (arena->size - offset) / size) {
+          D_BUG( "position %u with %u * %u bytes exceeds arena of %u bytes", position, num, size, arena->size );
+          return NULL;
+     }
+
+     return arena->data + offset;
+}
 
+void
+dfb_graphics_state_arena_release( CoreGraphicsState *state,
+                                  u32                position,
+                                  u32                num,
+                                  u32                size )
+{
+     CoreGraphicsStateArena *arena;
+     u32                     end;
+
+     D_MAGIC_ASSERT( state, CoreGraphicsState );
+
+     arena = state->arena;
+
+     D_MAGIC_ASSERT( arena, CoreGraphicsStateArena );
+
+     end = position + CORE_GRAPHICS_STATE_ARENA_ALIGN( num * size );
+
+     D_DEBUG_AT( Core_GraphicsState, "%s( %p, consumed %u -> %u )\n", __FUNCTION__, state, arena->consumed, end );
+
+     /* Atomic update orders our reads of the arguments before the client reusing the space */
+     D_SYNC_ADD_AND_FETCH( &arena->consumed, end - arena->consumed );
+}
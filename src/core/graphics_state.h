@@ -40,6 +40,29 @@
 #include <core/state.h>
 
 
+/*
+ * Shared argument arena, filled by the client and read in place by the master.
+ *
+ * Positions are running byte counts, the client writes behind 'consumed' which
+ * the master advances after processing each call referencing the arena.
+ *
+ * The size is a power of two, so offsets stay continuous when positions wrap around.
+ */
+typedef struct {
+     int                      magic;
+
+     FusionSHMPoolShared     *shmpool;
+
+     u32                      size;
+     u32                      consumed;
+
+     u8                      *data;
+} CoreGraphicsStateArena;
+
+#define CORE_GRAPHICS_STATE_ARENA_ALIGN(length)   (((length) + 7) & ~7)
+
+#define CORE_GRAPHICS_STATE_ARENA_OFFSET(arena,position)   ((position) & ((arena)->size - 1))
+
 struct __DFB_CoreGraphicsState {
      FusionObject             object;
      int                      magic;
@@ -49,6 +72,8 @@ struct __DFB_CoreGraphicsState {
      CardState                state;
 
      DFB_Renderer            *renderer;
+
+     CoreGraphicsStateArena  *arena;
 };
 
 typedef enum {
@@ -79,6 +104,22 @@ FusionObjectPool *dfb_graphics_state_pool_create( const FusionWorld *world );
 void dfb_graphics_state_dispatch_done( CoreGraphicsState *state,
                                        u32                cookie );
 
+/*
+ * Returns 'num' elements of 'size' bytes stored at 'position' in the arena, NULL if out of bounds
+ */
+const void *dfb_graphics_state_arena_get    ( CoreGraphicsState *state,
+                                              u32                position,
+                                              u32                num,
+                                              u32                size );
+
+/*
+ * Recycles the arena space of the elements at 'position' after they have been processed
+ */
+void        dfb_graphics_state_arena_release( CoreGraphicsState *state,
+                                              u32                position,
+                                              u32                num,
+                                              u32                size );
+
 /*
  * Generates dfb_graphics_state_ref(), dfb_graphics_state_attach() etc.
  */
@@ -667,6 +667,9 @@ dfb_layer_region_flip_update( CoreLayerRegion     *region,
                /* ...or copy updated contents from back to front buffer. */
                dfb_back_to_front_copy_rotation( surface, update, surface->rotation );
 
+               /* The back buffer keeps its content, which is now being shown. */
+               dfb_surface_presented( surface, CSBR_BACK, surface->flips );
+
                if ((flags & DSFLIP_WAITFORSYNC) == DSFLIP_WAIT) {
                     D_DEBUG_AT( Core_Layers, "  -> Waiting for VSync...\n" );
 
@@ -900,6 +903,9 @@ dfb_layer_region_flip_update_stereo( CoreLayerRegion     *region,
 
                dfb_back_to_front_copy_stereo( surface, eyes, left_update, right_update, surface->rotation );
 
+               /* The back buffer keeps its content, which is now being shown. */
+               dfb_surface_presented( surface, CSBR_BACK, surface->flips );
+
                if ((flags & DSFLIP_WAITFORSYNC) == DSFLIP_WAIT) {
                     D_DEBUG_AT( Core_Layers, "  -> Waiting for VSync...\n" );
 
@@ -88,7 +88,7 @@ localInitPool( CoreDFB                    *core,
      D_MAGIC_ASSERT( pool, CoreSurfacePool );
      D_ASSERT( ret_desc != NULL );
 
-     ret_desc->caps              = CSPCAPS_VIRTUAL;
+     ret_desc->caps              = CSPCAPS_VIRTUAL | CSPCAPS_CAPACITY;
      ret_desc->access[CSAID_CPU] = CSAF_READ | CSAF_WRITE | CSAF_SHARED;
      ret_desc->types             = CSTF_LAYER | CSTF_WINDOW | CSTF_CURSOR | CSTF_FONT | CSTF_SHARED | CSTF_INTERNAL;
      ret_desc->priority          = CSPP_DEFAULT;
@@ -105,7 +105,7 @@ sharedInitPool( CoreDFB                    *core,
      if (ret)
           return ret;
 
-     ret_desc->caps              = CSPCAPS_VIRTUAL;
+     ret_desc->caps              = CSPCAPS_VIRTUAL | CSPCAPS_CAPACITY;
      ret_desc->access[CSAID_CPU] = CSAF_READ | CSAF_WRITE | CSAF_SHARED;
      ret_desc->types             = CSTF_LAYER | CSTF_WINDOW | CSTF_CURSOR | CSTF_FONT | CSTF_SHARED | CSTF_INTERNAL;
      ret_desc->priority          = (dfb_system_caps() & CSCAPS_PREFER_SHM) ? CSPP_PREFERED : CSPP_DEFAULT;
@@ -34,6 +34,12 @@
 
 #include <config.h>
 
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <sys/eventfd.h>
+
 #ifdef USE_ZLIB
 #include <zlib.h>
 #endif
@@ -43,10 +49,13 @@
 #include <core/core.h>
 #include <core/palette.h>
 #include <core/surface.h>
+#include <core/surface_allocation.h>
 #include <core/surface_pool.h>
 
 #include <core/system.h>
+#include <core/surface_core.h>
 
+#include <core/SurfaceTask.h>
 #include <core/Task.h>
 
 #include <fusion/conf.h>
@@ -160,6 +169,187 @@ release_frame( CoreSurface *surface,
      }
 }
 
+/*
+ * Copy-on-write duplicates
+ *
+ * Buffers of a duplicate link to the buffers of the source surface ('cow') until either one is written.
+ * Links are created or removed with both surfaces locked, always locking the source before the duplicate,
+ * so writing to the source is held back while the duplicate is locked.
+ *
+ * The shared content is only read with the source locked, see dfb_surface_cow_lock_source().
+ */
+
+static DFBResult
+cow_copy( CoreSurfaceBuffer     *buffer,
+          CoreSurfaceAllocation *allocation )
+{
+     DFBResult              ret = DFB_OK;
+     CoreSurfaceBuffer     *shared;
+     CoreSurfaceAllocation *source;
+
+     D_MAGIC_ASSERT( buffer, CoreSurfaceBuffer );
+     D_MAGIC_ASSERT_IF( allocation, CoreSurfaceAllocation );
+
+     shared = buffer->cow;
+     D_MAGIC_ASSERT( shared, CoreSurfaceBuffer );
+     D_MAGIC_ASSERT( shared->surface, CoreSurface );
+     FUSION_SKIRMISH_ASSERT( &shared->surface->lock );
+
+     D_DEBUG_AT( Core_Surface, "%s( buffer %p <- %p, allocation %p )\n", __FUNCTION__, buffer, shared, allocation );
+
+     buffer->cow = NULL;
+
+     source = shared->written;
+     if (!source)
+          return DFB_OK;
+
+     D_MAGIC_ASSERT( source, CoreSurfaceAllocation );
+
+     /* Prefer the pool of the shared allocation for the transfer. */
+     if (!allocation && dfb_surface_pool_allocate( source->pool, buffer, NULL, 0, &allocation )) {
+          ret = dfb_surface_pools_allocate( buffer, CSAID_CPU, CSAF_READ | CSAF_WRITE, &allocation );
+          if (ret) {
+               D_DERROR( ret, "Core/Surface: Could not allocate buffer for copy on write!\n" );
+               return ret;
+          }
+     }
+
+     ret = dfb_surface_allocation_transfer( allocation, source );
+     if (ret) {
+          D_DERROR( ret, "Core/Surface: Could not copy shared buffer content!\n" );
+          return ret;
+     }
+
+     dfb_surface_allocation_written( allocation, NULL, 0 );
+
+     return DFB_OK;
+}
+
+static bool
+cow_linked( CoreSurface *surface )
+{
+     int i;
+
+     D_MAGIC_ASSERT( surface, CoreSurface );
+     FUSION_SKIRMISH_ASSERT( &surface->lock );
+
+     for (i=0; i<surface->num_buffers; i++) {
+          if (surface->left_buffers[i] && surface->left_buffers[i]->cow)
+               return true;
+
+          if (surface->right_buffers[i] && surface->right_buffers[i]->cow)
+               return true;
+     }
+
+     return false;
+}
+
+/*
+ * Gives the duplicates of a surface their own copy of 'buffer' (all if NULL), with the surface locked.
+ */
+static void
+cow_release( CoreSurface       *surface,
+             CoreSurfaceBuffer *buffer )
+{
+     int          i, n;
+     CoreSurface *clone;
+
+     D_MAGIC_ASSERT( surface, CoreSurface );
+     FUSION_SKIRMISH_ASSERT( &surface->lock );
+
+     fusion_vector_foreach (clone, i, surface->cow_clones) {
+          D_MAGIC_ASSERT( clone, CoreSurface );
+          D_ASSERT( clone->cow_source == surface );
+
+          D_DEBUG_AT( Core_Surface, "%s( %p ) -> releasing %p\n", __FUNCTION__, surface, clone );
+
+          dfb_surface_lock( clone );
+
+          for (n=0; n<clone->num_buffers; n++) {
+               CoreSurfaceBuffer *left  = clone->left_buffers[n];
+               CoreSurfaceBuffer *right = clone->right_buffers[n];
+
+               if (left && left->cow && (!buffer || left->cow == buffer))
+                    cow_copy( left, NULL );
+
+               if (right && right->cow && (!buffer || right->cow == buffer))
+                    cow_copy( right, NULL );
+          }
+
+          if (!cow_linked( clone )) {
+               clone->cow_source = NULL;
+
+               fusion_vector_remove( &surface->cow_clones, i-- );
+
+               /* The caller holds another reference. */
+               dfb_surface_unref( surface );
+          }
+
+          dfb_surface_unlock( clone );
+     }
+}
+
+/*
+ * Removes the links of a duplicate to its source, copying the shared content or discarding it.
+ */
+static void
+cow_unlink( CoreSurface *surface,
+            bool         copy )
+{
+     int          i;
+     CoreSurface *source;
+
+     D_MAGIC_ASSERT( surface, CoreSurface );
+
+     dfb_surface_lock( surface );
+
+     source = surface->cow_source;
+     if (source)
+          dfb_surface_ref( source );
+
+     dfb_surface_unlock( surface );
+
+     if (!source)
+          return;
+
+     D_DEBUG_AT( Core_Surface, "%s( %p ) <- %p\n", __FUNCTION__, surface, source );
+
+     dfb_surface_lock( source );
+     dfb_surface_lock( surface );
+
+     if (surface->cow_source == source) {
+          for (i=0; i<surface->num_buffers; i++) {
+               CoreSurfaceBuffer *left  = surface->left_buffers[i];
+               CoreSurfaceBuffer *right = surface->right_buffers[i];
+
+               if (left && left->cow) {
+                    if (copy)
+                         cow_copy( left, NULL );
+                    else
+                         left->cow = NULL;
+               }
+
+               if (right && right->cow) {
+                    if (copy)
+                         cow_copy( right, NULL );
+                    else
+                         right->cow = NULL;
+               }
+          }
+
+          surface->cow_source = NULL;
+
+          fusion_vector_remove( &source->cow_clones, fusion_vector_index_of( &source->cow_clones, surface ) );
+
+          dfb_surface_unref( source );
+     }
+
+     dfb_surface_unlock( surface );
+     dfb_surface_unlock( source );
+
+     dfb_surface_unref( source );
+}
+
 /**********************************************************************************************************************/
 
 static const ReactionFunc dfb_surface_globals[] = {
@@ -209,6 +399,11 @@ surface_destructor( FusionObject *object, bool zombie, void *ctx )
 
      CoreSurface_Deinit_Dispatch( &surface->call );
 
+     /* Duplicates hold a reference to their source, so only a duplicate may still be linked. */
+     D_ASSUME( fusion_vector_is_empty( &surface->cow_clones ) );
+
+     cow_unlink( surface, false );
+
      dfb_surface_lock( surface );
 
      surface->state |= CSSF_DESTROYED;
@@ -253,6 +448,7 @@ surface_destructor( FusionObject *object, bool zombie, void *ctx )
      dfb_surface_unlock( surface );
 
      fusion_vector_destroy( &surface->clients );
+     fusion_vector_destroy( &surface->cow_clones );
 
      fusion_skirmish_destroy( &surface->lock );
 
@@ -393,6 +589,7 @@ dfb_surface_create( CoreDFB                  *core,
      direct_serial_increase( &surface->config_serial );
 
      fusion_vector_init( &surface->clients, 2, surface->shmpool );
+     fusion_vector_init( &surface->cow_clones, 2, surface->shmpool );
 
      snprintf( buf, sizeof(buf), "Surface %dx%d %s %s", surface->config.size.w,
                surface->config.size.h, dfb_pixelformat_name(surface->config.format),
@@ -404,6 +601,9 @@ dfb_surface_create( CoreDFB                  *core,
 
      fusion_reactor_direct( surface->object.reactor, false );
 
+     /* Notifications only describe what has changed, identical ones can be merged. */
+     fusion_reactor_coalesce( surface->object.reactor, true );
+
 //     fusion_skirmish_add_permissions( &surface->lock, 0, FUSION_SKIRMISH_PERMIT_PREVAIL | FUSION_SKIRMISH_PERMIT_DISMISS );
 
      fusion_hash_create( surface->shmpool, HASH_INT, HASH_PTR, 7, &surface->frames );
@@ -550,6 +750,192 @@ dfb_surface_create_simple ( CoreDFB                 *core,
      return CoreDFB_CreateSurface( core, &config, type, resource_id, palette, ret_surface );
 }
 
+DFBResult
+dfb_surface_duplicate( CoreDFB      *core,
+                       CoreSurface  *source,
+                       CoreSurface **ret_surface )
+{
+     DFBResult              ret;
+     int                    num_eyes;
+     bool                   linked = false;
+     DFBSurfaceStereoEye    eye;
+     CoreSurfaceBufferRole  role;
+     CoreSurfaceConfig      config;
+     CoreSurface           *surface;
+
+     D_ASSERT( core != NULL );
+     D_MAGIC_ASSERT( source, CoreSurface );
+     D_ASSERT( ret_surface != NULL );
+
+     D_DEBUG_AT( Core_Surface, "%s( %p )\n", __FUNCTION__, source );
+
+     /* Only share buffers having content of their own. */
+     cow_unlink( source, true );
+
+     if (dfb_surface_lock( source ))
+          return DFB_FUSION;
+
+     if (source->state & CSSF_DESTROYED) {
+          dfb_surface_unlock( source );
+          return DFB_DESTROYED;
+     }
+
+     if (source->num_buffers < 1) {
+          dfb_surface_unlock( source );
+          return DFB_BUFFEREMPTY;
+     }
+
+     config.flags      = CSCONF_SIZE | CSCONF_FORMAT | CSCONF_COLORSPACE | CSCONF_CAPS;
+     config.size       = source->config.size;
+     config.format     = source->config.format;
+     config.colorspace = source->config.colorspace;
+     config.caps       = source->config.caps & ~DSCAPS_PRIMARY;
+
+     ret = dfb_surface_create( core, &config, CSTF_NONE, 0, source->palette, &surface );
+     if (ret) {
+          dfb_surface_unlock( source );
+          return ret;
+     }
+
+     dfb_surface_lock( surface );
+
+     /* Link each buffer to the one of the source having the same role. */
+     num_eyes = config.caps & DSCAPS_STEREO ? 2 : 1;
+     for (eye=DSSE_LEFT; num_eyes>0; num_eyes--, eye=DSSE_RIGHT) {
+          for (role=CSBR_FRONT; role<=CSBR_IDLE; role++) {
+               CoreSurfaceBuffer *buffer = dfb_surface_get_buffer3( surface, role, eye, surface->flips );
+               CoreSurfaceBuffer *shared = dfb_surface_get_buffer3( source, role, eye, source->flips );
+
+               D_MAGIC_ASSERT( buffer, CoreSurfaceBuffer );
+               D_MAGIC_ASSERT( shared, CoreSurfaceBuffer );
+
+               if (buffer->cow || !shared->written)
+                    continue;
+
+               D_DEBUG_AT( Core_Surface, "  -> sharing %s\n", ToString_CoreSurfaceBuffer( shared ) );
+
+               buffer->cow = shared;
+
+               linked = true;
+          }
+     }
+
+     if (linked) {
+          surface->cow_source = source;
+
+          fusion_vector_add( &source->cow_clones, surface );
+
+          dfb_surface_ref( source );
+     }
+
+     dfb_surface_unlock( surface );
+     dfb_surface_unlock( source );
+
+     *ret_surface = surface;
+
+     return DFB_OK;
+}
+
+void
+dfb_surface_cow_detach( CoreSurface *surface )
+{
+     D_MAGIC_ASSERT( surface, CoreSurface );
+
+     D_DEBUG_AT( Core_Surface, "%s( %p )\n", __FUNCTION__, surface );
+
+     cow_unlink( surface, true );
+}
+
+CoreSurface *
+dfb_surface_cow_lock_source( CoreSurface *surface )
+{
+     CoreSurface *source;
+
+     D_MAGIC_ASSERT( surface, CoreSurface );
+
+     /* Links are only set up while creating the duplicate, so no lock is needed for the check. */
+     if (!surface->cow_source)
+          return NULL;
+
+     dfb_surface_lock( surface );
+
+     source = surface->cow_source;
+     if (source)
+          dfb_surface_ref( source );
+
+     dfb_surface_unlock( surface );
+
+     if (!source)
+          return NULL;
+
+     D_DEBUG_AT( Core_Surface, "%s( %p ) <- %p\n", __FUNCTION__, surface, source );
+
+     /* The link may be gone meanwhile, which just makes the lock unnecessary. */
+     dfb_surface_lock( source );
+
+     return source;
+}
+
+void
+dfb_surface_cow_unlock_source( CoreSurface *source )
+{
+     if (!source)
+          return;
+
+     D_MAGIC_ASSERT( source, CoreSurface );
+
+     dfb_surface_unlock( source );
+     dfb_surface_unref( source );
+}
+
+DFBResult
+dfb_surface_cow_update( CoreSurfaceAllocation  *allocation,
+                        CoreSurfaceAccessFlags  access )
+{
+     DFBResult          ret;
+     CoreSurfaceBuffer *buffer;
+     CoreSurface       *surface;
+
+     D_MAGIC_ASSERT( allocation, CoreSurfaceAllocation );
+
+     buffer = allocation->buffer;
+     D_MAGIC_ASSERT( buffer, CoreSurfaceBuffer );
+
+     surface = buffer->surface;
+     D_MAGIC_ASSERT( surface, CoreSurface );
+     FUSION_SKIRMISH_ASSERT( &surface->lock );
+
+     D_DEBUG_AT( Core_Surface, "%s( %p, access 0x%02x )\n", __FUNCTION__, allocation, access );
+
+     /*
+      * The source has to be locked before the duplicate, so here it can only be tried, succeeding
+      * if the caller locked it via dfb_surface_cow_lock_source(). Writing to the source is held back
+      * while the duplicate is locked, which makes the allocation the most recent one.
+      */
+     if (buffer->cow) {
+          CoreSurface *source = buffer->cow->surface;
+
+          D_MAGIC_ASSERT( source, CoreSurface );
+
+          if (dfb_surface_trylock( source )) {
+               D_DEBUG_AT( Core_Surface, "  -> source %p is locked by someone else!\n", source );
+               return DFB_LOCKED;
+          }
+
+          ret = cow_copy( buffer, allocation );
+
+          dfb_surface_unlock( source );
+
+          if (ret)
+               return ret;
+     }
+
+     if (access & CSAF_WRITE)
+          cow_release( surface, buffer );
+
+     return DFB_OK;
+}
+
 DFBResult
 dfb_surface_init_palette( CoreDFB     *core,
                           CoreSurface *surface )
@@ -610,6 +996,8 @@ dfb_surface_notify( CoreSurface                  *surface,
                return DFB_OK;
      }
 
+     memset( &notification, 0, sizeof(notification) );
+
      notification.flags   = flags;
      notification.surface = surface;
 
@@ -676,6 +1064,8 @@ dfb_surface_notify_frame( CoreSurface  *surface,
 
      direct_serial_increase( &surface->serial );
 
+     memset( &notification, 0, sizeof(notification) );
+
      notification.flags      = CSNF_FRAME;
      notification.surface    = surface;
      notification.flip_count = flip_count;
@@ -777,6 +1167,8 @@ dfb_surface_flip_buffers( CoreSurface *surface, bool swap )
 
      D_DEBUG_AT( Core_Surface, "  -> flips %d <-----------------\n", surface->flips );
 
+     dfb_surface_presented( surface, CSBR_FRONT, surface->flips );
+
      // FIXME: cleanup, only used by desktop background via primary surface,
      // make it use surface client
      dfb_surface_notify( surface, CSNF_FLIP );
@@ -784,6 +1176,63 @@ dfb_surface_flip_buffers( CoreSurface *surface, bool swap )
      return DFB_OK;
 }
 
+void
+dfb_surface_presented( CoreSurface           *surface,
+                       CoreSurfaceBufferRole  role,
+                       u32                    flip_count )
+{
+     CoreSurfaceBuffer *buffer;
+
+     D_DEBUG_AT( Core_Surface, "%s( %p, role %d, flip_count %u )\n", __FUNCTION__, surface, role, flip_count );
+
+     D_MAGIC_ASSERT( surface, CoreSurface );
+     FUSION_SKIRMISH_ASSERT( &surface->lock );
+
+     if (surface->num_buffers == 0)
+          return;
+
+     /* Zero is reserved for buffers never being presented. */
+     if (!++surface->frame)
+          surface->frame = 1;
+
+     buffer = dfb_surface_get_buffer3( surface, role, DSSE_LEFT, flip_count );
+     D_MAGIC_ASSERT( buffer, CoreSurfaceBuffer );
+
+     buffer->frame = surface->frame;
+
+     if (surface->config.caps & DSCAPS_STEREO) {
+          buffer = dfb_surface_get_buffer3( surface, role, DSSE_RIGHT, flip_count );
+          D_MAGIC_ASSERT( buffer, CoreSurfaceBuffer );
+
+          buffer->frame = surface->frame;
+     }
+
+     D_DEBUG_AT( Core_Surface, "  -> frame %u\n", surface->frame );
+}
+
+u32
+dfb_surface_buffer_age( CoreSurface           *surface,
+                        CoreSurfaceBufferRole  role,
+                        DFBSurfaceStereoEye    eye,
+                        u32                    flip_count )
+{
+     CoreSurfaceBuffer *buffer;
+
+     D_MAGIC_ASSERT( surface, CoreSurface );
+     FUSION_SKIRMISH_ASSERT( &surface->lock );
+
+     if (surface->num_buffers == 0)
+          return 0;
+
+     buffer = dfb_surface_get_buffer3( surface, role, eye, flip_count );
+     D_MAGIC_ASSERT( buffer, CoreSurfaceBuffer );
+
+     if (!buffer->frame)
+          return 0;
+
+     return surface->frame - buffer->frame + 1;
+}
+
 DFBResult
 dfb_surface_dispatch_event( CoreSurface         *surface,
                             DFBSurfaceEventType  type )
@@ -902,6 +1351,116 @@ dfb_surface_check_acks( CoreSurface *surface )
      return DFB_OK;
 }
 
+/*
+ * Rounds up the size of surfaces being resized, e.g. windows during interactive resizing,
+ * to avoid a reallocation for each small step.
+ */
+static int
+surface_capacity( int size )
+{
+     return direct_util_align( size + size / 8, 64 );
+}
+
+/*
+ * Checks if the new size fits into the capacity of the surface and all of its allocations.
+ */
+static bool
+surface_fits_in_place( CoreSurface        *surface,
+                       const DFBDimension *size )
+{
+     int                    i, n;
+     CoreSurfaceBuffer     *buffer;
+     CoreSurfaceAllocation *allocation;
+
+     D_MAGIC_ASSERT( surface, CoreSurface );
+     D_ASSERT( size != NULL );
+
+     if (size->w > surface->config.min_size.w || size->h > surface->config.min_size.h)
+          return false;
+
+     if (surface->config.caps & DSCAPS_STATIC_ALLOC)
+          return true;
+
+     /* Release memory when shrinking a lot. */
+     if (size->w * size->h < surface->config.min_size.w * surface->config.min_size.h / 4)
+          return false;
+
+     for (i=0; i<surface->num_buffers; i++) {
+          buffer = surface->left_buffers[i];
+
+          while (buffer) {
+               D_MAGIC_ASSERT( buffer, CoreSurfaceBuffer );
+
+               fusion_vector_foreach (allocation, n, buffer->allocs) {
+                    D_MAGIC_ASSERT( allocation, CoreSurfaceAllocation );
+
+                    if (!(allocation->pool->desc.caps & CSPCAPS_CAPACITY) ||
+                        size->w > allocation->config.min_size.w || size->h > allocation->config.min_size.h)
+                    {
+                         D_DEBUG_AT( Core_Surface, "  -> allocation %p (%s) cannot be resized in place\n",
+                                     allocation, allocation->pool->desc.name );
+                         return false;
+                    }
+               }
+
+               buffer = (buffer == surface->left_buffers[i] && (surface->config.caps & DSCAPS_STEREO)) ?
+                        surface->right_buffers[i] : NULL;
+          }
+     }
+
+     return true;
+}
+
+/*
+ * Updates the geometry of the surface, its buffers and allocations keeping the memory.
+ */
+static void
+surface_resize_in_place( CoreSurface        *surface,
+                         const DFBDimension *size )
+{
+     int                    i, n;
+     DFBRegion              region = DFB_REGION_INIT_FROM_DIMENSION( size );
+     CoreSurfaceBuffer     *buffer;
+     CoreSurfaceAllocation *allocation;
+
+     D_DEBUG_AT( Core_Surface, "%s( %p, %dx%d -> %dx%d ) <- capacity %dx%d\n", __FUNCTION__, surface,
+                 surface->config.size.w, surface->config.size.h, size->w, size->h,
+                 surface->config.min_size.w, surface->config.min_size.h );
+
+     D_MAGIC_ASSERT( surface, CoreSurface );
+     FUSION_SKIRMISH_ASSERT( &surface->lock );
+
+     surface->config.size = *size;
+
+     for (i=0; i<surface->num_buffers; i++) {
+          buffer = surface->left_buffers[i];
+
+          while (buffer) {
+               D_MAGIC_ASSERT( buffer, CoreSurfaceBuffer );
+
+               buffer->config.size = *size;
+
+               /* Content is undefined now. */
+               buffer->frame = 0;
+
+               dfb_updates_reset( &buffer->damage );
+               dfb_updates_add( &buffer->damage, &region );
+
+               fusion_vector_foreach (allocation, n, buffer->allocs) {
+                    D_MAGIC_ASSERT( allocation, CoreSurfaceAllocation );
+
+                    allocation->config.size = *size;
+
+                    dfb_updates_reset( &allocation->damage );
+                    dfb_updates_add( &allocation->damage, &region );
+               }
+
+               buffer = (buffer == surface->left_buffers[i] && (surface->config.caps & DSCAPS_STEREO)) ?
+                        surface->right_buffers[i] : NULL;
+          }
+     }
+}
+
 DFBResult
 dfb_surface_reconfig( CoreSurface             *surface,
                       const CoreSurfaceConfig *config )
@@ -925,6 +1484,9 @@ dfb_surface_reconfig( CoreSurface             *surface,
      if (config->flags & CSCONF_PREALLOCATED)
           return DFB_UNSUPPORTED;
 
+     /* Buffers of a duplicate may be resized in place, keeping their content. */
+     cow_unlink( surface, true );
+
      if (fusion_skirmish_prevail( &surface->lock ))
           return DFB_FUSION;
 
@@ -933,24 +1495,48 @@ dfb_surface_reconfig( CoreSurface             *surface,
           return DFB_UNSUPPORTED;
      }
 
+     cow_release( surface, NULL );
+
      if (  (config->flags == CSCONF_SIZE ||
           ((config->flags == (CSCONF_SIZE | CSCONF_FORMAT)) && (config->format == surface->config.format)))  &&
-         config->size.w <= surface->config.min_size.w &&
-         config->size.h <= surface->config.min_size.h)
+         surface_fits_in_place( surface, &config->size ))
      {
-          surface->config.size = config->size;
+          new_config      = surface->config;
+          new_config.size = config->size;
+
+          ret = Core_Resource_CheckSurfaceUpdate( surface, &new_config );
+          if (ret) {
+               fusion_skirmish_dismiss( &surface->lock );
+               return ret;
+          }
+
+          surface_resize_in_place( surface, &config->size );
 
           direct_serial_increase( &surface->config_serial );
 
+          Core_Resource_UpdateSurface( surface, &new_config );
+
+          dfb_surface_notify( surface, CSNF_SIZEFORMAT );
+
+          if (dfb_config->surface_clear)
+               dfb_surface_clear_buffers( surface );
+
           fusion_skirmish_dismiss( &surface->lock );
           return DFB_OK;
      }
 
      new_config = surface->config;
 
-     if (config->flags & CSCONF_SIZE)
+     if (config->flags & CSCONF_SIZE) {
           new_config.size = config->size;
 
+          /* Keep some capacity for windows being resized to reuse their allocations. */
+          if ((surface->type & CSTF_WINDOW) && !(surface->config.caps & DSCAPS_STATIC_ALLOC)) {
+               new_config.min_size.w = surface_capacity( config->size.w );
+               new_config.min_size.h = surface_capacity( config->size.h );
+          }
+     }
+
      if (config->flags & CSCONF_FORMAT)
           new_config.format = config->format;
 
@@ -1078,6 +1664,8 @@ dfb_surface_destroy_buffers( CoreSurface *surface )
           return DFB_UNSUPPORTED;
      }
 
+     cow_release( surface, NULL );
+
      /* Destroy the Surface Buffers. */
      num_eyes = surface->config.caps & DSCAPS_STEREO ? 2 : 1;
      for (eye = DSSE_LEFT; num_eyes > 0; num_eyes--, eye = DSSE_RIGHT) {
@@ -1116,6 +1704,8 @@ dfb_surface_deallocate_buffers( CoreSurface *surface )
           return DFB_UNSUPPORTED;
      }
 
+     cow_release( surface, NULL );
+
      /* Deallocate the Surface Buffers. */
      num_eyes = surface->config.caps & DSCAPS_STEREO ? 2 : 1;
      for (eye = DSSE_LEFT; num_eyes > 0; num_eyes--, eye = DSSE_RIGHT) {
@@ -1200,18 +1790,35 @@ dfb_surface_lock_buffer2( CoreSurface            *surface,
                           CoreSurfaceAccessorID   accessor,
                           CoreSurfaceAccessFlags  access,
                           CoreSurfaceBufferLock  *ret_lock )
+{
+     return dfb_surface_lock_buffer3( surface, role, flip_count, eye, accessor, access, NULL, ret_lock );
+}
+
+DFBResult
+dfb_surface_lock_buffer3( CoreSurface            *surface,
+                          CoreSurfaceBufferRole   role,
+                          u32                     flip_count,
+                          DFBSurfaceStereoEye     eye,
+                          CoreSurfaceAccessorID   accessor,
+                          CoreSurfaceAccessFlags  access,
+                          const DFBRegion        *damage,
+                          CoreSurfaceBufferLock  *ret_lock )
 {
      DFBResult              ret;
      CoreSurfaceAllocation *allocation;
 
      D_MAGIC_ASSERT( surface, CoreSurface );
+     DFB_REGION_ASSERT_IF( damage );
 
      D_DEBUG_AT( Core_Surface, "%s( accessor 0x%x, access 0x%x, role %d, count %u, eye %d ) <- %dx%d %s\n",
                  __FUNCTION__, accessor, access, role, flip_count, eye, surface->config.size.w, surface->config.size.h,
                  dfb_pixelformat_name(surface->config.format) );
 
-     ret = CoreSurface_PreLockBuffer3( surface, role, flip_count, eye,
-                                       accessor, access, true, &allocation );
+     if (damage)
+          D_DEBUG_AT( Core_Surface, "  -> damage %d,%d-%dx%d\n", DFB_RECTANGLE_VALS_FROM_REGION( damage ) );
+
+     ret = CoreSurface_PreLockBuffer4( surface, role, flip_count, eye,
+                                       accessor, access, true, damage, &allocation );
      if (ret)
           return ret;
 
@@ -1243,11 +1850,159 @@ dfb_surface_unlock_buffer( CoreSurface           *surface,
 
      D_MAGIC_ASSERT( surface, CoreSurface );
 
+     if (lock->task || lock->fence >= 0)
+          return dfb_surface_unlock_buffer_fenced( surface, lock, -1 );
+
      ret = dfb_surface_buffer_unlock( lock );
 
      return ret;
 }
 
+static DFBResult
+fence_lock_run( void     *ctx,
+                DFB_Task *task )
+{
+     int fence = (long) ctx;
+
+     D_DEBUG_AT( Core_Surface, "%s( %p ) <- fence %d\n", __FUNCTION__, task, fence );
+
+     /* Access is granted, keep the task running until the buffer gets unlocked. */
+     eventfd_write( fence, 1 );
+
+     return DFB_OK;
+}
+
+static void
+fence_wait( int fence )
+{
+     struct pollfd pfd;
+
+     pfd.fd     = fence;
+     pfd.events = POLLIN;
+
+     while (poll( &pfd, 1, -1 ) < 0 && errno == EINTR);
+}
+
+DFBResult
+dfb_surface_lock_buffer_fenced( CoreSurface            *surface,
+                                CoreSurfaceBufferRole   role,
+                                u32                     flip_count,
+                                DFBSurfaceStereoEye     eye,
+                                CoreSurfaceAccessorID   accessor,
+                                CoreSurfaceAccessFlags  access,
+                                CoreSurfaceBufferLock  *ret_lock,
+                                int                    *ret_fence )
+{
+     DFBResult              ret;
+     int                    fence;
+     DFB_SurfaceTask       *task;
+     CoreSurfaceAllocation *allocation;
+
+     D_MAGIC_ASSERT( surface, CoreSurface );
+     D_ASSERT( ret_lock != NULL );
+     D_ASSERT( ret_fence != NULL );
+
+     D_DEBUG_AT( Core_Surface, "%s( accessor 0x%x, access 0x%x, role %d, count %u, eye %d )\n",
+                 __FUNCTION__, accessor, access, role, flip_count, eye );
+
+     /* Without the task manager (or outside the master) the lock is granted right away. */
+     if (!dfb_config->task_manager || accessor != CSAID_CPU || !dfb_core_is_master( core_dfb )) {
+          *ret_fence = -1;
+
+          return dfb_surface_lock_buffer2( surface, role, flip_count, eye, accessor, access, ret_lock );
+     }
+
+     fence = eventfd( 0, EFD_CLOEXEC );
+     if (fence < 0) {
+          ret = errno2result( errno );
+          D_DERROR( ret, "Core/Surface: Could not create eventfd!\n" );
+          return ret;
+     }
+
+     ret = SurfaceTask_Create( NULL, fence_lock_run, (void*)(long) fence, accessor, &task );
+     if (ret)
+          goto error_task;
+
+     ret = SurfaceTask_AddAccess( task, surface, role, eye, flip_count, access, &allocation );
+     if (ret)
+          goto error_access;
+
+     D_MAGIC_ASSERT( allocation, CoreSurfaceAllocation );
+
+     dfb_surface_allocation_ref( allocation );
+
+     dfb_surface_buffer_lock_init( ret_lock, accessor, access );
+
+     ret = dfb_surface_pool_lock( allocation->pool, allocation, ret_lock );
+     if (ret) {
+          D_DERROR( ret, "Core/Surface: Locking allocation failed! [%s]\n", allocation->pool->desc.name );
+          dfb_surface_buffer_lock_deinit( ret_lock );
+          dfb_surface_allocation_unref( allocation );
+          goto error_access;
+     }
+
+     ret_lock->task  = task;
+     ret_lock->fence = fence;
+
+     Task_Flush( task );
+
+     D_DEBUG_AT( Core_Surface, "  -> task %p, fence %d\n", task, fence );
+
+     *ret_fence = fence;
+
+     return DFB_OK;
+
+
+error_access:
+     Task_Release( task );
+
+error_task:
+     close( fence );
+
+     return ret;
+}
+
+DFBResult
+dfb_surface_unlock_buffer_fenced( CoreSurface           *surface,
+                                  CoreSurfaceBufferLock *lock,
+                                  int                    fence )
+{
+     DFBResult        ret;
+     DFB_SurfaceTask *task;
+     int              granted;
+
+     D_MAGIC_ASSERT( surface, CoreSurface );
+     D_MAGIC_ASSERT( lock, CoreSurfaceBufferLock );
+
+     D_DEBUG_AT( Core_Surface, "%s( %p, fence %d ) <- task %p, granted %d\n", __FUNCTION__,
+                 lock, fence, lock->task, lock->fence );
+
+     task    = lock->task;
+     granted = lock->fence;
+
+     ret = dfb_surface_buffer_unlock( lock );
+
+     /* The caller may not have waited for the lock to be granted at all. */
+     if (granted >= 0) {
+          fence_wait( granted );
+          close( granted );
+     }
+
+     if (task) {
+          if (fence >= 0 && !dfb_surface_core_wait_fence( DFB_CORE( core_dfb, SURFACE ), fence, task ))
+               return ret;
+
+          Task_Done( task );
+     }
+
+     if (fence >= 0) {
+          fence_wait( fence );
+          close( fence );
+     }
+
+     return ret;
+}
+
 DFBResult
 dfb_surface_read_buffer( CoreSurface            *surface,
                          CoreSurfaceBufferRole   role,
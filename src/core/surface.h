@@ -46,6 +46,14 @@
 #include <core/coredefs.h>
 #include <core/coretypes.h>
 
+#include <directfb_util.h>
+
+
+/*
+ * Maximum number of damaged regions tracked per Surface Buffer or Allocation before collapsing to the bounding box
+ */
+#define CORE_SURFACE_DAMAGE_REGIONS  8
+
 
 typedef enum {
      CSNF_NONE           = 0x00000000,
@@ -269,6 +277,11 @@ struct __DFB_CoreSurface
      FusionHash              *frames;
 
      DirectSerial             config_serial;
+
+     u32                      frame;         /* Number of frames presented, for buffer age. */
+
+     CoreSurface             *cow_source;    /* Surface this one has been duplicated from, while sharing buffers. */
+     FusionVector             cow_clones;    /* Duplicates still sharing buffers of this surface. */
 };
 
 #define CORE_SURFACE_ASSERT(surface)                                                           \
@@ -306,6 +319,38 @@ DFBResult dfb_surface_create_simple ( CoreDFB                      *core,
                                       CorePalette                  *palette,
                                       CoreSurface                 **ret_surface );
 
+/*
+ * Creates a surface with the same configuration and content as 'source'.
+ *
+ * The buffers are shared copy-on-write, i.e. the content is only copied
+ * as soon as either surface is written or reconfigured.
+ */
+DFBResult dfb_surface_duplicate     ( CoreDFB                      *core,
+                                      CoreSurface                  *source,
+                                      CoreSurface                 **ret_surface );
+
+/*
+ * Gives a duplicate its own copy of the content still shared with the source,
+ * called without holding the surface lock.
+ */
+void      dfb_surface_cow_detach    ( CoreSurface                  *surface );
+
+/*
+ * Locks the source a duplicate shares buffers with, which has to be locked before the duplicate
+ * for the shared content to be read or copied, called without holding the lock of the duplicate.
+ * Returns NULL if there's no source.
+ */
+CoreSurface *dfb_surface_cow_lock_source  ( CoreSurface               *surface );
+
+void         dfb_surface_cow_unlock_source( CoreSurface               *source );
+
+/*
+ * Resolves copy-on-write sharing of the allocation's buffer before it is updated,
+ * called by dfb_surface_allocation_update_region() with the surface lock held.
+ */
+DFBResult dfb_surface_cow_update    ( CoreSurfaceAllocation        *allocation,
+                                      CoreSurfaceAccessFlags        access );
+
 DFBResult dfb_surface_init_palette  ( CoreDFB                      *core,
                                       CoreSurface                  *surface );
 
@@ -340,6 +385,23 @@ DFBResult dfb_surface_flip          ( CoreSurface                  *surface,
 DFBResult dfb_surface_flip_buffers  ( CoreSurface                  *surface,
                                       bool                          swap );
 
+/*
+ * Marks the buffers of the role as being presented in a new frame, e.g. after a flip,
+ * or the back buffer after copying it to the front buffer.
+ */
+void      dfb_surface_presented     ( CoreSurface                  *surface,
+                                      CoreSurfaceBufferRole         role,
+                                      u32                           flip_count );
+
+/*
+ * Returns the number of frames since the content of the buffer has been presented,
+ * or zero if the content is undefined, similar to EGL_EXT_buffer_age.
+ */
+u32       dfb_surface_buffer_age    ( CoreSurface                  *surface,
+                                      CoreSurfaceBufferRole         role,
+                                      DFBSurfaceStereoEye           eye,
+                                      u32                           flip_count );
+
 DFBResult dfb_surface_dispatch_event( CoreSurface                  *surface,
                                       DFBSurfaceEventType           type );
 
@@ -374,9 +436,45 @@ DFBResult dfb_surface_lock_buffer2  ( CoreSurface                  *surface,
                                       CoreSurfaceAccessFlags        access,
                                       CoreSurfaceBufferLock        *ret_lock );
 
+/*
+ * Like dfb_surface_lock_buffer2(), but when locking for writing the optional damage region
+ * tells which part of the buffer is going to be written, so that only this part needs to
+ * be brought up to date and the other allocations get outdated only there.
+ */
+DFBResult dfb_surface_lock_buffer3  ( CoreSurface                  *surface,
+                                      CoreSurfaceBufferRole         role,
+                                      u32                           flip_count,
+                                      DFBSurfaceStereoEye           eye,
+                                      CoreSurfaceAccessorID         accessor,
+                                      CoreSurfaceAccessFlags        access,
+                                      const DFBRegion              *damage,
+                                      CoreSurfaceBufferLock        *ret_lock );
+
 DFBResult dfb_surface_unlock_buffer ( CoreSurface                  *surface,
                                       CoreSurfaceBufferLock        *lock );
 
+/*
+ * Like dfb_surface_lock_buffer2(), but returns before access is granted when running the task manager.
+ * The returned fence becomes readable once the lock is usable, it is -1 if the lock has been granted
+ * already. The fence is owned by the lock and must not be closed by the caller.
+ */
+DFBResult dfb_surface_lock_buffer_fenced( CoreSurface             *surface,
+                                      CoreSurfaceBufferRole         role,
+                                      u32                           flip_count,
+                                      DFBSurfaceStereoEye           eye,
+                                      CoreSurfaceAccessorID         accessor,
+                                      CoreSurfaceAccessFlags        access,
+                                      CoreSurfaceBufferLock        *ret_lock,
+                                      int                          *ret_fence );
+
+/*
+ * Unlocks the buffer, but keeps it busy for other accessors until the fence becomes readable.
+ * The fence is taken over by this function, passing -1 equals dfb_surface_unlock_buffer().
+ */
+DFBResult dfb_surface_unlock_buffer_fenced( CoreSurface           *surface,
+                                      CoreSurfaceBufferLock        *lock,
+                                      int                           fence );
+
 DFBResult dfb_surface_read_buffer   ( CoreSurface                  *surface,
                                       CoreSurfaceBufferRole         role,
                                       void                         *destination,
@@ -646,14 +744,15 @@ dfb_surface_calc_buffer_size( CoreSurface *surface,
 
      format = surface->config.format;
 
-     width = direct_util_align( surface->config.size.w, pixel_align );
+     /* Allocate the capacity given by the minimum size, allowing to resize in place. */
+     width = direct_util_align( MAX( surface->config.size.w, surface->config.min_size.w ), pixel_align );
      pitch = direct_util_align( DFB_BYTES_PER_LINE( format, width ), byte_align );
 
      if (ret_pitch)
           *ret_pitch = pitch;
 
      if (ret_size)
-          *ret_size = pitch * DFB_PLANE_MULTIPLY( format, surface->config.size.h );
+          *ret_size = pitch * DFB_PLANE_MULTIPLY( format, MAX( surface->config.size.h, surface->config.min_size.h ) );
 }
 
 static __inline__ void
@@ -111,6 +111,8 @@ surface_allocation_destructor( FusionObject *object, bool zombie, void *ctx )
      if (allocation->read_tasks)
           delete allocation->read_tasks;
 
+     dfb_updates_deinit( &allocation->damage );
+
      direct_serial_deinit( &allocation->serial );
 
      D_MAGIC_CLEAR( allocation );
@@ -133,6 +135,51 @@ dfb_surface_allocation_pool_create( const FusionWorld *world )
 
 /**********************************************************************************************************************/
 
+static void
+allocation_damage( CoreSurfaceAllocation *allocation,
+                   const DFBRegion       *region )
+{
+     DFBRegion clipped = DFB_REGION_INIT_FROM_DIMENSION( &allocation->config.size );
+
+     D_MAGIC_ASSERT( &allocation->damage, DFBUpdates );
+     DFB_REGION_ASSERT_IF( region );
+
+     if (region && !dfb_region_region_intersect( &clipped, region ))
+          return;
+
+     dfb_updates_add( &allocation->damage, &clipped );
+}
+
+/*
+ * Returns the number of rectangles to be transferred for updating the allocation,
+ * or zero if the whole buffer needs to be transferred.
+ */
+static unsigned int
+allocation_damage_rects( CoreSurfaceAllocation *allocation,
+                         DFBRectangle          *ret_rects )
+{
+     int num = 0;
+
+     D_MAGIC_ASSERT( allocation, CoreSurfaceAllocation );
+     D_ASSERT( ret_rects != NULL );
+
+     /* Sub byte and planar formats are always transferred as a whole. */
+     if (DFB_PLANAR_PIXELFORMAT( allocation->config.format ) || DFB_BITS_PER_PIXEL( allocation->config.format ) < 8)
+          return 0;
+
+     dfb_updates_get_rectangles( &allocation->damage, ret_rects, &num );
+
+     if (num == 1 && ret_rects[0].x == 0 && ret_rects[0].y == 0 &&
+         ret_rects[0].w == allocation->config.size.w && ret_rects[0].h == allocation->config.size.h)
+          return 0;
+
+     D_DEBUG_AT( Core_SurfAllocation, "  -> %d damaged rectangles\n", num );
+
+     return num;
+}
+
+/**********************************************************************************************************************/
+
 DFBResult
 dfb_surface_allocation_create( CoreDFB                *core,
                                CoreSurfaceBuffer      *buffer,
@@ -178,6 +225,11 @@ dfb_surface_allocation_create( CoreDFB                *core,
 
      direct_serial_init( &allocation->serial );
 
+     dfb_updates_init( &allocation->damage, allocation->damage_regions, D_ARRAY_SIZE(allocation->damage_regions) );
+
+     /* Nothing has been transferred yet, so everything is outdated. */
+     allocation_damage( allocation, NULL );
+
      fusion_ref_add_permissions( &allocation->object.ref, 0, FUSION_REF_PERMIT_REF_UNREF_LOCAL );
 
      CoreSurfaceAllocation_Init_Dispatch( core, allocation, &allocation->call );
@@ -345,9 +397,48 @@ transfer_buffer( const CoreSurfaceConfig *config,
      }
 }
 
+static void
+transfer_rects( const CoreSurfaceConfig *config,
+                const char              *src,
+                char                    *dst,
+                int                      srcpitch,
+                int                      dstpitch,
+                const DFBRectangle      *rects,
+                unsigned int             num_rects )
+{
+     unsigned int i;
+     int          y;
+
+     D_DEBUG_AT( Core_SurfAllocation, "%s( %p, %p [%d] -> %p [%d] ) * %u rects\n",
+                 __FUNCTION__, config, src, srcpitch, dst, dstpitch, num_rects );
+
+     D_ASSERT( src != NULL );
+     D_ASSERT( dst != NULL );
+     D_ASSERT( rects != NULL );
+     D_ASSERT( !DFB_PLANAR_PIXELFORMAT( config->format ) );
+
+     for (i=0; i<num_rects; i++) {
+          const DFBRectangle *rect  = &rects[i];
+          int                 bytes = DFB_BYTES_PER_LINE( config->format, rect->w );
+          const char         *s     = src + DFB_BYTES_PER_LINE( config->format, rect->x ) + rect->y * srcpitch;
+          char               *d     = dst + DFB_BYTES_PER_LINE( config->format, rect->x ) + rect->y * dstpitch;
+
+          DFB_RECTANGLE_ASSERT( rect );
+
+          for (y=0; y<rect->h; y++) {
+               direct_memcpy( d, s, bytes );
+
+               s += srcpitch;
+               d += dstpitch;
+          }
+     }
+}
+
 static DFBResult
 allocation_update_copy( CoreSurfaceAllocation *allocation,
-                        CoreSurfaceAllocation *source )
+                        CoreSurfaceAllocation *source,
+                        const DFBRectangle    *rects,
+                        unsigned int           num_rects )
 {
      DFBResult              ret;
      CoreSurfaceBufferLock  src;
@@ -395,7 +486,10 @@ allocation_update_copy( CoreSurfaceAllocation *allocation,
           return ret;
      }
 
-     transfer_buffer( &allocation->config, (char*) src.addr, (char*) dst.addr, src.pitch, dst.pitch );
+     if (num_rects)
+          transfer_rects( &allocation->config, (char*) src.addr, (char*) dst.addr, src.pitch, dst.pitch, rects, num_rects );
+     else
+          transfer_buffer( &allocation->config, (char*) src.addr, (char*) dst.addr, src.pitch, dst.pitch );
 
      dfb_surface_pool_unlock( allocation->pool, allocation, &dst );
      dfb_surface_pool_unlock( source->pool, source, &src );
@@ -408,7 +502,9 @@ allocation_update_copy( CoreSurfaceAllocation *allocation,
 
 static DFBResult
 allocation_update_write( CoreSurfaceAllocation *allocation,
-                         CoreSurfaceAllocation *source )
+                         CoreSurfaceAllocation *source,
+                         const DFBRectangle    *rects,
+                         unsigned int           num_rects )
 {
      DFBResult              ret;
      CoreSurfaceBufferLock  src;
@@ -440,7 +536,16 @@ allocation_update_write( CoreSurfaceAllocation *allocation,
      }
 
      /* Write to the destination allocation. */
-     ret = dfb_surface_pool_write( allocation->pool, allocation, (char*) src.addr, src.pitch, NULL );
+     if (num_rects) {
+          unsigned int i;
+
+          for (i=0, ret=DFB_OK; i<num_rects && !ret; i++)
+               ret = dfb_surface_pool_write( allocation->pool, allocation,
+                                             (char*) src.addr + DFB_BYTES_PER_LINE( allocation->config.format, rects[i].x ) +
+                                             rects[i].y * src.pitch, src.pitch, &rects[i] );
+     }
+     else
+          ret = dfb_surface_pool_write( allocation->pool, allocation, (char*) src.addr, src.pitch, NULL );
      if (ret)
           D_DERROR( ret, "Core/SurfBuffer: Could not write from destination allocation!\n" );
 
@@ -453,7 +558,9 @@ allocation_update_write( CoreSurfaceAllocation *allocation,
 
 static DFBResult
 allocation_update_read( CoreSurfaceAllocation *allocation,
-                        CoreSurfaceAllocation *source )
+                        CoreSurfaceAllocation *source,
+                        const DFBRectangle    *rects,
+                        unsigned int           num_rects )
 {
      DFBResult              ret;
      CoreSurfaceBufferLock  dst;
@@ -485,7 +592,16 @@ allocation_update_read( CoreSurfaceAllocation *allocation,
      }
 
      /* Read from the source allocation. */
-     ret = dfb_surface_pool_read( source->pool, source, dst.addr, dst.pitch, NULL );
+     if (num_rects) {
+          unsigned int i;
+
+          for (i=0, ret=DFB_OK; i<num_rects && !ret; i++)
+               ret = dfb_surface_pool_read( source->pool, source,
+                                            (char*) dst.addr + DFB_BYTES_PER_LINE( allocation->config.format, rects[i].x ) +
+                                            rects[i].y * dst.pitch, dst.pitch, &rects[i] );
+     }
+     else
+          ret = dfb_surface_pool_read( source->pool, source, dst.addr, dst.pitch, NULL );
      if (ret)
           D_DERROR( ret, "Core/SurfBuffer: Could not read from source allocation!\n" );
 
@@ -497,6 +613,41 @@ allocation_update_read( CoreSurfaceAllocation *allocation,
 }
 
 
+static DFBResult
+allocation_transfer( CoreSurfaceBuffer     *buffer,
+                     CoreSurfaceAllocation *allocation,
+                     CoreSurfaceAllocation *source,
+                     const DFBRectangle    *rects,
+                     unsigned int           num_rects )
+{
+     DFBResult ret;
+
+     D_DEBUG_AT( Core_SurfAllocation, "  -> updating allocation %p from %p (%u rects)...\n", allocation, source, num_rects );
+
+     D_MAGIC_ASSERT( source, CoreSurfaceAllocation );
+
+     ret = dfb_surface_pool_bridges_transfer( buffer, source, allocation, num_rects ? rects : NULL, num_rects );
+     if (ret) {
+          if ((source->access[CSAID_CPU] & CSAF_READ) && (allocation->access[CSAID_CPU] & CSAF_WRITE))
+               ret = allocation_update_copy( allocation, source, rects, num_rects );
+          else if (source->access[CSAID_CPU] & CSAF_READ)
+               ret = allocation_update_write( allocation, source, rects, num_rects );
+          else if (allocation->access[CSAID_CPU] & CSAF_WRITE)
+               ret = allocation_update_read( allocation, source, rects, num_rects );
+          else {
+               D_WARN( "[%s] -> [%s]", source->pool->desc.name, allocation->pool->desc.name );
+               D_UNIMPLEMENTED();
+               ret = DFB_UNSUPPORTED;
+          }
+     }
+
+     if (ret)
+          D_DERROR( ret, "Core/SurfaceBuffer: Updating allocation failed!\n" );
+
+     return ret;
+}
+
+
 namespace DirectFB {
 
 
@@ -504,18 +655,24 @@ class TransferTask : public SurfaceTask
 {
 public:
      TransferTask( CoreSurfaceAllocation *allocation,
-                   CoreSurfaceAllocation *source )
+                   CoreSurfaceAllocation *source,
+                   const DFBRectangle    *rects,
+                   unsigned int           num_rects )
           :
           SurfaceTask( CSAID_CPU ), // FIXME
           allocation( allocation ),
-          source( source )
+          source( source ),
+          num_rects( num_rects )
      {
           D_ASSUME( allocation != source );
-          D_ASSERT( source->buffer == allocation->buffer );
+          D_ASSERT( source->buffer == allocation->buffer || source->buffer == allocation->buffer->cow );
+          D_ASSERT( num_rects <= D_ARRAY_SIZE(this->rects) );
 
           buffer = source->buffer;
 
           dfb_surface_buffer_ref( buffer );
+
+          memcpy( this->rects, rects, sizeof(DFBRectangle) * num_rects );
      }
 
      virtual ~TransferTask()
@@ -524,9 +681,11 @@ public:
      }
 
      static DFBResult Generate( CoreSurfaceAllocation *allocation,
-                                CoreSurfaceAllocation *source )
+                                CoreSurfaceAllocation *source,
+                                const DFBRectangle    *rects,
+                                unsigned int           num_rects )
      {
-          TransferTask *task = new TransferTask( allocation, source );
+          TransferTask *task = new TransferTask( allocation, source, rects, num_rects );
 
           task->AddAccess( allocation, CSAF_WRITE );
           task->AddAccess( source, CSAF_READ );
@@ -541,28 +700,9 @@ protected:
      {
           DFBResult ret;
 
-          D_DEBUG_AT( Core_SurfAllocation, "  -> updating allocation %p from %p...\n", allocation, source );
-
-          D_MAGIC_ASSERT( source, CoreSurfaceAllocation );
-
-          ret = dfb_surface_pool_bridges_transfer( buffer, source, allocation, NULL, 0 );
-          if (ret) {
-               if ((source->access[CSAID_CPU] & CSAF_READ) && (allocation->access[CSAID_CPU] & CSAF_WRITE))
-                    ret = allocation_update_copy( allocation, source );
-               else if (source->access[CSAID_CPU] & CSAF_READ)
-                    ret = allocation_update_write( allocation, source );
-               else if (allocation->access[CSAID_CPU] & CSAF_WRITE)
-                    ret = allocation_update_read( allocation, source );
-               else {
-                    D_UNIMPLEMENTED();
-                    ret = DFB_UNSUPPORTED;
-               }
-          }
-
-          if (ret) {
-               D_DERROR( ret, "Core/SurfaceBuffer: Updating allocation failed!\n" );
+          ret = allocation_transfer( buffer, allocation, source, rects, num_rects );
+          if (ret)
                return ret;
-          }
 
           Done();
 
@@ -573,6 +713,8 @@ private:
      CoreSurfaceAllocation *allocation;
      CoreSurfaceAllocation *source;
      CoreSurfaceBuffer     *buffer;
+     DFBRectangle           rects[CORE_SURFACE_DAMAGE_REGIONS];
+     unsigned int           num_rects;
 };
 
 
@@ -582,6 +724,14 @@ extern "C" {
 DFBResult
 dfb_surface_allocation_update( CoreSurfaceAllocation  *allocation,
                                CoreSurfaceAccessFlags  access )
+{
+     return dfb_surface_allocation_update_region( allocation, access, NULL );
+}
+
+DFBResult
+dfb_surface_allocation_update_region( CoreSurfaceAllocation  *allocation,
+                                      CoreSurfaceAccessFlags  access,
+                                      const DFBRegion        *damage )
 {
      DFBResult              ret;
      int                    i;
@@ -592,6 +742,7 @@ dfb_surface_allocation_update( CoreSurfaceAllocation  *allocation,
 
      D_MAGIC_ASSERT( allocation, CoreSurfaceAllocation );
      D_FLAGS_ASSERT( access, CSAF_ALL );
+     DFB_REGION_ASSERT_IF( damage );
 
      D_DEBUG_AT( Core_SurfAllocation, "  -> alloc:   %s\n", ToString_CoreSurfaceAllocation( allocation ) );
 
@@ -601,8 +752,17 @@ dfb_surface_allocation_update( CoreSurfaceAllocation  *allocation,
      D_MAGIC_ASSERT( buffer->surface, CoreSurface );
      FUSION_SKIRMISH_ASSERT( &buffer->surface->lock );
 
+     /* Copy shared content of duplicated surfaces before it's used or overwritten. */
+     if (buffer->cow || (access & CSAF_WRITE && !fusion_vector_is_empty( &buffer->surface->cow_clones ))) {
+          ret = dfb_surface_cow_update( allocation, access );
+          if (ret)
+               return ret;
+     }
+
      if (direct_serial_update( &allocation->serial, &buffer->serial ) && buffer->written) {
           CoreSurfaceAllocation *source = buffer->written;
+          DFBRectangle           rects[CORE_SURFACE_DAMAGE_REGIONS];
+          unsigned int           num_rects;
 
           D_DEBUG_AT( Core_SurfAllocation, "  -> written: %s\n", ToString_CoreSurfaceAllocation( source ) );
 
@@ -613,49 +773,35 @@ dfb_surface_allocation_update( CoreSurfaceAllocation  *allocation,
           D_MAGIC_ASSERT( source, CoreSurfaceAllocation );
           D_ASSERT( source->buffer == allocation->buffer );
 
+          /* Only transfer regions written since the allocation has been up to date. */
+          num_rects = allocation_damage_rects( allocation, rects );
+
           if (dfb_config->task_manager) {
-               DirectFB::TransferTask::Generate( allocation, source );
+               DirectFB::TransferTask::Generate( allocation, source, rects, num_rects );
           }
           else {
-               D_DEBUG_AT( Core_SurfAllocation, "  -> updating allocation %p from %p...\n", allocation, source );
-
-               ret = dfb_surface_pool_bridges_transfer( buffer, source, allocation, NULL, 0 );
-               if (ret) {
-                    if ((source->access[CSAID_CPU] & CSAF_READ) && (allocation->access[CSAID_CPU] & CSAF_WRITE))
-                         ret = allocation_update_copy( allocation, source );
-                    else if (source->access[CSAID_CPU] & CSAF_READ)
-                         ret = allocation_update_write( allocation, source );
-                    else if (allocation->access[CSAID_CPU] & CSAF_WRITE)
-                         ret = allocation_update_read( allocation, source );
-                    else {
-                         D_WARN( "[%s] -> [%s]", source->pool->desc.name, allocation->pool->desc.name );
-                         D_UNIMPLEMENTED();
-                         ret = DFB_UNSUPPORTED;
-                    }
-               }
-
-               if (ret) {
-                    D_DERROR( ret, "Core/SurfaceBuffer: Updating allocation failed!\n" );
+               ret = allocation_transfer( buffer, allocation, source, rects, num_rects );
+               if (ret)
                     return ret;
-               }
           }
      }
 
+     /* Allocation is up to date now. */
+     dfb_updates_reset( &allocation->damage );
+
      if (access & CSAF_WRITE) {
           D_DEBUG_AT( Core_SurfAllocation, "  -> increasing serial...\n" );
 
-          direct_serial_increase( &buffer->serial );
-
-          direct_serial_copy( &allocation->serial, &buffer->serial );
+          dfb_surface_allocation_written( allocation, damage, damage ? 1 : 0 );
 
-          buffer->written = allocation;
-          buffer->read    = NULL;
-
-          /* Zap volatile allocations (freed when no longer up to date). */
+          /*
+           * Zap volatile allocations (freed when no longer up to date) and those lent to
+           * duplicates, which keep them until unreferenced.
+           */
           fusion_vector_foreach (alloc, i, buffer->allocs) {
                D_MAGIC_ASSERT( alloc, CoreSurfaceAllocation );
 
-               if (alloc != allocation && (alloc->flags & CSALF_VOLATILE)) {
+               if (alloc != allocation && (alloc->flags & CSALF_VOLATILE || dfb_surface_allocation_lent( alloc ))) {
                     dfb_surface_allocation_decouple( alloc );
                     i--;
                }
@@ -682,6 +828,83 @@ dfb_surface_allocation_update( CoreSurfaceAllocation  *allocation,
      return DFB_OK;
 }
 
+void
+dfb_surface_allocation_written( CoreSurfaceAllocation *allocation,
+                                const DFBRegion       *regions,
+                                unsigned int           num_regions )
+{
+     int                    i;
+     unsigned int           n;
+     CoreSurfaceAllocation *alloc;
+     CoreSurfaceBuffer     *buffer;
+
+     D_DEBUG_AT( Core_SurfAllocation, "%s( %p, %u regions )\n", __FUNCTION__, (void *)allocation, num_regions );
+
+     D_MAGIC_ASSERT( allocation, CoreSurfaceAllocation );
+     D_ASSERT( regions != NULL || num_regions == 0 );
+
+     buffer = allocation->buffer;
+     D_MAGIC_ASSERT( buffer, CoreSurfaceBuffer );
+
+     D_MAGIC_ASSERT( buffer->surface, CoreSurface );
+     FUSION_SKIRMISH_ASSERT( &buffer->surface->lock );
+
+     /*
+      * Other allocations being up to date so far only miss the new regions,
+      * outdated ones accumulate them with their existing damage.
+      */
+     fusion_vector_foreach (alloc, i, buffer->allocs) {
+          D_MAGIC_ASSERT( alloc, CoreSurfaceAllocation );
+
+          if (alloc == allocation)
+               continue;
+
+          if (direct_serial_check( &alloc->serial, &buffer->serial ))
+               dfb_updates_reset( &alloc->damage );
+
+          if (num_regions) {
+               for (n=0; n<num_regions; n++)
+                    allocation_damage( alloc, &regions[n] );
+          }
+          else
+               allocation_damage( alloc, NULL );
+     }
+
+     if (num_regions) {
+          for (n=0; n<num_regions; n++)
+               dfb_surface_buffer_damage( buffer, &regions[n] );
+     }
+     else
+          dfb_surface_buffer_damage( buffer, NULL );
+
+     direct_serial_increase( &buffer->serial );
+
+     direct_serial_copy( &allocation->serial, &buffer->serial );
+
+     dfb_updates_reset( &allocation->damage );
+
+     buffer->written = allocation;
+     buffer->read    = NULL;
+}
+
+DFBResult
+dfb_surface_allocation_transfer( CoreSurfaceAllocation *allocation,
+                                 CoreSurfaceAllocation *source )
+{
+     D_DEBUG_AT( Core_SurfAllocation, "%s( %p <- %p )\n", __FUNCTION__, (void *)allocation, (void *)source );
+
+     D_MAGIC_ASSERT( allocation, CoreSurfaceAllocation );
+     D_MAGIC_ASSERT( source, CoreSurfaceAllocation );
+     D_ASSERT( allocation->config.format == source->config.format );
+     D_ASSERT( allocation->config.size.w == source->config.size.w );
+     D_ASSERT( allocation->config.size.h == source->config.size.h );
+
+     if (dfb_config->task_manager)
+          return DirectFB::TransferTask::Generate( allocation, source, NULL, 0 );
+
+     return allocation_transfer( allocation->buffer, allocation, source, NULL, 0 );
+}
+
 DFBResult
 dfb_surface_allocation_dump( CoreSurfaceAllocation *allocation,
                              const char            *directory,
@@ -43,6 +43,7 @@
 #include <core/surface_pool.h>
 
 #include <directfb.h>
+#include <directfb_util.h>
 
 
 /*
@@ -54,13 +55,14 @@ typedef enum {
 
      CSALF_VOLATILE      = 0x00000002,  /* Allocation should be freed when no longer up to date. */
      CSALF_PREALLOCATED  = 0x00000004,  /* Preallocated memory, don't zap when "thrifty-surface-buffers" is active. */
+     CSALF_COW_LENT      = 0x00000008,  /* Lent to a duplicated surface for reading, not written until unreferenced. */
 
      CSALF_MUCKOUT       = 0x00001000,  /* Indicates surface pool being in the progress of mucking out this and possibly
                                            other allocations to have enough space for a new allocation to be made. */
 
      CSALF_DEALLOCATED   = 0x00002000,  /* Decoupled and deallocated surface buffer allocation */
 
-     CSALF_ALL           = 0x00003006   /* All of these. */
+     CSALF_ALL           = 0x0000300E   /* All of these. */
 } CoreSurfaceAllocationFlags;
 
 typedef enum {
@@ -114,6 +116,9 @@ struct __DFB_CoreSurfaceAllocation {
 
      unsigned int                   invalidated;  /* bit mask of accessors which have already invalidated their cache for this allocation */
 
+     DFBUpdates                     damage;       /* Regions being outdated if serial is not equal to the buffer's. */
+     DFBRegion                      damage_regions[CORE_SURFACE_DAMAGE_REGIONS];
+
      FusionCall                     call;
 
      FusionObjectID                 buffer_id;
@@ -144,6 +149,28 @@ DFBResult dfb_surface_allocation_decouple( CoreSurfaceAllocation       *allocati
 DFBResult dfb_surface_allocation_update  ( CoreSurfaceAllocation       *allocation,
                                            CoreSurfaceAccessFlags       access );
 
+/*
+ * Same as dfb_surface_allocation_update(), but with write access only 'damage' is going to be modified.
+ *
+ * Passing NULL is equal to dfb_surface_allocation_update(), i.e. the whole buffer is assumed to be written.
+ */
+DFBResult dfb_surface_allocation_update_region( CoreSurfaceAllocation  *allocation,
+                                                CoreSurfaceAccessFlags  access,
+                                                const DFBRegion        *damage );
+
+/*
+ * Make allocation the latest written one, damaging other allocations within the regions given (all if none).
+ */
+void      dfb_surface_allocation_written ( CoreSurfaceAllocation       *allocation,
+                                           const DFBRegion             *regions,
+                                           unsigned int                 num_regions );
+
+/*
+ * Copy the whole content of 'source' to 'allocation', which may belong to another buffer with the same configuration.
+ */
+DFBResult dfb_surface_allocation_transfer( CoreSurfaceAllocation       *allocation,
+                                           CoreSurfaceAllocation       *source );
+
 
 DFBResult dfb_surface_allocation_dump    ( CoreSurfaceAllocation       *allocation,
                                            const char                  *directory,
@@ -163,6 +190,25 @@ dfb_surface_allocation_locks( CoreSurfaceAllocation *allocation )
      return refs - 1;
 }
 
+/*
+ * Returns true if the allocation is still lent to a duplicate, see CSALF_COW_LENT.
+ *
+ * Borrowers hold a reference while reading, the flag is cleared once nobody holds one anymore.
+ */
+static inline bool
+dfb_surface_allocation_lent( CoreSurfaceAllocation *allocation )
+{
+     if (!(allocation->flags & CSALF_COW_LENT))
+          return false;
+
+     if (dfb_surface_allocation_locks( allocation ))
+          return true;
+
+     allocation->flags &= ~CSALF_COW_LENT;
+
+     return false;
+}
+
 
 FUSION_OBJECT_METHODS( CoreSurfaceAllocation, dfb_surface_allocation )
 
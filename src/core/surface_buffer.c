@@ -103,6 +103,8 @@ surface_buffer_destructor( FusionObject *object, bool zombie, void *ctx )
 
      fusion_vector_destroy( &buffer->allocs );
 
+     dfb_updates_deinit( &buffer->damage );
+
      direct_serial_deinit( &buffer->serial );
 
      D_MAGIC_CLEAR( buffer );
@@ -161,6 +163,11 @@ dfb_surface_buffer_create( CoreDFB                 *core,
      buffer->resource_id = surface->resource_id;
      buffer->index       = index;
 
+     dfb_updates_init( &buffer->damage, buffer->damage_regions, D_ARRAY_SIZE(buffer->damage_regions) );
+
+     /* Content is undefined, so everything is damaged. */
+     dfb_surface_buffer_damage( buffer, NULL );
+
      if (surface->config.caps & DSCAPS_VIDEOONLY)
           buffer->policy = CSP_VIDEOONLY;
      else if (surface->config.caps & DSCAPS_SYSTEMONLY)
@@ -242,6 +249,24 @@ dfb_surface_buffer_deallocate( CoreSurfaceBuffer *buffer )
      return DFB_OK;
 }
 
+void
+dfb_surface_buffer_damage( CoreSurfaceBuffer *buffer,
+                           const DFBRegion   *region )
+{
+     DFBRegion clipped = DFB_REGION_INIT_FROM_DIMENSION( &buffer->config.size );
+
+     D_MAGIC_ASSERT( &buffer->damage, DFBUpdates );
+     DFB_REGION_ASSERT_IF( region );
+
+     if (region && !dfb_region_region_intersect( &clipped, region ))
+          return;
+
+     D_DEBUG_AT( Core_SurfBuffer, "%s( %p, %4d,%4d-%4dx%4d )\n", __FUNCTION__, buffer,
+                 DFB_RECTANGLE_VALS_FROM_REGION( &clipped ) );
+
+     dfb_updates_add( &buffer->damage, &clipped );
+}
+
 CoreSurfaceAllocation *
 dfb_surface_buffer_find_allocation( CoreSurfaceBuffer       *buffer,
                                     CoreSurfaceAccessorID    accessor,
@@ -304,6 +329,11 @@ dfb_surface_buffer_find_allocation( CoreSurfaceBuffer       *buffer,
                continue;
           }
 
+          /* Duplicates may still read allocations lent to them, so these must not be changed. */
+          if ((flags & CSAF_WRITE || !direct_serial_check( &alloc->serial, &buffer->serial )) &&
+              dfb_surface_allocation_lent( alloc ))
+               continue;
+
           if (direct_serial_check( &alloc->serial, &buffer->serial )) {
                /* Return immediately if up to date allocation has required flags. */
                if (D_FLAGS_ARE_SET( alloc->access[accessor], flags ))
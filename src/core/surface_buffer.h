@@ -87,6 +87,8 @@ struct __DFB_CoreSurfaceBufferLock {
      void                    *handle;             /* " */
 
      DFB_SurfaceTask         *task;
+
+     int                      fence;              /* Signalled when an asynchronous lock is granted, -1 otherwise */
 };
 
 static inline void
@@ -102,6 +104,7 @@ dfb_surface_buffer_lock_reset( CoreSurfaceBufferLock *lock )
      lock->pitch      = 0;
      lock->handle     = 0;
      lock->task       = NULL;
+     lock->fence      = -1;
 }
 
 static inline void
@@ -175,6 +178,13 @@ struct __DFB_CoreSurfaceBuffer {
      unsigned int             busy;
 
      FusionObjectID           surface_id;
+
+     DFBUpdates               damage;        /* Regions written since last reset, e.g. by a back to front copy. */
+     DFBRegion                damage_regions[CORE_SURFACE_DAMAGE_REGIONS];
+
+     u32                      frame;         /* Surface frame in which the content was presented, zero if never. */
+
+     CoreSurfaceBuffer       *cow;           /* Buffer of the source surface, shared until either one is written. */
 };
 
 #define CORE_SURFACE_BUFFER_ASSERT(buffer)                                                     \
@@ -241,6 +251,12 @@ CoreSurfaceAllocation *
 dfb_surface_buffer_find_allocation_key( CoreSurfaceBuffer       *buffer,
                                         const char              *key );
 
+/*
+ * Adds a region (or the whole buffer if NULL) to the accumulated damage of the buffer.
+ */
+void      dfb_surface_buffer_damage ( CoreSurfaceBuffer       *buffer,
+                                      const DFBRegion         *region );
+
 static inline int
 dfb_surface_buffer_index( CoreSurfaceBuffer *buffer )
 {
@@ -32,6 +32,12 @@
 
 #include <config.h>
 
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <sys/eventfd.h>
+
 #include <directfb.h>
 #include <directfb_util.h>
 
@@ -39,6 +45,7 @@
 #include <direct/mem.h>
 #include <direct/messages.h>
 #include <direct/signals.h>
+#include <direct/util.h>
 
 #include <direct/String.h>
 
@@ -52,6 +59,8 @@
 #include <core/surface_pool.h>
 #include <core/surface_pool_bridge.h>
 
+#include <core/Task.h>
+
 
 #if FUSION_BUILD_MULTI
 extern SurfacePoolFuncs sharedSurfacePoolFuncs;
@@ -71,6 +80,198 @@ DFB_CORE_PART( surface_core, SurfaceCore );
 
 /**********************************************************************************************************************/
 
+typedef struct {
+     DirectLink       link;
+
+     int              fence;
+     DFB_SurfaceTask *task;
+} FenceWait;
+
+static void *
+fence_thread_main( DirectThread *thread,
+                   void         *arg )
+{
+     DFBSurfaceCore *data = arg;
+     FenceWait      *wait, *next;
+
+     D_DEBUG_AT( Core_Surface, "%s()\n", __FUNCTION__ );
+
+     while (true) {
+          int i;
+          int num;
+
+          direct_mutex_lock( &data->fence_lock );
+
+          if (data->fence_stop) {
+               direct_mutex_unlock( &data->fence_lock );
+               break;
+          }
+
+          num = 1 + direct_list_count_elements_EXPENSIVE( data->fence_waits );
+
+          {
+               struct pollfd fds[num];
+
+               fds[0].fd     = data->fence_wakeup;
+               fds[0].events = POLLIN;
+
+               i = 1;
+
+               direct_list_foreach (wait, data->fence_waits) {
+                    fds[i].fd     = wait->fence;
+                    fds[i].events = POLLIN;
+
+                    i++;
+               }
+
+               direct_mutex_unlock( &data->fence_lock );
+
+               if (poll( fds, num, -1 ) < 0) {
+                    if (errno == EINTR)
+                         continue;
+
+                    D_PERROR( "Core/Surface: Polling fences failed!\n" );
+                    break;
+               }
+
+               if (fds[0].revents) {
+                    eventfd_t value;
+
+                    eventfd_read( data->fence_wakeup, &value );
+               }
+
+               direct_mutex_lock( &data->fence_lock );
+
+               /* New waits are only appended, the ones polled are still in front. */
+               i = 1;
+
+               direct_list_foreach_safe (wait, next, data->fence_waits) {
+                    if (i == num)
+                         break;
+
+                    if (fds[i++].revents) {
+                         D_DEBUG_AT( Core_Surface, "  -> fence %d signalled, task %p done\n", wait->fence, wait->task );
+
+                         direct_list_remove( &data->fence_waits, &wait->link );
+
+                         Task_Done( wait->task );
+
+                         close( wait->fence );
+
+                         D_FREE( wait );
+                    }
+               }
+
+               direct_mutex_unlock( &data->fence_lock );
+          }
+     }
+
+     return NULL;
+}
+
+static void
+fence_init( DFBSurfaceCore *data )
+{
+     direct_mutex_init( &data->fence_lock );
+
+     data->fence_waits  = NULL;
+     data->fence_thread = NULL;
+     data->fence_wakeup = -1;
+     data->fence_stop   = false;
+}
+
+static void
+fence_deinit( DFBSurfaceCore *data )
+{
+     FenceWait *wait, *next;
+
+     direct_mutex_lock( &data->fence_lock );
+
+     data->fence_stop = true;
+
+     direct_mutex_unlock( &data->fence_lock );
+
+     if (data->fence_thread) {
+          eventfd_write( data->fence_wakeup, 1 );
+
+          direct_thread_join( data->fence_thread );
+          direct_thread_destroy( data->fence_thread );
+     }
+
+     /* Don't keep tasks blocked when fences are never signalled. */
+     direct_list_foreach_safe (wait, next, data->fence_waits) {
+          Task_Done( wait->task );
+
+          close( wait->fence );
+
+          D_FREE( wait );
+     }
+
+     if (data->fence_wakeup >= 0)
+          close( data->fence_wakeup );
+
+     direct_mutex_deinit( &data->fence_lock );
+}
+
+DFBResult
+dfb_surface_core_wait_fence( DFBSurfaceCore  *data,
+                             int              fence,
+                             DFB_SurfaceTask *task )
+{
+     DFBResult  ret;
+     FenceWait *wait;
+
+     D_DEBUG_AT( Core_Surface, "%s( %p, %d, %p )\n", __FUNCTION__, data, fence, task );
+
+     D_MAGIC_ASSERT( data, DFBSurfaceCore );
+     D_ASSERT( fence >= 0 );
+     D_ASSERT( task != NULL );
+
+     wait = D_CALLOC( 1, sizeof(FenceWait) );
+     if (!wait)
+          return D_OOM();
+
+     wait->fence = fence;
+     wait->task  = task;
+
+     direct_mutex_lock( &data->fence_lock );
+
+     if (!data->fence_thread) {
+          data->fence_wakeup = eventfd( 0, EFD_CLOEXEC );
+          if (data->fence_wakeup < 0) {
+               ret = errno2result( errno );
+               D_DERROR( ret, "Core/Surface: Could not create eventfd!\n" );
+               goto error;
+          }
+
+          data->fence_thread = direct_thread_create( DTT_DEFAULT, fence_thread_main, data, "Surface Fence" );
+          if (!data->fence_thread) {
+               ret = DFB_INIT;
+               close( data->fence_wakeup );
+               data->fence_wakeup = -1;
+               goto error;
+          }
+     }
+
+     direct_list_append( &data->fence_waits, &wait->link );
+
+     direct_mutex_unlock( &data->fence_lock );
+
+     eventfd_write( data->fence_wakeup, 1 );
+
+     return DFB_OK;
+
+
+error:
+     direct_mutex_unlock( &data->fence_lock );
+
+     D_FREE( wait );
+
+     return ret;
+}
+
+/**********************************************************************************************************************/
+
 static DFBEnumerationResult
 alloc_callback( CoreSurfaceAllocation *alloc,
                 void                  *ctx )
@@ -272,6 +473,8 @@ dfb_surface_core_initialize( CoreDFB              *core,
           return ret;
      }
 
+     fence_init( data );
+
      D_MAGIC_SET( data, DFBSurfaceCore );
      D_MAGIC_SET( shared, DFBSurfaceCoreShared );
 
@@ -315,6 +518,8 @@ dfb_surface_core_join( CoreDFB              *core,
           return ret;
      }
 
+     fence_init( data );
+
      D_MAGIC_SET( data, DFBSurfaceCore );
 
      return DFB_OK;
@@ -333,6 +538,8 @@ dfb_surface_core_shutdown( DFBSurfaceCore *data,
 
      shared = data->shared;
 
+     fence_deinit( data );
+
      direct_signal_handler_remove( data->dump_signal_handler );
 
      dfb_surface_pool_bridge_destroy( shared->prealloc_pool_bridge );
@@ -364,6 +571,8 @@ dfb_surface_core_leave( DFBSurfaceCore *data,
 
      shared = data->shared;
 
+     fence_deinit( data );
+
      direct_signal_handler_remove( data->dump_signal_handler );
 
      dfb_surface_pool_bridge_leave( shared->prealloc_pool_bridge );
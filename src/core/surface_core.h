@@ -33,6 +33,10 @@
 #ifndef __CORE__SURFACE_CORE_H__
 #define __CORE__SURFACE_CORE_H__
 
+#include <direct/list.h>
+#include <direct/os/mutex.h>
+#include <direct/thread.h>
+
 #include <core/coretypes.h>
 
 typedef struct {
@@ -52,7 +56,21 @@ typedef struct {
      DFBSurfaceCoreShared  *shared;
 
      DirectSignalHandler   *dump_signal_handler;
+
+     DirectMutex            fence_lock;
+     DirectLink            *fence_waits;          /* Tasks waiting for fences passed to dfb_surface_unlock_buffer_fenced(). */
+     DirectThread          *fence_thread;         /* Started on demand. */
+     int                    fence_wakeup;
+     bool                   fence_stop;
 } DFBSurfaceCore;
 
+
+/*
+ * Finishes the task once the fence becomes readable, taking ownership of the fence.
+ */
+DFBResult dfb_surface_core_wait_fence( DFBSurfaceCore  *data,
+                                       int              fence,
+                                       DFB_SurfaceTask *task );
+
 #endif
 
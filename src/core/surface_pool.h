@@ -50,7 +50,9 @@ typedef enum {
      CSPCAPS_READ        = 0x00000004,  /* pool provides Read() function (set automatically) */
      CSPCAPS_WRITE       = 0x00000008,  /* pool provides Write() function (set automatically) */
 
-     CSPCAPS_ALL         = 0x0000000F
+     CSPCAPS_CAPACITY    = 0x00000010,  /* pool allocates config.min_size if larger, allocations can be resized in place */
+
+     CSPCAPS_ALL         = 0x0000001F
 } CoreSurfacePoolCapabilities;
 
 typedef enum {
@@ -70,6 +70,8 @@
 
 #include <gfx/convert.h>
 
+#include <misc/capture.h>
+
 #include <display/idirectfbsurface.h>
 #endif
 
@@ -259,6 +261,9 @@ DirectFBCreate( IDirectFB **interface_ptr )
           return ret;
      }
 
+     if (dfb_config->capture)
+          dfb_capture_start( dfb );
+
      D_DEBUG_AT( DirectFB_Main, "  -> Done\n" );
 
      *interface_ptr = dfb;
@@ -597,12 +597,15 @@ IDirectFBSurface_Lock( IDirectFBSurface *thiz,
      if (allocation) {
           D_DEBUG_AT( Surface, "  -> having allocation %s\n", ToString_CoreSurfaceAllocation(allocation) );
 
+          /* Writing needs to be prelocked if the content is lent to or shared with duplicates. */
           if (!allocation->buffer ||
-              !direct_serial_check( &allocation->serial, &allocation->buffer->serial ))
+              !direct_serial_check( &allocation->serial, &allocation->buffer->serial ) ||
+              (access & CSAF_WRITE && (allocation->flags & CSALF_COW_LENT ||
+                                       !fusion_vector_is_empty( &data->surface->cow_clones ))))
           {
                D_DEBUG_AT( Surface, "  -> outdated!\n" );
 
-               dfb_surface_allocation_ref( allocation );
+               dfb_surface_allocation_unref( allocation );
 
                data->allocations[index] = allocation = NULL;
           }
@@ -616,14 +619,18 @@ IDirectFBSurface_Lock( IDirectFBSurface *thiz,
           if (ret)
                return ret;
 
-          data->allocations[index] = allocation;
+          /* Allocations of the source read by a duplicate are not kept, the reference is used for the lock. */
+          if (allocation->surface == data->surface)
+               data->allocations[index] = allocation;
      }
 
-     ret = dfb_surface_allocation_ref( allocation );
-     if (ret) {
-          D_DERROR( ret, "IDirectFBSurface: Ref'ing allocation failed! [%s]\n",
-                    allocation->pool->desc.name );
-          return ret;
+     if (data->allocations[index] == allocation) {
+          ret = dfb_surface_allocation_ref( allocation );
+          if (ret) {
+               D_DERROR( ret, "IDirectFBSurface: Ref'ing allocation failed! [%s]\n",
+                         allocation->pool->desc.name );
+               return ret;
+          }
      }
 
      /* Lock the allocation. */
@@ -3865,6 +3872,155 @@ IDirectFBSurface_Flush( IDirectFBSurface     *thiz,
      return DFB_OK;
 }
 
+static DFBResult
+IDirectFBSurface_GetBufferAge( IDirectFBSurface *thiz,
+                               unsigned int     *ret_age )
+{
+     DFBResult  ret;
+     u32        age;
+
+     DIRECT_INTERFACE_GET_DATA(IDirectFBSurface)
+
+     D_DEBUG_AT( Surface, "%s( %p )\n", __FUNCTION__, thiz );
+
+     if (!data->surface)
+          return DFB_DESTROYED;
+
+     if (!ret_age)
+          return DFB_INVARG;
+
+     ret = CoreSurface_GetBufferAge( data->surface, CSBR_BACK, data->state.to_eye,
+                                     data->state.destination_flip_count_used ?
+                                     data->state.destination_flip_count : data->surface->flips, &age );
+     if (ret)
+          return ret;
+
+     D_DEBUG_AT( Surface, "  -> age %u\n", age );
+
+     *ret_age = age;
+
+     return DFB_OK;
+}
+
+static DFBResult
+IDirectFBSurface_Duplicate( IDirectFBSurface  *thiz,
+                            IDirectFBSurface **ret_interface )
+{
+     DFBResult         ret;
+     CoreSurface      *surface;
+     IDirectFBSurface *iface;
+
+     DIRECT_INTERFACE_GET_DATA(IDirectFBSurface)
+
+     D_DEBUG_AT( Surface, "%s( %p )\n", __FUNCTION__, thiz );
+
+     if (!data->surface)
+          return DFB_DESTROYED;
+
+     if (!ret_interface)
+          return DFB_INVARG;
+
+     if (data->caps & DSCAPS_SUBSURFACE)
+          return DFB_UNSUPPORTED;
+
+     /* Let pending drawing end up in the copy. */
+     CoreGraphicsStateClient_Flush( &data->state_client, 0, CGSCFF_NONE );
+
+     ret = CoreSurface_Duplicate( data->surface, &surface );
+     if (ret)
+          return ret;
+
+     DIRECT_ALLOCATE_INTERFACE( iface, IDirectFBSurface );
+
+     ret = IDirectFBSurface_Construct( iface, NULL, NULL, NULL, NULL, surface,
+                                       surface->config.caps, data->core, data->idirectfb );
+
+     dfb_surface_unref( surface );
+
+     if (ret)
+          return ret;
+
+     *ret_interface = iface;
+
+     return DFB_OK;
+}
+
+static DFBResult
+IDirectFBSurface_LockFenced( IDirectFBSurface     *thiz,
+                             DFBSurfaceLockFlags   flags,
+                             void                **ret_ptr,
+                             int                  *ret_pitch,
+                             int                  *ret_fence )
+{
+     DFBResult              ret;
+     CoreSurfaceBufferRole  role   = CSBR_FRONT;
+     CoreSurfaceAccessFlags access = CSAF_NONE;
+
+     DIRECT_INTERFACE_GET_DATA(IDirectFBSurface)
+
+     D_DEBUG_AT( Surface, "%s( %p )\n", __FUNCTION__, thiz );
+
+     if (!data->surface)
+          return DFB_DESTROYED;
+
+     if (data->locked)
+          return DFB_LOCKED;
+
+     if (!flags || !ret_ptr || !ret_pitch || !ret_fence)
+          return DFB_INVARG;
+
+     if (!data->area.current.w || !data->area.current.h)
+          return DFB_INVAREA;
+
+     if (flags & DSLF_READ)
+          access |= CSAF_READ;
+
+     if (flags & DSLF_WRITE) {
+          access |= CSAF_WRITE;
+          role = CSBR_BACK;
+     }
+
+     CoreGraphicsStateClient_FlushCurrent( 0, CGSCFF_NONE );
+
+     ret = dfb_surface_lock_buffer_fenced( data->surface, role, data->local_flip_count, data->src_eye,
+                                           CSAID_CPU, access, &data->lock, ret_fence );
+     if (ret) {
+          D_DERROR( ret, "IDirectFBSurface: Locking surface failed!\n" );
+          return ret;
+     }
+
+     D_DEBUG_AT( Surface, "  -> fence %d\n", *ret_fence );
+
+     data->locked = true;
+
+     *ret_ptr   = data->lock.addr + data->lock.pitch * data->area.current.y +
+                  DFB_BYTES_PER_LINE( data->surface->config.format, data->area.current.x );
+     *ret_pitch = data->lock.pitch;
+
+     return DFB_OK;
+}
+
+static DFBResult
+IDirectFBSurface_UnlockFenced( IDirectFBSurface *thiz,
+                               int               fence )
+{
+     DIRECT_INTERFACE_GET_DATA(IDirectFBSurface)
+
+     D_DEBUG_AT( Surface, "%s( %p, %d )\n", __FUNCTION__, thiz, fence );
+
+     if (!data->surface)
+          return DFB_DESTROYED;
+
+     if (!data->locked)
+          return DFB_ACCESSDENIED;
+
+     dfb_surface_unlock_buffer_fenced( data->surface, &data->lock, fence );
+
+     data->locked = false;
+
+     return DFB_OK;
+}
+
 /******/
 
 DFBResult IDirectFBSurface_Construct( IDirectFBSurface       *thiz,
@@ -4103,6 +4259,13 @@ DFBResult IDirectFBSurface_Construct( IDirectFBSurface       *thiz,
 
      thiz->Flush          = IDirectFBSurface_Flush;
 
+     thiz->GetBufferAge   = IDirectFBSurface_GetBufferAge;
+
+     thiz->Duplicate      = IDirectFBSurface_Duplicate;
+
+     thiz->LockFenced     = IDirectFBSurface_LockFenced;
+     thiz->UnlockFenced   = IDirectFBSurface_UnlockFenced;
+
      dfb_surface_attach( surface,
                          IDirectFBSurface_listener, thiz, &data->reaction );
 
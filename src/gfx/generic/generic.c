@@ -8817,10 +8817,10 @@ gAcquireLockBuffers( CardState *state, DFBAccelerationMask accel )
      else if (state->drawingflags & (DSDRAW_BLEND | DSDRAW_DST_COLORKEY))
           access |= CSAF_READ;
 
-     /* Lock destination */
-     ret = dfb_surface_lock_buffer2( destination, state->to, destination->flips,
+     /* Lock destination, nothing outside the clip gets written */
+     ret = dfb_surface_lock_buffer3( destination, state->to, destination->flips,
                                      state->to_eye,
-                                     CSAID_CPU, access, &state->dst );
+                                     CSAID_CPU, access, &state->clip, &state->dst );
      if (ret) {
           D_DERROR( ret, "DirectFB/Genefx: Could not lock destination!\n" );
           return ret;
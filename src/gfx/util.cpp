@@ -42,6 +42,8 @@ extern "C" {
 #include <direct/util.h>
 
 #include <core/state.h>
+#include <core/surface.h>
+#include <core/surface_buffer.h>
 
 #include <gfx/util.h>
 
@@ -415,6 +417,92 @@ dfb_gfx_copy_regions_client( CoreSurface             *source,
 
 /*********************************************************************************************************************/
 
+/*
+ * Returns the parts of the update rectangle which differ between back and front buffer,
+ * i.e. the parts written to any of them since the last copy, resetting the damage where
+ * it will be covered by the copy. Returns false if the whole rectangle needs to be copied.
+ */
+static bool
+back_to_front_damage( CoreSurface         *surface,
+                      DFBSurfaceStereoEye  eye,
+                      const DFBRectangle  *rect,
+                      DFBRectangle        *ret_rects,
+                      int                 *ret_num )
+{
+     int                n;
+     DFBRegion          update = DFB_REGION_INIT_FROM_RECTANGLE( rect );
+     DFBRegion          regions[CORE_SURFACE_DAMAGE_REGIONS];
+     DFBUpdates         updates;
+     CoreSurfaceBuffer *back;
+     CoreSurfaceBuffer *front;
+
+     if (dfb_surface_lock( surface ))
+          return false;
+
+     if (surface->num_buffers < 2) {
+          dfb_surface_unlock( surface );
+          return false;
+     }
+
+     back  = dfb_surface_get_buffer3( surface, CSBR_BACK,  eye, surface->flips );
+     front = dfb_surface_get_buffer3( surface, CSBR_FRONT, eye, surface->flips );
+
+     D_MAGIC_ASSERT( back, CoreSurfaceBuffer );
+     D_MAGIC_ASSERT( front, CoreSurfaceBuffer );
+
+     dfb_updates_init( &updates, regions, D_ARRAY_SIZE(regions) );
+
+     for (n=0; n<back->damage.num_regions; n++) {
+          DFBRegion region = back->damage.regions[n];
+
+          if (dfb_region_region_intersect( &region, &update ))
+               dfb_updates_add( &updates, &region );
+     }
+
+     for (n=0; n<front->damage.num_regions; n++) {
+          DFBRegion region = front->damage.regions[n];
+
+          if (dfb_region_region_intersect( &region, &update ))
+               dfb_updates_add( &updates, &region );
+     }
+
+     /* Back buffer is going to be in sync with the front buffer unless written outside of the update. */
+     if (!back->damage.num_regions || dfb_region_region_extends( &update, &back->damage.bounding ))
+          dfb_updates_reset( &back->damage );
+
+     dfb_surface_unlock( surface );
+
+     dfb_updates_get_rectangles( &updates, ret_rects, ret_num );
+     dfb_updates_deinit( &updates );
+
+     return true;
+}
+
+/*
+ * Resets the front buffer damage after a copy if it has only been written within the copied area.
+ */
+static void
+back_to_front_done( CoreSurface         *surface,
+                    DFBSurfaceStereoEye  eye,
+                    const DFBRegion     *copied )
+{
+     CoreSurfaceBuffer *front;
+
+     if (dfb_surface_lock( surface ))
+          return;
+
+     if (surface->num_buffers > 1) {
+          front = dfb_surface_get_buffer3( surface, CSBR_FRONT, eye, surface->flips );
+
+          D_MAGIC_ASSERT( front, CoreSurfaceBuffer );
+
+          if (!front->damage.num_regions || dfb_region_region_extends( copied, &front->damage.bounding ))
+               dfb_updates_reset( &front->damage );
+     }
+
+     dfb_surface_unlock( surface );
+}
+
 static void
 back_to_front_copy( CoreSurface             *surface,
                     DFBSurfaceStereoEye      eye,
@@ -422,8 +510,14 @@ back_to_front_copy( CoreSurface             *surface,
                     DFBSurfaceBlittingFlags  flags,
                     int                      rotation)
 {
+     int           i;
+     int           num     = 0;
+     bool          damaged = false;
      DFBRectangle  rect;
      DFBPoint      point;
+     DFBRectangle  rects[CORE_SURFACE_DAMAGE_REGIONS];
+     DFBPoint      points[CORE_SURFACE_DAMAGE_REGIONS];
+     DFBRegion     clip;
      StateClient  *client = StateClient::Get();
 
 
@@ -461,11 +555,33 @@ back_to_front_copy( CoreSurface             *surface,
 
           D_FLAGS_SET( flags, DSBLIT_ROTATE270 );
      }
+     else
+          /* Only copy the parts being damaged in the back or front buffer. */
+          damaged = back_to_front_damage( surface, eye, &rect, rects, &num );
 
      D_FLAGS_SET( client->state.modified, SMF_CLIP | SMF_SOURCE | SMF_DESTINATION | SMF_FROM | SMF_TO );
 
-     client->state.clip.x2       = surface->config.size.w - 1;
-     client->state.clip.y2       = surface->config.size.h - 1;
+     if (num) {
+          clip = DFB_REGION_INIT_FROM_RECTANGLE( &rects[0] );
+
+          for (i=0; i<num; i++) {
+               DFBRegion damage = DFB_REGION_INIT_FROM_RECTANGLE( &rects[i] );
+
+               dfb_region_region_union( &clip, &damage );
+
+               points[i].x = rects[i].x;
+               points[i].y = rects[i].y;
+          }
+     }
+     else {
+          clip.x1 = 0;
+          clip.y1 = 0;
+          clip.x2 = surface->config.size.w - 1;
+          clip.y2 = surface->config.size.h - 1;
+     }
+
+     /* Limit the clip which is taken as the damage being written. */
+     client->state.clip          = clip;
      client->state.source        = surface;
      client->state.destination   = surface;
      client->state.from          = CSBR_BACK;
@@ -474,13 +590,23 @@ back_to_front_copy( CoreSurface             *surface,
      client->state.to_eye        = eye;
      client->state.blittingflags = flags;
 
-     CoreGraphicsStateClient_Blit( &client->client, &rect, &point, 1 );
+     if (damaged) {
+          if (num)
+               CoreGraphicsStateClient_Blit( &client->client, rects, points, num );
+     }
+     else
+          CoreGraphicsStateClient_Blit( &client->client, &rect, &point, 1 );
 
      CoreGraphicsStateClient_Flush( &client->client, 0, CGSCFF_FOLLOW_READER );
 
+     if (damaged && num)
+          back_to_front_done( surface, eye, &clip );
+
      /* Signal end of sequence. */
      dfb_state_stop_drawing( &client->state );
 
+     client->state.clip.x1     = 0;
+     client->state.clip.y1     = 0;
      client->state.destination = NULL;
      client->state.source      = NULL;
 }
@@ -273,3 +273,20 @@ IDirectFBDataBuffer_Construct( IDirectFBDataBuffer *thiz,
      return DFB_OK;
 }
 
+DFBResult
+IDirectFBDataBuffer_Borrow( IDirectFBDataBuffer  *thiz,
+                            unsigned int          length,
+                            const void          **ret_ptr,
+                            unsigned int         *ret_length )
+{
+     DIRECT_INTERFACE_GET_DATA(IDirectFBDataBuffer)
+
+     if (!length || !ret_ptr)
+          return DFB_INVARG;
+
+     if (!data->Borrow)
+          return DFB_UNSUPPORTED;
+
+     return data->Borrow( thiz, length, ret_ptr, ret_length );
+}
+
@@ -50,6 +50,12 @@ typedef struct {
      bool         is_memory;
 
      FusionCall   call;       /* for remote access */
+
+     /* optional, see IDirectFBDataBuffer_Borrow() */
+     DFBResult  (*Borrow)( IDirectFBDataBuffer  *thiz,
+                           unsigned int          length,
+                           const void          **ret_ptr,
+                           unsigned int         *ret_length );
 } IDirectFBDataBuffer_data;
 
 /*
@@ -90,6 +96,18 @@ DFBResult IDirectFBDataBuffer_Construct( IDirectFBDataBuffer *thiz,
  */
 void IDirectFBDataBuffer_Destruct( IDirectFBDataBuffer *thiz );
 
+/*
+ * Like GetData(), but returns a pointer into the buffer instead of copying the data.
+ *
+ * Supported by memory buffers and memory mapped files, others return DFB_UNSUPPORTED
+ * and the data has to be fetched via GetData(). The pointer stays valid as long as
+ * the data buffer exists.
+ */
+DFBResult IDirectFBDataBuffer_Borrow( IDirectFBDataBuffer  *thiz,
+                                      unsigned int          length,
+                                      const void          **ret_ptr,
+                                      unsigned int         *ret_length );
+
 /*
  * generic streamed data buffer
  */
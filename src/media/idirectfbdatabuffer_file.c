@@ -239,6 +239,31 @@ IDirectFBDataBuffer_File_PeekData( IDirectFBDataBuffer *thiz,
      return ret;
 }
 
+static DFBResult
+IDirectFBDataBuffer_File_Borrow( IDirectFBDataBuffer  *thiz,
+                                 unsigned int          length,
+                                 const void          **ret_ptr,
+                                 unsigned int         *ret_length )
+{
+     DFBResult    ret;
+     unsigned int size;
+
+     DIRECT_INTERFACE_GET_DATA(IDirectFBDataBuffer_File)
+
+     direct_mutex_lock( &data->mutex );
+
+     ret = direct_stream_borrow( data->stream, length, 0, ret_ptr, &size );
+     if (ret == DFB_OK)
+          ret = direct_stream_seek( data->stream, direct_stream_offset( data->stream ) + size );
+
+     direct_mutex_unlock( &data->mutex );
+
+     if (ret == DFB_OK && ret_length)
+          *ret_length = size;
+
+     return ret;
+}
+
 static DFBResult
 IDirectFBDataBuffer_File_HasData( IDirectFBDataBuffer *thiz )
 {
@@ -279,6 +304,8 @@ IDirectFBDataBuffer_File_Construct( IDirectFBDataBuffer *thiz,
 
      direct_mutex_init( &data->mutex );
 
+     data->base.Borrow = IDirectFBDataBuffer_File_Borrow;
+
      thiz->Release                = IDirectFBDataBuffer_File_Release;
      thiz->Flush                  = IDirectFBDataBuffer_File_Flush;
      thiz->Finish                 = IDirectFBDataBuffer_File_Finish;
@@ -176,6 +176,31 @@ IDirectFBDataBuffer_Memory_GetData( IDirectFBDataBuffer *thiz,
      return DFB_OK;
 }
 
+static DFBResult
+IDirectFBDataBuffer_Memory_Borrow( IDirectFBDataBuffer  *thiz,
+                                   unsigned int          length,
+                                   const void          **ret_ptr,
+                                   unsigned int         *ret_length )
+{
+     unsigned int size;
+
+     DIRECT_INTERFACE_GET_DATA(IDirectFBDataBuffer_Memory)
+
+     if (data->pos >= data->length)
+          return DFB_EOF;
+
+     size = MIN( length, data->length - data->pos );
+
+     *ret_ptr = (const char*) data->buffer + data->pos;
+
+     data->pos += size;
+
+     if (ret_length)
+          *ret_length = size;
+
+     return DFB_OK;
+}
+
 static DFBResult
 IDirectFBDataBuffer_Memory_PeekData( IDirectFBDataBuffer *thiz,
                                      unsigned int         length,
@@ -241,6 +266,7 @@ IDirectFBDataBuffer_Memory_Construct( IDirectFBDataBuffer *thiz,
      data->length = length;
 
      data->base.is_memory = true;
+     data->base.Borrow    = IDirectFBDataBuffer_Memory_Borrow;
 
      thiz->Release                = IDirectFBDataBuffer_Memory_Release;
      thiz->Flush                  = IDirectFBDataBuffer_Memory_Flush;
@@ -0,0 +1,1830 @@
+/*
+   (c) Copyright 2012-2013  DirectFB integrated media GmbH
+   (c) Copyright 2001-2013  The world wide DirectFB Open Source Community (directfb.org)
+   (c) Copyright 2000-2004  Convergence (integrated media) GmbH
+
+   All rights reserved.
+
+   Written by Denis Oliver Kropp <dok@directfb.org>,
+              Andreas Shimokawa <andi@directfb.org>,
+              Marek Pikarski <mass@directfb.org>,
+              Sven Neumann <neo@directfb.org>,
+              Ville Syrjälä <syrjala@sci.fi> and
+              Claudio Ciccani <klan@users.sf.net>.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the
+   Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+   Boston, MA 02111-1307, USA.
+*/
+
+
+
+//#define DIRECT_ENABLE_DEBUG
+
+#include <config.h>
+
+#include <fcntl.h>
+#include <string.h>
+
+#include <directfb.h>
+#include <directfb_util.h>
+#include <directfb_version.h>
+
+#include <direct/debug.h>
+#include <direct/direct.h>
+#include <direct/filesystem.h>
+#include <direct/hash.h>
+#include <direct/mem.h>
+#include <direct/memcpy.h>
+#include <direct/messages.h>
+#include <direct/thread.h>
+#include <direct/util.h>
+
+#include <fusion/wire.h>
+
+#include <gfx/convert.h>
+
+#include <misc/capture.h>
+#include <misc/conf.h>
+
+
+D_DEBUG_DOMAIN( DirectFB_Capture, "DirectFB/Capture", "DirectFB API Capture" );
+
+/**********************************************************************************************************************/
+
+#define CAPTURE_BUFFER_SIZE   0x40000
+
+#define CAPTURE_SCALAR        16
+#define CAPTURE_ARRAY(bytes)  (FUSION_WIRE_ALIGN + FUSION_WIRE_ALIGNED( bytes ))
+
+typedef struct {
+     int                      magic;
+
+     void                    *iface;
+     u32                      id;
+     DFBCaptureInterface      type;
+
+     int                      refs;          /* Tracked references, informational as internal ones are unknown */
+
+     DFBSurfaceLockFlags      lock_flags;
+     void                    *lock_ptr;
+     int                      lock_pitch;
+
+     /* Functions of the instance before patching */
+     union {
+          IAny                    any;
+          IDirectFB               dfb;
+          IDirectFBDisplayLayer   layer;
+          IDirectFBWindow         window;
+          IDirectFBSurface        surface;
+          IDirectFBFont           font;
+          IDirectFBImageProvider  provider;
+     } orig;
+} CaptureObject;
+
+typedef struct {
+     FusionWireEncoder        encoder;
+     u8                      *allocated;     /* Message larger than the write buffer */
+} CaptureCall;
+
+static struct {
+     bool                     active;
+
+     DirectMutex              lock;
+     DirectTLS                depth;         /* Nesting of wrapped calls, only the outermost ones are recorded */
+
+     DirectFile               file;
+     u8                      *buffer;
+     unsigned int             length;
+
+     DirectHash               objects;
+     u32                      next_id;
+
+     DirectCleanupHandler    *cleanup;
+} capture;
+
+/**********************************************************************************************************************/
+
+static void
+capture_flush( void )
+{
+     DirectResult ret;
+     size_t       written;
+
+     if (!capture.length)
+          return;
+
+     ret = direct_file_write( &capture.file, capture.buffer, capture.length, &written );
+     if (ret || written != capture.length)
+          D_DERROR( ret, "DirectFB/Capture: Could not write %u bytes!\n", capture.length );
+
+     capture.length = 0;
+}
+
+static CaptureObject *
+capture_enter( void *iface )
+{
+     CaptureObject *object;
+     long           depth;
+
+     direct_mutex_lock( &capture.lock );
+
+     object = direct_hash_lookup( &capture.objects, (unsigned long) iface );
+
+     direct_mutex_unlock( &capture.lock );
+
+     D_MAGIC_ASSERT( object, CaptureObject );
+
+     depth = (long) direct_tls_get( capture.depth );
+
+     direct_tls_set( capture.depth, (void*)(depth + 1) );
+
+     return object;
+}
+
+static bool
+capture_leave( void )
+{
+     long depth = (long) direct_tls_get( capture.depth ) - 1;
+
+     D_ASSERT( depth >= 0 );
+
+     direct_tls_set( capture.depth, (void*) depth );
+
+     return depth == 0;
+}
+
+/*
+ * Starts a message of at most 'size' bytes of items, holding the lock until capture_end().
+ */
+static bool
+capture_begin( CaptureCall      *call,
+               CaptureObject    *object,
+               DFBCaptureMethod  method,
+               unsigned int      size )
+{
+     void *buffer;
+
+     direct_mutex_lock( &capture.lock );
+
+     if (!capture.active) {
+          direct_mutex_unlock( &capture.lock );
+          return false;
+     }
+
+     size += sizeof(FusionWireHeader);
+
+     if (capture.length + size > CAPTURE_BUFFER_SIZE)
+          capture_flush();
+
+     if (size > CAPTURE_BUFFER_SIZE) {
+          call->allocated = D_MALLOC( size );
+          if (!call->allocated) {
+               D_OOM();
+               direct_mutex_unlock( &capture.lock );
+               return false;
+          }
+
+          buffer = call->allocated;
+     }
+     else {
+          call->allocated = NULL;
+
+          buffer = capture.buffer + capture.length;
+     }
+
+     fusion_wire_encode_init( &call->encoder, buffer, size, object->type, method, FWMF_NONE );
+
+     call->encoder.header->object_id = object->id;
+
+     return true;
+}
+
+static void
+capture_end( CaptureCall *call )
+{
+     unsigned int length;
+
+     fusion_wire_encode_finish( &call->encoder, &length );
+
+     if (call->allocated) {
+          size_t written;
+
+          direct_file_write( &capture.file, call->allocated, length, &written );
+
+          D_FREE( call->allocated );
+     }
+     else
+          capture.length += length;
+
+     direct_mutex_unlock( &capture.lock );
+}
+
+static void
+capture_record( CaptureObject    *object,
+                DFBCaptureMethod  method )
+{
+     CaptureCall call;
+
+     if (capture_begin( &call, object, method, 0 ))
+          capture_end( &call );
+}
+
+static void
+capture_record_u32( CaptureObject    *object,
+                    DFBCaptureMethod  method,
+                    u32               value )
+{
+     CaptureCall call;
+
+     if (capture_begin( &call, object, method, CAPTURE_SCALAR )) {
+          fusion_wire_encode_u32( &call.encoder, value );
+
+          capture_end( &call );
+     }
+}
+
+static void
+capture_record_s32s( CaptureObject    *object,
+                     DFBCaptureMethod  method,
+                     s32               a,
+                     s32               b )
+{
+     CaptureCall call;
+
+     if (capture_begin( &call, object, method, 2 * CAPTURE_SCALAR )) {
+          fusion_wire_encode_s32( &call.encoder, a );
+          fusion_wire_encode_s32( &call.encoder, b );
+
+          capture_end( &call );
+     }
+}
+
+/* Optional argument as an array of zero or one element. */
+static void
+capture_encode_optional( CaptureCall  *call,
+                         const void   *value,
+                         unsigned int  size )
+{
+     fusion_wire_encode_array( &call->encoder, value, size, value ? 1 : 0 );
+}
+
+static u32
+capture_object_id( void *iface )
+{
+     CaptureObject *object;
+
+     if (!iface)
+          return 0;
+
+     direct_mutex_lock( &capture.lock );
+
+     object = direct_hash_lookup( &capture.objects, (unsigned long) iface );
+
+     direct_mutex_unlock( &capture.lock );
+
+     if (!object) {
+          D_ONCE( "interface not created via captured calls, calls using it are not replayable" );
+          return 0;
+     }
+
+     return object->id;
+}
+
+/**********************************************************************************************************************/
+
+/*
+ * Records the pixels of a surface area, using the lock of the application if it has one.
+ */
+static void
+capture_contents( CaptureObject      *object,
+                  const DFBRectangle *rect )
+{
+     IDirectFBSurface      *surface = object->iface;
+     DFBRectangle           area    = { 0, 0, 0, 0 };
+     DFBSurfacePixelFormat  format;
+     CaptureCall            call;
+     u8                    *src;
+     u8                    *dst;
+     int                    pitch;
+     int                    bytes;
+     int                    y;
+
+     D_MAGIC_ASSERT( object, CaptureObject );
+     D_ASSERT( object->type == DCI_SURFACE );
+
+     object->orig.surface.GetSize( surface, &area.w, &area.h );
+     object->orig.surface.GetPixelFormat( surface, &format );
+
+     if (DFB_PLANAR_PIXELFORMAT( format )) {
+          D_ONCE( "contents of planar surfaces are not captured" );
+          return;
+     }
+
+     if (rect && !dfb_rectangle_intersect( &area, rect ))
+          return;
+
+     if (object->lock_ptr) {
+          src   = object->lock_ptr;
+          pitch = object->lock_pitch;
+     }
+     else if (object->orig.surface.Lock( surface, DSLF_READ, (void**) &src, &pitch ))
+          return;
+
+     bytes = DFB_BYTES_PER_LINE( format, area.w );
+
+     if (capture_begin( &call, object, DCM_SURFACE_CONTENTS,
+                        CAPTURE_ARRAY( sizeof(DFBRectangle) ) + CAPTURE_SCALAR + CAPTURE_ARRAY( bytes * area.h ) ))
+     {
+          fusion_wire_encode_array( &call.encoder, &area, sizeof(DFBRectangle), 1 );
+          fusion_wire_encode_u32( &call.encoder, format );
+          fusion_wire_encode_reserve( &call.encoder, 1, bytes * area.h, (void**) &dst );
+
+          src += area.y * pitch + DFB_BYTES_PER_LINE( format, area.x );
+
+          for (y=0; y<area.h; y++) {
+               direct_memcpy( dst, src, bytes );
+
+               src += pitch;
+               dst += bytes;
+          }
+
+          capture_end( &call );
+     }
+
+     if (!object->lock_ptr)
+          object->orig.surface.Unlock( surface );
+}
+
+/**********************************************************************************************************************/
+
+static CaptureObject *capture_object( void *iface, DFBCaptureInterface type );
+
+#define CAPTURE_REFERENCES( IFACE, Prefix, member )                                       \
+static DirectResult                                                                         \
+Prefix##_AddRef( IFACE *thiz )                                                              \
+{                                                                                           \
+     CaptureObject *object = capture_enter( thiz );                                         \
+     DirectResult   ret;                                                                    \
+                                                                                            \
+     ret = object->orig.member.AddRef( thiz );                                              \
+                                                                                            \
+     object->refs++;                                                                        \
+                                                                                            \
+     if (capture_leave() && object->type != DCI_IMAGEPROVIDER)                              \
+          capture_record( object, DCM_ADDREF );                                             \
+                                                                                            \
+     return ret;                                                                            \
+}                                                                                           \
+                                                                                            \
+static DirectResult                                                                         \
+Prefix##_Release( IFACE *thiz )                                                             \
+{                                                                                           \
+     CaptureObject *object = capture_enter( thiz );                                         \
+     DirectResult   ret;                                                                    \
+                                                                                            \
+     /* The interface may be gone afterwards, the object stays until the address is reused */ \
+     ret = object->orig.member.Release( thiz );                                             \
+                                                                                            \
+     object->refs--;                                                                        \
+                                                                                            \
+     if (capture_leave() && object->type != DCI_IMAGEPROVIDER)                              \
+          capture_record( object, DCM_RELEASE );                                            \
+                                                                                            \
+     return ret;                                                                            \
+}
+
+/**********************************************************************************************************************
+ * IDirectFBSurface
+ */
+
+CAPTURE_REFERENCES( IDirectFBSurface, Surface, surface )
+
+static DFBResult
+Surface_Clear( IDirectFBSurface *thiz,
+               u8 r, u8 g, u8 b, u8 a )
+{
+     CaptureObject *object = capture_enter( thiz );
+     DFBResult      ret;
+
+     ret = object->orig.surface.Clear( thiz, r, g, b, a );
+
+     if (capture_leave())
+          capture_record_u32( object, DCM_SURFACE_CLEAR, PIXEL_ARGB( a, r, g, b ) );
+
+     return ret;
+}
+
+static DFBResult
+Surface_SetColor( IDirectFBSurface *thiz,
+                  u8 r, u8 g, u8 b, u8 a )
+{
+     CaptureObject *object = capture_enter( thiz );
+     DFBResult      ret;
+
+     ret = object->orig.surface.SetColor( thiz, r, g, b, a );
+
+     if (capture_leave())
+          capture_record_u32( object, DCM_SURFACE_SET_COLOR, PIXEL_ARGB( a, r, g, b ) );
+
+     return ret;
+}
+
+static DFBResult
+Surface_SetClip( IDirectFBSurface *thiz,
+                 const DFBRegion  *clip )
+{
+     CaptureObject *object = capture_enter( thiz );
+     CaptureCall    call;
+     DFBResult      ret;
+
+     ret = object->orig.surface.SetClip( thiz, clip );
+
+     if (capture_leave() && capture_begin( &call, object, DCM_SURFACE_SET_CLIP, CAPTURE_ARRAY( sizeof(DFBRegion) ) )) {
+          capture_encode_optional( &call, clip, sizeof(DFBRegion) );
+
+          capture_end( &call );
+     }
+
+     return ret;
+}
+
+static DFBResult
+Surface_SetDrawingFlags( IDirectFBSurface       *thiz,
+                         DFBSurfaceDrawingFlags  flags )
+{
+     CaptureObject *object = capture_enter( thiz );
+     DFBResult      ret;
+
+     ret = object->orig.surface.SetDrawingFlags( thiz, flags );
+
+     if (capture_leave())
+          capture_record_u32( object, DCM_SURFACE_SET_DRAWING_FLAGS, flags );
+
+     return ret;
+}
+
+static DFBResult
+Surface_SetBlittingFlags( IDirectFBSurface        *thiz,
+                          DFBSurfaceBlittingFlags  flags )
+{
+     CaptureObject *object = capture_enter( thiz );
+     DFBResult      ret;
+
+     ret = object->orig.surface.SetBlittingFlags( thiz, flags );
+
+     if (capture_leave())
+          capture_record_u32( object, DCM_SURFACE_SET_BLITTING_FLAGS, flags );
+
+     return ret;
+}
+
+static DFBResult
+Surface_SetPorterDuff( IDirectFBSurface         *thiz,
+                       DFBSurfacePorterDuffRule  rule )
+{
+     CaptureObject *object = capture_enter( thiz );
+     DFBResult      ret;
+
+     ret = object->orig.surface.SetPorterDuff( thiz, rule );
+
+     if (capture_leave())
+          capture_record_u32( object, DCM_SURFACE_SET_PORTER_DUFF, rule );
+
+     return ret;
+}
+
+static DFBResult
+Surface_SetSrcBlendFunction( IDirectFBSurface        *thiz,
+                             DFBSurfaceBlendFunction  function )
+{
+     CaptureObject *object = capture_enter( thiz );
+     DFBResult      ret;
+
+     ret = object->orig.surface.SetSrcBlendFunction( thiz, function );
+
+     if (capture_leave())
+          capture_record_u32( object, DCM_SURFACE_SET_SRC_BLEND_FUNCTION, function );
+
+     return ret;
+}
+
+static DFBResult
+Surface_SetDstBlendFunction( IDirectFBSurface        *thiz,
+                             DFBSurfaceBlendFunction  function )
+{
+     CaptureObject *object = capture_enter( thiz );
+     DFBResult      ret;
+
+     ret = object->orig.surface.SetDstBlendFunction( thiz, function );
+
+     if (capture_leave())
+          capture_record_u32( object, DCM_SURFACE_SET_DST_BLEND_FUNCTION, function );
+
+     return ret;
+}
+
+static DFBResult
+Surface_SetFont( IDirectFBSurface *thiz,
+                 IDirectFBFont    *font )
+{
+     CaptureObject *object = capture_enter( thiz );
+     CaptureCall    call;
+     DFBResult      ret;
+
+     ret = object->orig.surface.SetFont( thiz, font );
+
+     if (capture_leave() && capture_begin( &call, object, DCM_SURFACE_SET_FONT, CAPTURE_SCALAR )) {
+          fusion_wire_encode_object( &call.encoder, capture_object_id( font ) );
+
+          capture_end( &call );
+     }
+
+     return ret;
+}
+
+static DFBResult
+Surface_SetSrcColorKey( IDirectFBSurface *thiz,
+                        u8 r, u8 g, u8 b )
+{
+     CaptureObject *object = capture_enter( thiz );
+     DFBResult      ret;
+
+     ret = object->orig.surface.SetSrcColorKey( thiz, r, g, b );
+
+     if (capture_leave())
+          capture_record_u32( object, DCM_SURFACE_SET_SRC_COLOR_KEY, PIXEL_RGB32( r, g, b ) );
+
+     return ret;
+}
+
+static DFBResult
+Surface_SetDstColorKey( IDirectFBSurface *thiz,
+                        u8 r, u8 g, u8 b )
+{
+     CaptureObject *object = capture_enter( thiz );
+     DFBResult      ret;
+
+     ret = object->orig.surface.SetDstColorKey( thiz, r, g, b );
+
+     if (capture_leave())
+          capture_record_u32( object, DCM_SURFACE_SET_DST_COLOR_KEY, PIXEL_RGB32( r, g, b ) );
+
+     return ret;
+}
+
+static DFBResult
+Surface_SetRenderOptions( IDirectFBSurface        *thiz,
+                          DFBSurfaceRenderOptions  options )
+{
+     CaptureObject *object = capture_enter( thiz );
+     DFBResult      ret;
+
+     ret = object->orig.surface.SetRenderOptions( thiz, options );
+
+     if (capture_leave())
+          capture_record_u32( object, DCM_SURFACE_SET_RENDER_OPTIONS, options );
+
+     return ret;
+}
+
+static DFBResult
+Surface_SetMatrix( IDirectFBSurface *thiz,
+                   const s32        *matrix )
+{
+     CaptureObject *object = capture_enter( thiz );
+     CaptureCall    call;
+     DFBResult      ret;
+
+     ret = object->orig.surface.SetMatrix( thiz, matrix );
+
+     if (capture_leave() && capture_begin( &call, object, DCM_SURFACE_SET_MATRIX, CAPTURE_ARRAY( 9 * sizeof(s32) ) )) {
+          fusion_wire_encode_array( &call.encoder, matrix, sizeof(s32), matrix ? 9 : 0 );
+
+          capture_end( &call );
+     }
+
+     return ret;
+}
+
+static DFBResult
+Surface_SetSourceMask( IDirectFBSurface    *thiz,
+                       IDirectFBSurface    *mask,
+                       int                  x,
+                       int                  y,
+                       DFBSurfaceMaskFlags  flags )
+{
+     CaptureObject *object = capture_enter( thiz );
+     CaptureCall    call;
+     DFBResult      ret;
+
+     ret = object->orig.surface.SetSourceMask( thiz, mask, x, y, flags );
+
+     if (capture_leave() && capture_begin( &call, object, DCM_SURFACE_SET_SOURCE_MASK, 4 * CAPTURE_SCALAR )) {
+          fusion_wire_encode_object( &call.encoder, capture_object_id( mask ) );
+          fusion_wire_encode_s32( &call.encoder, x );
+          fusion_wire_encode_s32( &call.encoder, y );
+          fusion_wire_encode_u32( &call.encoder, flags );
+
+          capture_end( &call );
+     }
+
+     return ret;
+}
+
+static void
+capture_rectangles( CaptureObject      *object,
+                    DFBCaptureMethod    method,
+                    const DFBRectangle *rects,
+                    unsigned int        num )
+{
+     CaptureCall call;
+
+     if (capture_begin( &call, object, method, CAPTURE_ARRAY( sizeof(DFBRectangle) * num ) )) {
+          fusion_wire_encode_array( &call.encoder, rects, sizeof(DFBRectangle), num );
+
+          capture_end( &call );
+     }
+}
+
+static DFBResult
+Surface_FillRectangle( IDirectFBSurface *thiz,
+                       int x, int y, int w, int h )
+{
+     CaptureObject *object = capture_enter( thiz );
+     DFBRectangle   rect   = { x, y, w, h };
+     DFBResult      ret;
+
+     ret = object->orig.surface.FillRectangle( thiz, x, y, w, h );
+
+     if (capture_leave())
+          capture_rectangles( object, DCM_SURFACE_FILL_RECTANGLES, &rect, 1 );
+
+     return ret;
+}
+
+static DFBResult
+Surface_FillRectangles( IDirectFBSurface   *thiz,
+                        const DFBRectangle *rects,
+                        unsigned int        num )
+{
+     CaptureObject *object = capture_enter( thiz );
+     DFBResult      ret;
+
+     ret = object->orig.surface.FillRectangles( thiz, rects, num );
+
+     if (capture_leave() && rects)
+          capture_rectangles( object, DCM_SURFACE_FILL_RECTANGLES, rects, num );
+
+     return ret;
+}
+
+static DFBResult
+Surface_DrawRectangle( IDirectFBSurface *thiz,
+                       int x, int y, int w, int h )
+{
+     CaptureObject *object = capture_enter( thiz );
+     DFBRectangle   rect   = { x, y, w, h };
+     DFBResult      ret;
+
+     ret = object->orig.surface.DrawRectangle( thiz, x, y, w, h );
+
+     if (capture_leave())
+          capture_rectangles( object, DCM_SURFACE_DRAW_RECTANGLE, &rect, 1 );
+
+     return ret;
+}
+
+static void
+capture_triangles( CaptureObject     *object,
+                   const DFBTriangle *tris,
+                   unsigned int       num )
+{
+     CaptureCall call;
+
+     if (capture_begin( &call, object, DCM_SURFACE_FILL_TRIANGLES, CAPTURE_ARRAY( sizeof(DFBTriangle) * num ) )) {
+          fusion_wire_encode_array( &call.encoder, tris, sizeof(DFBTriangle), num );
+
+          capture_end( &call );
+     }
+}
+
+static DFBResult
+Surface_FillTriangle( IDirectFBSurface *thiz,
+                      int x1, int y1, int x2, int y2, int x3, int y3 )
+{
+     CaptureObject *object = capture_enter( thiz );
+     DFBTriangle    tri    = { x1, y1, x2, y2, x3, y3 };
+     DFBResult      ret;
+
+     ret = object->orig.surface.FillTriangle( thiz, x1, y1, x2, y2, x3, y3 );
+
+     if (capture_leave())
+          capture_triangles( object, &tri, 1 );
+
+     return ret;
+}
+
+static DFBResult
+Surface_FillTriangles( IDirectFBSurface  *thiz,
+                       const DFBTriangle *tris,
+                       unsigned int       num )
+{
+     CaptureObject *object = capture_enter( thiz );
+     DFBResult      ret;
+
+     ret = object->orig.surface.FillTriangles( thiz, tris, num );
+
+     if (capture_leave() && tris)
+          capture_triangles( object, tris, num );
+
+     return ret;
+}
+
+static DFBResult
+Surface_FillSpans( IDirectFBSurface *thiz,
+                   int               y,
+                   const DFBSpan    *spans,
+                   unsigned int      num )
+{
+     CaptureObject *object = capture_enter( thiz );
+     CaptureCall    call;
+     DFBResult      ret;
+
+     ret = object->orig.surface.FillSpans( thiz, y, spans, num );
+
+     if (capture_leave() && spans &&
+         capture_begin( &call, object, DCM_SURFACE_FILL_SPANS, CAPTURE_SCALAR + CAPTURE_ARRAY( sizeof(DFBSpan) * num ) ))
+     {
+          fusion_wire_encode_s32( &call.encoder, y );
+          fusion_wire_encode_array( &call.encoder, spans, sizeof(DFBSpan), num );
+
+          capture_end( &call );
+     }
+
+     return ret;
+}
+
+static DFBResult
+Surface_FillTrapezoids( IDirectFBSurface   *thiz,
+                        const DFBTrapezoid *traps,
+                        unsigned int        num )
+{
+     CaptureObject *object = capture_enter( thiz );
+     CaptureCall    call;
+     DFBResult      ret;
+
+     ret = object->orig.surface.FillTrapezoids( thiz, traps, num );
+
+     if (capture_leave() && traps &&
+         capture_begin( &call, object, DCM_SURFACE_FILL_TRAPEZOIDS, CAPTURE_ARRAY( sizeof(DFBTrapezoid) * num ) ))
+     {
+          fusion_wire_encode_array( &call.encoder, traps, sizeof(DFBTrapezoid), num );
+
+          capture_end( &call );
+     }
+
+     return ret;
+}
+
+static void
+capture_lines( CaptureObject   *object,
+               const DFBRegion *lines,
+               unsigned int     num )
+{
+     CaptureCall call;
+
+     if (capture_begin( &call, object, DCM_SURFACE_DRAW_LINES, CAPTURE_ARRAY( sizeof(DFBRegion) * num ) )) {
+          fusion_wire_encode_array( &call.encoder, lines, sizeof(DFBRegion), num );
+
+          capture_end( &call );
+     }
+}
+
+static DFBResult
+Surface_DrawLine( IDirectFBSurface *thiz,
+                  int x1, int y1, int x2, int y2 )
+{
+     CaptureObject *object = capture_enter( thiz );
+     DFBRegion      line   = { x1, y1, x2, y2 };
+     DFBResult      ret;
+
+     ret = object->orig.surface.DrawLine( thiz, x1, y1, x2, y2 );
+
+     if (capture_leave())
+          capture_lines( object, &line, 1 );
+
+     return ret;
+}
+
+static DFBResult
+Surface_DrawLines( IDirectFBSurface *thiz,
+                   const DFBRegion  *lines,
+                   unsigned int      num_lines )
+{
+     CaptureObject *object = capture_enter( thiz );
+     DFBResult      ret;
+
+     ret = object->orig.surface.DrawLines( thiz, lines, num_lines );
+
+     if (capture_leave() && lines)
+          capture_lines( object, lines, num_lines );
+
+     return ret;
+}
+
+static void
+capture_blit( CaptureObject      *object,
+              DFBCaptureMethod    method,
+              IDirectFBSurface   *source,
+              const DFBRectangle *source_rect,
+              int                 x,
+              int                 y )
+{
+     CaptureCall call;
+
+     if (capture_begin( &call, object, method, 3 * CAPTURE_SCALAR + CAPTURE_ARRAY( sizeof(DFBRectangle) ) )) {
+          fusion_wire_encode_object( &call.encoder, capture_object_id( source ) );
+          capture_encode_optional( &call, source_rect, sizeof(DFBRectangle) );
+          fusion_wire_encode_s32( &call.encoder, x );
+          fusion_wire_encode_s32( &call.encoder, y );
+
+          capture_end( &call );
+     }
+}
+
+static DFBResult
+Surface_Blit( IDirectFBSurface   *thiz,
+              IDirectFBSurface   *source,
+              const DFBRectangle *source_rect,
+              int                 x,
+              int                 y )
+{
+     CaptureObject *object = capture_enter( thiz );
+     DFBResult      ret;
+
+     ret = object->orig.surface.Blit( thiz, source, source_rect, x, y );
+
+     if (capture_leave())
+          capture_blit( object, DCM_SURFACE_BLIT, source, source_rect, x, y );
+
+     return ret;
+}
+
+static DFBResult
+Surface_TileBlit( IDirectFBSurface   *thiz,
+                  IDirectFBSurface   *source,
+                  const DFBRectangle *source_rect,
+                  int                 x,
+                  int                 y )
+{
+     CaptureObject *object = capture_enter( thiz );
+     DFBResult      ret;
+
+     ret = object->orig.surface.TileBlit( thiz, source, source_rect, x, y );
+
+     if (capture_leave())
+          capture_blit( object, DCM_SURFACE_TILE_BLIT, source, source_rect, x, y );
+
+     return ret;
+}
+
+static DFBResult
+Surface_BatchBlit( IDirectFBSurface   *thiz,
+                   IDirectFBSurface   *source,
+                   const DFBRectangle *source_rects,
+                   const DFBPoint     *dest_points,
+                   int                 num )
+{
+     CaptureObject *object = capture_enter( thiz );
+     CaptureCall    call;
+     DFBResult      ret;
+
+     ret = object->orig.surface.BatchBlit( thiz, source, source_rects, dest_points, num );
+
+     if (capture_leave() && source_rects && dest_points && num > 0 &&
+         capture_begin( &call, object, DCM_SURFACE_BATCH_BLIT,
+                        CAPTURE_SCALAR + CAPTURE_ARRAY( sizeof(DFBRectangle) * num ) + CAPTURE_ARRAY( sizeof(DFBPoint) * num ) ))
+     {
+          fusion_wire_encode_object( &call.encoder, capture_object_id( source ) );
+          fusion_wire_encode_array( &call.encoder, source_rects, sizeof(DFBRectangle), num );
+          fusion_wire_encode_array( &call.encoder, dest_points, sizeof(DFBPoint), num );
+
+          capture_end( &call );
+     }
+
+     return ret;
+}
+
+static DFBResult
+Surface_StretchBlit( IDirectFBSurface   *thiz,
+                     IDirectFBSurface   *source,
+                     const DFBRectangle *source_rect,
+                     const DFBRectangle *destination_rect )
+{
+     CaptureObject *object = capture_enter( thiz );
+     CaptureCall    call;
+     DFBResult      ret;
+
+     ret = object->orig.surface.StretchBlit( thiz, source, source_rect, destination_rect );
+
+     if (capture_leave() &&
+         capture_begin( &call, object, DCM_SURFACE_STRETCH_BLIT, CAPTURE_SCALAR + 2 * CAPTURE_ARRAY( sizeof(DFBRectangle) ) ))
+     {
+          fusion_wire_encode_object( &call.encoder, capture_object_id( source ) );
+          capture_encode_optional( &call, source_rect, sizeof(DFBRectangle) );
+          capture_encode_optional( &call, destination_rect, sizeof(DFBRectangle) );
+
+          capture_end( &call );
+     }
+
+     return ret;
+}
+
+static DFBResult
+Surface_BatchBlit2( IDirectFBSurface   *thiz,
+                    IDirectFBSurface   *source,
+                    IDirectFBSurface   *source2,
+                    const DFBRectangle *source_rects,
+                    const DFBPoint     *dest_points,
+                    const DFBPoint     *source2_points,
+                    int                 num )
+{
+     CaptureObject *object = capture_enter( thiz );
+     CaptureCall    call;
+     DFBResult      ret;
+
+     ret = object->orig.surface.BatchBlit2( thiz, source, source2, source_rects, dest_points, source2_points, num );
+
+     if (capture_leave() && source_rects && dest_points && source2_points && num > 0 &&
+         capture_begin( &call, object, DCM_SURFACE_BATCH_BLIT2,
+                        2 * CAPTURE_SCALAR + CAPTURE_ARRAY( sizeof(DFBRectangle) * num ) + 2 * CAPTURE_ARRAY( sizeof(DFBPoint) * num ) ))
+     {
+          fusion_wire_encode_object( &call.encoder, capture_object_id( source ) );
+          fusion_wire_encode_object( &call.encoder, capture_object_id( source2 ) );
+          fusion_wire_encode_array( &call.encoder, source_rects, sizeof(DFBRectangle), num );
+          fusion_wire_encode_array( &call.encoder, dest_points, sizeof(DFBPoint), num );
+          fusion_wire_encode_array( &call.encoder, source2_points, sizeof(DFBPoint), num );
+
+          capture_end( &call );
+     }
+
+     return ret;
+}
+
+static DFBResult
+Surface_BatchStretchBlit( IDirectFBSurface   *thiz,
+                          IDirectFBSurface   *source,
+                          const DFBRectangle *source_rects,
+                          const DFBRectangle *dest_rects,
+                          int                 num )
+{
+     CaptureObject *object = capture_enter( thiz );
+     CaptureCall    call;
+     DFBResult      ret;
+
+     ret = object->orig.surface.BatchStretchBlit( thiz, source, source_rects, dest_rects, num );
+
+     if (capture_leave() && source_rects && dest_rects && num > 0 &&
+         capture_begin( &call, object, DCM_SURFACE_BATCH_STRETCH_BLIT, CAPTURE_SCALAR + 2 * CAPTURE_ARRAY( sizeof(DFBRectangle) * num ) ))
+     {
+          fusion_wire_encode_object( &call.encoder, capture_object_id( source ) );
+          fusion_wire_encode_array( &call.encoder, source_rects, sizeof(DFBRectangle), num );
+          fusion_wire_encode_array( &call.encoder, dest_rects, sizeof(DFBRectangle), num );
+
+          capture_end( &call );
+     }
+
+     return ret;
+}
+
+static DFBResult
+Surface_TextureTriangles( IDirectFBSurface     *thiz,
+                          IDirectFBSurface     *texture,
+                          const DFBVertex      *vertices,
+                          const int            *indices,
+                          int                   num,
+                          DFBTriangleFormation  formation )
+{
+     CaptureObject *object = capture_enter( thiz );
+     CaptureCall    call;
+     DFBResult      ret;
+     int            num_vertices = num;
+     int            i;
+
+     ret = object->orig.surface.TextureTriangles( thiz, texture, vertices, indices, num, formation );
+
+     /* With indices only the referenced vertices are known to exist. */
+     if (indices) {
+          for (i=0, num_vertices=0; i<num; i++) {
+               if (indices[i] < 0) {
+                    num_vertices = 0;
+                    break;
+               }
+
+               if (indices[i] >= num_vertices)
+                    num_vertices = indices[i] + 1;
+          }
+     }
+
+     if (capture_leave() && vertices && num > 0 && num_vertices > 0 &&
+         capture_begin( &call, object, DCM_SURFACE_TEXTURE_TRIANGLES,
+                        3 * CAPTURE_SCALAR + CAPTURE_ARRAY( sizeof(DFBVertex) * num_vertices ) + CAPTURE_ARRAY( sizeof(int) * num ) ))
+     {
+          fusion_wire_encode_object( &call.encoder, capture_object_id( texture ) );
+          fusion_wire_encode_array( &call.encoder, vertices, sizeof(DFBVertex), num_vertices );
+          fusion_wire_encode_array( &call.encoder, indices, sizeof(int), indices ? num : 0 );
+          fusion_wire_encode_s32( &call.encoder, num );
+          fusion_wire_encode_u32( &call.encoder, formation );
+
+          capture_end( &call );
+     }
+
+     return ret;
+}
+
+static DFBResult
+Surface_DrawString( IDirectFBSurface    *thiz,
+                    const char          *text,
+                    int                  bytes,
+                    int                  x,
+                    int                  y,
+                    DFBSurfaceTextFlags  flags )
+{
+     CaptureObject *object = capture_enter( thiz );
+     CaptureCall    call;
+     DFBResult      ret;
+
+     ret = object->orig.surface.DrawString( thiz, text, bytes, x, y, flags );
+
+     if (!text)
+          bytes = 0;
+     else if (bytes < 0)
+          bytes = strlen( text );
+
+     if (capture_leave() && capture_begin( &call, object, DCM_SURFACE_DRAW_STRING, CAPTURE_ARRAY( bytes ) + 3 * CAPTURE_SCALAR )) {
+          fusion_wire_encode_array( &call.encoder, text, 1, bytes );
+          fusion_wire_encode_s32( &call.encoder, x );
+          fusion_wire_encode_s32( &call.encoder, y );
+          fusion_wire_encode_u32( &call.encoder, flags );
+
+          capture_end( &call );
+     }
+
+     return ret;
+}
+
+static DFBResult
+Surface_DrawGlyph( IDirectFBSurface    *thiz,
+                   unsigned int         character,
+                   int                  x,
+                   int                  y,
+                   DFBSurfaceTextFlags  flags )
+{
+     CaptureObject *object = capture_enter( thiz );
+     CaptureCall    call;
+     DFBResult      ret;
+
+     ret = object->orig.surface.DrawGlyph( thiz, character, x, y, flags );
+
+     if (capture_leave() && capture_begin( &call, object, DCM_SURFACE_DRAW_GLYPH, 4 * CAPTURE_SCALAR )) {
+          fusion_wire_encode_u32( &call.encoder, character );
+          fusion_wire_encode_s32( &call.encoder, x );
+          fusion_wire_encode_s32( &call.encoder, y );
+          fusion_wire_encode_u32( &call.encoder, flags );
+
+          capture_end( &call );
+     }
+
+     return ret;
+}
+
+static DFBResult
+Surface_Flip( IDirectFBSurface    *thiz,
+              const DFBRegion     *region,
+              DFBSurfaceFlipFlags  flags )
+{
+     CaptureObject *object = capture_enter( thiz );
+     CaptureCall    call;
+     DFBResult      ret;
+
+     ret = object->orig.surface.Flip( thiz, region, flags );
+
+     if (capture_leave() && capture_begin( &call, object, DCM_SURFACE_FLIP, CAPTURE_ARRAY( sizeof(DFBRegion) ) + CAPTURE_SCALAR )) {
+          capture_encode_optional( &call, region, sizeof(DFBRegion) );
+          fusion_wire_encode_u32( &call.encoder, flags );
+
+          capture_end( &call );
+     }
+
+     return ret;
+}
+
+static DFBResult
+Surface_GetSubSurface( IDirectFBSurface    *thiz,
+                       const DFBRectangle  *rect,
+                       IDirectFBSurface   **ret_interface )
+{
+     CaptureObject *object = capture_enter( thiz );
+     CaptureObject *created;
+     CaptureCall    call;
+     DFBResult      ret;
+
+     ret = object->orig.surface.GetSubSurface( thiz, rect, ret_interface );
+
+     if (capture_leave() && !ret) {
+          created = capture_object( *ret_interface, DCI_SURFACE );
+
+          if (capture_begin( &call, object, DCM_SURFACE_GET_SUB_SURFACE, CAPTURE_ARRAY( sizeof(DFBRectangle) ) + CAPTURE_SCALAR )) {
+               capture_encode_optional( &call, rect, sizeof(DFBRectangle) );
+               fusion_wire_encode_object( &call.encoder, created ? created->id : 0 );
+
+               capture_end( &call );
+          }
+     }
+
+     return ret;
+}
+
+static DFBResult
+Surface_Lock( IDirectFBSurface     *thiz,
+              DFBSurfaceLockFlags   flags,
+              void                **ret_ptr,
+              int                  *ret_pitch )
+{
+     CaptureObject *object = capture_enter( thiz );
+     DFBResult      ret;
+
+     ret = object->orig.surface.Lock( thiz, flags, ret_ptr, ret_pitch );
+
+     if (capture_leave() && !ret) {
+          object->lock_flags = flags;
+          object->lock_ptr   = *ret_ptr;
+          object->lock_pitch = *ret_pitch;
+     }
+
+     return ret;
+}
+
+static DFBResult
+Surface_Unlock( IDirectFBSurface *thiz )
+{
+     CaptureObject *object = capture_enter( thiz );
+     bool           outer;
+
+     outer = capture_leave();
+
+     if (outer && object->lock_ptr) {
+          if (object->lock_flags & DSLF_WRITE)
+               capture_contents( object, NULL );
+
+          object->lock_ptr = NULL;
+     }
+
+     return object->orig.surface.Unlock( thiz );
+}
+
+static DFBResult
+Surface_Write( IDirectFBSurface   *thiz,
+               const DFBRectangle *rect,
+               const void         *ptr,
+               int                 pitch )
+{
+     CaptureObject *object = capture_enter( thiz );
+     DFBResult      ret;
+
+     ret = object->orig.surface.Write( thiz, rect, ptr, pitch );
+
+     if (capture_leave() && !ret)
+          capture_contents( object, rect );
+
+     return ret;
+}
+
+static void
+capture_patch_surface( IDirectFBSurface *thiz )
+{
+     thiz->AddRef              = Surface_AddRef;
+     thiz->Release             = Surface_Release;
+     thiz->Clear               = Surface_Clear;
+     thiz->SetColor            = Surface_SetColor;
+     thiz->SetClip             = Surface_SetClip;
+     thiz->SetDrawingFlags     = Surface_SetDrawingFlags;
+     thiz->SetBlittingFlags    = Surface_SetBlittingFlags;
+     thiz->SetPorterDuff       = Surface_SetPorterDuff;
+     thiz->SetSrcBlendFunction = Surface_SetSrcBlendFunction;
+     thiz->SetDstBlendFunction = Surface_SetDstBlendFunction;
+     thiz->SetFont             = Surface_SetFont;
+     thiz->SetSrcColorKey      = Surface_SetSrcColorKey;
+     thiz->SetDstColorKey      = Surface_SetDstColorKey;
+     thiz->SetRenderOptions    = Surface_SetRenderOptions;
+     thiz->SetMatrix           = Surface_SetMatrix;
+     thiz->SetSourceMask       = Surface_SetSourceMask;
+     thiz->FillRectangle       = Surface_FillRectangle;
+     thiz->FillRectangles      = Surface_FillRectangles;
+     thiz->DrawRectangle       = Surface_DrawRectangle;
+     thiz->FillTriangle        = Surface_FillTriangle;
+     thiz->FillTriangles       = Surface_FillTriangles;
+     thiz->FillSpans           = Surface_FillSpans;
+     thiz->FillTrapezoids      = Surface_FillTrapezoids;
+     thiz->DrawLine            = Surface_DrawLine;
+     thiz->DrawLines           = Surface_DrawLines;
+     thiz->Blit                = Surface_Blit;
+     thiz->TileBlit            = Surface_TileBlit;
+     thiz->BatchBlit           = Surface_BatchBlit;
+     thiz->BatchBlit2          = Surface_BatchBlit2;
+     thiz->StretchBlit         = Surface_StretchBlit;
+     thiz->BatchStretchBlit    = Surface_BatchStretchBlit;
+     thiz->TextureTriangles    = Surface_TextureTriangles;
+     thiz->DrawString          = Surface_DrawString;
+     thiz->DrawGlyph           = Surface_DrawGlyph;
+     thiz->Flip                = Surface_Flip;
+     thiz->GetSubSurface       = Surface_GetSubSurface;
+     thiz->Lock                = Surface_Lock;
+     thiz->Unlock              = Surface_Unlock;
+     thiz->Write               = Surface_Write;
+}
+
+/**********************************************************************************************************************
+ * IDirectFBFont
+ */
+
+CAPTURE_REFERENCES( IDirectFBFont, Font, font )
+
+static void
+capture_patch_font( IDirectFBFont *thiz )
+{
+     thiz->AddRef  = Font_AddRef;
+     thiz->Release = Font_Release;
+}
+
+/**********************************************************************************************************************
+ * IDirectFBImageProvider
+ */
+
+CAPTURE_REFERENCES( IDirectFBImageProvider, ImageProvider, provider )
+
+static DFBResult
+ImageProvider_RenderTo( IDirectFBImageProvider *thiz,
+                        IDirectFBSurface       *destination,
+                        const DFBRectangle     *destination_rect )
+{
+     CaptureObject *object = capture_enter( thiz );
+     CaptureObject *target;
+     DFBResult      ret;
+
+     ret = object->orig.provider.RenderTo( thiz, destination, destination_rect );
+
+     if (capture_leave() && !ret && destination) {
+          direct_mutex_lock( &capture.lock );
+
+          target = direct_hash_lookup( &capture.objects, (unsigned long) destination );
+
+          direct_mutex_unlock( &capture.lock );
+
+          if (target)
+               capture_contents( target, destination_rect );
+          else
+               D_ONCE( "rendering to a surface not created via captured calls" );
+     }
+
+     return ret;
+}
+
+static void
+capture_patch_provider( IDirectFBImageProvider *thiz )
+{
+     thiz->AddRef   = ImageProvider_AddRef;
+     thiz->Release  = ImageProvider_Release;
+     thiz->RenderTo = ImageProvider_RenderTo;
+}
+
+/**********************************************************************************************************************
+ * IDirectFBWindow
+ */
+
+CAPTURE_REFERENCES( IDirectFBWindow, Window, window )
+
+static DFBResult
+Window_GetSurface( IDirectFBWindow   *thiz,
+                   IDirectFBSurface **ret_interface )
+{
+     CaptureObject *object = capture_enter( thiz );
+     CaptureObject *created;
+     CaptureCall    call;
+     DFBResult      ret;
+
+     ret = object->orig.window.GetSurface( thiz, ret_interface );
+
+     if (capture_leave() && !ret) {
+          created = capture_object( *ret_interface, DCI_SURFACE );
+
+          if (capture_begin( &call, object, DCM_WINDOW_GET_SURFACE, CAPTURE_SCALAR )) {
+               fusion_wire_encode_object( &call.encoder, created ? created->id : 0 );
+
+               capture_end( &call );
+          }
+     }
+
+     return ret;
+}
+
+static DFBResult
+Window_SetOpacity( IDirectFBWindow *thiz,
+                   u8               opacity )
+{
+     CaptureObject *object = capture_enter( thiz );
+     DFBResult      ret;
+
+     ret = object->orig.window.SetOpacity( thiz, opacity );
+
+     if (capture_leave())
+          capture_record_u32( object, DCM_WINDOW_SET_OPACITY, opacity );
+
+     return ret;
+}
+
+static DFBResult
+Window_MoveTo( IDirectFBWindow *thiz,
+               int              x,
+               int              y )
+{
+     CaptureObject *object = capture_enter( thiz );
+     DFBResult      ret;
+
+     ret = object->orig.window.MoveTo( thiz, x, y );
+
+     if (capture_leave())
+          capture_record_s32s( object, DCM_WINDOW_MOVE_TO, x, y );
+
+     return ret;
+}
+
+static DFBResult
+Window_Resize( IDirectFBWindow *thiz,
+               int              width,
+               int              height )
+{
+     CaptureObject *object = capture_enter( thiz );
+     DFBResult      ret;
+
+     ret = object->orig.window.Resize( thiz, width, height );
+
+     if (capture_leave())
+          capture_record_s32s( object, DCM_WINDOW_RESIZE, width, height );
+
+     return ret;
+}
+
+static void
+capture_patch_window( IDirectFBWindow *thiz )
+{
+     thiz->AddRef     = Window_AddRef;
+     thiz->Release    = Window_Release;
+     thiz->GetSurface = Window_GetSurface;
+     thiz->SetOpacity = Window_SetOpacity;
+     thiz->MoveTo     = Window_MoveTo;
+     thiz->Resize     = Window_Resize;
+}
+
+/**********************************************************************************************************************
+ * IDirectFBDisplayLayer
+ */
+
+CAPTURE_REFERENCES( IDirectFBDisplayLayer, Layer, layer )
+
+static DFBResult
+Layer_SetCooperativeLevel( IDirectFBDisplayLayer           *thiz,
+                           DFBDisplayLayerCooperativeLevel  level )
+{
+     CaptureObject *object = capture_enter( thiz );
+     DFBResult      ret;
+
+     ret = object->orig.layer.SetCooperativeLevel( thiz, level );
+
+     if (capture_leave())
+          capture_record_u32( object, DCM_LAYER_SET_COOPERATIVE_LEVEL, level );
+
+     return ret;
+}
+
+static DFBResult
+Layer_CreateWindow( IDirectFBDisplayLayer       *thiz,
+                    const DFBWindowDescription  *desc,
+                    IDirectFBWindow            **ret_interface )
+{
+     CaptureObject *object = capture_enter( thiz );
+     CaptureObject *created;
+     CaptureCall    call;
+     DFBResult      ret;
+
+     ret = object->orig.layer.CreateWindow( thiz, desc, ret_interface );
+
+     if (capture_leave() && !ret) {
+          created = capture_object( *ret_interface, DCI_WINDOW );
+
+          if (capture_begin( &call, object, DCM_LAYER_CREATE_WINDOW, CAPTURE_ARRAY( sizeof(DFBWindowDescription) ) + CAPTURE_SCALAR )) {
+               fusion_wire_encode_array( &call.encoder, desc, sizeof(DFBWindowDescription), 1 );
+               fusion_wire_encode_object( &call.encoder, created ? created->id : 0 );
+
+               capture_end( &call );
+          }
+     }
+
+     return ret;
+}
+
+static DFBResult
+Layer_GetSurface( IDirectFBDisplayLayer  *thiz,
+                  IDirectFBSurface      **ret_interface )
+{
+     CaptureObject *object = capture_enter( thiz );
+     CaptureObject *created;
+     CaptureCall    call;
+     DFBResult      ret;
+
+     ret = object->orig.layer.GetSurface( thiz, ret_interface );
+
+     if (capture_leave() && !ret) {
+          created = capture_object( *ret_interface, DCI_SURFACE );
+
+          if (capture_begin( &call, object, DCM_LAYER_GET_SURFACE, CAPTURE_SCALAR )) {
+               fusion_wire_encode_object( &call.encoder, created ? created->id : 0 );
+
+               capture_end( &call );
+          }
+     }
+
+     return ret;
+}
+
+static void
+capture_patch_layer( IDirectFBDisplayLayer *thiz )
+{
+     thiz->AddRef              = Layer_AddRef;
+     thiz->Release             = Layer_Release;
+     thiz->SetCooperativeLevel = Layer_SetCooperativeLevel;
+     thiz->CreateWindow        = Layer_CreateWindow;
+     thiz->GetSurface          = Layer_GetSurface;
+}
+
+/**********************************************************************************************************************
+ * IDirectFB
+ */
+
+CAPTURE_REFERENCES( IDirectFB, DirectFB, dfb )
+
+static DFBResult
+DirectFB_SetCooperativeLevel( IDirectFB           *thiz,
+                              DFBCooperativeLevel  level )
+{
+     CaptureObject *object = capture_enter( thiz );
+     DFBResult      ret;
+
+     ret = object->orig.dfb.SetCooperativeLevel( thiz, level );
+
+     if (capture_leave())
+          capture_record_u32( object, DCM_DFB_SET_COOPERATIVE_LEVEL, level );
+
+     return ret;
+}
+
+static DFBResult
+DirectFB_CreateSurface( IDirectFB                    *thiz,
+                        const DFBSurfaceDescription  *desc,
+                        IDirectFBSurface            **ret_interface )
+{
+     CaptureObject *object = capture_enter( thiz );
+     CaptureObject *created;
+     CaptureCall    call;
+     DFBResult      ret;
+
+     ret = object->orig.dfb.CreateSurface( thiz, desc, ret_interface );
+
+     if (capture_leave() && !ret) {
+          DFBSurfaceDescription recorded = *desc;
+
+          created = capture_object( *ret_interface, DCI_SURFACE );
+
+          /* Pointers are meaningless in the replay, preallocated contents are recorded below. */
+          recorded.flags &= ~(DSDESC_PREALLOCATED | DSDESC_PALETTE);
+
+          memset( recorded.preallocated, 0, sizeof(recorded.preallocated) );
+          memset( &recorded.palette, 0, sizeof(recorded.palette) );
+
+          if (capture_begin( &call, object, DCM_DFB_CREATE_SURFACE, CAPTURE_ARRAY( sizeof(DFBSurfaceDescription) ) + CAPTURE_SCALAR )) {
+               fusion_wire_encode_array( &call.encoder, &recorded, sizeof(DFBSurfaceDescription), 1 );
+               fusion_wire_encode_object( &call.encoder, created ? created->id : 0 );
+
+               capture_end( &call );
+          }
+
+          if (created && (desc->flags & DSDESC_PREALLOCATED))
+               capture_contents( created, NULL );
+     }
+
+     return ret;
+}
+
+static DFBResult
+DirectFB_GetDisplayLayer( IDirectFB              *thiz,
+                          DFBDisplayLayerID       layer_id,
+                          IDirectFBDisplayLayer **ret_interface )
+{
+     CaptureObject *object = capture_enter( thiz );
+     CaptureObject *created;
+     CaptureCall    call;
+     DFBResult      ret;
+
+     ret = object->orig.dfb.GetDisplayLayer( thiz, layer_id, ret_interface );
+
+     if (capture_leave() && !ret) {
+          created = capture_object( *ret_interface, DCI_DISPLAYLAYER );
+
+          if (capture_begin( &call, object, DCM_DFB_GET_DISPLAY_LAYER, 2 * CAPTURE_SCALAR )) {
+               fusion_wire_encode_u32( &call.encoder, layer_id );
+               fusion_wire_encode_object( &call.encoder, created ? created->id : 0 );
+
+               capture_end( &call );
+          }
+     }
+
+     return ret;
+}
+
+static DFBResult
+DirectFB_CreateFont( IDirectFB                 *thiz,
+                     const char                *filename,
+                     const DFBFontDescription  *desc,
+                     IDirectFBFont            **ret_interface )
+{
+     CaptureObject *object = capture_enter( thiz );
+     CaptureObject *created;
+     CaptureCall    call;
+     DFBResult      ret;
+     int            length = filename ? strlen( filename ) : 0;
+
+     ret = object->orig.dfb.CreateFont( thiz, filename, desc, ret_interface );
+
+     if (capture_leave() && !ret) {
+          created = capture_object( *ret_interface, DCI_FONT );
+
+          if (capture_begin( &call, object, DCM_DFB_CREATE_FONT,
+                             CAPTURE_ARRAY( length ) + CAPTURE_ARRAY( sizeof(DFBFontDescription) ) + CAPTURE_SCALAR ))
+          {
+               fusion_wire_encode_array( &call.encoder, filename, 1, length );
+               capture_encode_optional( &call, desc, sizeof(DFBFontDescription) );
+               fusion_wire_encode_object( &call.encoder, created ? created->id : 0 );
+
+               capture_end( &call );
+          }
+     }
+
+     return ret;
+}
+
+static DFBResult
+DirectFB_CreateImageProvider( IDirectFB               *thiz,
+                              const char              *filename,
+                              IDirectFBImageProvider **ret_interface )
+{
+     CaptureObject *object = capture_enter( thiz );
+     DFBResult      ret;
+
+     ret = object->orig.dfb.CreateImageProvider( thiz, filename, ret_interface );
+
+     /* Not recorded, only what it renders. */
+     if (capture_leave() && !ret)
+          capture_object( *ret_interface, DCI_IMAGEPROVIDER );
+
+     return ret;
+}
+
+static void
+capture_patch_dfb( IDirectFB *thiz )
+{
+     thiz->AddRef              = DirectFB_AddRef;
+     thiz->Release             = DirectFB_Release;
+     thiz->SetCooperativeLevel = DirectFB_SetCooperativeLevel;
+     thiz->CreateSurface       = DirectFB_CreateSurface;
+     thiz->GetDisplayLayer     = DirectFB_GetDisplayLayer;
+     thiz->CreateFont          = DirectFB_CreateFont;
+     thiz->CreateImageProvider = DirectFB_CreateImageProvider;
+}
+
+/**********************************************************************************************************************/
+
+static bool
+capture_is_patched( CaptureObject *object )
+{
+     IAny *any = object->iface;
+
+     switch (object->type) {
+          case DCI_IDIRECTFB:
+               return (void*) any->Release == (void*) DirectFB_Release;
+          case DCI_DISPLAYLAYER:
+               return (void*) any->Release == (void*) Layer_Release;
+          case DCI_WINDOW:
+               return (void*) any->Release == (void*) Window_Release;
+          case DCI_SURFACE:
+               return (void*) any->Release == (void*) Surface_Release;
+          case DCI_FONT:
+               return (void*) any->Release == (void*) Font_Release;
+          case DCI_IMAGEPROVIDER:
+               return (void*) any->Release == (void*) ImageProvider_Release;
+          default:
+               D_BUG( "unexpected type %d", object->type );
+     }
+
+     return false;
+}
+
+/*
+ * Returns the object of an interface passed to the application, patching a new one.
+ *
+ * Interfaces may be returned again, e.g. a window's surface. A stale object of a destroyed
+ * interface at the same address is detected by the functions being unpatched again.
+ */
+static CaptureObject *
+capture_object( void                *iface,
+                DFBCaptureInterface  type )
+{
+     CaptureObject *object;
+
+     direct_mutex_lock( &capture.lock );
+
+     object = direct_hash_lookup( &capture.objects, (unsigned long) iface );
+     if (object) {
+          D_MAGIC_ASSERT( object, CaptureObject );
+
+          if (object->type == type && capture_is_patched( object )) {
+               object->refs++;
+
+               direct_mutex_unlock( &capture.lock );
+
+               return object;
+          }
+
+          direct_hash_remove( &capture.objects, (unsigned long) iface );
+
+          D_MAGIC_CLEAR( object );
+          D_FREE( object );
+     }
+
+     object = D_CALLOC( 1, sizeof(CaptureObject) );
+     if (!object) {
+          D_OOM();
+          direct_mutex_unlock( &capture.lock );
+          return NULL;
+     }
+
+     object->iface = iface;
+     object->id    = ++capture.next_id;
+     object->type  = type;
+     object->refs  = 1;
+
+     D_DEBUG_AT( DirectFB_Capture, "%s( %p, type %d ) -> id %u\n", __FUNCTION__, iface, type, object->id );
+
+     switch (type) {
+          case DCI_IDIRECTFB:
+               object->orig.dfb = *(IDirectFB*) iface;
+               capture_patch_dfb( iface );
+               break;
+
+          case DCI_DISPLAYLAYER:
+               object->orig.layer = *(IDirectFBDisplayLayer*) iface;
+               capture_patch_layer( iface );
+               break;
+
+          case DCI_WINDOW:
+               object->orig.window = *(IDirectFBWindow*) iface;
+               capture_patch_window( iface );
+               break;
+
+          case DCI_SURFACE:
+               object->orig.surface = *(IDirectFBSurface*) iface;
+               capture_patch_surface( iface );
+               break;
+
+          case DCI_FONT:
+               object->orig.font = *(IDirectFBFont*) iface;
+               capture_patch_font( iface );
+               break;
+
+          case DCI_IMAGEPROVIDER:
+               object->orig.provider = *(IDirectFBImageProvider*) iface;
+               capture_patch_provider( iface );
+               break;
+
+          default:
+               D_BUG( "unexpected type %d", type );
+     }
+
+     D_MAGIC_SET( object, CaptureObject );
+
+     direct_hash_insert( &capture.objects, (unsigned long) iface, object );
+
+     direct_mutex_unlock( &capture.lock );
+
+     return object;
+}
+
+static void
+capture_cleanup( void *ctx )
+{
+     dfb_capture_stop();
+}
+
+/**********************************************************************************************************************/
+
+DFBResult
+dfb_capture_start( IDirectFB *idirectfb )
+{
+     DirectResult   ret;
+     CaptureObject *object;
+     CaptureCall    call;
+
+     D_DEBUG_AT( DirectFB_Capture, "%s( %p ) <- '%s'\n", __FUNCTION__, idirectfb, dfb_config->capture );
+
+     D_ASSERT( idirectfb != NULL );
+     D_ASSERT( dfb_config->capture != NULL );
+
+     if (capture.active)
+          return DFB_OK;
+
+     ret = direct_file_open( &capture.file, dfb_config->capture, O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+     if (ret) {
+          D_DERROR( ret, "DirectFB/Capture: Could not open '%s'!\n", dfb_config->capture );
+          return ret;
+     }
+
+     capture.buffer = D_MALLOC( CAPTURE_BUFFER_SIZE );
+     if (!capture.buffer) {
+          direct_file_close( &capture.file );
+          return D_OOM();
+     }
+
+     capture.length  = 0;
+     capture.next_id = 0;
+
+     direct_recursive_mutex_init( &capture.lock );
+     direct_tls_register( &capture.depth, NULL );
+     direct_hash_init( &capture.objects, 61 );
+
+     capture.active = true;
+
+     object = capture_object( idirectfb, DCI_IDIRECTFB );
+
+     D_ASSERT( object == NULL || object->id == 1 );
+
+     if (object && capture_begin( &call, object, DCM_STREAM_HEADER, 4 * CAPTURE_SCALAR )) {
+          call.encoder.header->call_id   = DCI_STREAM;
+          call.encoder.header->object_id = 0;
+
+          fusion_wire_encode_u32( &call.encoder, DFB_CAPTURE_VERSION );
+          fusion_wire_encode_u32( &call.encoder, DIRECTFB_MAJOR_VERSION );
+          fusion_wire_encode_u32( &call.encoder, DIRECTFB_MINOR_VERSION );
+          fusion_wire_encode_u32( &call.encoder, DIRECTFB_MICRO_VERSION );
+
+          capture_end( &call );
+     }
+
+     direct_cleanup_handler_add( capture_cleanup, NULL, &capture.cleanup );
+
+     D_INFO( "DirectFB/Capture: Recording to '%s'\n", dfb_config->capture );
+
+     return DFB_OK;
+}
+
+void
+dfb_capture_stop( void )
+{
+     D_DEBUG_AT( DirectFB_Capture, "%s()\n", __FUNCTION__ );
+
+     if (!capture.active)
+          return;
+
+     direct_mutex_lock( &capture.lock );
+
+     capture_flush();
+
+     direct_file_close( &capture.file );
+
+     D_FREE( capture.buffer );
+
+     capture.buffer = NULL;
+     capture.active = false;
+
+     direct_mutex_unlock( &capture.lock );
+}
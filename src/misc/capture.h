@@ -0,0 +1,134 @@
+/*
+   (c) Copyright 2012-2013  DirectFB integrated media GmbH
+   (c) Copyright 2001-2013  The world wide DirectFB Open Source Community (directfb.org)
+   (c) Copyright 2000-2004  Convergence (integrated media) GmbH
+
+   All rights reserved.
+
+   Written by Denis Oliver Kropp <dok@directfb.org>,
+              Andreas Shimokawa <andi@directfb.org>,
+              Marek Pikarski <mass@directfb.org>,
+              Sven Neumann <neo@directfb.org>,
+              Ville Syrjälä <syrjala@sci.fi> and
+              Claudio Ciccani <klan@users.sf.net>.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the
+   Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+   Boston, MA 02111-1307, USA.
+*/
+
+
+
+#ifndef __MISC__CAPTURE_H__
+#define __MISC__CAPTURE_H__
+
+#include <directfb.h>
+
+/*
+ * Capture of API traffic for replaying it with dfbreplay.
+ *
+ * Calls of the application on IDirectFB and the display layers, windows, surfaces and fonts created
+ * via it are written to the file given by the "capture" option, one fusion/wire.h message per call.
+ * The header's call_id is the interface, call_arg the method and object_id the capture id of the
+ * instance. Created interfaces are recorded as object items in the message of the creating call.
+ *
+ * Pixels written by the application via Lock/Unlock, Write() or an image provider's RenderTo() are
+ * recorded as DCM_SURFACE_CONTENTS messages, so the replay does not need any image files.
+ *
+ * Descriptions are recorded as raw structs, replaying needs a build with the same ABI.
+ *
+ * Methods without a DCM_ value below are passed through unrecorded, e.g. index based color keys,
+ * palettes, stereo eyes and surface properties like SetAlphaRamp(), so a replay of applications
+ * using them may differ.
+ */
+
+#define DFB_CAPTURE_VERSION   1
+
+typedef enum {
+     DCI_STREAM                          = 0,      /* First message: capture version, DirectFB version */
+
+     DCI_IDIRECTFB                       = 1,      /* Object id 1 is the super interface */
+     DCI_DISPLAYLAYER                    = 2,
+     DCI_WINDOW                          = 3,
+     DCI_SURFACE                         = 4,
+     DCI_FONT                            = 5,
+     DCI_IMAGEPROVIDER                   = 6       /* Not recorded, only RenderTo() results are */
+} DFBCaptureInterface;
+
+typedef enum {
+     DCM_STREAM_HEADER                   = 0,      /* u32 capture version, u32 major, u32 minor, u32 micro */
+
+     DCM_ADDREF                          = 1,
+     DCM_RELEASE                         = 2,
+
+     DCM_DFB_SET_COOPERATIVE_LEVEL       = 0x100,  /* u32 level */
+     DCM_DFB_CREATE_SURFACE              = 0x101,  /* DFBSurfaceDescription[1], object */
+     DCM_DFB_GET_DISPLAY_LAYER           = 0x102,  /* u32 layer id, object */
+     DCM_DFB_CREATE_FONT                 = 0x103,  /* char[] file name or empty, DFBFontDescription[0/1], object */
+
+     DCM_LAYER_SET_COOPERATIVE_LEVEL     = 0x200,  /* u32 level */
+     DCM_LAYER_CREATE_WINDOW             = 0x201,  /* DFBWindowDescription[1], object */
+     DCM_LAYER_GET_SURFACE               = 0x202,  /* object */
+
+     DCM_WINDOW_GET_SURFACE              = 0x300,  /* object */
+     DCM_WINDOW_SET_OPACITY              = 0x301,  /* u32 opacity */
+     DCM_WINDOW_MOVE_TO                  = 0x302,  /* s32 x, s32 y */
+     DCM_WINDOW_RESIZE                   = 0x303,  /* s32 width, s32 height */
+
+     DCM_SURFACE_CONTENTS                = 0x400,  /* DFBRectangle[1], u32 format, u8[] packed lines */
+     DCM_SURFACE_CLEAR                   = 0x401,  /* u32 argb */
+     DCM_SURFACE_SET_COLOR               = 0x402,  /* u32 argb */
+     DCM_SURFACE_SET_CLIP                = 0x403,  /* DFBRegion[0/1] */
+     DCM_SURFACE_SET_DRAWING_FLAGS       = 0x404,  /* u32 flags */
+     DCM_SURFACE_SET_BLITTING_FLAGS      = 0x405,  /* u32 flags */
+     DCM_SURFACE_SET_PORTER_DUFF         = 0x406,  /* u32 rule */
+     DCM_SURFACE_SET_SRC_BLEND_FUNCTION  = 0x407,  /* u32 function */
+     DCM_SURFACE_SET_DST_BLEND_FUNCTION  = 0x408,  /* u32 function */
+     DCM_SURFACE_SET_FONT                = 0x409,  /* object */
+     DCM_SURFACE_FILL_RECTANGLES         = 0x40a,  /* DFBRectangle[] */
+     DCM_SURFACE_DRAW_RECTANGLE          = 0x40b,  /* DFBRectangle[1] */
+     DCM_SURFACE_DRAW_LINES              = 0x40c,  /* DFBRegion[] */
+     DCM_SURFACE_BLIT                    = 0x40d,  /* object, DFBRectangle[0/1], s32 x, s32 y */
+     DCM_SURFACE_BATCH_BLIT              = 0x40e,  /* object, DFBRectangle[], DFBPoint[] */
+     DCM_SURFACE_STRETCH_BLIT            = 0x40f,  /* object, DFBRectangle[0/1], DFBRectangle[0/1] */
+     DCM_SURFACE_TILE_BLIT               = 0x410,  /* object, DFBRectangle[0/1], s32 x, s32 y */
+     DCM_SURFACE_DRAW_STRING             = 0x411,  /* char[] text, s32 x, s32 y, u32 flags */
+     DCM_SURFACE_FLIP                    = 0x412,  /* DFBRegion[0/1], u32 flags, ends a frame */
+     DCM_SURFACE_GET_SUB_SURFACE         = 0x413,  /* DFBRectangle[0/1], object */
+     DCM_SURFACE_SET_SRC_COLOR_KEY       = 0x414,  /* u32 rgb */
+     DCM_SURFACE_SET_DST_COLOR_KEY       = 0x415,  /* u32 rgb */
+     DCM_SURFACE_SET_RENDER_OPTIONS      = 0x416,  /* u32 options */
+     DCM_SURFACE_SET_MATRIX              = 0x417,  /* s32[0/9] */
+     DCM_SURFACE_SET_SOURCE_MASK         = 0x418,  /* object, s32 x, s32 y, u32 flags */
+     DCM_SURFACE_FILL_TRIANGLES          = 0x419,  /* DFBTriangle[] */
+     DCM_SURFACE_FILL_SPANS              = 0x41a,  /* s32 y, DFBSpan[] */
+     DCM_SURFACE_FILL_TRAPEZOIDS         = 0x41b,  /* DFBTrapezoid[] */
+     DCM_SURFACE_TEXTURE_TRIANGLES       = 0x41c,  /* object, DFBVertex[], int[] indices or empty, s32 num, u32 formation */
+     DCM_SURFACE_BATCH_BLIT2             = 0x41d,  /* object, object, DFBRectangle[], DFBPoint[], DFBPoint[] */
+     DCM_SURFACE_BATCH_STRETCH_BLIT      = 0x41e,  /* object, DFBRectangle[], DFBRectangle[] */
+     DCM_SURFACE_DRAW_GLYPH              = 0x41f   /* u32 character, s32 x, s32 y, u32 flags */
+} DFBCaptureMethod;
+
+
+/*
+ * Starts capturing the calls on the super interface and everything created via it.
+ */
+DFBResult dfb_capture_start( IDirectFB *idirectfb );
+
+/*
+ * Writes out pending messages and closes the file.
+ */
+void      dfb_capture_stop ( void );
+
+#endif
@@ -181,6 +181,7 @@ static const char *config_usage_strings[]  = {
      "  videoram-limit=<amount>        Limit amount of Video RAM in kb\n"
      "  agpmem-limit=<amount>          Limit amount of AGP memory in kb\n"
      "  screenshot-dir=<directory>     Dump screen content on <Print> key presses\n"
+     "  capture=<file>                 Record API calls and surface contents for dfbreplay\n"
      "  video-phys=<hexaddress>        Physical start of video memory (devmem system)\n"
      "  video-length=<bytes>           Length of video memory (devmem system)\n"
      "  mmio-phys=<hexaddress>         Physical start of MMIO area (devmem system)\n"
@@ -215,6 +216,7 @@ static const char *config_usage_strings[]  = {
      "  max-font-rows=<number>         Maximum number of glyph cache rows (total for all fonts)\n"
      "  max-font-row-width=<pixels>    Maximum width of glyph cache row surface\n"
      "  graphics-state-call-limit=<n>  Set FusionCall quota for graphics state object (default 5000)\n"
+     "  graphics-state-arena=<kb>      Shared memory for passing bulk arguments in place, rounded up to a power of two (default 64, 0 disables)\n"
      "\n",
      " Window surface swapping policy:\n"
      "  window-surface-policy=(auto|videohigh|videolow|systemonly|videoonly)\n"
@@ -526,6 +528,7 @@ static void config_allocate( void )
      dfb_config->screen_frame_interval   = 16666;
 
      dfb_config->graphics_state_call_limit = 5000;
+     dfb_config->graphics_state_arena      = 64;
 
      dfb_config->max_render_tasks          = 10;
      dfb_config->max_frame_advance         = 100000;
@@ -598,6 +601,17 @@ DFBResult dfb_config_set( const char *name, const char *value )
                return DFB_INVARG;
           }
      } else
+     if (strcmp (name, "capture" ) == 0) {
+          if (value) {
+               if (dfb_config->capture)
+                    D_FREE( dfb_config->capture );
+               dfb_config->capture = D_STRDUP( value );
+          }
+          else {
+               D_ERROR("DirectFB/Config 'capture': No file name specified!\n");
+               return DFB_INVARG;
+          }
+     } else
      if (strcmp (name, "scaled" ) == 0) {
           if (value) {
                int width, height;
@@ -1876,6 +1890,25 @@ DFBResult dfb_config_set( const char *name, const char *value )
                return DFB_INVARG;
           }
      } else
+     if (strcmp (name, "graphics-state-arena" ) == 0) {
+          if (value) {
+               char *error;
+               unsigned long size;
+
+               size = strtoul( value, &error, 10 );
+
+               if (*error) {
+                    D_ERROR( "DirectFB/Config '%s': Error in value '%s'!\n", name, error );
+                    return DFB_INVARG;
+               }
+
+               dfb_config->graphics_state_arena = size;
+          }
+          else {
+               D_ERROR( "DirectFB/Config '%s': No value specified!\n", name );
+               return DFB_INVARG;
+          }
+     } else
      if (strcmp (name, "always-flush-callbuffer" ) == 0) {
           dfb_config->always_flush_callbuffer = true;
      } else
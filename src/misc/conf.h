@@ -314,6 +314,7 @@ typedef struct
      bool          surface_clear;
 
      unsigned int  graphics_state_call_limit;
+     unsigned int  graphics_state_arena;
 
      bool          always_flush_callbuffer;
      unsigned int  layers_fps;
@@ -330,6 +331,8 @@ typedef struct
      bool          ownership_check;
 
      bool          force_frametime;
+
+     char         *capture;                           /* record API calls into this file */
 } DFBConfig;
 
 extern DFBConfig DIRECTFB_API *dfb_config;
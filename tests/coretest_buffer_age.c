@@ -0,0 +1,170 @@
+/*
+   (c) Copyright 2012-2013  DirectFB integrated media GmbH
+   (c) Copyright 2001-2013  The world wide DirectFB Open Source Community (directfb.org)
+   (c) Copyright 2000-2004  Convergence (integrated media) GmbH
+
+   All rights reserved.
+
+   Written by Denis Oliver Kropp <dok@directfb.org>,
+              Andreas Shimokawa <andi@directfb.org>,
+              Marek Pikarski <mass@directfb.org>,
+              Sven Neumann <neo@directfb.org>,
+              Ville Syrjälä <syrjala@sci.fi> and
+              Claudio Ciccani <klan@users.sf.net>.
+
+   This file is subject to the terms and conditions of the MIT License:
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation
+   files (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <config.h>
+
+#include <direct/messages.h>
+
+#include <core/core.h>
+#include <core/surface.h>
+
+#include <core/CoreSurface.h>
+
+#include <directfb.h>
+
+
+#define NUM_FLIPS  10
+
+
+static DFBResult
+check_age( CoreSurface *surface, const char *what, int flip, u32 expected )
+{
+     u32 age;
+
+     dfb_surface_lock( surface );
+
+     age = dfb_surface_buffer_age( surface, CSBR_BACK, DSSE_LEFT, surface->flips );
+
+     dfb_surface_unlock( surface );
+
+     if (age != expected) {
+          D_ERROR( "CoreTest/BufferAge: Age after %s flip %d is %u, expected %u!\n", what, flip, age, expected );
+          return DFB_FAILURE;
+     }
+
+     return DFB_OK;
+}
+
+int
+main( int argc, char *argv[] )
+{
+     int          i;
+     DFBResult    ret;
+     DFBRegion    region = { 0, 0, 9, 9 };
+     IDirectFB   *dfb;
+     CoreDFB     *core;
+     CoreSurface *surface;
+
+     /* Initialize DirectFB. */
+     ret = DirectFBInit( &argc, &argv );
+     if (ret) {
+          D_DERROR( ret, "CoreTest/BufferAge: DirectFBInit() failed!\n" );
+          return ret;
+     }
+
+
+     /* Create super interface. */
+     ret = DirectFBCreate( &dfb );
+     if (ret) {
+          D_DERROR( ret, "CoreTest/BufferAge: DirectFBCreate() failed!\n" );
+          return ret;
+     }
+
+     dfb_core_create( &core );
+
+
+     /*
+      * This test flips a double buffered surface in different ways and checks
+      * that each flip advances the age of the back buffer exactly once.
+      */
+
+     ret = dfb_surface_create_simple( core, 64, 64, DSPF_ARGB, DSCS_RGB, DSCAPS_SYSTEMONLY | DSCAPS_DOUBLE,
+                                      CSTF_NONE, 0, NULL, &surface );
+     if (ret) {
+          D_DERROR( ret, "CoreTest/BufferAge: dfb_surface_create_simple() failed!\n" );
+          goto error_surface;
+     }
+
+     /* Never presented. */
+     ret = check_age( surface, "no", 0, 0 );
+     if (ret)
+          goto error;
+
+     /* Swapping, the back buffer has been shown before the last frame (after the first flip). */
+     for (i=1; i<=NUM_FLIPS; i++) {
+          ret = CoreSurface_Flip2( surface, DFB_FALSE, NULL, NULL, DSFLIP_NONE, 0 );
+          if (ret) {
+               D_DERROR( ret, "CoreTest/BufferAge: CoreSurface_Flip2() failed!\n" );
+               goto error;
+          }
+
+          ret = check_age( surface, "swapping", i, i == 1 ? 0 : 2 );
+          if (ret)
+               goto error;
+     }
+
+     /* Copying, the back buffer always holds the last frame. */
+     for (i=1; i<=NUM_FLIPS; i++) {
+          ret = CoreSurface_Flip2( surface, DFB_FALSE, &region, NULL, DSFLIP_BLIT, 0 );
+          if (ret) {
+               D_DERROR( ret, "CoreTest/BufferAge: CoreSurface_Flip2( DSFLIP_BLIT ) failed!\n" );
+               goto error;
+          }
+
+          ret = check_age( surface, "copying", i, 1 );
+          if (ret)
+               goto error;
+     }
+
+     /* Dispatching updates with a flip count like the task manager does (front has been stale before). */
+     for (i=1; i<=NUM_FLIPS; i++) {
+          ret = CoreSurface_DispatchUpdate( surface, DFB_FALSE, NULL, NULL, DSFLIP_NONE, 0, surface->flips + 1 );
+          if (ret) {
+               D_DERROR( ret, "CoreTest/BufferAge: CoreSurface_DispatchUpdate() failed!\n" );
+               goto error;
+          }
+
+          if (i > 1) {
+               ret = check_age( surface, "dispatched", i, 2 );
+               if (ret)
+                    goto error;
+          }
+     }
+
+     D_INFO( "CoreTest/BufferAge: OK\n" );
+
+
+error:
+     dfb_surface_unref( surface );
+
+error_surface:
+     dfb_core_destroy( core, false );
+
+     /* Shutdown DirectFB. */
+     dfb->Release( dfb );
+
+     return ret;
+}
@@ -0,0 +1,202 @@
+/*
+   (c) Copyright 2012-2013  DirectFB integrated media GmbH
+   (c) Copyright 2001-2013  The world wide DirectFB Open Source Community (directfb.org)
+   (c) Copyright 2000-2004  Convergence (integrated media) GmbH
+
+   All rights reserved.
+
+   Written by Denis Oliver Kropp <dok@directfb.org>,
+              Andreas Shimokawa <andi@directfb.org>,
+              Marek Pikarski <mass@directfb.org>,
+              Sven Neumann <neo@directfb.org>,
+              Ville Syrjälä <syrjala@sci.fi> and
+              Claudio Ciccani <klan@users.sf.net>.
+
+   This file is subject to the terms and conditions of the MIT License:
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation
+   files (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <config.h>
+
+#include <direct/messages.h>
+
+#include <core/core.h>
+#include <core/surface.h>
+#include <core/surface_allocation.h>
+#include <core/surface_buffer.h>
+
+#include <directfb.h>
+#include <directfb_util.h>
+
+
+static DFBResult
+write_region( CoreSurface *surface, int x1, int y1, int x2, int y2 )
+{
+     DFBResult             ret;
+     DFBRegion             region = { x1, y1, x2, y2 };
+     CoreSurfaceBufferLock lock;
+
+     ret = dfb_surface_lock_buffer3( surface, CSBR_BACK, surface->flips, DSSE_LEFT,
+                                     CSAID_CPU, CSAF_WRITE, &region, &lock );
+     if (ret) {
+          D_DERROR( ret, "CoreTest/Damage: dfb_surface_lock_buffer3() failed!\n" );
+          return ret;
+     }
+
+     dfb_surface_unlock_buffer( surface, &lock );
+
+     return DFB_OK;
+}
+
+static DFBResult
+check_damage( CoreSurface *surface, int num, int x1, int y1, int x2, int y2 )
+{
+     DFBResult          ret = DFB_OK;
+     CoreSurfaceBuffer *buffer;
+
+     dfb_surface_lock( surface );
+
+     buffer = dfb_surface_get_buffer( surface, CSBR_BACK );
+
+     if (buffer->damage.num_regions != num ||
+         buffer->damage.bounding.x1 != x1 || buffer->damage.bounding.y1 != y1 ||
+         buffer->damage.bounding.x2 != x2 || buffer->damage.bounding.y2 != y2)
+     {
+          D_ERROR( "CoreTest/Damage: Got %d regions within %d,%d-%d,%d, expected %d within %d,%d-%d,%d!\n",
+                   buffer->damage.num_regions, DFB_REGION_VALS( &buffer->damage.bounding ), num, x1, y1, x2, y2 );
+          ret = DFB_FAILURE;
+     }
+
+     dfb_surface_unlock( surface );
+
+     return ret;
+}
+
+static void
+reset_damage( CoreSurface *surface )
+{
+     dfb_surface_lock( surface );
+
+     dfb_updates_reset( &dfb_surface_get_buffer( surface, CSBR_BACK )->damage );
+
+     dfb_surface_unlock( surface );
+}
+
+int
+main( int argc, char *argv[] )
+{
+     int          i;
+     DFBResult    ret;
+     IDirectFB   *dfb;
+     CoreDFB     *core;
+     CoreSurface *surface;
+
+     /* Initialize DirectFB. */
+     ret = DirectFBInit( &argc, &argv );
+     if (ret) {
+          D_DERROR( ret, "CoreTest/Damage: DirectFBInit() failed!\n" );
+          return ret;
+     }
+
+
+     /* Create super interface. */
+     ret = DirectFBCreate( &dfb );
+     if (ret) {
+          D_DERROR( ret, "CoreTest/Damage: DirectFBCreate() failed!\n" );
+          return ret;
+     }
+
+     dfb_core_create( &core );
+
+
+     /*
+      * This test writes different regions of a surface buffer and checks
+      * the damage being accumulated, clipped and collapsed.
+      */
+
+     ret = dfb_surface_create_simple( core, 200, 200, DSPF_ARGB, DSCS_RGB, DSCAPS_SYSTEMONLY, CSTF_NONE, 0, NULL, &surface );
+     if (ret) {
+          D_DERROR( ret, "CoreTest/Damage: dfb_surface_create_simple() failed!\n" );
+          goto error_surface;
+     }
+
+     /* New buffers are damaged as a whole. */
+     ret = check_damage( surface, 1, 0, 0, 199, 199 );
+     if (ret)
+          goto error;
+
+     reset_damage( surface );
+
+     /* Single region. */
+     ret = write_region( surface, 10, 10, 49, 49 );
+     if (!ret)
+          ret = check_damage( surface, 1, 10, 10, 49, 49 );
+     if (ret)
+          goto error;
+
+     /* Disjoint region partly outside gets clipped and added. */
+     ret = write_region( surface, 150, 150, 299, 299 );
+     if (!ret)
+          ret = check_damage( surface, 2, 10, 10, 199, 199 );
+     if (ret)
+          goto error;
+
+     /* Region being completely outside does not add anything. */
+     ret = write_region( surface, 300, 300, 399, 399 );
+     if (!ret)
+          ret = check_damage( surface, 2, 10, 10, 199, 199 );
+     if (ret)
+          goto error;
+
+     /* Overlapping region gets combined with the first. */
+     ret = write_region( surface, 40, 40, 59, 59 );
+     if (!ret)
+          ret = check_damage( surface, 2, 10, 10, 199, 199 );
+     if (ret)
+          goto error;
+
+     reset_damage( surface );
+
+     /* Too many disjoint regions collapse to the bounding box. */
+     for (i=0; i<=CORE_SURFACE_DAMAGE_REGIONS; i++) {
+          ret = write_region( surface, i * 20, 0, i * 20 + 9, 9 );
+          if (ret)
+               goto error;
+     }
+
+     ret = check_damage( surface, 1, 0, 0, CORE_SURFACE_DAMAGE_REGIONS * 20 + 9, 9 );
+     if (ret)
+          goto error;
+
+     D_INFO( "CoreTest/Damage: OK\n" );
+
+
+error:
+     dfb_surface_unref( surface );
+
+error_surface:
+     dfb_core_destroy( core, false );
+
+     /* Shutdown DirectFB. */
+     dfb->Release( dfb );
+
+     return ret;
+}
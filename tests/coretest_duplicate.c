@@ -0,0 +1,241 @@
+/*
+   (c) Copyright 2012-2013  DirectFB integrated media GmbH
+   (c) Copyright 2001-2013  The world wide DirectFB Open Source Community (directfb.org)
+   (c) Copyright 2000-2004  Convergence (integrated media) GmbH
+
+   All rights reserved.
+
+   Written by Denis Oliver Kropp <dok@directfb.org>,
+              Andreas Shimokawa <andi@directfb.org>,
+              Marek Pikarski <mass@directfb.org>,
+              Sven Neumann <neo@directfb.org>,
+              Ville Syrjälä <syrjala@sci.fi> and
+              Claudio Ciccani <klan@users.sf.net>.
+
+   This file is subject to the terms and conditions of the MIT License:
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation
+   files (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <config.h>
+
+#include <direct/messages.h>
+
+#include <core/core.h>
+#include <core/surface.h>
+#include <core/surface_buffer.h>
+
+#include <directfb.h>
+#include <directfb_util.h>
+
+
+#define SIZE 16
+
+static DFBResult
+fill_surface( CoreSurface *surface, u32 pixel )
+{
+     DFBResult ret;
+     int       i;
+     u32       pixels[SIZE * SIZE];
+
+     for (i=0; i<SIZE * SIZE; i++)
+          pixels[i] = pixel;
+
+     ret = dfb_surface_write_buffer( surface, CSBR_FRONT, pixels, SIZE * 4, NULL );
+     if (ret)
+          D_DERROR( ret, "CoreTest/Duplicate: dfb_surface_write_buffer() failed!\n" );
+
+     return ret;
+}
+
+static DFBResult
+check_pixels( const char *what, const u32 *pixels, int pitch, u32 pixel )
+{
+     int x, y;
+
+     for (y=0; y<SIZE; y++) {
+          for (x=0; x<SIZE; x++) {
+               u32 value = pixels[y * pitch / 4 + x];
+
+               if (value != pixel) {
+                    D_ERROR( "CoreTest/Duplicate: %s has 0x%08x at %d,%d, expected 0x%08x!\n", what, value, x, y, pixel );
+                    return DFB_FAILURE;
+               }
+          }
+     }
+
+     return DFB_OK;
+}
+
+static DFBResult
+check_surface( const char *what, CoreSurface *surface, u32 pixel )
+{
+     DFBResult ret;
+     u32       pixels[SIZE * SIZE];
+
+     ret = dfb_surface_read_buffer( surface, CSBR_FRONT, pixels, SIZE * 4, NULL );
+     if (ret) {
+          D_DERROR( ret, "CoreTest/Duplicate: dfb_surface_read_buffer() failed!\n" );
+          return ret;
+     }
+
+     return check_pixels( what, pixels, SIZE * 4, pixel );
+}
+
+static bool
+is_shared( CoreSurface *surface )
+{
+     bool shared;
+
+     dfb_surface_lock( surface );
+
+     shared = dfb_surface_get_buffer( surface, CSBR_FRONT )->cow != NULL;
+
+     dfb_surface_unlock( surface );
+
+     return shared;
+}
+
+int
+main( int argc, char *argv[] )
+{
+     DFBResult              ret;
+     IDirectFB             *dfb;
+     CoreDFB               *core;
+     CoreSurface           *surface;
+     CoreSurface           *duplicate = NULL;
+     CoreSurfaceBufferLock  lock;
+
+     /* Initialize DirectFB. */
+     ret = DirectFBInit( &argc, &argv );
+     if (ret) {
+          D_DERROR( ret, "CoreTest/Duplicate: DirectFBInit() failed!\n" );
+          return ret;
+     }
+
+
+     /* Create super interface. */
+     ret = DirectFBCreate( &dfb );
+     if (ret) {
+          D_DERROR( ret, "CoreTest/Duplicate: DirectFBCreate() failed!\n" );
+          return ret;
+     }
+
+     dfb_core_create( &core );
+
+
+     /*
+      * This test duplicates a surface and checks that writing to either one
+      * does not show up in the other, while reading keeps the content shared.
+      */
+
+     ret = dfb_surface_create_simple( core, SIZE, SIZE, DSPF_ARGB, DSCS_RGB, DSCAPS_SYSTEMONLY, CSTF_NONE, 0, NULL, &surface );
+     if (ret) {
+          D_DERROR( ret, "CoreTest/Duplicate: dfb_surface_create_simple() failed!\n" );
+          goto error_surface;
+     }
+
+     ret = fill_surface( surface, 0xff111111 );
+     if (ret)
+          goto error;
+
+     ret = dfb_surface_duplicate( core, surface, &duplicate );
+     if (ret) {
+          D_DERROR( ret, "CoreTest/Duplicate: dfb_surface_duplicate() failed!\n" );
+          goto error;
+     }
+
+     /* Reading the duplicate does not copy the content. */
+     ret = check_surface( "duplicate", duplicate, 0xff111111 );
+     if (ret)
+          goto error;
+
+     if (!is_shared( duplicate )) {
+          D_ERROR( "CoreTest/Duplicate: Reading the duplicate copied the content!\n" );
+          ret = DFB_FAILURE;
+          goto error;
+     }
+
+     /* Writing the source while the duplicate is locked for reading must not show up in the lock. */
+     ret = dfb_surface_lock_buffer( duplicate, CSBR_FRONT, CSAID_CPU, CSAF_READ, &lock );
+     if (ret) {
+          D_DERROR( ret, "CoreTest/Duplicate: dfb_surface_lock_buffer() failed!\n" );
+          goto error;
+     }
+
+     ret = fill_surface( surface, 0xff222222 );
+     if (!ret)
+          ret = check_pixels( "locked duplicate", lock.addr, lock.pitch, 0xff111111 );
+
+     dfb_surface_unlock_buffer( duplicate, &lock );
+
+     if (ret)
+          goto error;
+
+     /* Snapshot isolation after writing the source. */
+     ret = check_surface( "duplicate", duplicate, 0xff111111 );
+     if (!ret)
+          ret = check_surface( "source", surface, 0xff222222 );
+     if (ret)
+          goto error;
+
+     dfb_surface_unref( duplicate );
+
+     /* Writing a duplicate gives it its own copy, leaving the source alone. */
+     ret = dfb_surface_duplicate( core, surface, &duplicate );
+     if (ret) {
+          D_DERROR( ret, "CoreTest/Duplicate: dfb_surface_duplicate() failed!\n" );
+          duplicate = NULL;
+          goto error;
+     }
+
+     ret = fill_surface( duplicate, 0xff333333 );
+     if (ret)
+          goto error;
+
+     if (is_shared( duplicate )) {
+          D_ERROR( "CoreTest/Duplicate: Writing the duplicate did not detach it!\n" );
+          ret = DFB_FAILURE;
+          goto error;
+     }
+
+     ret = check_surface( "duplicate", duplicate, 0xff333333 );
+     if (!ret)
+          ret = check_surface( "source", surface, 0xff222222 );
+     if (ret)
+          goto error;
+
+     D_INFO( "CoreTest/Duplicate: OK\n" );
+
+
+error:
+     if (duplicate)
+          dfb_surface_unref( duplicate );
+
+     dfb_surface_unref( surface );
+
+error_surface:
+     dfb_core_destroy( core, false );
+
+     /* Shutdown DirectFB. */
+     dfb->Release( dfb );
+
+     return ret;
+}
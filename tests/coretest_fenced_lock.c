@@ -0,0 +1,207 @@
+/*
+   (c) Copyright 2012-2013  DirectFB integrated media GmbH
+   (c) Copyright 2001-2013  The world wide DirectFB Open Source Community (directfb.org)
+   (c) Copyright 2000-2004  Convergence (integrated media) GmbH
+
+   All rights reserved.
+
+   Written by Denis Oliver Kropp <dok@directfb.org>,
+              Andreas Shimokawa <andi@directfb.org>,
+              Marek Pikarski <mass@directfb.org>,
+              Sven Neumann <neo@directfb.org>,
+              Ville Syrjälä <syrjala@sci.fi> and
+              Claudio Ciccani <klan@users.sf.net>.
+
+   This file is subject to the terms and conditions of the MIT License:
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation
+   files (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <config.h>
+
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <sys/eventfd.h>
+
+#include <direct/clock.h>
+#include <direct/messages.h>
+#include <direct/thread.h>
+#include <direct/util.h>
+
+#include <core/core.h>
+#include <core/surface.h>
+#include <core/surface_buffer.h>
+
+#include <directfb.h>
+#include <directfb_util.h>
+
+
+#define SIZE      16
+#define DELAY_MS  100
+
+static void *
+signal_thread( DirectThread *thread, void *arg )
+{
+     int fence = (long) arg;
+
+     direct_thread_sleep( DELAY_MS * 1000 );
+
+     eventfd_write( fence, 1 );
+
+     return NULL;
+}
+
+int
+main( int argc, char *argv[] )
+{
+     DFBResult              ret;
+     IDirectFB             *dfb;
+     CoreDFB               *core;
+     CoreSurface           *surface;
+     CoreSurfaceBufferLock  lock;
+     DirectThread          *thread;
+     int                    granted;
+     int                    fence;
+     int                    x, y;
+     long long              start;
+     long long              elapsed;
+     u32                    pixels[SIZE * SIZE];
+
+     /* Initialize DirectFB. */
+     ret = DirectFBInit( &argc, &argv );
+     if (ret) {
+          D_DERROR( ret, "CoreTest/FencedLock: DirectFBInit() failed!\n" );
+          return ret;
+     }
+
+
+     /* Create super interface. */
+     ret = DirectFBCreate( &dfb );
+     if (ret) {
+          D_DERROR( ret, "CoreTest/FencedLock: DirectFBCreate() failed!\n" );
+          return ret;
+     }
+
+     dfb_core_create( &core );
+
+
+     /*
+      * This test writes a surface via a fenced lock and checks that the content
+      * can only be read back after the fence passed to the unlock is signalled.
+      */
+
+     ret = dfb_surface_create_simple( core, SIZE, SIZE, DSPF_ARGB, DSCS_RGB, DSCAPS_SYSTEMONLY, CSTF_NONE, 0, NULL, &surface );
+     if (ret) {
+          D_DERROR( ret, "CoreTest/FencedLock: dfb_surface_create_simple() failed!\n" );
+          goto error_surface;
+     }
+
+     ret = dfb_surface_lock_buffer_fenced( surface, CSBR_BACK, surface->flips, DSSE_LEFT,
+                                           CSAID_CPU, CSAF_WRITE, &lock, &granted );
+     if (ret) {
+          D_DERROR( ret, "CoreTest/FencedLock: dfb_surface_lock_buffer_fenced() failed!\n" );
+          goto error;
+     }
+
+     /* The lock may be granted later, but the fence must become readable. */
+     if (granted >= 0) {
+          struct pollfd pfd = { granted, POLLIN, 0 };
+
+          if (poll( &pfd, 1, 5000 ) != 1) {
+               D_ERROR( "CoreTest/FencedLock: Lock not granted within 5 seconds!\n" );
+               ret = DFB_TIMEOUT;
+               goto error;
+          }
+     }
+
+     for (y=0; y<SIZE; y++) {
+          for (x=0; x<SIZE; x++)
+               ((u32*)(lock.addr + y * lock.pitch))[x] = 0xff112233;
+     }
+
+     fence = eventfd( 0, EFD_CLOEXEC );
+     if (fence < 0) {
+          ret = errno2result( errno );
+          D_DERROR( ret, "CoreTest/FencedLock: Could not create eventfd!\n" );
+          dfb_surface_unlock_buffer_fenced( surface, &lock, -1 );
+          goto error;
+     }
+
+     /* The signalling thread keeps its own descriptor, the unlock takes over ours. */
+     thread = direct_thread_create( DTT_DEFAULT, signal_thread, (void*)(long) dup( fence ), "Fence Signal" );
+     if (!thread) {
+          D_ERROR( "CoreTest/FencedLock: Could not create thread!\n" );
+          eventfd_write( fence, 1 );
+          dfb_surface_unlock_buffer_fenced( surface, &lock, fence );
+          ret = DFB_INIT;
+          goto error;
+     }
+
+     start = direct_clock_get_millis();
+
+     ret = dfb_surface_unlock_buffer_fenced( surface, &lock, fence );
+     if (ret) {
+          D_DERROR( ret, "CoreTest/FencedLock: dfb_surface_unlock_buffer_fenced() failed!\n" );
+          goto error_thread;
+     }
+
+     /* Reading has to wait for the fence. */
+     ret = dfb_surface_read_buffer( surface, CSBR_BACK, pixels, SIZE * 4, NULL );
+     if (ret) {
+          D_DERROR( ret, "CoreTest/FencedLock: dfb_surface_read_buffer() failed!\n" );
+          goto error_thread;
+     }
+
+     elapsed = direct_clock_get_millis() - start;
+
+     if (elapsed < DELAY_MS * 9 / 10) {
+          D_ERROR( "CoreTest/FencedLock: Read after %lld ms, before the fence was signalled!\n", elapsed );
+          ret = DFB_FAILURE;
+          goto error_thread;
+     }
+
+     for (x=0; x<SIZE * SIZE; x++) {
+          if (pixels[x] != 0xff112233) {
+               D_ERROR( "CoreTest/FencedLock: Read 0x%08x at %d, expected 0xff112233!\n", pixels[x], x );
+               ret = DFB_FAILURE;
+               goto error_thread;
+          }
+     }
+
+     D_INFO( "CoreTest/FencedLock: OK (read after %lld ms)\n", elapsed );
+
+
+error_thread:
+     direct_thread_join( thread );
+     direct_thread_destroy( thread );
+
+error:
+     dfb_surface_unref( surface );
+
+error_surface:
+     dfb_core_destroy( core, false );
+
+     /* Shutdown DirectFB. */
+     dfb->Release( dfb );
+
+     return ret;
+}
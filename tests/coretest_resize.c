@@ -0,0 +1,158 @@
+/*
+   (c) Copyright 2012-2013  DirectFB integrated media GmbH
+   (c) Copyright 2001-2013  The world wide DirectFB Open Source Community (directfb.org)
+   (c) Copyright 2000-2004  Convergence (integrated media) GmbH
+
+   All rights reserved.
+
+   Written by Denis Oliver Kropp <dok@directfb.org>,
+              Andreas Shimokawa <andi@directfb.org>,
+              Marek Pikarski <mass@directfb.org>,
+              Sven Neumann <neo@directfb.org>,
+              Ville Syrjälä <syrjala@sci.fi> and
+              Claudio Ciccani <klan@users.sf.net>.
+
+   This file is subject to the terms and conditions of the MIT License:
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation
+   files (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <config.h>
+
+#include <direct/messages.h>
+
+#include <core/core.h>
+#include <core/surface.h>
+#include <core/surface_allocation.h>
+
+#include <directfb.h>
+
+
+#define NUM_RESIZES      1000
+#define MAX_ALLOCATIONS  (NUM_RESIZES / 10)
+
+
+static DFBResult
+check_allocation( CoreSurface *surface, FusionObjectID *id, int *count )
+{
+     DFBResult             ret;
+     CoreSurfaceBufferLock lock;
+
+     ret = dfb_surface_lock_buffer( surface, CSBR_BACK, CSAID_CPU, CSAF_WRITE, &lock );
+     if (ret) {
+          D_DERROR( ret, "CoreTest/Resize: dfb_surface_lock_buffer() failed!\n" );
+          return ret;
+     }
+
+     /* Object IDs are not reused, unlike addresses. */
+     if (lock.allocation->object.id != *id) {
+          *id = lock.allocation->object.id;
+
+          (*count)++;
+     }
+
+     dfb_surface_unlock_buffer( surface, &lock );
+
+     return DFB_OK;
+}
+
+int
+main( int argc, char *argv[] )
+{
+     int                i;
+     int                count = 0;
+     FusionObjectID     id    = 0;
+     DFBResult          ret;
+     IDirectFB         *dfb;
+     CoreDFB           *core;
+     CoreSurface       *surface;
+     CoreSurfaceConfig  config;
+
+     /* Initialize DirectFB. */
+     ret = DirectFBInit( &argc, &argv );
+     if (ret) {
+          D_DERROR( ret, "CoreTest/Resize: DirectFBInit() failed!\n" );
+          return ret;
+     }
+
+
+     /* Create super interface. */
+     ret = DirectFBCreate( &dfb );
+     if (ret) {
+          D_DERROR( ret, "CoreTest/Resize: DirectFBCreate() failed!\n" );
+          return ret;
+     }
+
+     dfb_core_create( &core );
+
+
+     /*
+      * This test creates a window surface and resizes it back and forth like
+      * during interactive resizing, counting the allocations being created.
+      */
+
+     ret = dfb_surface_create_simple( core, 200, 200, DSPF_ARGB, DSCS_RGB, DSCAPS_SYSTEMONLY, CSTF_WINDOW, 0, NULL, &surface );
+     if (ret) {
+          D_DERROR( ret, "CoreTest/Resize: dfb_surface_create_simple() failed!\n" );
+          goto error_surface;
+     }
+
+     ret = check_allocation( surface, &id, &count );
+     if (ret)
+          goto error;
+
+     for (i=0; i<NUM_RESIZES; i++) {
+          int step = (i < NUM_RESIZES / 2) ? i : NUM_RESIZES - 1 - i;
+
+          config.flags  = CSCONF_SIZE;
+          config.size.w = 200 + step;
+          config.size.h = 200 + step / 2;
+
+          ret = dfb_surface_reconfig( surface, &config );
+          if (ret) {
+               D_DERROR( ret, "CoreTest/Resize: dfb_surface_reconfig( %dx%d ) failed!\n", config.size.w, config.size.h );
+               goto error;
+          }
+
+          ret = check_allocation( surface, &id, &count );
+          if (ret)
+               goto error;
+     }
+
+     D_INFO( "CoreTest/Resize: %d resizes needed %d allocations\n", NUM_RESIZES, count );
+
+     if (count > MAX_ALLOCATIONS) {
+          D_ERROR( "CoreTest/Resize: Too many allocations (%d > %d)!\n", count, MAX_ALLOCATIONS );
+          ret = DFB_FAILURE;
+     }
+
+
+error:
+     dfb_surface_unref( surface );
+
+error_surface:
+     dfb_core_destroy( core, false );
+
+     /* Shutdown DirectFB. */
+     dfb->Release( dfb );
+
+     return ret;
+}
+
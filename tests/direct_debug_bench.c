@@ -0,0 +1,224 @@
+/*
+   (c) Copyright 2012-2013  DirectFB integrated media GmbH
+   (c) Copyright 2001-2013  The world wide DirectFB Open Source Community (directfb.org)
+   (c) Copyright 2000-2004  Convergence (integrated media) GmbH
+
+   All rights reserved.
+
+   Written by Denis Oliver Kropp <dok@directfb.org>,
+              Andreas Shimokawa <andi@directfb.org>,
+              Marek Pikarski <mass@directfb.org>,
+              Sven Neumann <neo@directfb.org>,
+              Ville Syrjälä <syrjala@sci.fi> and
+              Claudio Ciccani <klan@users.sf.net>.
+
+   This file is subject to the terms and conditions of the MIT License:
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation
+   files (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+
+/*
+ * Force the debug macros even in release builds, the library needs debug support (DIRECT_BUILD_DEBUGS).
+ */
+#define DIRECT_ENABLE_DEBUG
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <direct/clock.h>
+#include <direct/conf.h>
+#include <direct/debug.h>
+#include <direct/direct.h>
+#include <direct/log_domain.h>
+#include <direct/messages.h>
+
+D_DEBUG_DOMAIN( Bench_Domain, "Bench/Domain", "Disabled domain used for the benchmark" );
+
+/**********************************************************************************************************************/
+
+static int num_loops = 20000000;
+
+/**********************************************************************************************************************/
+
+static int parse_cmdline ( int argc, char *argv[] );
+static int show_usage    ( void );
+
+/**********************************************************************************************************************/
+
+static volatile unsigned int sink;
+
+/* Some work per iteration, so the loop doesn't collapse */
+static unsigned int __attribute__((noinline))
+work( unsigned int value )
+{
+     return value * 2654435761u;
+}
+
+/* Stands for argument generation like ToString<> or dfb_pixelformat_name() */
+static const char * __attribute__((noinline))
+describe( unsigned int value )
+{
+     static char buf[32];
+
+     snprintf( buf, sizeof(buf), "0x%08x", value );
+
+     return buf;
+}
+
+static long long
+report( const char *impl, long long start, long long base )
+{
+     long long time = direct_clock_get_abs_micros() - start;
+
+     if (base)
+          printf( "%-22s %9lld us %7.2f ns/loop  (%+.2f ns)\n", impl, time, time * 1000.0 / num_loops,
+                  (time - base) * 1000.0 / num_loops );
+     else
+          printf( "%-22s %9lld us %7.2f ns/loop\n", impl, time, time * 1000.0 / num_loops );
+
+     return time;
+}
+
+int
+main( int argc, char *argv[] )
+{
+     long long    start;
+     long long    base;
+     unsigned int i;
+     unsigned int acc;
+
+     if (parse_cmdline( argc, argv ))
+          return -1;
+
+     direct_initialize();
+
+     /* Make sure the domain is off even if debug output was requested in general. */
+     direct_log_domain_config_level( "Bench/Domain", DIRECT_LOG_NONE );
+
+     if (direct_log_domain_check( &Bench_Domain )) {
+          D_ERROR( "Bench/Domain should be disabled!\n" );
+          return -2;
+     }
+
+     printf( "\n%d loops, domain '%s' disabled\n\n", num_loops, Bench_Domain.name );
+
+
+     /* Release build, no debug code at all. */
+     start = direct_clock_get_abs_micros();
+
+     for (i=0, acc=0; i<(unsigned int) num_loops; i++)
+          acc += work( i );
+
+     sink = acc;
+     base = report( "release", start, 0 );
+
+
+     /* Cached level check in the macro, arguments not evaluated. */
+     start = direct_clock_get_abs_micros();
+
+     for (i=0, acc=0; i<(unsigned int) num_loops; i++) {
+          acc += work( i );
+
+          D_DEBUG_AT( Bench_Domain, "%s( %u, %u )\n", __FUNCTION__, i, acc );
+     }
+
+     sink = acc;
+     report( "D_DEBUG_AT", start, base );
+
+     start = direct_clock_get_abs_micros();
+
+     for (i=0, acc=0; i<(unsigned int) num_loops; i++) {
+          acc += work( i );
+
+          D_DEBUG_AT( Bench_Domain, "%s( %u ) %s\n", __FUNCTION__, i, describe( acc ) );
+     }
+
+     sink = acc;
+     report( "D_DEBUG_AT (describe)", start, base );
+
+
+#if DIRECT_BUILD_DEBUGS
+     /* Calling into the library for every message, like the macros did before. */
+     start = direct_clock_get_abs_micros();
+
+     for (i=0, acc=0; i<(unsigned int) num_loops; i++) {
+          acc += work( i );
+
+          direct_debug_at( &Bench_Domain, "%s( %u, %u )\n", __FUNCTION__, i, acc );
+     }
+
+     sink = acc;
+     report( "call", start, base );
+
+     start = direct_clock_get_abs_micros();
+
+     for (i=0, acc=0; i<(unsigned int) num_loops; i++) {
+          acc += work( i );
+
+          direct_debug_at( &Bench_Domain, "%s( %u ) %s\n", __FUNCTION__, i, describe( acc ) );
+     }
+
+     sink = acc;
+     report( "call (describe)", start, base );
+#endif
+
+     printf( "\n" );
+
+     direct_shutdown();
+
+     return 0;
+}
+
+/**********************************************************************************************************************/
+
+static int
+parse_cmdline( int argc, char *argv[] )
+{
+     int i;
+
+     for (i=1; i<argc; i++) {
+          if (!strcmp( argv[i], "-n" ) && i+1 < argc && atoi( argv[i+1] ) > 0)
+               num_loops = atoi( argv[++i] );
+          else
+               return show_usage();
+     }
+
+     return 0;
+}
+
+static int
+show_usage( void )
+{
+     fprintf( stderr, "\n"
+                      "Usage:\n"
+                      "   direct_debug_bench [options]\n"
+                      "\n"
+                      "Options:\n"
+                      "   -n <num>  Number of loops (default 20000000)\n"
+                      "\n"
+              );
+
+     return -1;
+}
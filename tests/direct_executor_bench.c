@@ -0,0 +1,395 @@
+/*
+   (c) Copyright 2012-2013  DirectFB integrated media GmbH
+   (c) Copyright 2001-2013  The world wide DirectFB Open Source Community (directfb.org)
+   (c) Copyright 2000-2004  Convergence (integrated media) GmbH
+
+   All rights reserved.
+
+   Written by Denis Oliver Kropp <dok@directfb.org>,
+              Andreas Shimokawa <andi@directfb.org>,
+              Marek Pikarski <mass@directfb.org>,
+              Sven Neumann <neo@directfb.org>,
+              Ville Syrjälä <syrjala@sci.fi> and
+              Claudio Ciccani <klan@users.sf.net>.
+
+   This file is subject to the terms and conditions of the MIT License:
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation
+   files (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <direct/atomic.h>
+#include <direct/clock.h>
+#include <direct/debug.h>
+#include <direct/direct.h>
+#include <direct/executor.h>
+#include <direct/mem.h>
+#include <direct/messages.h>
+#include <direct/system.h>
+#include <direct/thread.h>
+#include <direct/util.h>
+
+/**********************************************************************************************************************/
+
+static int num_tasks   = 200000;
+static int num_workers = 0;      /* default is one per CPU */
+static int task_work   = 200;    /* loop iterations per task */
+
+/**********************************************************************************************************************/
+
+static int parse_cmdline ( int argc, char *argv[] );
+static int show_usage    ( void );
+
+/**********************************************************************************************************************/
+
+/*
+ * Reference implementation as TaskThreadsQ was before using the executor,
+ * one queue protected by a mutex shared by all threads.
+ */
+
+typedef struct {
+     DirectExecutorFunc  func;
+     void               *ctx;
+} RefTask;
+
+typedef struct {
+     DirectMutex      lock;
+     DirectWaitQueue  cond;
+
+     RefTask         *tasks;
+     unsigned int     size;
+     unsigned int     head;
+     unsigned int     tail;
+
+     bool             shutdown;
+
+     unsigned int     num;
+     DirectThread   **threads;
+} RefPool;
+
+static void *
+ref_loop( DirectThread *thread, void *arg )
+{
+     RefPool *pool = arg;
+     RefTask  task;
+
+     while (true) {
+          direct_mutex_lock( &pool->lock );
+
+          while (pool->head == pool->tail && !pool->shutdown)
+               direct_waitqueue_wait( &pool->cond, &pool->lock );
+
+          if (pool->head == pool->tail) {
+               direct_mutex_unlock( &pool->lock );
+               return NULL;
+          }
+
+          task = pool->tasks[pool->head];
+
+          pool->head = (pool->head + 1) % pool->size;
+
+          direct_mutex_unlock( &pool->lock );
+
+          task.func( task.ctx );
+     }
+}
+
+static void
+ref_push( RefPool *pool, DirectExecutorFunc func, void *ctx )
+{
+     direct_mutex_lock( &pool->lock );
+
+     pool->tasks[pool->tail].func = func;
+     pool->tasks[pool->tail].ctx  = ctx;
+
+     pool->tail = (pool->tail + 1) % pool->size;
+
+     D_ASSERT( pool->tail != pool->head );
+
+     direct_waitqueue_signal( &pool->cond );
+
+     direct_mutex_unlock( &pool->lock );
+}
+
+static RefPool *
+ref_create( unsigned int num )
+{
+     unsigned int  i;
+     RefPool      *pool = D_CALLOC( 1, sizeof(RefPool) );
+
+     pool->size    = num_tasks + 1;
+     pool->tasks   = D_CALLOC( pool->size, sizeof(RefTask) );
+     pool->num     = num;
+     pool->threads = D_CALLOC( num, sizeof(DirectThread*) );
+
+     direct_mutex_init( &pool->lock );
+     direct_waitqueue_init( &pool->cond );
+
+     for (i=0; i<num; i++)
+          pool->threads[i] = direct_thread_create( DTT_DEFAULT, ref_loop, pool, "Ref Pool" );
+
+     return pool;
+}
+
+static void
+ref_destroy( RefPool *pool )
+{
+     unsigned int i;
+
+     direct_mutex_lock( &pool->lock );
+     pool->shutdown = true;
+     direct_waitqueue_broadcast( &pool->cond );
+     direct_mutex_unlock( &pool->lock );
+
+     for (i=0; i<pool->num; i++) {
+          direct_thread_join( pool->threads[i] );
+          direct_thread_destroy( pool->threads[i] );
+     }
+
+     direct_waitqueue_deinit( &pool->cond );
+     direct_mutex_deinit( &pool->lock );
+
+     D_FREE( pool->threads );
+     D_FREE( pool->tasks );
+     D_FREE( pool );
+}
+
+/**********************************************************************************************************************/
+
+static int          done;
+static volatile int sink;
+
+static void
+busy( int loops )
+{
+     int i;
+
+     for (i=0; i<loops; i++)
+          sink += i;
+}
+
+static void
+task_func( void *ctx )
+{
+     busy( task_work );
+
+     D_SYNC_ADD_AND_FETCH( &done, 1 );
+}
+
+static void
+wait_done( int num )
+{
+     while (D_SYNC_ADD_AND_FETCH( &done, 0 ) < num)
+          direct_thread_sleep( 100 );
+}
+
+/* Tasks spawning two more until the total is reached, keeps workers busy with their own deques. */
+static DirectExecutor *spawn_executor;
+static int             spawned;
+
+static void
+spawn_func( void *ctx )
+{
+     int i;
+
+     busy( task_work );
+
+     for (i=0; i<2; i++) {
+          if (D_SYNC_ADD_AND_FETCH( &spawned, 1 ) <= num_tasks)
+               direct_executor_submit( spawn_executor, spawn_func, NULL, DEP_NORMAL );
+     }
+
+     D_SYNC_ADD_AND_FETCH( &done, 1 );
+}
+
+/* Uneven work per index, later ones are more expensive. */
+static void
+range_func( void *ctx, unsigned int index )
+{
+     busy( task_work * (1 + index * 4 / num_tasks) );
+}
+
+typedef struct {
+     unsigned int from;
+     unsigned int to;
+} Slice;
+
+static void *
+slice_loop( DirectThread *thread, void *arg )
+{
+     Slice        *slice = arg;
+     unsigned int  i;
+
+     for (i=slice->from; i<slice->to; i++)
+          range_func( NULL, i );
+
+     return NULL;
+}
+
+/**********************************************************************************************************************/
+
+static void
+report( const char *test, const char *impl, long long start )
+{
+     long long time = direct_clock_get_abs_micros() - start;
+
+     printf( "%-10s %-12s %9lld us %9.1f ns/task\n", test, impl, time, time * 1000.0 / num_tasks );
+}
+
+int
+main( int argc, char *argv[] )
+{
+     DirectResult    ret;
+     DirectExecutor *executor;
+     RefPool        *pool;
+     long long       start;
+     int             i;
+
+     if (parse_cmdline( argc, argv ))
+          return -1;
+
+     direct_initialize();
+
+     if (!num_workers)
+          num_workers = direct_num_cpus();
+
+     ret = direct_executor_create( "Bench", num_workers, DTT_DEFAULT, DEF_NONE, &executor );
+     if (ret) {
+          D_DERROR( ret, "direct_executor_create() failed!\n" );
+          return -2;
+     }
+
+     pool = ref_create( num_workers );
+
+     printf( "\n%d tasks of %d loops, %d workers\n\n", num_tasks, task_work, num_workers );
+
+
+     /* Submission from one thread, all tasks stolen or distributed. */
+     done  = 0;
+     start = direct_clock_get_abs_micros();
+
+     for (i=0; i<num_tasks; i++)
+          ref_push( pool, task_func, NULL );
+
+     wait_done( num_tasks );
+     report( "submit", "single queue", start );
+
+     done  = 0;
+     start = direct_clock_get_abs_micros();
+
+     for (i=0; i<num_tasks; i++)
+          direct_executor_submit( executor, task_func, NULL, DEP_NORMAL );
+
+     wait_done( num_tasks );
+     report( "submit", "executor", start );
+
+
+     /* Tasks spawning tasks. */
+     done           = 0;
+     spawned        = 1;
+     spawn_executor = executor;
+     start          = direct_clock_get_abs_micros();
+
+     direct_executor_submit( executor, spawn_func, NULL, DEP_NORMAL );
+
+     wait_done( num_tasks );
+     report( "spawn", "executor", start );
+
+
+     /* Uneven range, static slices per thread versus dynamic distribution. */
+     start = direct_clock_get_abs_micros();
+     {
+          DirectThread *threads[num_workers];
+          Slice         slices[num_workers];
+
+          for (i=0; i<num_workers; i++) {
+               slices[i].from = num_tasks * i / num_workers;
+               slices[i].to   = num_tasks * (i + 1) / num_workers;
+
+               threads[i] = direct_thread_create( DTT_DEFAULT, slice_loop, &slices[i], "Slice" );
+          }
+
+          for (i=0; i<num_workers; i++) {
+               direct_thread_join( threads[i] );
+               direct_thread_destroy( threads[i] );
+          }
+     }
+     report( "range", "static", start );
+
+     start = direct_clock_get_abs_micros();
+
+     direct_executor_parallel( executor, range_func, NULL, num_tasks, DEP_NORMAL );
+
+     report( "range", "executor", start );
+
+     printf( "\n" );
+
+     ref_destroy( pool );
+
+     direct_executor_destroy( executor );
+
+     direct_shutdown();
+
+     return 0;
+}
+
+/**********************************************************************************************************************/
+
+static int
+parse_cmdline( int argc, char *argv[] )
+{
+     int i;
+
+     for (i=1; i<argc; i++) {
+          if (!strcmp( argv[i], "-n" ) && i+1 < argc && atoi( argv[i+1] ) > 0)
+               num_tasks = atoi( argv[++i] );
+          else if (!strcmp( argv[i], "-w" ) && i+1 < argc && atoi( argv[i+1] ) > 0)
+               num_workers = atoi( argv[++i] );
+          else if (!strcmp( argv[i], "-l" ) && i+1 < argc && atoi( argv[i+1] ) >= 0)
+               task_work = atoi( argv[++i] );
+          else
+               return show_usage();
+     }
+
+     return 0;
+}
+
+static int
+show_usage( void )
+{
+     fprintf( stderr, "\n"
+                      "Usage:\n"
+                      "   direct_executor_bench [options]\n"
+                      "\n"
+                      "Options:\n"
+                      "   -n <num>  Number of tasks (default 200000)\n"
+                      "   -w <num>  Number of workers (default one per CPU)\n"
+                      "   -l <num>  Loop iterations per task (default 200)\n"
+                      "\n"
+              );
+
+     return -1;
+}
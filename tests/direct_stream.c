@@ -52,7 +52,8 @@ D_DEBUG_DOMAIN( Direct_Cat, "Direct/Cat", "libdirect cat" );
 static int
 show_usage( const char *prg )
 {
-     fprintf( stderr, "Usage: %s <url>\n", prg );
+     fprintf( stderr, "Usage: %s [-b] <url>\n"
+                      "   -b  Borrow data from memory mapped files instead of copying\n", prg );
 
      return -1;
 }
@@ -64,11 +65,14 @@ main( int argc, char *argv[] )
      int            i, fdo;
      DirectStream  *stream;
      const char    *url = NULL;
+     bool           borrow = false;
 
      /* Parse arguments. */
      for (i=1; i<argc; i++) {
           if (!strcmp( argv[i], "-h" ))
                return show_usage( argv[0] );
+          else if (!strcmp( argv[i], "-b" ))
+               borrow = true;
           else if (!url)
                url = argv[i];
           else
@@ -99,6 +103,33 @@ main( int argc, char *argv[] )
           goto close_in;
      }
 
+     /* Write directly from the mapping, if supported. */
+     while (borrow) {
+          const void   *ptr;
+          unsigned int  length;
+
+          ret = direct_stream_borrow( stream, 1024 * 1024, 0, &ptr, &length );
+          if (ret) {
+               if (ret == DR_UNSUPPORTED) {
+                    D_INFO( "Direct/Cat: Borrowing not supported, copying...\n" );
+                    break;
+               }
+
+               D_DERROR( ret, "Direct/Cat: Borrowing from '%s' failed!\n", url );
+               goto close_both;
+          }
+
+          D_DEBUG_AT( Direct_Cat, "Borrowed %5u bytes\n", length );
+
+          if (write( fdo, ptr, length ) != length) {
+               ret = errno2result( errno );
+               D_PERROR( "Direct/Cat: Writing to stdout (%d) failed!\n", fileno(stdout) );
+               goto close_both;
+          }
+
+          direct_stream_seek( stream, direct_stream_offset( stream ) + length );
+     }
+
      /* Copy loop. */
      while (true) {
           char         buf[16384];
@@ -54,6 +54,7 @@
 
 
 static bool sync_calls;
+static bool no_direct;
 
 /**********************************************************************************************************************/
 
@@ -128,9 +129,10 @@ main( int argc, char *argv[] )
      direct_clock_start( &clock );
 
      for (i=0; i<NUM_ITEMS; i++)
-          fusion_call_execute( &call, sync_calls ? FCEF_NONE : FCEF_ONEWAY, 0, 0, &retcall );
+          fusion_call_execute( &call, (sync_calls ? FCEF_NONE : FCEF_ONEWAY) | (no_direct ? FCEF_NODIRECT : FCEF_NONE),
+                               0, 0, &retcall );
 
-     fusion_call_execute( &call, FCEF_NONE, 1, 0, &retcall );
+     fusion_call_execute( &call, FCEF_NONE | (no_direct ? FCEF_NODIRECT : FCEF_NONE), 1, 0, &retcall );
 
      direct_clock_stop( &clock );
 
@@ -138,6 +140,10 @@ main( int argc, char *argv[] )
      D_INFO( "Fusion/Call: Stopped after %lld.%03lld seconds... (%lld items/sec)\n",
              DIRECT_CLOCK_DIFF_SEC_MS( &clock ), NUM_ITEMS * 1000000ULL / direct_clock_diff( &clock ) );
 
+     if (sync_calls)
+          D_INFO( "Fusion/Call: %lld.%03lld us per round trip\n",
+                  direct_clock_diff( &clock ) / NUM_ITEMS, direct_clock_diff( &clock ) * 1000 / NUM_ITEMS % 1000 );
+
      return 0;
 }
 
@@ -151,6 +157,8 @@ parse_cmdline( int argc, char *argv[] )
      for (i=1; i<argc; i++) {
           if (!strcmp( argv[i], "-s" ))
                sync_calls = true;
+          else if (!strcmp( argv[i], "-n" ))
+               no_direct = true;
           else
                return show_usage();
      }
@@ -167,6 +175,7 @@ show_usage( void )
                       "\n"
                       "Options:\n"
                       "   -s  Synchronous calls\n"
+                      "   -n  Pass calls through the dispatcher (FCEF_NODIRECT)\n"
                       "\n"
               );
 
@@ -0,0 +1,669 @@
+/*
+   (c) Copyright 2012-2013  DirectFB integrated media GmbH
+   (c) Copyright 2001-2013  The world wide DirectFB Open Source Community (directfb.org)
+   (c) Copyright 2000-2004  Convergence (integrated media) GmbH
+
+   All rights reserved.
+
+   Written by Denis Oliver Kropp <dok@directfb.org>,
+              Andreas Shimokawa <andi@directfb.org>,
+              Marek Pikarski <mass@directfb.org>,
+              Sven Neumann <neo@directfb.org>,
+              Ville Syrjälä <syrjala@sci.fi> and
+              Claudio Ciccani <klan@users.sf.net>.
+
+   This file is subject to the terms and conditions of the MIT License:
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation
+   files (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <direct/debug.h>
+#include <direct/hash.h>
+#include <direct/mem.h>
+#include <direct/memcpy.h>
+#include <direct/messages.h>
+#include <direct/util.h>
+
+#include <fusion/hash.h>
+
+/**********************************************************************************************************************/
+
+static int num_keys = 100000;
+static int lookups  = 4;     /* lookup rounds per run */
+
+/**********************************************************************************************************************/
+
+static int parse_cmdline ( int argc, char *argv[] );
+static int show_usage    ( void );
+
+/**********************************************************************************************************************/
+
+/*
+ * Reference implementations as DirectHash and FusionHash were before switching to Robin Hood hashing,
+ * linear probing with tombstones and chaining, both in prime sized tables indexed by modulo.
+ */
+
+static const unsigned int ref_primes[] = {
+     11, 19, 37, 73, 109, 163, 251, 367, 557, 823, 1237, 1861, 2777, 4177, 6247, 9371, 14057, 21089,
+     31627, 47431, 71143, 106721, 160073, 240101, 360163, 540217, 810343, 1215497, 1823231, 2734867,
+     4102283, 6153409, 9230113, 13845163
+};
+
+static unsigned int
+ref_primes_closest( unsigned int num )
+{
+     unsigned int i;
+
+     for (i=0; i<D_ARRAY_SIZE(ref_primes); i++)
+          if (ref_primes[i] > num)
+               return ref_primes[i];
+
+     return ref_primes[D_ARRAY_SIZE(ref_primes) - 1];
+}
+
+#define REF_REMOVED  ((void *) -1)
+
+typedef struct {
+     unsigned long  key;
+     void          *value;
+} RefElement;
+
+typedef struct {
+     int         size;
+     int         count;
+     int         removed;
+     RefElement *elements;
+} RefProbeHash;
+
+static void
+ref_probe_insert( RefProbeHash *hash, unsigned long key, void *value )
+{
+     int pos;
+
+     if ((hash->count + hash->removed) > hash->size / 2) {
+          int         i, size = ref_primes_closest( hash->size );
+          RefElement *elements = D_CALLOC( size, sizeof(RefElement) );
+
+          for (i=0; i<hash->size; i++) {
+               RefElement *element = &hash->elements[i];
+
+               if (element->value && element->value != REF_REMOVED) {
+                    for (pos = element->key % size; elements[pos].value; pos = (pos + 1) % size);
+
+                    elements[pos] = *element;
+               }
+          }
+
+          D_FREE( hash->elements );
+
+          hash->size     = size;
+          hash->elements = elements;
+          hash->removed  = 0;
+     }
+
+     for (pos = key % hash->size; hash->elements[pos].value && hash->elements[pos].value != REF_REMOVED; pos = (pos + 1) % hash->size);
+
+     if (hash->elements[pos].value == REF_REMOVED)
+          hash->removed--;
+
+     hash->elements[pos].key   = key;
+     hash->elements[pos].value = value;
+     hash->count++;
+}
+
+static int
+ref_probe_locate( const RefProbeHash *hash, unsigned long key )
+{
+     int pos;
+
+     for (pos = key % hash->size; hash->elements[pos].value; pos = (pos + 1) % hash->size) {
+          if (hash->elements[pos].value != REF_REMOVED && hash->elements[pos].key == key)
+               return pos;
+     }
+
+     return -1;
+}
+
+static void *
+ref_probe_lookup( const RefProbeHash *hash, unsigned long key )
+{
+     int pos = ref_probe_locate( hash, key );
+
+     return (pos != -1) ? hash->elements[pos].value : NULL;
+}
+
+static void
+ref_probe_remove( RefProbeHash *hash, unsigned long key )
+{
+     int pos = ref_probe_locate( hash, key );
+
+     if (pos != -1) {
+          hash->elements[pos].value = REF_REMOVED;
+          hash->count--;
+          hash->removed++;
+     }
+}
+
+typedef struct _RefNode RefNode;
+
+struct _RefNode {
+     const void *key;
+     void       *value;
+     RefNode    *next;
+};
+
+typedef struct {
+     bool      strings;
+     int       size;
+     int       nnodes;
+     RefNode **nodes;
+} RefChainHash;
+
+static unsigned int
+ref_chain_index( const RefChainHash *hash, const void *key, int size )
+{
+     if (hash->strings) {
+          const signed char *p = key;
+          unsigned int       h = *p;
+
+          if (h)
+               for (p += 1; *p != '\0'; p++)
+                    h = (h << 5) - h + *p;
+
+          return h % size;
+     }
+
+     return (unsigned long) key % size;
+}
+
+static RefNode **
+ref_chain_lookup_node( RefChainHash *hash, const void *key )
+{
+     RefNode **node = &hash->nodes[ref_chain_index( hash, key, hash->size )];
+
+     if (hash->strings) {
+          while (*node && strcmp( (*node)->key, key ))
+               node = &(*node)->next;
+     }
+     else {
+          while (*node && (*node)->key != key)
+               node = &(*node)->next;
+     }
+
+     return node;
+}
+
+static void
+ref_chain_resize( RefChainHash *hash )
+{
+     int       i, size = ref_primes_closest( hash->nnodes );
+     RefNode **nodes    = D_CALLOC( size, sizeof(RefNode*) );
+     RefNode  *node, *next;
+
+     for (i=0; i<hash->size; i++) {
+          for (node = hash->nodes[i]; node; node = next) {
+               unsigned int index = ref_chain_index( hash, node->key, size );
+
+               next         = node->next;
+               node->next   = nodes[index];
+               nodes[index] = node;
+          }
+     }
+
+     D_FREE( hash->nodes );
+
+     hash->nodes = nodes;
+     hash->size  = size;
+}
+
+static void
+ref_chain_insert( RefChainHash *hash, const void *key, void *value )
+{
+     RefNode **node = ref_chain_lookup_node( hash, key );
+
+     *node = D_CALLOC( 1, sizeof(RefNode) );
+
+     (*node)->key   = key;
+     (*node)->value = value;
+
+     if (3 * hash->size <= ++hash->nnodes)
+          ref_chain_resize( hash );
+}
+
+static void *
+ref_chain_lookup( RefChainHash *hash, const void *key )
+{
+     RefNode *node = *ref_chain_lookup_node( hash, key );
+
+     return node ? node->value : NULL;
+}
+
+static void
+ref_chain_remove( RefChainHash *hash, const void *key )
+{
+     RefNode **node = ref_chain_lookup_node( hash, key );
+
+     if (*node) {
+          RefNode *dest = *node;
+
+          *node = dest->next;
+
+          D_FREE( dest );
+
+          hash->nnodes--;
+     }
+}
+
+/**********************************************************************************************************************/
+
+typedef enum {
+     IMPL_DIRECT,
+     IMPL_FUSION,
+     IMPL_REF_PROBE,
+     IMPL_REF_CHAIN,
+
+     _IMPL_NUM
+} Impl;
+
+static const char *impl_names[] = {
+     "DirectHash", "FusionHash", "prime probing", "prime chaining"
+};
+
+typedef struct {
+     Impl          impl;
+     bool          strings;
+
+     DirectHash    direct;
+     FusionHash   *fusion;
+     RefProbeHash  probe;
+     RefChainHash  chain;
+} Table;
+
+static void
+table_init( Table *table, Impl impl, bool strings )
+{
+     memset( table, 0, sizeof(Table) );
+
+     table->impl    = impl;
+     table->strings = strings;
+
+     switch (impl) {
+          case IMPL_DIRECT:
+               direct_hash_init( &table->direct, 17 );
+               break;
+
+          case IMPL_FUSION:
+               fusion_hash_create_local( strings ? HASH_STRING : HASH_INT, HASH_INT, 17, &table->fusion );
+               break;
+
+          case IMPL_REF_PROBE:
+               table->probe.size     = 11;
+               table->probe.elements = D_CALLOC( 11, sizeof(RefElement) );
+               break;
+
+          case IMPL_REF_CHAIN:
+               table->chain.strings = strings;
+               table->chain.size    = 11;
+               table->chain.nodes   = D_CALLOC( 11, sizeof(RefNode*) );
+               break;
+
+          default:
+               D_BUG( "unknown implementation" );
+     }
+}
+
+static void
+table_deinit( Table *table, const void **keys, int num )
+{
+     int i;
+
+     switch (table->impl) {
+          case IMPL_DIRECT:
+               direct_hash_deinit( &table->direct );
+               break;
+
+          case IMPL_FUSION:
+               fusion_hash_destroy( table->fusion );
+               break;
+
+          case IMPL_REF_PROBE:
+               D_FREE( table->probe.elements );
+               break;
+
+          case IMPL_REF_CHAIN:
+               for (i=0; i<num; i++)
+                    ref_chain_remove( &table->chain, keys[i] );
+
+               D_FREE( table->chain.nodes );
+               break;
+
+          default:
+               break;
+     }
+}
+
+static __inline__ void
+table_insert( Table *table, const void *key, void *value )
+{
+     switch (table->impl) {
+          case IMPL_DIRECT:
+               direct_hash_insert( &table->direct, (unsigned long) key, value );
+               break;
+
+          case IMPL_FUSION:
+               fusion_hash_insert( table->fusion, (void*) key, value );
+               break;
+
+          case IMPL_REF_PROBE:
+               ref_probe_insert( &table->probe, (unsigned long) key, value );
+               break;
+
+          case IMPL_REF_CHAIN:
+               ref_chain_insert( &table->chain, key, value );
+               break;
+
+          default:
+               break;
+     }
+}
+
+static __inline__ void *
+table_lookup( Table *table, const void *key )
+{
+     switch (table->impl) {
+          case IMPL_DIRECT:
+               return direct_hash_lookup( &table->direct, (unsigned long) key );
+
+          case IMPL_FUSION:
+               return fusion_hash_lookup( table->fusion, key );
+
+          case IMPL_REF_PROBE:
+               return ref_probe_lookup( &table->probe, (unsigned long) key );
+
+          case IMPL_REF_CHAIN:
+               return ref_chain_lookup( &table->chain, key );
+
+          default:
+               return NULL;
+     }
+}
+
+static __inline__ void
+table_remove( Table *table, const void *key )
+{
+     switch (table->impl) {
+          case IMPL_DIRECT:
+               direct_hash_remove( &table->direct, (unsigned long) key );
+               break;
+
+          case IMPL_FUSION:
+               fusion_hash_remove( table->fusion, key, NULL, NULL );
+               break;
+
+          case IMPL_REF_PROBE:
+               ref_probe_remove( &table->probe, (unsigned long) key );
+               break;
+
+          case IMPL_REF_CHAIN:
+               ref_chain_remove( &table->chain, key );
+               break;
+
+          default:
+               break;
+     }
+}
+
+/**********************************************************************************************************************/
+
+typedef enum {
+     KEYS_IDS,         /* sequential object, call and reactor IDs */
+     KEYS_POINTERS,    /* heap addresses, e.g. surface buffers */
+     KEYS_GLYPHS,      /* character codes from a few Unicode blocks */
+     KEYS_STRINGS,     /* property and symbol names */
+
+     _KEYS_NUM
+} Keys;
+
+static const char *keys_names[] = {
+     "ids", "pointers", "glyphs", "strings"
+};
+
+static const void **
+keys_create( Keys keys, int num, void ***ret_blocks )
+{
+     int          i;
+     const void **array  = D_CALLOC( num * 2, sizeof(void*) );
+     void       **blocks = NULL;
+
+     /* The second half of the keys is only used for missing lookups. */
+     switch (keys) {
+          case KEYS_IDS:
+               for (i=0; i<num*2; i++)
+                    array[i] = (void*)(unsigned long)(i + 1);
+               break;
+
+          case KEYS_POINTERS:
+               blocks = D_CALLOC( num * 2, sizeof(void*) );
+
+               for (i=0; i<num*2; i++)
+                    array[i] = blocks[i] = D_MALLOC( 48 + (i % 5) * 16 );
+               break;
+
+          case KEYS_GLYPHS:
+               /* Latin, then CJK ideographs, then Hangul syllables, like mixed text would fill a glyph cache. */
+               for (i=0; i<num*2; i++) {
+                    if (i < 0x180 - 0x20)
+                         array[i] = (void*)(unsigned long)(0x20 + i);
+                    else if (i < 0x180 - 0x20 + 0x5200)
+                         array[i] = (void*)(unsigned long)(0x4e00 + i - (0x180 - 0x20));
+                    else
+                         array[i] = (void*)(unsigned long)(0xac00 + i - (0x180 - 0x20 + 0x5200));
+               }
+               break;
+
+          case KEYS_STRINGS:
+               blocks = D_CALLOC( num * 2, sizeof(void*) );
+
+               for (i=0; i<num*2; i++) {
+                    char *name = D_MALLOC( 32 );
+
+                    snprintf( name, 32, "%s_property_%d", (i & 1) ? "surface" : "window", i );
+
+                    array[i] = blocks[i] = name;
+               }
+               break;
+
+          default:
+               D_BUG( "unknown keys" );
+     }
+
+     *ret_blocks = blocks;
+
+     return array;
+}
+
+static void
+keys_destroy( const void **array, void **blocks, int num )
+{
+     int i;
+
+     if (blocks) {
+          for (i=0; i<num*2; i++)
+               D_FREE( blocks[i] );
+
+          D_FREE( blocks );
+     }
+
+     D_FREE( array );
+}
+
+/**********************************************************************************************************************/
+
+static void
+run( Impl impl, Keys keys, const void **array, const void **shuffled, bool report )
+{
+     Table       table;
+     DirectClock clock;
+     int         i, round;
+     long long   insert, hit, miss, churn;
+     int         found = 0;
+
+     table_init( &table, impl, keys == KEYS_STRINGS );
+
+     direct_clock_start( &clock );
+
+     for (i=0; i<num_keys; i++)
+          table_insert( &table, array[i], (void*)(unsigned long)(i + 1) );
+
+     direct_clock_stop( &clock );
+     insert = direct_clock_diff( &clock );
+
+     direct_clock_start( &clock );
+
+     for (round=0; round<lookups; round++) {
+          for (i=0; i<num_keys; i++)
+               found += table_lookup( &table, shuffled[i] ) != NULL;
+     }
+
+     direct_clock_stop( &clock );
+     hit = direct_clock_diff( &clock );
+
+     direct_clock_start( &clock );
+
+     for (round=0; round<lookups; round++) {
+          for (i=num_keys; i<num_keys*2; i++)
+               found += table_lookup( &table, shuffled[i] ) != NULL;
+     }
+
+     direct_clock_stop( &clock );
+     miss = direct_clock_diff( &clock );
+
+     /* Remove and insert again, like objects coming and going. */
+     direct_clock_start( &clock );
+
+     for (i=0; i<num_keys; i+=2)
+          table_remove( &table, shuffled[i] );
+
+     for (i=0; i<num_keys; i+=2)
+          table_insert( &table, shuffled[i], (void*)(unsigned long)(i + 1) );
+
+     direct_clock_stop( &clock );
+     churn = direct_clock_diff( &clock );
+
+     if (found != num_keys * lookups)
+          D_ERROR( "Hash/Bench: %s found %d instead of %d keys!\n", impl_names[impl], found, num_keys * lookups );
+
+     table_deinit( &table, array, num_keys );
+
+     if (report)
+          printf( "%-10s %-16s %9lld %9lld %9lld %9lld\n", keys_names[keys], impl_names[impl],
+             insert * 1000 / num_keys, hit * 1000 / (num_keys * lookups), miss * 1000 / (num_keys * lookups), churn * 1000 / num_keys );
+}
+
+int
+main( int argc, char *argv[] )
+{
+     Keys keys;
+     Impl impl;
+
+     if (parse_cmdline( argc, argv ))
+          return -1;
+
+     printf( "\n%d keys, nanoseconds per operation\n\n", num_keys );
+     printf( "%-10s %-16s %9s %9s %9s %9s\n", "keys", "implementation", "insert", "hit", "miss", "churn" );
+
+     for (keys=0; keys<_KEYS_NUM; keys++) {
+          int           i;
+          void        **blocks;
+          const void  **array    = keys_create( keys, num_keys, &blocks );
+          const void  **shuffled = D_MALLOC( num_keys * 2 * sizeof(void*) );
+
+          /* Look up in random order, separately for present and missing keys. */
+          direct_memcpy( shuffled, array, num_keys * 2 * sizeof(void*) );
+
+          for (i=num_keys*2-1; i>0; i--) {
+               int         n    = (i < num_keys) ? rand() % (i + 1) : num_keys + rand() % (i - num_keys + 1);
+               const void *temp = shuffled[i];
+
+               shuffled[i] = shuffled[n];
+               shuffled[n] = temp;
+          }
+
+          for (impl=0; impl<_IMPL_NUM; impl++) {
+               /* String keys need comparing contents. */
+               if (keys == KEYS_STRINGS && (impl == IMPL_DIRECT || impl == IMPL_REF_PROBE))
+                    continue;
+
+               /* First run warms up caches and the allocator. */
+               run( impl, keys, array, shuffled, false );
+               run( impl, keys, array, shuffled, true );
+          }
+
+          D_FREE( shuffled );
+
+          keys_destroy( array, blocks, num_keys );
+
+          printf( "\n" );
+     }
+
+     return 0;
+}
+
+/**********************************************************************************************************************/
+
+static int
+parse_cmdline( int argc, char *argv[] )
+{
+     int i;
+
+     for (i=1; i<argc; i++) {
+          if (!strcmp( argv[i], "-n" ) && i+1 < argc && atoi( argv[i+1] ) > 0)
+               num_keys = atoi( argv[++i] );
+          else if (!strcmp( argv[i], "-l" ) && i+1 < argc && atoi( argv[i+1] ) > 0)
+               lookups = atoi( argv[++i] );
+          else
+               return show_usage();
+     }
+
+     return 0;
+}
+
+static int
+show_usage( void )
+{
+     fprintf( stderr, "\n"
+                      "Usage:\n"
+                      "   fusion_hash_bench [options]\n"
+                      "\n"
+                      "Options:\n"
+                      "   -n <num>  Number of keys (default 100000)\n"
+                      "   -l <num>  Rounds of looking up all keys (default 4)\n"
+                      "\n"
+              );
+
+     return -1;
+}
@@ -39,13 +39,17 @@
 #include <sys/types.h>
 #include <unistd.h>
 #include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
 
 #include <directfb.h>
 
 #include <direct/build.h>
+#include <direct/clock.h>
 #include <direct/debug.h>
 #include <direct/log.h>
 #include <direct/messages.h>
+#include <direct/thread.h>
 
 #include <fusion/fusion.h>
 #include <fusion/reactor.h>
@@ -66,6 +70,63 @@ do {                                    \
 
 static FusionWorld   *m_world;
 
+static int            m_threads    = 4;
+static int            m_iterations = 100000;
+
+static unsigned long  m_counter;
+
+
+static void *
+contend_main( DirectThread *thread,
+              void         *arg )
+{
+     int             i;
+     FusionSkirmish *skirmish = arg;
+
+     for (i=0; i<m_iterations; i++) {
+          fusion_skirmish_prevail( skirmish );
+
+          m_counter++;
+
+          fusion_skirmish_dismiss( skirmish );
+     }
+
+     return NULL;
+}
+
+static int
+bench_contention( FusionSkirmish *skirmish )
+{
+     int           i;
+     long long     t1, t2;
+     DirectThread *threads[m_threads];
+
+     m_counter = 0;
+
+     t1 = direct_clock_get_micros();
+
+     for (i=0; i<m_threads; i++)
+          threads[i] = direct_thread_create( DTT_DEFAULT, contend_main, skirmish, "Contender" );
+
+     for (i=0; i<m_threads; i++) {
+          direct_thread_join( threads[i] );
+          direct_thread_destroy( threads[i] );
+     }
+
+     t2 = direct_clock_get_micros();
+
+     direct_log_printf( NULL, "Contention: %d threads, %lu locks in %lld.%03lld ms (%lld ns per lock)\n",
+                        m_threads, m_counter, (t2 - t1) / 1000, (t2 - t1) % 1000,
+                        m_counter ? (t2 - t1) * 1000 / (long long) m_counter : 0 );
+
+     if (m_counter != (unsigned long) m_threads * m_iterations) {
+          D_ERROR( "Lost updates, counted %lu!\n", m_counter );
+          return -1;
+     }
+
+     return 0;
+}
+
 
 int
 main( int argc, char *argv[] )
@@ -75,6 +136,17 @@ main( int argc, char *argv[] )
 
      DirectFBInit( &argc, &argv );
 
+     if (argc > 1)
+          m_threads = atoi( argv[1] );
+
+     if (argc > 2)
+          m_iterations = atoi( argv[2] );
+
+     if (m_threads < 1 || m_iterations < 1) {
+          fprintf( stderr, "Usage: %s [threads [iterations]]\n", argv[0] );
+          return -1;
+     }
+
      ret = fusion_enter( -1, 0, FER_MASTER, &m_world );
      if (ret) {
           D_DERROR( ret, "fusion_enter() failed" );
@@ -121,6 +193,15 @@ main( int argc, char *argv[] )
      }
 
 
+     MSG( "Contending for skirmish...\n" );
+
+     if (bench_contention( &skirmish ))
+          return -5;
+
+
+     fusion_skirmish_destroy( &skirmish );
+
+
      MSG( "Exiting from world %d (FusionID %lu, pid %d)...\n",
           fusion_world_index( m_world ), fusion_id( m_world ), getpid() );
 
@@ -0,0 +1,311 @@
+/*
+   (c) Copyright 2012-2013  DirectFB integrated media GmbH
+   (c) Copyright 2001-2013  The world wide DirectFB Open Source Community (directfb.org)
+   (c) Copyright 2000-2004  Convergence (integrated media) GmbH
+
+   All rights reserved.
+
+   Written by Denis Oliver Kropp <dok@directfb.org>,
+              Andreas Shimokawa <andi@directfb.org>,
+              Marek Pikarski <mass@directfb.org>,
+              Sven Neumann <neo@directfb.org>,
+              Ville Syrjälä <syrjala@sci.fi> and
+              Claudio Ciccani <klan@users.sf.net>.
+
+   This file is subject to the terms and conditions of the MIT License:
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation
+   files (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <direct/debug.h>
+#include <direct/messages.h>
+#include <direct/util.h>
+
+#include <fusion/wire.h>
+
+/**********************************************************************************************************************/
+
+static const u16 test_elements[] = { 1, 2, 3, 4, 5, 6, 7 };
+
+static int failures;
+
+#define CHECK(cond)                                                                     \
+     do {                                                                               \
+          if (!(cond)) {                                                                \
+               fprintf( stderr, "Fusion/Wire: %s:%d: check '%s' failed\n",              \
+                        __FILE__, __LINE__, #cond );                                    \
+               failures++;                                                              \
+          }                                                                             \
+     } while (0)
+
+/**********************************************************************************************************************/
+
+static unsigned int
+encode_message( u64 *buffer, unsigned int size )
+{
+     DirectResult       ret;
+     FusionWireEncoder  encoder;
+     unsigned int       length = 0;
+     u32               *reserved;
+
+     ret = fusion_wire_encode_init( &encoder, buffer, size, 42, -7, FWMF_ONEWAY );
+     CHECK( ret == DR_OK );
+
+     CHECK( fusion_wire_encode_u32( &encoder, 0xdeadbeef ) == DR_OK );
+     CHECK( fusion_wire_encode_s32( &encoder, -123456 ) == DR_OK );
+     CHECK( fusion_wire_encode_u64( &encoder, 0x0123456789abcdefULL ) == DR_OK );
+     CHECK( fusion_wire_encode_s64( &encoder, -9876543210LL ) == DR_OK );
+     CHECK( fusion_wire_encode_object( &encoder, 77 ) == DR_OK );
+     CHECK( fusion_wire_encode_array( &encoder, test_elements, sizeof(test_elements[0]), D_ARRAY_SIZE(test_elements) ) == DR_OK );
+     CHECK( fusion_wire_encode_array( &encoder, NULL, 4, 0 ) == DR_OK );
+
+     CHECK( fusion_wire_encode_reserve( &encoder, 4, 3, (void**) &reserved ) == DR_OK );
+     reserved[0] = 10;
+     reserved[1] = 20;
+     reserved[2] = 30;
+
+     CHECK( fusion_wire_encode_finish( &encoder, &length ) == DR_OK );
+
+     return length;
+}
+
+/*
+ * Decodes the message written by encode_message(), returns the number of items decoded successfully.
+ * Every item must either match or fail, decoding stops at the first failure.
+ */
+static int
+decode_message( const void *buffer, unsigned int length )
+{
+     FusionWireDecoder  decoder;
+     unsigned int       element_size;
+     unsigned int       count;
+     const void        *elements;
+     u32                u32_value;
+     s32                s32_value;
+     u64                u64_value;
+     s64                s64_value;
+     int                items = 0;
+
+     if (fusion_wire_decode_init( &decoder, buffer, length ))
+          return -1;
+
+     CHECK( decoder.header->call_id == 42 );
+     CHECK( decoder.header->call_arg == -7 );
+     CHECK( decoder.header->flags == FWMF_ONEWAY );
+
+     if (fusion_wire_decode_peek( &decoder, &element_size ) == FWIT_U32) {
+          CHECK( element_size == 4 );
+     }
+
+     if (fusion_wire_decode_u32( &decoder, &u32_value ))
+          return items;
+     CHECK( u32_value == 0xdeadbeef );
+     items++;
+
+     if (fusion_wire_decode_s32( &decoder, &s32_value ))
+          return items;
+     CHECK( s32_value == -123456 );
+     items++;
+
+     if (fusion_wire_decode_u64( &decoder, &u64_value ))
+          return items;
+     CHECK( u64_value == 0x0123456789abcdefULL );
+     items++;
+
+     if (fusion_wire_decode_s64( &decoder, &s64_value ))
+          return items;
+     CHECK( s64_value == -9876543210LL );
+     items++;
+
+     if (fusion_wire_decode_object( &decoder, &u32_value ))
+          return items;
+     CHECK( u32_value == 77 );
+     items++;
+
+     if (fusion_wire_decode_array( &decoder, sizeof(test_elements[0]), &elements, &count ))
+          return items;
+     CHECK( count == D_ARRAY_SIZE(test_elements) );
+     CHECK( !memcmp( elements, test_elements, sizeof(test_elements) ) );
+     items++;
+
+     if (fusion_wire_decode_array( &decoder, 4, &elements, &count ))
+          return items;
+     CHECK( count == 0 );
+     items++;
+
+     if (fusion_wire_decode_peek( &decoder, &element_size ) == FWIT_ARRAY) {
+          CHECK( element_size == 4 );
+     }
+
+     if (fusion_wire_decode_array( &decoder, 4, &elements, &count ))
+          return items;
+     CHECK( count == 3 );
+     CHECK( ((const u32*) elements)[0] == 10 && ((const u32*) elements)[1] == 20 && ((const u32*) elements)[2] == 30 );
+     items++;
+
+     CHECK( fusion_wire_decode_peek( &decoder, &element_size ) == FWIT_NONE );
+     CHECK( fusion_wire_decode_u32( &decoder, &u32_value ) == DR_EOF );
+
+     return items;
+}
+
+/**********************************************************************************************************************/
+
+static void
+test_round_trip( void )
+{
+     u64          buffer[64];
+     unsigned int length;
+
+     length = encode_message( buffer, sizeof(buffer) );
+
+     CHECK( length > sizeof(FusionWireHeader) );
+     CHECK( !(length & (FUSION_WIRE_ALIGN - 1)) );
+     CHECK( fusion_wire_message_length( buffer, length ) == length );
+
+     CHECK( decode_message( buffer, length ) == 8 );
+}
+
+static void
+test_encode_limits( void )
+{
+     u64                buffer[64];
+     unsigned int       length;
+     unsigned int       size;
+     FusionWireEncoder  encoder;
+     void              *elements;
+
+     length = encode_message( buffer, sizeof(buffer) );
+
+     /* The whole remaining space can be reserved, but not a single byte more. */
+     for (size = sizeof(FusionWireHeader) + FUSION_WIRE_ALIGN; size < length; size++) {
+          unsigned int avail = (size & ~(FUSION_WIRE_ALIGN - 1)) - sizeof(FusionWireHeader) - FUSION_WIRE_ALIGN;
+
+          fusion_wire_encode_init( &encoder, buffer, size, 0, 0, FWMF_NONE );
+
+          CHECK( fusion_wire_encode_reserve( &encoder, 1, avail + 1, &elements ) == DR_LIMITEXCEEDED );
+          CHECK( fusion_wire_encode_reserve( &encoder, 1, avail, &elements ) == DR_OK );
+          CHECK( encoder.length <= encoder.size );
+          CHECK( fusion_wire_encode_reserve( &encoder, 1, 0, &elements ) == DR_LIMITEXCEEDED );
+
+          fusion_wire_encode_finish( &encoder, NULL );
+     }
+
+     /* Element size times count exceeds 32 bits, must not wrap around to a small size. */
+     fusion_wire_encode_init( &encoder, buffer, sizeof(buffer), 0, 0, FWMF_NONE );
+
+     CHECK( fusion_wire_encode_reserve( &encoder, 4, 0x40000001, &elements ) == DR_LIMITEXCEEDED );
+     CHECK( fusion_wire_encode_reserve( &encoder, 0xffffff, 0x1001, &elements ) == DR_LIMITEXCEEDED );
+     CHECK( fusion_wire_encode_reserve( &encoder, 0x1000000, 1, &elements ) == DR_INVARG );
+     CHECK( fusion_wire_encode_reserve( &encoder, 0, 1, &elements ) == DR_INVARG );
+     CHECK( encoder.length == sizeof(FusionWireHeader) );
+
+     fusion_wire_encode_finish( &encoder, NULL );
+}
+
+static void
+test_truncated( void )
+{
+     u64          buffer[64];
+     u64          copy[64];
+     unsigned int length;
+     unsigned int cut;
+
+     length = encode_message( buffer, sizeof(buffer) );
+
+     /* Incomplete input is reported as such. */
+     for (cut = 0; cut < length; cut++)
+          CHECK( decode_message( buffer, cut ) == -1 );
+
+     /* Messages claiming a shorter length must decode a prefix of the items, but never past the end. */
+     for (cut = sizeof(FusionWireHeader); cut < length; cut += FUSION_WIRE_ALIGN) {
+          u64 *data = malloc( cut );
+
+          memcpy( data, buffer, cut );
+
+          ((FusionWireHeader*) data)->length = cut;
+
+          CHECK( decode_message( data, cut ) < 8 );
+
+          free( data );
+     }
+
+     /* A huge count must not wrap around to a small size, 4 * 0x40000001 is 4 in 32 bits. */
+     memcpy( copy, buffer, length );
+
+     {
+          FusionWireDecoder  decoder;
+          unsigned int       element_size;
+          const void        *elements;
+          unsigned int       count;
+          u32               *words;
+          u32                u32_value;
+          u64                u64_value;
+
+          CHECK( fusion_wire_decode_init( &decoder, copy, length ) == DR_OK );
+
+          /* Skip to the empty array of 32 bit elements. */
+          fusion_wire_decode_u32( &decoder, &u32_value );
+          fusion_wire_decode_s32( &decoder, (s32*) &u32_value );
+          fusion_wire_decode_u64( &decoder, &u64_value );
+          fusion_wire_decode_s64( &decoder, (s64*) &u64_value );
+          fusion_wire_decode_object( &decoder, &u32_value );
+          fusion_wire_decode_array( &decoder, sizeof(test_elements[0]), &elements, &count );
+
+          CHECK( fusion_wire_decode_peek( &decoder, &element_size ) == FWIT_ARRAY && element_size == 4 );
+
+          words = (u32*)((u8*) copy + decoder.offset);
+
+          words[1] = 0x40000001;
+          CHECK( fusion_wire_decode_array( &decoder, 4, &elements, &count ) == DR_INVARG );
+
+          words[1] = 0xffffffff;
+          CHECK( fusion_wire_decode_array( &decoder, 4, &elements, &count ) == DR_INVARG );
+
+          words[1] = 0;
+          CHECK( fusion_wire_decode_array( &decoder, 4, &elements, &count ) == DR_OK );
+          CHECK( count == 0 );
+     }
+}
+
+/**********************************************************************************************************************/
+
+int
+main( int argc, char *argv[] )
+{
+     test_round_trip();
+     test_encode_limits();
+     test_truncated();
+
+     if (failures) {
+          fprintf( stderr, "Fusion/Wire: %d checks failed\n", failures );
+          return 1;
+     }
+
+     printf( "Fusion/Wire: all checks passed\n" );
+
+     return 0;
+}
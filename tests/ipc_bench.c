@@ -0,0 +1,1141 @@
+/*
+   (c) Copyright 2012-2013  DirectFB integrated media GmbH
+   (c) Copyright 2001-2013  The world wide DirectFB Open Source Community (directfb.org)
+   (c) Copyright 2000-2004  Convergence (integrated media) GmbH
+
+   All rights reserved.
+
+   Written by Denis Oliver Kropp <dok@directfb.org>,
+              Andreas Shimokawa <andi@directfb.org>,
+              Marek Pikarski <mass@directfb.org>,
+              Sven Neumann <neo@directfb.org>,
+              Ville Syrjälä <syrjala@sci.fi> and
+              Claudio Ciccani <klan@users.sf.net>.
+
+   This file is subject to the terms and conditions of the MIT License:
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation
+   files (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <time.h>
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include <directfb_build.h>
+#include <directfb_version.h>
+
+#include <direct/atomic.h>
+#include <direct/direct.h>
+#include <direct/mem.h>
+#include <direct/messages.h>
+#include <direct/thread.h>
+#include <direct/util.h>
+
+#include <fusion/build.h>
+#include <fusion/call.h>
+#include <fusion/conf.h>
+#include <fusion/fusion.h>
+#include <fusion/reactor.h>
+
+#if DIRECTFB_BUILD_ONE
+#include <One/One.h>
+#endif
+
+#if DIRECTFB_BUILD_VOODOO
+#include <voodoo/link.h>
+#include <voodoo/manager.h>
+#endif
+
+#ifndef HAVE_FORK
+# define fork() -1
+#endif
+
+
+/*
+ * Unified IPC benchmark
+ *
+ * Each transport is measured with 1, 2, 4... up to the maximum number of client processes
+ * forked from the master, which does the serving. Clients leave the inherited world and
+ * join it again as slaves, so that they get their own Fusion ID. For every payload size, all clients
+ * measure the round trip latency of each request and the time it takes to push a number
+ * of one way requests. After each window of one way requests, a round trip makes sure all
+ * of them were processed, as not every transport blocks senders while messages are queued
+ * (builtin Fusion queues messages beyond the ring in shared memory).
+ *
+ * Results are written as JSON, one entry per transport, client count and payload size.
+ */
+
+#define MAX_CLIENTS   64
+#define MAX_SIZES     16
+
+/**********************************************************************************************************************/
+
+typedef struct {
+     u32                 client;
+     u32                 reply;
+     u32                 response_qid;
+     u32                 reserved;
+
+     /* payload follows */
+} BenchMessage;
+
+typedef struct {
+     int                 parties;
+     int                 count;
+     int                 generation;
+
+     DirectResult        errors[MAX_CLIENTS];
+     long long           oneway_ns[MAX_CLIENTS];
+
+     long long           samples[0];    /* clients x iterations */
+} BenchShared;
+
+typedef struct {
+     int                 index;
+
+     /* Fusion Reactor */
+     DirectMutex         lock;
+     DirectWaitQueue     wait;
+     unsigned int        responses;
+     Reaction            reaction;
+
+#if DIRECTFB_BUILD_ONE
+     OneQID              response_qid;
+#endif
+
+#if DIRECTFB_BUILD_VOODOO
+     VoodooLink          link;
+     VoodooManager      *manager;
+#endif
+} BenchClient;
+
+typedef struct {
+     FusionWorld        *world;
+     int                 world_index;
+     BenchShared        *shared;
+
+     int                 clients;
+
+     /* Fusion Call */
+     FusionCall          call;
+
+     /* Fusion Reactor */
+     FusionReactor      *request;
+     FusionReactor      *response;
+     Reaction            reaction;
+
+#if DIRECTFB_BUILD_ONE
+     OneQID              queue_id;
+     DirectThread       *thread;
+     bool                quit;
+#endif
+
+#if DIRECTFB_BUILD_VOODOO
+     int                 sockets[MAX_CLIENTS][2];
+     VoodooLink          links[MAX_CLIENTS];
+     VoodooManager      *managers[MAX_CLIENTS];
+     VoodooInstanceID    instances[MAX_CLIENTS];
+#endif
+} Bench;
+
+typedef struct {
+     const char         *name;
+
+     DirectResult (*Setup)     ( Bench *bench );
+     void         (*Teardown)  ( Bench *bench );
+
+     DirectResult (*ClientInit)( Bench *bench, BenchClient *client );
+     void         (*ClientExit)( Bench *bench, BenchClient *client );
+
+     DirectResult (*RoundTrip) ( Bench *bench, BenchClient *client, BenchMessage *msg, size_t length );
+     DirectResult (*Send)      ( Bench *bench, BenchClient *client, BenchMessage *msg, size_t length );
+} BenchTransport;
+
+/**********************************************************************************************************************/
+
+static unsigned int iterations  = 10000;
+static int          max_clients = 4;
+static size_t       sizes[MAX_SIZES] = { 0, 64, 1024, 8192 };
+static int          num_sizes   = 4;
+static const char  *only;
+static const char  *output;
+static size_t       window      = 32 * 1024;
+static int          timeout     = 60;
+
+/**********************************************************************************************************************/
+
+static int parse_cmdline ( int argc, char *argv[] );
+static int show_usage    ( void );
+
+/**********************************************************************************************************************/
+
+static long long
+bench_nanos( void )
+{
+     struct timespec spec;
+
+     clock_gettime( CLOCK_MONOTONIC, &spec );
+
+     return spec.tv_sec * 1000000000LL + spec.tv_nsec;
+}
+
+/*
+ * Rendezvous of the master and all clients, without being part of any measurement.
+ */
+static DirectResult
+bench_barrier( BenchShared *shared )
+{
+     int       generation = shared->generation;
+     long long deadline   = bench_nanos() + timeout * 1000000000LL;
+
+     if (D_SYNC_ADD_AND_FETCH( &shared->count, 1 ) == shared->parties) {
+          shared->count = 0;
+
+          D_SYNC_ADD( &shared->generation, 1 );
+
+          return DR_OK;
+     }
+
+     while (*(volatile int *) &shared->generation == generation) {
+          if (bench_nanos() > deadline)
+               return DR_TIMEOUT;
+
+          usleep( 100 );
+     }
+
+     return DR_OK;
+}
+
+/**********************************************************************************************************************/
+
+static FusionCallHandlerResult
+call_handler( int           caller,
+              int           call_arg,
+              void         *ptr,
+              unsigned int  length,
+              void         *ctx,
+              unsigned int  serial,
+              void         *ret_ptr,
+              unsigned int  ret_size,
+              unsigned int *ret_length )
+{
+     if (ret_ptr && ret_size >= sizeof(int)) {
+          *(int *) ret_ptr = 0;
+          *ret_length      = sizeof(int);
+     }
+
+     return FCHR_RETURN;
+}
+
+static DirectResult
+call_setup( Bench *bench )
+{
+     return fusion_call_init3( &bench->call, call_handler, bench, bench->world );
+}
+
+static void
+call_teardown( Bench *bench )
+{
+     fusion_call_destroy( &bench->call );
+}
+
+static DirectResult
+call_client_init( Bench *bench, BenchClient *client )
+{
+     return DR_OK;
+}
+
+static void
+call_client_exit( Bench *bench, BenchClient *client )
+{
+}
+
+static DirectResult
+call_round_trip( Bench *bench, BenchClient *client, BenchMessage *msg, size_t length )
+{
+     int          result;
+     unsigned int ret_length;
+
+     return fusion_call_execute3( &bench->call, FCEF_NONE, 0, msg, length, &result, sizeof(result), &ret_length );
+}
+
+static DirectResult
+call_send( Bench *bench, BenchClient *client, BenchMessage *msg, size_t length )
+{
+     return fusion_call_execute3( &bench->call, FCEF_ONEWAY, 0, msg, length, NULL, 0, NULL );
+}
+
+static const BenchTransport transport_call = {
+     .name       = "fusion_call",
+     .Setup      = call_setup,
+     .Teardown   = call_teardown,
+     .ClientInit = call_client_init,
+     .ClientExit = call_client_exit,
+     .RoundTrip  = call_round_trip,
+     .Send       = call_send
+};
+
+/**********************************************************************************************************************/
+
+static ReactionResult
+reactor_request( const void *msg_data,
+                 void       *ctx )
+{
+     Bench              *bench = ctx;
+     const BenchMessage *msg   = msg_data;
+
+     if (msg->reply)
+          fusion_reactor_dispatch_channel( bench->response, msg->client, msg, sizeof(BenchMessage), true, NULL );
+
+     return RS_OK;
+}
+
+static ReactionResult
+reactor_response( const void *msg_data,
+                  void       *ctx )
+{
+     BenchClient *client = ctx;
+
+     direct_mutex_lock( &client->lock );
+
+     client->responses++;
+
+     direct_waitqueue_broadcast( &client->wait );
+
+     direct_mutex_unlock( &client->lock );
+
+     return RS_OK;
+}
+
+static DirectResult
+reactor_setup( Bench *bench )
+{
+     DirectResult ret;
+
+     bench->request = fusion_reactor_new( sizeof(BenchMessage), "IPC Bench Request", bench->world );
+     if (!bench->request)
+          return DR_FUSION;
+
+     bench->response = fusion_reactor_new( sizeof(BenchMessage), "IPC Bench Response", bench->world );
+     if (!bench->response) {
+          fusion_reactor_free( bench->request );
+          return DR_FUSION;
+     }
+
+     ret = fusion_reactor_attach( bench->request, reactor_request, bench, &bench->reaction );
+     if (ret) {
+          fusion_reactor_free( bench->response );
+          fusion_reactor_free( bench->request );
+     }
+
+     return ret;
+}
+
+static void
+reactor_teardown( Bench *bench )
+{
+     fusion_reactor_detach( bench->request, &bench->reaction );
+
+     fusion_reactor_destroy( bench->response );
+     fusion_reactor_destroy( bench->request );
+
+     fusion_reactor_free( bench->response );
+     fusion_reactor_free( bench->request );
+}
+
+static DirectResult
+reactor_client_init( Bench *bench, BenchClient *client )
+{
+     direct_mutex_init( &client->lock );
+     direct_waitqueue_init( &client->wait );
+
+     return fusion_reactor_attach_channel( bench->response, client->index, reactor_response, client, &client->reaction );
+}
+
+static void
+reactor_client_exit( Bench *bench, BenchClient *client )
+{
+     fusion_reactor_detach( bench->response, &client->reaction );
+
+     direct_waitqueue_deinit( &client->wait );
+     direct_mutex_deinit( &client->lock );
+}
+
+static DirectResult
+reactor_round_trip( Bench *bench, BenchClient *client, BenchMessage *msg, size_t length )
+{
+     DirectResult ret;
+     unsigned int expected;
+
+     direct_mutex_lock( &client->lock );
+     expected = client->responses + 1;
+     direct_mutex_unlock( &client->lock );
+
+     msg->reply = true;
+
+     ret = fusion_reactor_dispatch_channel( bench->request, 0, msg, length, true, NULL );
+     if (ret)
+          return ret;
+
+     direct_mutex_lock( &client->lock );
+
+     while (client->responses < expected) {
+          ret = direct_waitqueue_wait_timeout( &client->wait, &client->lock, timeout * 1000000UL );
+          if (ret)
+               break;
+     }
+
+     direct_mutex_unlock( &client->lock );
+
+     return ret;
+}
+
+static DirectResult
+reactor_send( Bench *bench, BenchClient *client, BenchMessage *msg, size_t length )
+{
+     msg->reply = false;
+
+     return fusion_reactor_dispatch_channel( bench->request, 0, msg, length, true, NULL );
+}
+
+static const BenchTransport transport_reactor = {
+     .name       = "fusion_reactor",
+     .Setup      = reactor_setup,
+     .Teardown   = reactor_teardown,
+     .ClientInit = reactor_client_init,
+     .ClientExit = reactor_client_exit,
+     .RoundTrip  = reactor_round_trip,
+     .Send       = reactor_send
+};
+
+/**********************************************************************************************************************/
+
+#if DIRECTFB_BUILD_ONE
+
+#define ONE_BUFFER_SIZE  (128 * 1024)
+
+static void *
+one_server_loop( DirectThread *thread,
+                 void         *arg )
+{
+     Bench  *bench = arg;
+     char   *buf;
+     size_t  received;
+
+     buf = D_MALLOC( ONE_BUFFER_SIZE );
+     if (!buf) {
+          D_OOM();
+          return NULL;
+     }
+
+     while (!bench->quit) {
+          size_t i;
+
+          if (OneQueue_Receive( &bench->queue_id, 1, buf, ONE_BUFFER_SIZE, &received, false, 0 ))
+               continue;
+
+          for (i=0; i<received; ) {
+               OnePacketHeader *header = (OnePacketHeader*)(buf + i);
+               BenchMessage    *msg    = (BenchMessage*)(header + 1);
+
+               i += header->size + sizeof(OnePacketHeader);
+
+               if (msg->response_qid) {
+                    DirectResult result = DR_OK;
+
+                    OneQueue_Dispatch( msg->response_qid, &result, sizeof(result) );
+               }
+          }
+     }
+
+     D_FREE( buf );
+
+     return NULL;
+}
+
+static DirectResult
+one_setup( Bench *bench )
+{
+     DirectResult ret;
+
+     ret = One_Initialize();
+     if (ret)
+          return ret;
+
+     ret = OneQueue_New( ONE_QUEUE_NO_FLAGS, ONE_QID_NONE, &bench->queue_id );
+     if (ret) {
+          One_Shutdown();
+          return ret;
+     }
+
+     bench->quit   = false;
+     bench->thread = direct_thread_create( DTT_DEFAULT, one_server_loop, bench, "IPC Bench One" );
+
+     return DR_OK;
+}
+
+static void
+one_teardown( Bench *bench )
+{
+     bench->quit = true;
+
+     OneQueue_WakeUp( &bench->queue_id, 1 );
+
+     direct_thread_join( bench->thread );
+     direct_thread_destroy( bench->thread );
+
+     OneQueue_Destroy( bench->queue_id );
+
+     One_Shutdown();
+}
+
+static DirectResult
+one_client_init( Bench *bench, BenchClient *client )
+{
+     return OneQueue_New( ONE_QUEUE_NO_FLAGS, ONE_QID_NONE, &client->response_qid );
+}
+
+static void
+one_client_exit( Bench *bench, BenchClient *client )
+{
+     OneQueue_Destroy( client->response_qid );
+}
+
+static DirectResult
+one_round_trip( Bench *bench, BenchClient *client, BenchMessage *msg, size_t length )
+{
+     char   buf[512];
+     size_t received;
+
+     msg->response_qid = client->response_qid;
+
+     return OneQueue_DispatchReceive( bench->queue_id, msg, length,
+                                      &client->response_qid, 1, buf, sizeof(buf), &received, false, 0 );
+}
+
+static DirectResult
+one_send( Bench *bench, BenchClient *client, BenchMessage *msg, size_t length )
+{
+     msg->response_qid = 0;
+
+     return OneQueue_Dispatch( bench->queue_id, msg, length );
+}
+
+static const BenchTransport transport_one = {
+     .name       = "one_queue",
+     .Setup      = one_setup,
+     .Teardown   = one_teardown,
+     .ClientInit = one_client_init,
+     .ClientExit = one_client_exit,
+     .RoundTrip  = one_round_trip,
+     .Send       = one_send
+};
+
+#endif
+
+/**********************************************************************************************************************/
+
+#if DIRECTFB_BUILD_VOODOO
+
+#define VOODOO_LINK_CODE          0x80008676    /* packet mode */
+
+#define BENCH_METHOD_ID_Push      1
+#define BENCH_METHOD_ID_Sync      2
+
+static DirectResult
+voodoo_dispatch( void                 *dispatcher,
+                 void                 *real,
+                 VoodooManager        *manager,
+                 VoodooRequestMessage *msg )
+{
+     if (msg->method == BENCH_METHOD_ID_Sync)
+          return voodoo_manager_respond( manager, true, msg->header.serial, DR_OK, VOODOO_INSTANCE_NONE, VMBT_NONE );
+
+     return DR_OK;
+}
+
+static DirectResult
+voodoo_setup( Bench *bench )
+{
+     DirectResult ret;
+     int          i;
+     u32          code = VOODOO_LINK_CODE;
+
+     for (i=0; i<bench->clients; i++) {
+          int fds[2];
+
+          if (socketpair( PF_LOCAL, SOCK_STREAM, 0, bench->sockets[i] ))
+               return errno2result( errno );
+
+          /* Both ends expect the link code of the other side. */
+          if (write( bench->sockets[i][0], &code, sizeof(code) ) != sizeof(code) ||
+              write( bench->sockets[i][1], &code, sizeof(code) ) != sizeof(code))
+               return DR_IO;
+
+          fds[0] = fds[1] = bench->sockets[i][0];
+
+          ret = voodoo_link_init_fd( &bench->links[i], fds );
+          if (ret)
+               return ret;
+
+          ret = voodoo_manager_create( &bench->links[i], NULL, NULL, &bench->managers[i] );
+          if (ret)
+               return ret;
+
+          ret = voodoo_manager_register_local( bench->managers[i], VOODOO_INSTANCE_NONE, NULL, NULL,
+                                               voodoo_dispatch, &bench->instances[i] );
+          if (ret)
+               return ret;
+     }
+
+     return DR_OK;
+}
+
+static void
+voodoo_teardown( Bench *bench )
+{
+     int i;
+
+     for (i=0; i<bench->clients; i++) {
+          if (bench->managers[i]) {
+               voodoo_manager_quit( bench->managers[i] );
+               voodoo_manager_destroy( bench->managers[i] );
+
+               bench->managers[i] = NULL;
+          }
+
+          close( bench->sockets[i][1] );
+     }
+}
+
+static DirectResult
+voodoo_client_init( Bench *bench, BenchClient *client )
+{
+     DirectResult ret;
+     int          fds[2];
+
+     fds[0] = fds[1] = bench->sockets[client->index][1];
+
+     ret = voodoo_link_init_fd( &client->link, fds );
+     if (ret)
+          return ret;
+
+     return voodoo_manager_create( &client->link, NULL, NULL, &client->manager );
+}
+
+static void
+voodoo_client_exit( Bench *bench, BenchClient *client )
+{
+     voodoo_manager_quit( client->manager );
+     voodoo_manager_destroy( client->manager );
+}
+
+static DirectResult
+voodoo_round_trip( Bench *bench, BenchClient *client, BenchMessage *msg, size_t length )
+{
+     DirectResult           ret;
+     VoodooResponseMessage *response;
+
+     ret = voodoo_manager_request( client->manager, bench->instances[client->index],
+                                   BENCH_METHOD_ID_Sync, VREQ_RESPOND, &response,
+                                   VMBT_DATA, (int) length, msg,
+                                   VMBT_NONE );
+     if (ret)
+          return ret;
+
+     ret = response->result;
+
+     voodoo_manager_finish_request( client->manager, response );
+
+     return ret;
+}
+
+static DirectResult
+voodoo_send( Bench *bench, BenchClient *client, BenchMessage *msg, size_t length )
+{
+     return voodoo_manager_request( client->manager, bench->instances[client->index],
+                                    BENCH_METHOD_ID_Push, VREQ_NONE, NULL,
+                                    VMBT_DATA, (int) length, msg,
+                                    VMBT_NONE );
+}
+
+static const BenchTransport transport_voodoo = {
+     .name       = "voodoo",
+     .Setup      = voodoo_setup,
+     .Teardown   = voodoo_teardown,
+     .ClientInit = voodoo_client_init,
+     .ClientExit = voodoo_client_exit,
+     .RoundTrip  = voodoo_round_trip,
+     .Send       = voodoo_send
+};
+
+#endif
+
+/**********************************************************************************************************************/
+
+static const BenchTransport *transports[] = {
+     &transport_call,
+     &transport_reactor,
+#if DIRECTFB_BUILD_ONE
+     &transport_one,
+#endif
+#if DIRECTFB_BUILD_VOODOO
+     &transport_voodoo,
+#endif
+};
+
+/**********************************************************************************************************************/
+
+static DirectResult
+measure_round_trips( const BenchTransport *transport,
+                     Bench                *bench,
+                     BenchClient          *client,
+                     BenchMessage         *msg,
+                     size_t                length,
+                     long long            *samples )
+{
+     DirectResult ret;
+     unsigned int i;
+
+     /* Warm up */
+     for (i=0; i<iterations / 10 + 1; i++) {
+          ret = transport->RoundTrip( bench, client, msg, length );
+          if (ret)
+               return ret;
+     }
+
+     for (i=0; i<iterations; i++) {
+          long long start = bench_nanos();
+
+          ret = transport->RoundTrip( bench, client, msg, length );
+          if (ret)
+               return ret;
+
+          samples[i] = bench_nanos() - start;
+     }
+
+     return DR_OK;
+}
+
+static DirectResult
+measure_one_way( const BenchTransport *transport,
+                 Bench                *bench,
+                 BenchClient          *client,
+                 BenchMessage         *msg,
+                 size_t                length,
+                 long long            *ret_nanos )
+{
+     DirectResult ret;
+     unsigned int i;
+     size_t       pending = 0;
+     long long    start   = bench_nanos();
+
+     for (i=0; i<iterations; i++) {
+          ret = transport->Send( bench, client, msg, length );
+          if (ret)
+               return ret;
+
+          pending += length;
+
+          /* All requests have been processed once the round trip returns. */
+          if (pending + length > window || i == iterations - 1) {
+               ret = transport->RoundTrip( bench, client, msg, sizeof(BenchMessage) );
+               if (ret)
+                    return ret;
+
+               pending = 0;
+          }
+     }
+
+     *ret_nanos = bench_nanos() - start;
+
+     return DR_OK;
+}
+
+static int
+run_client( const BenchTransport *transport,
+            Bench                *bench,
+            int                   index )
+{
+     DirectResult  ret;
+     BenchClient   client;
+     BenchShared  *shared = bench->shared;
+     BenchMessage *msg;
+     int           i;
+
+     memset( &client, 0, sizeof(client) );
+
+     client.index = index;
+
+     msg = D_CALLOC( 1, sizeof(BenchMessage) + sizes[num_sizes-1] );
+     if (!msg)
+          return D_OOM();
+
+     msg->client = index;
+
+     ret = transport->ClientInit( bench, &client );
+
+     for (i=0; i<num_sizes; i++) {
+          DirectResult result = ret;
+          size_t       length = sizeof(BenchMessage) + sizes[i];
+
+          if (bench_barrier( shared ))
+               break;
+
+          if (!result)
+               result = measure_round_trips( transport, bench, &client, msg, length,
+                                             shared->samples + index * iterations );
+
+          if (bench_barrier( shared ))
+               break;
+
+          if (!result)
+               result = measure_one_way( transport, bench, &client, msg, length, &shared->oneway_ns[index] );
+
+          shared->errors[index] = result;
+
+          if (bench_barrier( shared ))
+               break;
+     }
+
+     if (!ret)
+          transport->ClientExit( bench, &client );
+
+     D_FREE( msg );
+
+     return ret;
+}
+
+/**********************************************************************************************************************/
+
+static int
+compare_samples( const void *a, const void *b )
+{
+     long long x = *(const long long *) a;
+     long long y = *(const long long *) b;
+
+     return (x > y) - (x < y);
+}
+
+static long long
+percentile( const long long *sorted, size_t count, double p )
+{
+     size_t index = (size_t)(p / 100.0 * count + 0.999999);
+
+     return sorted[index ? index - 1 : 0];
+}
+
+static void
+write_result( FILE                 *out,
+              bool                 *first,
+              const BenchTransport *transport,
+              Bench                *bench,
+              size_t                payload )
+{
+     BenchShared  *shared = bench->shared;
+     DirectResult  error  = DR_OK;
+     size_t        count  = (size_t) bench->clients * iterations;
+     long long     slowest = 0;
+     long double   sum     = 0;
+     size_t        i;
+
+     for (i=0; i<bench->clients; i++) {
+          if (shared->errors[i] && !error)
+               error = shared->errors[i];
+
+          if (shared->oneway_ns[i] > slowest)
+               slowest = shared->oneway_ns[i];
+     }
+
+     fprintf( out, "%s\n    { \"transport\": \"%s\", \"clients\": %d, \"payload\": %zu",
+              *first ? "" : ",", transport->name, bench->clients, payload );
+
+     *first = false;
+
+     if (error) {
+          fprintf( out, ", \"error\": \"%s\" }", DirectResultString( error ) );
+          return;
+     }
+
+     qsort( shared->samples, count, sizeof(long long), compare_samples );
+
+     for (i=0; i<count; i++)
+          sum += shared->samples[i];
+
+     fprintf( out, ",\n      \"round_trip\": { \"count\": %zu, \"min_ns\": %lld, \"mean_ns\": %lld, "
+                   "\"p50_ns\": %lld, \"p90_ns\": %lld, \"p99_ns\": %lld, \"p999_ns\": %lld, \"max_ns\": %lld }",
+              count, shared->samples[0], (long long)(sum / count),
+              percentile( shared->samples, count, 50 ), percentile( shared->samples, count, 90 ),
+              percentile( shared->samples, count, 99 ), percentile( shared->samples, count, 99.9 ),
+              shared->samples[count-1] );
+
+     /* Aggregate throughput of all clients, limited by the slowest one. */
+     fprintf( out, ",\n      \"one_way\": { \"count\": %zu, \"ns\": %lld, \"msgs_per_sec\": %.1f, \"mbytes_per_sec\": %.3f } }",
+              count, slowest,
+              count * 1e9 / slowest,
+              count * (sizeof(BenchMessage) + payload) * 1e9 / slowest / (1024.0 * 1024.0) );
+}
+
+static DirectResult
+run_transport( const BenchTransport *transport,
+               Bench                *bench,
+               FILE                 *out,
+               bool                 *first )
+{
+     DirectResult ret;
+     BenchShared *shared = bench->shared;
+     pid_t        pids[MAX_CLIENTS];
+     int          i, n;
+
+     D_INFO( "IPC/Bench: %s with %d client(s)...\n", transport->name, bench->clients );
+
+     memset( shared, 0, sizeof(BenchShared) );
+
+     shared->parties = bench->clients + 1;
+
+     ret = transport->Setup( bench );
+     if (ret) {
+          D_DERROR( ret, "IPC/Bench: Could not set up %s!\n", transport->name );
+          return ret;
+     }
+
+     for (n=0; n<bench->clients; n++) {
+          pids[n] = fork();
+
+          if (pids[n] == -1) {
+               ret = errno2result( errno );
+               D_PERROR( "IPC/Bench: fork() failed!\n" );
+               break;
+          }
+
+          if (!pids[n]) {
+#if FUSION_BUILD_MULTI
+               ret = fusion_enter( bench->world_index, 0, FER_SLAVE, &bench->world );
+               if (ret) {
+                    D_DERROR( ret, "IPC/Bench: Could not join world %d!\n", bench->world_index );
+                    _exit( 1 );
+               }
+#endif
+
+               ret = run_client( transport, bench, n );
+
+               fusion_exit( bench->world, false );
+
+               _exit( ret ? 1 : 0 );
+          }
+     }
+
+     if (n == bench->clients) {
+          for (i=0; i<num_sizes; i++) {
+               if (bench_barrier( shared ) || bench_barrier( shared ) || bench_barrier( shared )) {
+                    D_ERROR( "IPC/Bench: Timeout waiting for clients of %s!\n", transport->name );
+                    ret = DR_TIMEOUT;
+                    break;
+               }
+
+               write_result( out, first, transport, bench, sizes[i] );
+
+               memset( shared->errors, 0, sizeof(shared->errors) );
+          }
+     }
+
+     while (n--) {
+          if (ret)
+               kill( pids[n], SIGKILL );
+
+          waitpid( pids[n], NULL, 0 );
+     }
+
+     transport->Teardown( bench );
+
+     return ret;
+}
+
+/**********************************************************************************************************************/
+
+int
+main( int argc, char *argv[] )
+{
+     DirectResult  ret;
+     Bench         bench;
+     FILE         *out = stdout;
+     bool          first = true;
+     size_t        shared_size;
+     unsigned int  t;
+     int           i;
+
+     if (parse_cmdline( argc, argv ))
+          return -1;
+
+     memset( &bench, 0, sizeof(bench) );
+
+     /* Have forked clients close the world, see run_transport(). */
+     fusion_config_set( "fork-handler", NULL );
+
+     ret = fusion_enter( -1, 0, FER_MASTER, &bench.world );
+     if (ret) {
+          D_DERROR( ret, "IPC/Bench: fusion_enter() failed!\n" );
+          return ret;
+     }
+
+     fusion_world_set_fork_action( bench.world, FFA_CLOSE );
+
+     bench.world_index = fusion_world_index( bench.world );
+
+     shared_size  = sizeof(BenchShared) + sizeof(long long) * max_clients * iterations;
+     bench.shared = mmap( NULL, shared_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0 );
+     if (bench.shared == MAP_FAILED) {
+          D_PERROR( "IPC/Bench: Could not map %zu bytes of shared memory!\n", shared_size );
+          fusion_exit( bench.world, false );
+          return DR_NOSHAREDMEMORY;
+     }
+
+     if (output) {
+          out = fopen( output, "w" );
+          if (!out) {
+               D_PERROR( "IPC/Bench: Could not open '%s' for writing!\n", output );
+               munmap( bench.shared, shared_size );
+               fusion_exit( bench.world, false );
+               return DR_IO;
+          }
+     }
+
+     fprintf( out, "{\n  \"benchmark\": \"ipc_bench\",\n" );
+     fprintf( out, "  \"version\": \"%d.%d.%d\",\n",
+              DIRECTFB_MAJOR_VERSION, DIRECTFB_MINOR_VERSION, DIRECTFB_MICRO_VERSION );
+     fprintf( out, "  \"fusion\": \"%s\",\n",
+              FUSION_BUILD_MULTI ? (FUSION_BUILD_KERNEL ? "multi-kernel" : "multi-builtin") : "single" );
+     fprintf( out, "  \"iterations\": %u,\n  \"results\": [", iterations );
+
+     for (t=0; t<D_ARRAY_SIZE(transports); t++) {
+          if (only && !strstr( only, transports[t]->name ))
+               continue;
+
+          for (i=1; i<=max_clients; i*=2) {
+               bench.clients = i;
+
+               if (run_transport( transports[t], &bench, out, &first ))
+                    break;
+          }
+     }
+
+     fprintf( out, "\n  ]\n}\n" );
+
+     if (out != stdout)
+          fclose( out );
+
+     munmap( bench.shared, shared_size );
+
+     fusion_exit( bench.world, false );
+
+     return 0;
+}
+
+/**********************************************************************************************************************/
+
+static int
+parse_sizes( const char *arg )
+{
+     char *end;
+
+     num_sizes = 0;
+
+     while (*arg && num_sizes < MAX_SIZES) {
+          unsigned long size = strtoul( arg, &end, 10 );
+
+          if (end == arg || (num_sizes && size <= sizes[num_sizes-1]))
+               return -1;
+
+          sizes[num_sizes++] = size;
+
+          if (*end != ',')
+               break;
+
+          arg = end + 1;
+     }
+
+     return num_sizes ? 0 : -1;
+}
+
+static int
+parse_cmdline( int argc, char *argv[] )
+{
+     int i;
+
+     for (i=1; i<argc; i++) {
+          if (!strcmp( argv[i], "-n" ) && i+1 < argc && atoi( argv[i+1] ) > 0)
+               iterations = atoi( argv[++i] );
+          else if (!strcmp( argv[i], "-c" ) && i+1 < argc && atoi( argv[i+1] ) > 0 && atoi( argv[i+1] ) <= MAX_CLIENTS)
+               max_clients = atoi( argv[++i] );
+          else if (!strcmp( argv[i], "-s" ) && i+1 < argc) {
+               if (parse_sizes( argv[++i] ))
+                    return show_usage();
+          }
+          else if (!strcmp( argv[i], "-w" ) && i+1 < argc && atoi( argv[i+1] ) > 0)
+               window = atoi( argv[++i] );
+          else if (!strcmp( argv[i], "-t" ) && i+1 < argc)
+               only = argv[++i];
+          else if (!strcmp( argv[i], "-T" ) && i+1 < argc && atoi( argv[i+1] ) > 0)
+               timeout = atoi( argv[++i] );
+          else if (!strcmp( argv[i], "-o" ) && i+1 < argc)
+               output = argv[++i];
+          else
+               return show_usage();
+     }
+
+     return 0;
+}
+
+static int
+show_usage( void )
+{
+     unsigned int t;
+
+     fprintf( stderr, "\n"
+                      "Usage:\n"
+                      "   ipc_bench [options]\n"
+                      "\n"
+                      "Options:\n"
+                      "   -n <count>     Requests per client and payload size (default 10000)\n"
+                      "   -c <clients>   Maximum number of client processes, doubled from 1 (default 4)\n"
+                      "   -s <sizes>     Comma separated ascending payload sizes in bytes (default 0,64,1024,8192)\n"
+                      "   -w <bytes>     One way request bytes between round trips (default 32768)\n"
+                      "   -t <names>     Only run the listed transports\n"
+                      "   -T <seconds>   Timeout waiting for clients (default 60)\n"
+                      "   -o <file>      Write JSON results to <file> instead of stdout\n"
+                      "\n"
+                      "Transports:\n" );
+
+     for (t=0; t<D_ARRAY_SIZE(transports); t++)
+          fprintf( stderr, "   %s\n", transports[t]->name );
+
+     fprintf( stderr, "\n" );
+
+     return -1;
+}
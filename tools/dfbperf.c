@@ -0,0 +1,315 @@
+/*
+   (c) Copyright 2012-2013  DirectFB integrated media GmbH
+   (c) Copyright 2001-2013  The world wide DirectFB Open Source Community (directfb.org)
+   (c) Copyright 2000-2004  Convergence (integrated media) GmbH
+
+   All rights reserved.
+
+   Written by Denis Oliver Kropp <dok@directfb.org>,
+              Andreas Shimokawa <andi@directfb.org>,
+              Marek Pikarski <mass@directfb.org>,
+              Sven Neumann <neo@directfb.org>,
+              Ville Syrjälä <syrjala@sci.fi> and
+              Claudio Ciccani <klan@users.sf.net>.
+
+   This file is subject to the terms and conditions of the MIT License:
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation
+   files (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <config.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+
+#include <directfb.h>
+
+#include <direct/clock.h>
+#include <direct/perf.h>
+#include <direct/thread.h>
+
+/**********************************************************************************************************************/
+
+typedef struct {
+     int           num;
+     long long     timestamp;
+     s64           counts[DIRECT_PERF_MAX_COUNTERS];
+} Snapshot;
+
+typedef struct {
+     int           index;
+     s64           delta;
+} Entry;
+
+/**********************************************************************************************************************/
+
+static const char *name;
+
+static int  show_top  = 30;
+static int  interval  = 1000;   /* milli seconds */
+static bool show_all;
+
+static Snapshot snapshots[2];
+static Entry    entries[DIRECT_PERF_MAX_COUNTERS];
+
+/**********************************************************************************************************************/
+
+static DFBBoolean parse_command_line( int argc, char *argv[] );
+
+/**********************************************************************************************************************/
+
+/*
+ * Copies the counters, retrying while the exporting process is updating them.
+ */
+static bool
+snapshot_read( const DirectPerfShm *shm,
+               Snapshot            *snapshot )
+{
+     int i, retry;
+
+     for (retry=0; retry<1000; retry++) {
+          u32 sequence = *(volatile const u32 *) &shm->sequence;
+
+          if (sequence & 1) {
+               direct_thread_sleep( 100 );
+               continue;
+          }
+
+          __sync_synchronize();
+
+          snapshot->num       = shm->num_counters;
+          snapshot->timestamp = shm->timestamp;
+
+          if (snapshot->num > DIRECT_PERF_MAX_COUNTERS)
+               snapshot->num = DIRECT_PERF_MAX_COUNTERS;
+
+          for (i=0; i<snapshot->num; i++)
+               snapshot->counts[i] = shm->counters[i].count;
+
+          __sync_synchronize();
+
+          if (*(volatile const u32 *) &shm->sequence == sequence)
+               return true;
+     }
+
+     return false;
+}
+
+static int
+compare_delta( const void *a, const void *b )
+{
+     const Entry *ea = a;
+     const Entry *eb = b;
+
+     if (ea->delta > eb->delta)
+          return -1;
+
+     if (ea->delta < eb->delta)
+          return 1;
+
+     return ea->index - eb->index;
+}
+
+static void
+dump_counters( const DirectPerfShm *shm,
+               const Snapshot      *current,
+               const Snapshot      *previous )
+{
+     int       i, num = 0;
+     long long elapsed = current->timestamp - previous->timestamp;
+
+     for (i=0; i<current->num; i++) {
+          s64 delta = current->counts[i] - (i < previous->num ? previous->counts[i] : 0);
+
+          if (!delta && !show_all)
+               continue;
+
+          entries[num].index = i;
+          entries[num].delta = delta;
+
+          num++;
+     }
+
+     qsort( entries, num, sizeof(Entry), compare_delta );
+
+     printf( "\n-------------------------------[ Performance Counters of %5u (%lld ms) ]-------------------------------\n",
+             shm->pid, elapsed / 1000 );
+     printf( "Counter                                                             Total        Delta         Rate\n" );
+     printf( "--------------------------------------------------------------------------------------------------------\n" );
+
+     for (i=0; i<num && i<show_top; i++) {
+          const Entry *entry = &entries[i];
+
+          printf( "%-60.60s %12lld %12lld %10.1f/s\n",
+                  shm->counters[entry->index].name, (long long) current->counts[entry->index], (long long) entry->delta,
+                  elapsed > 0 ? entry->delta * 1000000.0 / elapsed : 0.0 );
+     }
+}
+
+/**********************************************************************************************************************/
+
+int
+main( int argc, char *argv[] )
+{
+     int            fd;
+     char           path[256];
+     DirectPerfShm *shm;
+     int            current = 0;
+
+     /* Parse the command line. */
+     if (!parse_command_line( argc, argv ))
+          return -1;
+
+     if (name[0] == '/')
+          snprintf( path, sizeof(path), "%s", name );
+     else
+          snprintf( path, sizeof(path), "/dev/shm/%s", name );
+
+     fd = open( path, O_RDONLY );
+     if (fd < 0) {
+          fprintf( stderr, "Could not open '%s': %s\n", path, strerror( errno ) );
+          fprintf( stderr, "The process has to be running with the 'perf-shm=%s' option.\n", name );
+          return -2;
+     }
+
+     shm = mmap( NULL, sizeof(DirectPerfShm), PROT_READ, MAP_SHARED, fd, 0 );
+     close( fd );
+
+     if (shm == MAP_FAILED) {
+          fprintf( stderr, "Could not map '%s': %s\n", path, strerror( errno ) );
+          return -3;
+     }
+
+     if (shm->magic != DIRECT_PERF_SHM_MAGIC || shm->version != DIRECT_PERF_SHM_VERSION) {
+          fprintf( stderr, "'%s' does not contain performance counters of this version!\n", path );
+          munmap( shm, sizeof(DirectPerfShm) );
+          return -4;
+     }
+
+     if (!snapshot_read( shm, &snapshots[current] )) {
+          fprintf( stderr, "Could not read a consistent snapshot!\n" );
+          munmap( shm, sizeof(DirectPerfShm) );
+          return -5;
+     }
+
+     while (shm->pid) {
+          direct_thread_sleep( interval * 1000LL );
+
+          current = !current;
+
+          if (!snapshot_read( shm, &snapshots[current] )) {
+               current = !current;
+               continue;
+          }
+
+          if (snapshots[current].timestamp == snapshots[!current].timestamp)
+               continue;
+
+          dump_counters( shm, &snapshots[current], &snapshots[!current] );
+          fflush( stdout );
+     }
+
+     printf( "\nThe process has stopped exporting.\n" );
+
+     munmap( shm, sizeof(DirectPerfShm) );
+
+     return 0;
+}
+
+/**********************************************************************************************************************/
+
+static void
+print_usage (const char *prg_name)
+{
+     fprintf (stderr, "\nDirectFB Performance Counter Monitor (version %s)\n\n", DIRECTFB_VERSION);
+     fprintf (stderr, "Usage: %s [options] <name>\n\n", prg_name);
+     fprintf (stderr, "Options:\n");
+     fprintf (stderr, "   -n,  --top <num>        Show the given number of most frequent counters (default 30)\n");
+     fprintf (stderr, "   -i,  --interval <ms>    Update interval in milli seconds (default 1000)\n");
+     fprintf (stderr, "   -a,  --all              Also show counters that did not change\n");
+     fprintf (stderr, "   -h,  --help             Show this help message\n");
+     fprintf (stderr, "   -v,  --version          Print version information\n");
+     fprintf (stderr, "\n");
+     fprintf (stderr, "The process has to be running with the 'perf-shm=<name>' option.\n");
+     fprintf (stderr, "\n");
+}
+
+static DFBBoolean
+parse_command_line( int argc, char *argv[] )
+{
+     int n;
+
+     for (n = 1; n < argc; n++) {
+          const char *arg = argv[n];
+
+          if (strcmp (arg, "-h") == 0 || strcmp (arg, "--help") == 0) {
+               print_usage (argv[0]);
+               return DFB_FALSE;
+          }
+
+          if (strcmp (arg, "-v") == 0 || strcmp (arg, "--version") == 0) {
+               fprintf (stderr, "dfbperf version %s\n", DIRECTFB_VERSION);
+               return DFB_FALSE;
+          }
+
+          if (strcmp (arg, "-a") == 0 || strcmp (arg, "--all") == 0) {
+               show_all = true;
+               continue;
+          }
+
+          if (strcmp (arg, "-n") == 0 || strcmp (arg, "--top") == 0) {
+               if (n<argc-1) {
+                    show_top = atoi( argv[++n] );
+                    continue;
+               }
+          }
+
+          if (strcmp (arg, "-i") == 0 || strcmp (arg, "--interval") == 0) {
+               if (n<argc-1) {
+                    interval = atoi( argv[++n] );
+
+                    if (interval > 0)
+                         continue;
+               }
+          }
+
+          if (arg[0] != '-' && !name) {
+               name = arg;
+               continue;
+          }
+
+          print_usage (argv[0]);
+
+          return DFB_FALSE;
+     }
+
+     if (!name) {
+          print_usage (argv[0]);
+          return DFB_FALSE;
+     }
+
+     return DFB_TRUE;
+}
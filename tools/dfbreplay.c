@@ -0,0 +1,1060 @@
+/*
+   (c) Copyright 2012-2013  DirectFB integrated media GmbH
+   (c) Copyright 2001-2013  The world wide DirectFB Open Source Community (directfb.org)
+   (c) Copyright 2000-2004  Convergence (integrated media) GmbH
+
+   All rights reserved.
+
+   Written by Denis Oliver Kropp <dok@directfb.org>,
+              Andreas Shimokawa <andi@directfb.org>,
+              Marek Pikarski <mass@directfb.org>,
+              Sven Neumann <neo@directfb.org>,
+              Ville Syrjälä <syrjala@sci.fi> and
+              Claudio Ciccani <klan@users.sf.net>.
+
+   This file is subject to the terms and conditions of the MIT License:
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation
+   files (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <config.h>
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <directfb.h>
+#include <directfb_version.h>
+
+#include <direct/clock.h>
+#include <direct/thread.h>
+
+#include <fusion/wire.h>
+
+#include <misc/capture.h>
+
+/**********************************************************************************************************************/
+
+typedef struct {
+     DFBCaptureInterface  type;
+     IAny                *iface;
+     int                  refs;
+} ReplayObject;
+
+typedef struct {
+     long long            cpu;
+     long long            wall;
+} ReplayFrame;
+
+/**********************************************************************************************************************/
+
+static IDirectFB    *dfb;
+
+static const char   *filename;
+static bool          timed;
+static bool          show_frames;
+static int           loops = 1;
+
+static u8           *data;
+static unsigned int  data_length;
+
+static ReplayObject *objects;
+static unsigned int  num_objects;
+
+static ReplayFrame  *frames;
+static unsigned int  num_frames;
+static unsigned int  max_frames;
+
+static unsigned int  num_calls;
+static unsigned int  num_failed;
+static unsigned int  num_skipped;
+
+/**********************************************************************************************************************/
+
+static DFBBoolean parse_command_line( int argc, char *argv[] );
+
+/**********************************************************************************************************************/
+
+static DFBResult
+load_file( void )
+{
+     FILE *file;
+     long  size;
+
+     file = fopen( filename, "rb" );
+     if (!file) {
+          perror( filename );
+          return DFB_IO;
+     }
+
+     fseek( file, 0, SEEK_END );
+     size = ftell( file );
+     fseek( file, 0, SEEK_SET );
+
+     if (size <= 0) {
+          fprintf( stderr, "%s: Empty capture!\n", filename );
+          fclose( file );
+          return DFB_IO;
+     }
+
+     /* Items are 8 byte aligned within the file, malloc() keeps them aligned in memory. */
+     data = malloc( size );
+     if (!data) {
+          fclose( file );
+          return DFB_NOSYSTEMMEMORY;
+     }
+
+     if (fread( data, size, 1, file ) != 1) {
+          perror( filename );
+          fclose( file );
+          return DFB_IO;
+     }
+
+     fclose( file );
+
+     data_length = size;
+
+     return DFB_OK;
+}
+
+/**********************************************************************************************************************/
+
+static void *
+object_get( u32                 id,
+            DFBCaptureInterface type )
+{
+     if (id == 0 || id >= num_objects || !objects[id].iface)
+          return NULL;
+
+     if (objects[id].type != type) {
+          fprintf( stderr, "Object %u has type %d, expected %d!\n", id, objects[id].type, type );
+          return NULL;
+     }
+
+     return objects[id].iface;
+}
+
+static void
+object_add( u32                  id,
+            DFBCaptureInterface  type,
+            void                *iface )
+{
+     IAny *any = iface;
+
+     if (id == 0) {
+          any->Release( any );
+          return;
+     }
+
+     if (id >= num_objects) {
+          unsigned int  num = id + 64;
+          ReplayObject *array;
+
+          array = realloc( objects, num * sizeof(ReplayObject) );
+          if (!array) {
+               fprintf( stderr, "Out of memory!\n" );
+               any->Release( any );
+               return;
+          }
+
+          memset( array + num_objects, 0, (num - num_objects) * sizeof(ReplayObject) );
+
+          objects     = array;
+          num_objects = num;
+     }
+
+     /* The same object was returned again during capture, keep using the first interface. */
+     if (objects[id].iface) {
+          objects[id].iface->AddRef( objects[id].iface );
+          objects[id].refs++;
+
+          any->Release( any );
+          return;
+     }
+
+     objects[id].type  = type;
+     objects[id].iface = any;
+     objects[id].refs  = 1;
+}
+
+static void
+objects_release( void )
+{
+     unsigned int i;
+
+     /* Release in reverse order of creation, e.g. surfaces before their windows. */
+     for (i=num_objects; i>2; i--) {
+          ReplayObject *object = &objects[i-1];
+
+          while (object->refs > 0) {
+               object->iface->Release( object->iface );
+               object->refs--;
+          }
+
+          object->iface = NULL;
+     }
+}
+
+/**********************************************************************************************************************/
+
+static const void *
+decode_optional( FusionWireDecoder *decoder,
+                 unsigned int       element_size )
+{
+     const void   *elements = NULL;
+     unsigned int  count    = 0;
+
+     fusion_wire_decode_array( decoder, element_size, &elements, &count );
+
+     return count ? elements : NULL;
+}
+
+static u32
+decode_u32( FusionWireDecoder *decoder )
+{
+     u32 value = 0;
+
+     fusion_wire_decode_u32( decoder, &value );
+
+     return value;
+}
+
+static s32
+decode_s32( FusionWireDecoder *decoder )
+{
+     s32 value = 0;
+
+     fusion_wire_decode_s32( decoder, &value );
+
+     return value;
+}
+
+static u32
+decode_object( FusionWireDecoder *decoder )
+{
+     u32 value = 0;
+
+     fusion_wire_decode_object( decoder, &value );
+
+     return value;
+}
+
+static DFBResult
+replay_stream( FusionWireDecoder *decoder,
+               DFBCaptureMethod   method )
+{
+     u32 version, major, minor, micro;
+
+     if (method != DCM_STREAM_HEADER)
+          return DFB_UNSUPPORTED;
+
+     version = decode_u32( decoder );
+     major   = decode_u32( decoder );
+     minor   = decode_u32( decoder );
+     micro   = decode_u32( decoder );
+
+     if (version != DFB_CAPTURE_VERSION) {
+          fprintf( stderr, "Capture format version %u is not supported!\n", version );
+          return DFB_VERSIONMISMATCH;
+     }
+
+     if (major != DIRECTFB_MAJOR_VERSION || minor != DIRECTFB_MINOR_VERSION || micro != DIRECTFB_MICRO_VERSION)
+          fprintf( stderr, "Warning: Captured with DirectFB %u.%u.%u, replaying with %s!\n", major, minor, micro, DIRECTFB_VERSION );
+
+     return DFB_OK;
+}
+
+static DFBResult
+replay_dfb( FusionWireDecoder *decoder,
+            DFBCaptureMethod   method )
+{
+     DFBResult ret;
+
+     switch (method) {
+          case DCM_DFB_SET_COOPERATIVE_LEVEL:
+               return dfb->SetCooperativeLevel( dfb, decode_u32( decoder ) );
+
+          case DCM_DFB_CREATE_SURFACE: {
+               const DFBSurfaceDescription *desc = decode_optional( decoder, sizeof(DFBSurfaceDescription) );
+               IDirectFBSurface            *surface;
+
+               ret = dfb->CreateSurface( dfb, desc, &surface );
+               if (ret == DFB_OK)
+                    object_add( decode_object( decoder ), DCI_SURFACE, surface );
+
+               return ret;
+          }
+
+          case DCM_DFB_GET_DISPLAY_LAYER: {
+               u32                    layer_id = decode_u32( decoder );
+               IDirectFBDisplayLayer *layer;
+
+               ret = dfb->GetDisplayLayer( dfb, layer_id, &layer );
+               if (ret == DFB_OK)
+                    object_add( decode_object( decoder ), DCI_DISPLAYLAYER, layer );
+
+               return ret;
+          }
+
+          case DCM_DFB_CREATE_FONT: {
+               const char               *name;
+               unsigned int              length;
+               const DFBFontDescription *desc;
+               IDirectFBFont            *font;
+               char                     *path;
+
+               fusion_wire_decode_array( decoder, 1, (const void**) &name, &length );
+
+               desc = decode_optional( decoder, sizeof(DFBFontDescription) );
+
+               path = strndup( name, length );
+
+               ret = dfb->CreateFont( dfb, path, desc, &font );
+               if (ret == DFB_OK)
+                    object_add( decode_object( decoder ), DCI_FONT, font );
+
+               free( path );
+
+               return ret;
+          }
+
+          default:
+               break;
+     }
+
+     return DFB_UNSUPPORTED;
+}
+
+static DFBResult
+replay_layer( IDirectFBDisplayLayer *layer,
+              FusionWireDecoder     *decoder,
+              DFBCaptureMethod       method )
+{
+     DFBResult ret;
+
+     switch (method) {
+          case DCM_LAYER_SET_COOPERATIVE_LEVEL:
+               return layer->SetCooperativeLevel( layer, decode_u32( decoder ) );
+
+          case DCM_LAYER_CREATE_WINDOW: {
+               const DFBWindowDescription *desc = decode_optional( decoder, sizeof(DFBWindowDescription) );
+               IDirectFBWindow            *window;
+
+               ret = layer->CreateWindow( layer, desc, &window );
+               if (ret == DFB_OK)
+                    object_add( decode_object( decoder ), DCI_WINDOW, window );
+
+               return ret;
+          }
+
+          case DCM_LAYER_GET_SURFACE: {
+               IDirectFBSurface *surface;
+
+               ret = layer->GetSurface( layer, &surface );
+               if (ret == DFB_OK)
+                    object_add( decode_object( decoder ), DCI_SURFACE, surface );
+
+               return ret;
+          }
+
+          default:
+               break;
+     }
+
+     return DFB_UNSUPPORTED;
+}
+
+static DFBResult
+replay_window( IDirectFBWindow   *window,
+               FusionWireDecoder *decoder,
+               DFBCaptureMethod   method )
+{
+     DFBResult ret;
+     s32       a, b;
+
+     switch (method) {
+          case DCM_WINDOW_GET_SURFACE: {
+               IDirectFBSurface *surface;
+
+               ret = window->GetSurface( window, &surface );
+               if (ret == DFB_OK)
+                    object_add( decode_object( decoder ), DCI_SURFACE, surface );
+
+               return ret;
+          }
+
+          case DCM_WINDOW_SET_OPACITY:
+               return window->SetOpacity( window, decode_u32( decoder ) );
+
+          case DCM_WINDOW_MOVE_TO:
+               a = decode_s32( decoder );
+               b = decode_s32( decoder );
+
+               return window->MoveTo( window, a, b );
+
+          case DCM_WINDOW_RESIZE:
+               a = decode_s32( decoder );
+               b = decode_s32( decoder );
+
+               return window->Resize( window, a, b );
+
+          default:
+               break;
+     }
+
+     return DFB_UNSUPPORTED;
+}
+
+static DFBResult
+replay_contents( IDirectFBSurface  *surface,
+                 FusionWireDecoder *decoder )
+{
+     const DFBRectangle    *rect;
+     DFBSurfacePixelFormat  format;
+     DFBSurfacePixelFormat  captured;
+     const void            *pixels;
+     unsigned int           length;
+
+     rect     = decode_optional( decoder, sizeof(DFBRectangle) );
+     captured = decode_u32( decoder );
+
+     fusion_wire_decode_array( decoder, 1, &pixels, &length );
+
+     if (!rect || !pixels)
+          return DFB_INVARG;
+
+     surface->GetPixelFormat( surface, &format );
+
+     if (format != captured || length < (unsigned int)(DFB_BYTES_PER_LINE( format, rect->w ) * rect->h))
+          return DFB_UNSUPPORTED;
+
+     return surface->Write( surface, rect, pixels, DFB_BYTES_PER_LINE( format, rect->w ) );
+}
+
+static DFBResult
+replay_surface( IDirectFBSurface  *surface,
+                FusionWireDecoder *decoder,
+                DFBCaptureMethod   method )
+{
+     DFBResult           ret;
+     const DFBRectangle *rects;
+     const DFBRegion    *regions;
+     const DFBPoint     *points;
+     unsigned int        num;
+     IDirectFBSurface   *source;
+     u32                 value;
+     s32                 x, y;
+     unsigned int        i;
+
+     switch (method) {
+          case DCM_SURFACE_CONTENTS:
+               return replay_contents( surface, decoder );
+
+          case DCM_SURFACE_CLEAR:
+               value = decode_u32( decoder );
+
+               return surface->Clear( surface, value >> 16, value >> 8, value, value >> 24 );
+
+          case DCM_SURFACE_SET_COLOR:
+               value = decode_u32( decoder );
+
+               return surface->SetColor( surface, value >> 16, value >> 8, value, value >> 24 );
+
+          case DCM_SURFACE_SET_CLIP:
+               return surface->SetClip( surface, decode_optional( decoder, sizeof(DFBRegion) ) );
+
+          case DCM_SURFACE_SET_DRAWING_FLAGS:
+               return surface->SetDrawingFlags( surface, decode_u32( decoder ) );
+
+          case DCM_SURFACE_SET_BLITTING_FLAGS:
+               return surface->SetBlittingFlags( surface, decode_u32( decoder ) );
+
+          case DCM_SURFACE_SET_PORTER_DUFF:
+               return surface->SetPorterDuff( surface, decode_u32( decoder ) );
+
+          case DCM_SURFACE_SET_SRC_BLEND_FUNCTION:
+               return surface->SetSrcBlendFunction( surface, decode_u32( decoder ) );
+
+          case DCM_SURFACE_SET_DST_BLEND_FUNCTION:
+               return surface->SetDstBlendFunction( surface, decode_u32( decoder ) );
+
+          case DCM_SURFACE_SET_SRC_COLOR_KEY:
+               value = decode_u32( decoder );
+
+               return surface->SetSrcColorKey( surface, value >> 16, value >> 8, value );
+
+          case DCM_SURFACE_SET_DST_COLOR_KEY:
+               value = decode_u32( decoder );
+
+               return surface->SetDstColorKey( surface, value >> 16, value >> 8, value );
+
+          case DCM_SURFACE_SET_RENDER_OPTIONS:
+               return surface->SetRenderOptions( surface, decode_u32( decoder ) );
+
+          case DCM_SURFACE_SET_MATRIX: {
+               const s32 *matrix;
+
+               if (fusion_wire_decode_array( decoder, sizeof(s32), (const void**) &matrix, &num ) || (num && num != 9))
+                    return DFB_INVARG;
+
+               return surface->SetMatrix( surface, num ? matrix : NULL );
+          }
+
+          case DCM_SURFACE_SET_SOURCE_MASK:
+               value = decode_object( decoder );
+
+               if (value && !object_get( value, DCI_SURFACE ))
+                    return DFB_IDNOTFOUND;
+
+               x = decode_s32( decoder );
+               y = decode_s32( decoder );
+
+               return surface->SetSourceMask( surface, object_get( value, DCI_SURFACE ), x, y, decode_u32( decoder ) );
+
+          case DCM_SURFACE_SET_FONT:
+               value = decode_object( decoder );
+
+               if (value && !object_get( value, DCI_FONT ))
+                    return DFB_IDNOTFOUND;
+
+               return surface->SetFont( surface, object_get( value, DCI_FONT ) );
+
+          case DCM_SURFACE_FILL_RECTANGLES:
+               if (fusion_wire_decode_array( decoder, sizeof(DFBRectangle), (const void**) &rects, &num ))
+                    return DFB_INVARG;
+
+               return surface->FillRectangles( surface, rects, num );
+
+          case DCM_SURFACE_DRAW_RECTANGLE:
+               rects = decode_optional( decoder, sizeof(DFBRectangle) );
+               if (!rects)
+                    return DFB_INVARG;
+
+               return surface->DrawRectangle( surface, rects->x, rects->y, rects->w, rects->h );
+
+          case DCM_SURFACE_FILL_TRIANGLES: {
+               const DFBTriangle *tris;
+
+               if (fusion_wire_decode_array( decoder, sizeof(DFBTriangle), (const void**) &tris, &num ))
+                    return DFB_INVARG;
+
+               return surface->FillTriangles( surface, tris, num );
+          }
+
+          case DCM_SURFACE_FILL_SPANS: {
+               const DFBSpan *spans;
+
+               y = decode_s32( decoder );
+
+               if (fusion_wire_decode_array( decoder, sizeof(DFBSpan), (const void**) &spans, &num ))
+                    return DFB_INVARG;
+
+               return surface->FillSpans( surface, y, spans, num );
+          }
+
+          case DCM_SURFACE_FILL_TRAPEZOIDS: {
+               const DFBTrapezoid *traps;
+
+               if (fusion_wire_decode_array( decoder, sizeof(DFBTrapezoid), (const void**) &traps, &num ))
+                    return DFB_INVARG;
+
+               return surface->FillTrapezoids( surface, traps, num );
+          }
+
+          case DCM_SURFACE_DRAW_LINES:
+               if (fusion_wire_decode_array( decoder, sizeof(DFBRegion), (const void**) &regions, &num ))
+                    return DFB_INVARG;
+
+               return surface->DrawLines( surface, regions, num );
+
+          case DCM_SURFACE_BLIT:
+          case DCM_SURFACE_TILE_BLIT:
+               source = object_get( decode_object( decoder ), DCI_SURFACE );
+               if (!source)
+                    return DFB_IDNOTFOUND;
+
+               rects = decode_optional( decoder, sizeof(DFBRectangle) );
+               x     = decode_s32( decoder );
+               y     = decode_s32( decoder );
+
+               if (method == DCM_SURFACE_TILE_BLIT)
+                    return surface->TileBlit( surface, source, rects, x, y );
+
+               return surface->Blit( surface, source, rects, x, y );
+
+          case DCM_SURFACE_BATCH_BLIT:
+               source = object_get( decode_object( decoder ), DCI_SURFACE );
+               if (!source)
+                    return DFB_IDNOTFOUND;
+
+               if (fusion_wire_decode_array( decoder, sizeof(DFBRectangle), (const void**) &rects, &num ) ||
+                   fusion_wire_decode_array( decoder, sizeof(DFBPoint), (const void**) &points, &num ))
+                    return DFB_INVARG;
+
+               return surface->BatchBlit( surface, source, rects, points, num );
+
+          case DCM_SURFACE_BATCH_BLIT2: {
+               IDirectFBSurface *source2;
+               const DFBPoint   *points2;
+               unsigned int      num2, num3;
+
+               source  = object_get( decode_object( decoder ), DCI_SURFACE );
+               source2 = object_get( decode_object( decoder ), DCI_SURFACE );
+               if (!source || !source2)
+                    return DFB_IDNOTFOUND;
+
+               if (fusion_wire_decode_array( decoder, sizeof(DFBRectangle), (const void**) &rects, &num ) ||
+                   fusion_wire_decode_array( decoder, sizeof(DFBPoint), (const void**) &points, &num2 ) ||
+                   fusion_wire_decode_array( decoder, sizeof(DFBPoint), (const void**) &points2, &num3 ) ||
+                   num2 != num || num3 != num)
+                    return DFB_INVARG;
+
+               return surface->BatchBlit2( surface, source, source2, rects, points, points2, num );
+          }
+
+          case DCM_SURFACE_BATCH_STRETCH_BLIT: {
+               const DFBRectangle *destinations;
+               unsigned int        num2;
+
+               source = object_get( decode_object( decoder ), DCI_SURFACE );
+               if (!source)
+                    return DFB_IDNOTFOUND;
+
+               if (fusion_wire_decode_array( decoder, sizeof(DFBRectangle), (const void**) &rects, &num ) ||
+                   fusion_wire_decode_array( decoder, sizeof(DFBRectangle), (const void**) &destinations, &num2 ) ||
+                   num2 != num)
+                    return DFB_INVARG;
+
+               return surface->BatchStretchBlit( surface, source, rects, destinations, num );
+          }
+
+          case DCM_SURFACE_TEXTURE_TRIANGLES: {
+               const DFBVertex *vertices;
+               const int       *indices;
+               unsigned int     num_vertices;
+               s32              count;
+
+               source = object_get( decode_object( decoder ), DCI_SURFACE );
+               if (!source)
+                    return DFB_IDNOTFOUND;
+
+               if (fusion_wire_decode_array( decoder, sizeof(DFBVertex), (const void**) &vertices, &num_vertices ) ||
+                   fusion_wire_decode_array( decoder, sizeof(int), (const void**) &indices, &num ))
+                    return DFB_INVARG;
+
+               count = decode_s32( decoder );
+               value = decode_u32( decoder );
+
+               /* Without indices the vertices are used in order, with indices all of them were recorded. */
+               if (count <= 0 || (num ? num != (unsigned int) count : num_vertices != (unsigned int) count))
+                    return DFB_INVARG;
+
+               for (i=0; i<num; i++) {
+                    if (indices[i] < 0 || (unsigned int) indices[i] >= num_vertices)
+                         return DFB_INVARG;
+               }
+
+               return surface->TextureTriangles( surface, source, vertices, num ? indices : NULL, count, value );
+          }
+
+          case DCM_SURFACE_STRETCH_BLIT: {
+               const DFBRectangle *destination;
+
+               source = object_get( decode_object( decoder ), DCI_SURFACE );
+               if (!source)
+                    return DFB_IDNOTFOUND;
+
+               rects       = decode_optional( decoder, sizeof(DFBRectangle) );
+               destination = decode_optional( decoder, sizeof(DFBRectangle) );
+
+               return surface->StretchBlit( surface, source, rects, destination );
+          }
+
+          case DCM_SURFACE_DRAW_STRING: {
+               const char *text;
+
+               if (fusion_wire_decode_array( decoder, 1, (const void**) &text, &num ))
+                    return DFB_INVARG;
+
+               x     = decode_s32( decoder );
+               y     = decode_s32( decoder );
+               value = decode_u32( decoder );
+
+               return surface->DrawString( surface, text, num, x, y, value );
+          }
+
+          case DCM_SURFACE_DRAW_GLYPH: {
+               u32 character = decode_u32( decoder );
+
+               x     = decode_s32( decoder );
+               y     = decode_s32( decoder );
+               value = decode_u32( decoder );
+
+               return surface->DrawGlyph( surface, character, x, y, value );
+          }
+
+          case DCM_SURFACE_FLIP:
+               regions = decode_optional( decoder, sizeof(DFBRegion) );
+
+               return surface->Flip( surface, regions, decode_u32( decoder ) );
+
+          case DCM_SURFACE_GET_SUB_SURFACE: {
+               IDirectFBSurface *sub;
+
+               rects = decode_optional( decoder, sizeof(DFBRectangle) );
+
+               ret = surface->GetSubSurface( surface, rects, &sub );
+               if (ret == DFB_OK)
+                    object_add( decode_object( decoder ), DCI_SURFACE, sub );
+
+               return ret;
+          }
+
+          default:
+               break;
+     }
+
+     return DFB_UNSUPPORTED;
+}
+
+static DFBResult
+replay_message( const FusionWireHeader *header,
+                FusionWireDecoder      *decoder )
+{
+     ReplayObject     *object;
+     DFBCaptureMethod  method = header->call_arg;
+
+     if (header->call_id == DCI_STREAM)
+          return replay_stream( decoder, method );
+
+     if (header->object_id == 1 && header->call_id == DCI_IDIRECTFB) {
+          /* References of the super interface belong to this tool. */
+          if (method == DCM_ADDREF || method == DCM_RELEASE)
+               return DFB_OK;
+
+          return replay_dfb( decoder, method );
+     }
+
+     if (header->object_id >= num_objects || !objects[header->object_id].iface)
+          return DFB_IDNOTFOUND;
+
+     object = &objects[header->object_id];
+
+     if (object->type != header->call_id)
+          return DFB_INVARG;
+
+     switch (method) {
+          case DCM_ADDREF:
+               object->refs++;
+               return object->iface->AddRef( object->iface );
+
+          case DCM_RELEASE:
+               object->iface->Release( object->iface );
+
+               if (--object->refs == 0)
+                    object->iface = NULL;
+
+               return DFB_OK;
+
+          default:
+               break;
+     }
+
+     switch (object->type) {
+          case DCI_DISPLAYLAYER:
+               return replay_layer( (IDirectFBDisplayLayer*) object->iface, decoder, method );
+
+          case DCI_WINDOW:
+               return replay_window( (IDirectFBWindow*) object->iface, decoder, method );
+
+          case DCI_SURFACE:
+               return replay_surface( (IDirectFBSurface*) object->iface, decoder, method );
+
+          default:
+               break;
+     }
+
+     return DFB_UNSUPPORTED;
+}
+
+/**********************************************************************************************************************/
+
+static void
+frame_add( long long cpu,
+           long long wall )
+{
+     if (num_frames == max_frames) {
+          ReplayFrame *array;
+
+          max_frames = max_frames ? max_frames * 2 : 1024;
+
+          array = realloc( frames, max_frames * sizeof(ReplayFrame) );
+          if (!array) {
+               fprintf( stderr, "Out of memory!\n" );
+               exit( -5 );
+          }
+
+          frames = array;
+     }
+
+     frames[num_frames].cpu  = cpu;
+     frames[num_frames].wall = wall;
+
+     if (show_frames)
+          printf( "frame %6u   cpu %8lld us   wall %8lld us\n", num_frames, cpu, wall );
+
+     num_frames++;
+}
+
+static DFBResult
+replay( void )
+{
+     DFBResult    ret;
+     unsigned int offset = 0;
+     long long    first  = 0;
+     long long    start  = direct_clock_get_time( DIRECT_CLOCK_MONOTONIC );
+     long long    frame_cpu;
+     long long    frame_wall;
+
+     frame_cpu  = direct_clock_get_time( DIRECT_CLOCK_PROCESS_CPUTIME_ID );
+     frame_wall = start;
+
+     while (offset < data_length) {
+          FusionWireDecoder       decoder;
+          const FusionWireHeader *header = (const FusionWireHeader *)(data + offset);
+          unsigned int            length = fusion_wire_message_length( header, data_length - offset );
+
+          if (!length || length > data_length - offset) {
+               fprintf( stderr, "Truncated message at offset %u!\n", offset );
+               return DFB_INCOMPLETE;
+          }
+
+          ret = fusion_wire_decode_init( &decoder, header, length );
+          if (ret) {
+               DirectFBError( "fusion_wire_decode_init", ret );
+               return ret;
+          }
+
+          if (timed) {
+               long long delay;
+
+               if (!first)
+                    first = header->timestamp;
+
+               delay = (header->timestamp - first) - (direct_clock_get_time( DIRECT_CLOCK_MONOTONIC ) - start);
+               if (delay > 0)
+                    direct_thread_sleep( delay );
+          }
+
+          ret = replay_message( header, &decoder );
+          if (ret == DFB_VERSIONMISMATCH)
+               return ret;
+
+          num_calls++;
+
+          if (ret == DFB_IDNOTFOUND || ret == DFB_UNSUPPORTED)
+               num_skipped++;
+          else if (ret)
+               num_failed++;
+
+          if (header->call_id == DCI_SURFACE && header->call_arg == DCM_SURFACE_FLIP) {
+               long long cpu  = direct_clock_get_time( DIRECT_CLOCK_PROCESS_CPUTIME_ID );
+               long long wall = direct_clock_get_time( DIRECT_CLOCK_MONOTONIC );
+
+               frame_add( cpu - frame_cpu, wall - frame_wall );
+
+               frame_cpu  = cpu;
+               frame_wall = wall;
+          }
+
+          offset += length;
+     }
+
+     return DFB_OK;
+}
+
+/**********************************************************************************************************************/
+
+static int
+compare_long_long( const void *a, const void *b )
+{
+     long long la = *(const long long*) a;
+     long long lb = *(const long long*) b;
+
+     return (la > lb) - (la < lb);
+}
+
+static void
+print_statistics( const char *name,
+                  size_t      offset )
+{
+     unsigned int  i;
+     long long    *values;
+     long long     sum = 0;
+
+     values = malloc( num_frames * sizeof(long long) );
+     if (!values)
+          return;
+
+     for (i=0; i<num_frames; i++) {
+          values[i] = *(const long long*)((const u8*) &frames[i] + offset);
+
+          sum += values[i];
+     }
+
+     qsort( values, num_frames, sizeof(long long), compare_long_long );
+
+     printf( "%-5s  mean %8lld   p50 %8lld   p90 %8lld   p99 %8lld   max %8lld  (us)\n", name,
+             sum / num_frames,
+             values[num_frames * 50 / 100],
+             values[num_frames * 90 / 100],
+             values[num_frames * 99 / 100],
+             values[num_frames - 1] );
+
+     free( values );
+}
+
+int
+main( int argc, char *argv[] )
+{
+     DFBResult ret;
+     int       i;
+
+     /* Initialize DirectFB. */
+     ret = DirectFBInit( &argc, &argv );
+     if (ret) {
+          DirectFBError( "DirectFBInit", ret );
+          return -1;
+     }
+
+     /* Parse the command line. */
+     if (!parse_command_line( argc, argv ))
+          return -2;
+
+     if (load_file())
+          return -3;
+
+     /* Create the super interface. */
+     ret = DirectFBCreate( &dfb );
+     if (ret) {
+          DirectFBError( "DirectFBCreate", ret );
+          return -4;
+     }
+
+     for (i=0; i<loops; i++) {
+          ret = replay();
+
+          objects_release();
+
+          if (ret)
+               break;
+     }
+
+     printf( "%s: %u calls, %u failed, %u skipped, %u frames\n", filename, num_calls, num_failed, num_skipped, num_frames );
+
+     if (num_frames) {
+          print_statistics( "cpu", offsetof( ReplayFrame, cpu ) );
+          print_statistics( "wall", offsetof( ReplayFrame, wall ) );
+     }
+
+     /* DirectFB deinitialization. */
+     dfb->Release( dfb );
+
+     free( frames );
+     free( objects );
+     free( data );
+
+     return ret ? -5 : 0;
+}
+
+/**********************************************************************************************************************/
+
+static void
+print_usage (const char *prg_name)
+{
+     fprintf (stderr, "\nDirectFB Capture Replay (version %s)\n\n", DIRECTFB_VERSION);
+     fprintf (stderr, "Usage: %s [options] <file>\n\n", prg_name);
+     fprintf (stderr, "Options:\n");
+     fprintf (stderr, "   -t,  --timed            Keep the original timing instead of replaying as fast as possible\n");
+     fprintf (stderr, "   -f,  --frames           Print the times of each frame\n");
+     fprintf (stderr, "   -n,  --loops <num>      Replay the capture the given number of times (default 1)\n");
+     fprintf (stderr, "   -h,  --help             Show this help message\n");
+     fprintf (stderr, "   -v,  --version          Print version information\n");
+     fprintf (stderr, "\n");
+     fprintf (stderr, "Captures are recorded with the 'capture=<file>' option, a frame ends with each Flip().\n");
+     fprintf (stderr, "Use '--dfb:system=dummy' to replay without output.\n");
+     fprintf (stderr, "\n");
+}
+
+static DFBBoolean
+parse_command_line( int argc, char *argv[] )
+{
+     int n;
+
+     for (n = 1; n < argc; n++) {
+          const char *arg = argv[n];
+
+          if (strcmp (arg, "-h") == 0 || strcmp (arg, "--help") == 0) {
+               print_usage (argv[0]);
+               return DFB_FALSE;
+          }
+
+          if (strcmp (arg, "-v") == 0 || strcmp (arg, "--version") == 0) {
+               fprintf (stderr, "dfbreplay version %s\n", DIRECTFB_VERSION);
+               return DFB_FALSE;
+          }
+
+          if (strcmp (arg, "-t") == 0 || strcmp (arg, "--timed") == 0) {
+               timed = true;
+               continue;
+          }
+
+          if (strcmp (arg, "-f") == 0 || strcmp (arg, "--frames") == 0) {
+               show_frames = true;
+               continue;
+          }
+
+          if (strcmp (arg, "-n") == 0 || strcmp (arg, "--loops") == 0) {
+               if (n<argc-1) {
+                    loops = atoi( argv[++n] );
+
+                    if (loops > 0)
+                         continue;
+               }
+          }
+
+          if (arg[0] != '-' && !filename) {
+               filename = arg;
+               continue;
+          }
+
+          print_usage (argv[0]);
+
+          return DFB_FALSE;
+     }
+
+     if (!filename) {
+          print_usage (argv[0]);
+          return DFB_FALSE;
+     }
+
+     return DFB_TRUE;
+}
@@ -0,0 +1,366 @@
+/*
+   (c) Copyright 2012-2013  DirectFB integrated media GmbH
+   (c) Copyright 2001-2013  The world wide DirectFB Open Source Community (directfb.org)
+   (c) Copyright 2000-2004  Convergence (integrated media) GmbH
+
+   All rights reserved.
+
+   Written by Denis Oliver Kropp <dok@directfb.org>,
+              Andreas Shimokawa <andi@directfb.org>,
+              Marek Pikarski <mass@directfb.org>,
+              Sven Neumann <neo@directfb.org>,
+              Ville Syrjälä <syrjala@sci.fi> and
+              Claudio Ciccani <klan@users.sf.net>.
+
+   This file is subject to the terms and conditions of the MIT License:
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation
+   files (the "Software"), to deal in the Software without restriction,
+   including without limitation the rights to use, copy, modify, merge,
+   publish, distribute, sublicense, and/or sell copies of the Software,
+   and to permit persons to whom the Software is furnished to do so,
+   subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <directfb.h>
+
+#include <direct/clock.h>
+#include <direct/thread.h>
+
+#include <fusion/build.h>
+#include <fusion/fusion.h>
+#include <fusion/profile.h>
+
+#include <core/core.h>
+
+/**********************************************************************************************************************/
+
+#define MAX_PROFILES  256
+
+typedef struct {
+     int               num;
+     FusionCallProfile profiles[MAX_PROFILES];
+} Snapshot;
+
+/**********************************************************************************************************************/
+
+static IDirectFB *dfb;
+
+static int  show_top      = 20;
+static int  interval      = 1000;   /* milli seconds */
+static bool reset_first;
+static bool show_callers;
+
+static Snapshot snapshots[2];
+
+/**********************************************************************************************************************/
+
+static DFBBoolean parse_command_line( int argc, char *argv[] );
+
+/**********************************************************************************************************************/
+
+static bool
+snapshot_callback( const FusionCallProfile *profile,
+                   void                    *ctx )
+{
+     Snapshot *snapshot = ctx;
+
+     if (snapshot->num == MAX_PROFILES)
+          return false;
+
+     snapshot->profiles[snapshot->num++] = *profile;
+
+     return true;
+}
+
+static const FusionCallProfile *
+snapshot_find( const Snapshot          *snapshot,
+               const FusionCallProfile *profile )
+{
+     int i;
+
+     for (i=0; i<snapshot->num; i++) {
+          const FusionCallProfile *other = &snapshot->profiles[i];
+
+          if (other->call_arg == profile->call_arg && !strcmp( other->name, profile->name ))
+               return other;
+     }
+
+     return NULL;
+}
+
+/*
+ * Turns the current statistics into the difference to the previous snapshot.
+ */
+static void
+profile_delta( FusionCallProfile       *profile,
+               const FusionCallProfile *previous )
+{
+     int i, n;
+
+     if (!previous || previous->count > profile->count)
+          return;
+
+     profile->count -= previous->count;
+     profile->wait  -= previous->wait;
+     profile->time  -= previous->time;
+
+     for (i=0; i<FUSION_CALL_PROFILE_BUCKETS; i++)
+          profile->histogram[i] -= previous->histogram[i];
+
+     for (i=0; i<FUSION_CALL_PROFILE_CALLERS; i++) {
+          for (n=0; n<FUSION_CALL_PROFILE_CALLERS; n++) {
+               if (previous->callers[n].fusion_id == profile->callers[i].fusion_id) {
+                    profile->callers[i].count -= previous->callers[n].count;
+                    profile->callers[i].time  -= previous->callers[n].time;
+                    break;
+               }
+          }
+     }
+
+     profile->other_callers -= previous->other_callers;
+}
+
+static int
+compare_time( const void *a, const void *b )
+{
+     const FusionCallProfile *pa = a;
+     const FusionCallProfile *pb = b;
+
+     if (pa->time > pb->time)
+          return -1;
+
+     if (pa->time < pb->time)
+          return 1;
+
+     return 0;
+}
+
+/*
+ * Returns the upper bound in micro seconds of the histogram bucket containing the percentile.
+ */
+static unsigned long long
+profile_percentile( const FusionCallProfile *profile,
+                    unsigned int             percent )
+{
+     int                i;
+     unsigned long long sum    = 0;
+     unsigned long long target = ((unsigned long long) profile->count * percent + 99) / 100;
+
+     for (i=0; i<FUSION_CALL_PROFILE_BUCKETS-1; i++) {
+          sum += profile->histogram[i];
+
+          if (sum >= target)
+               break;
+     }
+
+     return 1ULL << i;
+}
+
+static void
+dump_profiles( Snapshot       *current,
+               const Snapshot *previous,
+               long long       elapsed )
+{
+     int      i, n;
+     Snapshot delta = *current;
+
+     for (i=0; i<delta.num; i++)
+          profile_delta( &delta.profiles[i], snapshot_find( previous, &current->profiles[i] ) );
+
+     qsort( delta.profiles, delta.num, sizeof(FusionCallProfile), compare_time );
+
+     printf( "\n----------------------------------------[ Fusion Calls (%lld ms) ]--------------------------------------------\n",
+             elapsed / 1000 );
+     printf( "Handler                                    Arg    Calls   Load  Avg.Wait  Avg.Time  Max.Time     p50     p99\n" );
+     printf( "----------------------------------------------------------------------------------------------------------------\n" );
+
+     for (i=0; i<delta.num && i<show_top; i++) {
+          const FusionCallProfile *profile = &delta.profiles[i];
+
+          if (!profile->count)
+               break;
+
+          printf( "%-40.40s %5d %8u %5.1f%% %7llu us %7llu us %7llu us %5llu us %5llu us\n",
+                  profile->name, profile->call_arg, profile->count,
+                  elapsed ? profile->time * 100.0 / elapsed : 0.0,
+                  profile->wait / profile->count, profile->time / profile->count, profile->time_max,
+                  profile_percentile( profile, 50 ), profile_percentile( profile, 99 ) );
+
+          if (show_callers) {
+               for (n=0; n<FUSION_CALL_PROFILE_CALLERS; n++) {
+                    const FusionCallProfileCaller *caller = &profile->callers[n];
+
+                    if (!caller->fusion_id || !caller->count)
+                         continue;
+
+                    printf( "    <- fusion id 0x%08lx %23u %7llu us\n",
+                            caller->fusion_id, caller->count, caller->time / caller->count );
+               }
+
+               if (profile->other_callers)
+                    printf( "    <- others %36u\n", profile->other_callers );
+          }
+     }
+}
+
+/**********************************************************************************************************************/
+
+int
+main( int argc, char *argv[] )
+{
+     DFBResult    ret;
+     FusionWorld *world;
+     int          current = 0;
+     long long    last;
+
+     /* Initialize DirectFB. */
+     ret = DirectFBInit( &argc, &argv );
+     if (ret) {
+          DirectFBError( "DirectFBInit", ret );
+          return -1;
+     }
+
+     /* Parse the command line. */
+     if (!parse_command_line( argc, argv ))
+          return -2;
+
+     /* Create the super interface. */
+     ret = DirectFBCreate( &dfb );
+     if (ret) {
+          DirectFBError( "DirectFBCreate", ret );
+          return -3;
+     }
+
+     world = dfb_core_world( NULL );
+
+     if (reset_first)
+          fusion_call_profile_reset( world );
+
+     ret = fusion_call_profile_enum( world, snapshot_callback, &snapshots[current] );
+     if (ret) {
+          if (ret == DFB_UNSUPPORTED)
+               fprintf( stderr, "Call profiling is not enabled, run the master with '--dfb:call-profile'!\n" );
+          else
+               DirectFBError( "fusion_call_profile_enum", ret );
+
+          dfb->Release( dfb );
+          return -4;
+     }
+
+     last = direct_clock_get_micros();
+
+     while (true) {
+          long long now;
+
+          direct_thread_sleep( interval * 1000LL );
+
+          current = !current;
+
+          snapshots[current].num = 0;
+
+          fusion_call_profile_enum( world, snapshot_callback, &snapshots[current] );
+
+          now = direct_clock_get_micros();
+
+          dump_profiles( &snapshots[current], &snapshots[!current], now - last );
+          fflush( stdout );
+
+          last = now;
+     }
+
+     /* DirectFB deinitialization. */
+     dfb->Release( dfb );
+
+     return 0;
+}
+
+/**********************************************************************************************************************/
+
+static void
+print_usage (const char *prg_name)
+{
+     fprintf (stderr, "\nDirectFB Fusion Call Profiler (version %s)\n\n", DIRECTFB_VERSION);
+     fprintf (stderr, "Usage: %s [options]\n\n", prg_name);
+     fprintf (stderr, "Options:\n");
+     fprintf (stderr, "   -n,  --top <num>        Show the given number of most expensive calls (default 20)\n");
+     fprintf (stderr, "   -i,  --interval <ms>    Update interval in milli seconds (default 1000)\n");
+     fprintf (stderr, "   -r,  --reset            Clear the statistics before starting\n");
+     fprintf (stderr, "   -c,  --callers          Show statistics per calling fusionee\n");
+     fprintf (stderr, "   -h,  --help             Show this help message\n");
+     fprintf (stderr, "   -v,  --version          Print version information\n");
+     fprintf (stderr, "\n");
+     fprintf (stderr, "The master has to be running with the 'call-profile' option.\n");
+     fprintf (stderr, "\n");
+}
+
+static DFBBoolean
+parse_command_line( int argc, char *argv[] )
+{
+     int n;
+
+     for (n = 1; n < argc; n++) {
+          const char *arg = argv[n];
+
+          if (strcmp (arg, "-h") == 0 || strcmp (arg, "--help") == 0) {
+               print_usage (argv[0]);
+               return DFB_FALSE;
+          }
+
+          if (strcmp (arg, "-v") == 0 || strcmp (arg, "--version") == 0) {
+               fprintf (stderr, "fusionprof version %s\n", DIRECTFB_VERSION);
+               return DFB_FALSE;
+          }
+
+          if (strcmp (arg, "-r") == 0 || strcmp (arg, "--reset") == 0) {
+               reset_first = true;
+               continue;
+          }
+
+          if (strcmp (arg, "-c") == 0 || strcmp (arg, "--callers") == 0) {
+               show_callers = true;
+               continue;
+          }
+
+          if (strcmp (arg, "-n") == 0 || strcmp (arg, "--top") == 0) {
+               if (n<argc-1) {
+                    show_top = atoi( argv[++n] );
+                    continue;
+               }
+          }
+
+          if (strcmp (arg, "-i") == 0 || strcmp (arg, "--interval") == 0) {
+               if (n<argc-1) {
+                    interval = atoi( argv[++n] );
+
+                    if (interval > 0)
+                         continue;
+               }
+          }
+
+          print_usage (argv[0]);
+
+          return DFB_FALSE;
+     }
+
+     return DFB_TRUE;
+}
+